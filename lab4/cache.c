@@ -139,6 +139,11 @@
 /* bound sqword_t/dfloat_t to positive int */
 #define BOUND_POS(N)		((int)(MIN(MAX(0, (N)), 2147483647)))
 
+/* time of a follow-on operation LAT cycles into an access made at NOW,
+   untimed accesses (NOW == 0, e.g., sim-cache) stay untimed in the write-back
+   buffer, victim cache and lower levels of the hierarchy */
+#define CACHE_LATER(now, lat)	((now) == 0 ? 0 : (now) + (lat))
+
 /* unlink BLK from the hash table bucket chain in SET */
 static void
 unlink_htab_ent(struct cache_t *cp,		/* cache to update */
@@ -256,6 +261,67 @@ update_way_list(struct cache_set_t *set,	/* set contained way chain */
     panic("bogus WHERE designator");
 }
 
+/* ECE552 Assignment 4 - BEGIN CODE */
+
+/* (re)allocate the reference prediction table of cache CP as ENTRIES
+   entries of ASSOC ways each */
+static void
+pf_alloc_rpt(struct cache_t *cp, int entries, int assoc)
+{
+  int nsets, i;
+
+  if (assoc <= 0 || (assoc & (assoc-1)) != 0)
+    fatal("RPT associativity `%d' must be a power of two", assoc);
+  nsets = entries / assoc;
+  if (nsets <= 0 || nsets * assoc != entries || (nsets & (nsets-1)) != 0)
+    fatal("RPT of `%d' entries must have a power of two number of %d-way sets",
+	  entries, assoc);
+
+  free(cp->rpt);
+  cp->rpt = calloc(entries, sizeof(struct rpt_entry));
+  if (!cp->rpt)
+    fatal("out of virtual memory, could not allocate rpt");
+  for (i=0; i<entries; i++)
+    cp->rpt[i].state = UNINITIALIZED;
+  cp->rpt_assoc = assoc;
+  cp->rpt_set_mask = nsets - 1;
+}
+
+/* (re)allocate NSTREAMS stream buffers of DEPTH blocks for cache CP */
+static void
+pf_alloc_streams(struct cache_t *cp, int nstreams, int depth)
+{
+  if (nstreams <= 0)
+    fatal("number of stream buffers `%d' must be non-zero and positive",
+	  nstreams);
+  if (depth <= 0)
+    fatal("stream buffer depth `%d' must be non-zero and positive", depth);
+
+  free(cp->streams);
+  cp->streams = calloc(nstreams, sizeof(struct stream_buf));
+  if (!cp->streams)
+    fatal("out of virtual memory, could not allocate stream buffers");
+  cp->pf_nstreams = nstreams;
+  cp->pf_stream_depth = depth;
+}
+
+/* (re)allocate a PHT_SIZE entry SMS pattern history table for cache CP */
+static void
+pf_alloc_pht(struct cache_t *cp, int pht_size)
+{
+  if (pht_size <= 0 || (pht_size & (pht_size-1)) != 0)
+    fatal("SMS pattern history table size `%d' must be a power of two",
+	  pht_size);
+
+  free(cp->sms_pht);
+  cp->sms_pht = calloc(pht_size, sizeof(struct sms_pht_entry));
+  if (!cp->sms_pht)
+    fatal("out of virtual memory, could not allocate SMS pattern history table");
+  cp->sms_pht_mask = pht_size - 1;
+}
+
+/* ECE552 Assignment 4 - END CODE */
+
 /* create and initialize a general cache structure */
 struct cache_t *			/* pointer to cache created */
 cache_create(char *name,		/* name of the cache */
@@ -295,8 +361,10 @@ cache_create(char *name,		/* name of the cache */
     fatal("cache associativity `%d' must be a power of two", assoc);
   if (!blk_access_fn)
     fatal("must specify miss/replacement functions");
-  if (prefetch_type < 0)
-    fatal("prefetcher type `%d'must be a positive number", prefetch_type);
+  if (prefetch_type < 0
+      && prefetch_type != PF_TYPE_STREAM && prefetch_type != PF_TYPE_SMS)
+    fatal("prefetcher type `%d'must be a positive number, %d (stream buffers)"
+	  " or %d (SMS)", prefetch_type, PF_TYPE_STREAM, PF_TYPE_SMS);
 
   /* allocate the cache structure */
   cp = (struct cache_t *)
@@ -306,30 +374,15 @@ cache_create(char *name,		/* name of the cache */
 
   /* ECE552 Assignment 4 - BEGIN CODE */
 	
-  // initialize the rpt
+  // initialize the rpt, direct-mapped until cache_pf_tables() says otherwise
   if (prefetch_type > 2){
-  	cp->rpt = calloc(prefetch_type, sizeof(struct rpt_entry));
-	if (!(cp->rpt)){
-		fatal("out of virtual memory, could not allocate rpt");
-	}
-	int i;
-	for (i=0;i<prefetch_type;i++){
-		cp->rpt[i].state = UNINITIALIZED; // use 0 for the initial
-		cp->rpt[i].tag = 0;
-	}
+	pf_alloc_rpt(cp, prefetch_type, 1);
   }
 
   if (prefetch_type == 2){
 	/* allocate rpt */
-  	cp->rpt = calloc(RPT_SIZE, sizeof(struct rpt_entry));
-	if (!(cp->rpt)){
-		fatal("out of virtual memory, could not allocate rpt");
-	}
+	pf_alloc_rpt(cp, RPT_SIZE, 1);
 	int i;
-	for (i=0;i<RPT_SIZE;i++){
-		cp->rpt[i].state = UNINITIALIZED; // use 0 for the initial
-		cp->rpt[i].tag = 0; 
-	}
 	/* allocate miss queue */
 	cp->miss_queue = calloc(MISS_QUEUE_SIZE, sizeof(md_addr_t));
 	for (i=0;i<MISS_QUEUE_SIZE;i++){
@@ -339,6 +392,41 @@ cache_create(char *name,		/* name of the cache */
 	cp->queue_size = 0;
   }
 
+  /* track blocks evicted by prefetches, to measure cache pollution */
+  cp->pf_src = PF_NONE;
+  if (prefetch_type != 0){
+	cp->pf_victims = calloc(nsets * assoc, sizeof(struct pf_victim));
+	if (!(cp->pf_victims)){
+		fatal("out of virtual memory, could not allocate prefetch victims");
+	}
+	cp->pf_victims_mask = nsets * assoc - 1;
+
+	/* prefetch request queue, by default one prefetch per trigger at the
+	   next block or stride, see cache_pf_config() */
+	cp->pf_queue_size = PF_QUEUE_SIZE;
+	cp->pf_queue = calloc(cp->pf_queue_size, sizeof(struct pf_request));
+	if (!(cp->pf_queue)){
+		fatal("out of virtual memory, could not allocate prefetch queue");
+	}
+	cp->pf_distance = 1;
+	cp->pf_degree = 1;
+  }
+
+  /* stream buffers and the SMS tables, see cache_pf_tables() for sizing */
+  if (prefetch_type == PF_TYPE_STREAM){
+	pf_alloc_streams(cp, PF_NUM_STREAMS, PF_STREAM_DEPTH);
+  }
+  if (prefetch_type == PF_TYPE_SMS){
+	cp->sms_agt = calloc(SMS_AGT_SIZE, sizeof(struct sms_agt_entry));
+	if (!(cp->sms_agt)){
+		fatal("out of virtual memory, could not allocate SMS generation table");
+	}
+	for (cp->sms_region_shift = 0;
+	     (1 << cp->sms_region_shift) < bsize * SMS_REGION_BLKS;
+	     cp->sms_region_shift++);
+	pf_alloc_pht(cp, SMS_PHT_SIZE);
+  }
+
   /* ECE552 Assignment 4 - END CODE */
 
   /* initialize user parameters */
@@ -428,6 +516,7 @@ cache_create(char *name,		/* name of the cache */
 	  blk->status = 0;		
 	  blk->tag = 0;
 	  blk->ready = 0;
+	  blk->pf_src = PF_NONE;
 	  blk->user_data = (usize != 0
 			    ? (byte_t *)calloc(usize, sizeof(byte_t)) : NULL);
 
@@ -448,6 +537,486 @@ cache_create(char *name,		/* name of the cache */
   return cp;
 }
 
+/* ECE552 Assignment 4 - BEGIN CODE */
+
+/* prefetch aggressiveness levels used by the feedback loop */
+static struct {
+  int distance;		/* blocks (or strides) ahead of the trigger */
+  int degree;		/* prefetches per trigger */
+} pf_levels[PF_NUM_LEVELS] = {
+  { 1, 1 }, { 1, 2 }, { 2, 2 }, { 4, 4 }, { 8, 4 }
+};
+
+static void
+pf_set_level(struct cache_t *cp, int level)
+{
+  cp->pf_level = level;
+  cp->pf_distance = pf_levels[level].distance;
+  cp->pf_degree = pf_levels[level].degree;
+}
+
+/* configure the prefetch request queue of cache CP to hold QUEUE_SIZE
+   requests, and enable feedback-directed degree/distance control if
+   FEEDBACK is non-zero */
+void
+cache_pf_config(struct cache_t *cp,	/* cache instance */
+		int queue_size,		/* prefetch queue entries */
+		int feedback)		/* enable prefetch feedback? */
+{
+  if (!cp->prefetch_type)
+    return;
+
+  if (queue_size <= 0)
+    fatal("prefetch queue size `%d' must be non-zero and positive",
+	  queue_size);
+  if (cp->pf_queue_num)
+    panic("prefetch queue reconfigured while in use");
+
+  free(cp->pf_queue);
+  cp->pf_queue_size = queue_size;
+  cp->pf_queue = calloc(queue_size, sizeof(struct pf_request));
+  if (!cp->pf_queue)
+    fatal("out of virtual memory, could not allocate prefetch queue");
+  cp->pf_queue_head = 0;
+
+  /* feedback starts from the middle level, otherwise the prefetchers keep
+     their classic one-block (or one-stride) lookahead */
+  cp->pf_feedback = feedback;
+  pf_set_level(cp, feedback ? PF_NUM_LEVELS/2 : 0);
+}
+
+/* let the core's fetch-directed prefetcher prefetch into cache CP, its
+   fills are accounted to the PF_FETCH source */
+void
+cache_pf_fetch_enable(struct cache_t *cp)/* cache instance */
+{
+  cp->pf_fetch = TRUE;
+
+  /* pollution is tracked for these fills too */
+  if (!cp->pf_victims)
+    {
+      cp->pf_victims =
+	calloc(cp->nsets * cp->assoc, sizeof(struct pf_victim));
+      if (!cp->pf_victims)
+	fatal("out of virtual memory, could not allocate prefetch victims");
+      cp->pf_victims_mask = cp->nsets * cp->assoc - 1;
+    }
+}
+
+/* fetch-directed prefetch of the block holding ADDR into cache CP at time
+   NOW, returns non-zero if a fill was issued, zero if the block is present */
+int
+cache_pf_fetch(struct cache_t *cp,	/* cache instance */
+	       md_addr_t addr,		/* address to prefetch */
+	       tick_t now)		/* time of prefetch */
+{
+  md_addr_t baddr = CACHE_BADDR(cp, addr);
+
+  if (cache_probe(cp, baddr))
+    return FALSE;
+
+  cp->pf_src = PF_FETCH;
+  cache_access(cp, Read, baddr, NULL, cp->bsize, now, NULL, NULL,
+	       /* prefetch */1);
+  cp->pf_src = PF_NONE;
+  return TRUE;
+}
+
+/* size the reference prediction table (RPT_ASSOC ways), the stream buffers
+   (NSTREAMS streams of DEPTH blocks) or the SMS pattern history table
+   (PHT_SIZE entries) of cache CP, whichever its prefetcher uses */
+void
+cache_pf_tables(struct cache_t *cp,	/* cache instance */
+		int nstreams,		/* stream buffers */
+		int depth,		/* blocks ahead per stream buffer */
+		int pht_size,		/* SMS pattern history table entries */
+		int rpt_assoc)		/* RPT associativity */
+{
+  if (cp->prefetch_type == 2)
+    pf_alloc_rpt(cp, RPT_SIZE, rpt_assoc);
+  else if (cp->prefetch_type > 2)
+    pf_alloc_rpt(cp, cp->prefetch_type, rpt_assoc);
+  else if (cp->prefetch_type == PF_TYPE_STREAM)
+    pf_alloc_streams(cp, nstreams, depth);
+  else if (cp->prefetch_type == PF_TYPE_SMS)
+    pf_alloc_pht(cp, pht_size);
+}
+
+/* ECE552 Assignment 4 - END CODE */
+
+/* give cache CP a file of NENTRIES miss status holding registers, each
+   merging up to NTARGETS accesses to the block it is filling, zero entries
+   leaves the cache with unlimited outstanding misses */
+void
+cache_mshr_config(struct cache_t *cp,	/* cache instance */
+		  int nentries,		/* MSHR entries */
+		  int ntargets)		/* targets per entry */
+{
+  if (nentries < 0)
+    fatal("MSHR entries `%d' must be zero or positive", nentries);
+  if (nentries > 0 && ntargets <= 0)
+    fatal("MSHR targets `%d' must be non-zero and positive", ntargets);
+
+  free(cp->mshrs);
+  cp->mshrs = NULL;
+  cp->mshr_nentries = nentries;
+  cp->mshr_ntargets = ntargets;
+  if (nentries > 0)
+    {
+      cp->mshrs = calloc(nentries, sizeof(struct cache_mshr));
+      if (!cp->mshrs)
+	fatal("out of virtual memory");
+    }
+}
+
+/* find the MSHR filling block BADDR at time NOW, NULL if none is */
+static struct cache_mshr *
+mshr_lookup(struct cache_t *cp, md_addr_t baddr, tick_t now)
+{
+  int i;
+
+  for (i=0; i < cp->mshr_nentries; i++)
+    {
+      if (cp->mshrs[i].ready > now && cp->mshrs[i].baddr == baddr)
+	return &cp->mshrs[i];
+    }
+  return NULL;
+}
+
+/* return the MSHR that frees up first, it is free now if its ready time
+   has passed */
+static struct cache_mshr *
+mshr_next_free(struct cache_t *cp)
+{
+  struct cache_mshr *mshr = &cp->mshrs[0];
+  int i;
+
+  for (i=1; i < cp->mshr_nentries; i++)
+    {
+      if (cp->mshrs[i].ready < mshr->ready)
+	mshr = &cp->mshrs[i];
+    }
+  return mshr;
+}
+
+/* an access at NOW hit block BADDR while its fill, completing at READY, is
+   still outstanding; merge the access into the fill's MSHR or, when no
+   target is free, replay it after the fill completes, returns the latency
+   of the access */
+static unsigned int
+mshr_merge(struct cache_t *cp, md_addr_t baddr, tick_t ready, tick_t now)
+{
+  struct cache_mshr *mshr = mshr_lookup(cp, baddr, now);
+
+  if (!mshr || mshr->ntargets < cp->mshr_ntargets)
+    {
+      if (mshr)
+	{
+	  mshr->ntargets++;
+	  cp->mshr_merges++;
+	}
+      return MAX(cp->hit_latency, ready - now);
+    }
+
+  cp->mshr_target_stalls++;
+  cp->mshr_stall_cycles += ready - now;
+  return (ready - now) + cp->hit_latency;
+}
+
+/* return non-zero if an access to ADDR at time NOW would be accepted
+   without waiting for an MSHR, i.e., the block is present and not being
+   filled, its fill can take another target, or an MSHR is free */
+int
+cache_mshr_avail(struct cache_t *cp,	/* cache instance */
+		 md_addr_t addr,	/* address of access */
+		 tick_t now)		/* time of access */
+{
+  struct cache_mshr *mshr;
+
+  if (!cp->mshrs || now == 0)
+    return TRUE;
+
+  mshr = mshr_lookup(cp, CACHE_BADDR(cp, addr), now);
+  if (mshr)
+    return mshr->ntargets < cp->mshr_ntargets;
+  if (cache_probe(cp, addr))
+    return TRUE;
+  return mshr_next_free(cp)->ready <= now;
+}
+
+/* return the earliest time after NOW at which an MSHR of cache CP completes
+   its fill, zero if none is outstanding */
+tick_t
+cache_mshr_next_ready(struct cache_t *cp,	/* cache instance */
+		      tick_t now)		/* current time */
+{
+  tick_t next = 0;
+  int i;
+
+  for (i=0; i < cp->mshr_nentries; i++)
+    {
+      if (cp->mshrs[i].ready > now
+	  && (!next || cp->mshrs[i].ready < next))
+	next = cp->mshrs[i].ready;
+    }
+  return next;
+}
+
+/* give cache CP a write-back buffer of NENTRIES dirty blocks that drains
+   to the next level of memory whenever the bus is free, zero entries
+   writes dirty evictions back inline */
+void
+cache_wbb_config(struct cache_t *cp,	/* cache instance */
+		 int nentries)		/* write-back buffer entries */
+{
+  if (nentries < 0)
+    fatal("write-back buffer entries `%d' must be zero or positive",
+	  nentries);
+  if (cp->wbb_num)
+    panic("write-back buffer reconfigured while in use");
+
+  free(cp->wbb);
+  cp->wbb = NULL;
+  cp->wbb_size = nentries;
+  cp->wbb_head = 0;
+  if (nentries > 0)
+    {
+      cp->wbb = calloc(nentries, sizeof(struct cache_wb_entry));
+      if (!cp->wbb)
+	fatal("out of virtual memory");
+    }
+}
+
+/* give cache CP a fully-associative victim cache of NENTRIES blocks that
+   catches its evictions, zero entries for no victim cache */
+void
+cache_vc_config(struct cache_t *cp,	/* cache instance */
+		int nentries)		/* victim cache entries */
+{
+  if (nentries < 0)
+    fatal("victim cache entries `%d' must be zero or positive", nentries);
+  if (nentries > 0 && cp->balloc)
+    fatal("cache `%s' allocates block data, victim caches hold tags only",
+	  cp->name);
+
+  free(cp->vc);
+  cp->vc = NULL;
+  cp->vc_size = nentries;
+  cp->vc_num = 0;
+  if (nentries > 0)
+    {
+      cp->vc = calloc(nentries, sizeof(struct cache_vc_entry));
+      if (!cp->vc)
+	fatal("out of virtual memory");
+    }
+}
+
+/* make cache UPPER miss into cache LOWER under inclusion policy POLICY,
+   all the caches above LOWER share its policy; exclusion needs equal
+   block sizes, inclusion an upper block no bigger than the lower block */
+void
+cache_inclusion_config(struct cache_t *lower,	/* cache below */
+		       struct cache_t *upper,	/* cache above */
+		       enum cache_inclusion policy) /* inclusion policy */
+{
+  if (lower == upper)
+    panic("cache `%s' cannot sit above itself", lower->name);
+  if (lower->nuppers > 0 && lower->inclusion != policy)
+    fatal("the caches above `%s' must share one inclusion policy",
+	  lower->name);
+  if (lower->nuppers == CACHE_MAX_UPPERS)
+    fatal("more than %d caches above `%s'", CACHE_MAX_UPPERS, lower->name);
+  if (policy == Inclusive && upper->bsize > lower->bsize)
+    fatal("inclusive cache `%s' needs blocks at least as big as `%s'",
+	  lower->name, upper->name);
+  if (policy == Exclusive && upper->bsize != lower->bsize)
+    fatal("exclusive cache `%s' needs the block size of `%s'",
+	  lower->name, upper->name);
+  if (policy == Exclusive && lower->balloc)
+    fatal("cache `%s' allocates block data, exclusive caches hold tags only",
+	  lower->name);
+
+  lower->inclusion = policy;
+  lower->uppers[lower->nuppers++] = upper;
+  if (policy == Exclusive)
+    upper->excl_lower = lower;
+}
+
+/* issue the buffered writes of cache CP that the bus allows by time NOW, a
+   write leaves the buffer once the bus is free and it has been buffered,
+   and holds the bus for a cycle; untimed accesses (NOW == 0) drain the
+   buffer completely */
+static void
+wbb_drain(struct cache_t *cp, tick_t now)
+{
+  struct cache_wb_entry *wb;
+  tick_t when;
+
+  while (cp->wbb_num > 0)
+    {
+      wb = &cp->wbb[cp->wbb_head];
+      when = now == 0 ? 0 : MAX(cp->bus_free, wb->when);
+      if (when > now)
+	break;
+
+      /* NOTE: buffered writes carry no block, access functions only use it
+	 for reads */
+      cp->blk_access_fn(Write, wb->baddr, cp->bsize, NULL, when, 0);
+      if (now != 0)
+	cp->bus_free = when + 1;
+      cp->wbb_head = (cp->wbb_head + 1) % cp->wbb_size;
+      cp->wbb_num--;
+    }
+}
+
+/* put dirty block BADDR in the write-back buffer at time NOW, returns the
+   time spent waiting for the oldest write to drain if the buffer is full */
+static unsigned int
+wbb_insert(struct cache_t *cp, md_addr_t baddr, tick_t now)
+{
+  struct cache_wb_entry *wb;
+  tick_t when;
+  int lat = 0;
+
+  wbb_drain(cp, now);
+  if (cp->wbb_num == cp->wbb_size)
+    {
+      wb = &cp->wbb[cp->wbb_head];
+      when = MAX(cp->bus_free, wb->when);
+      cp->wbb_full_stalls++;
+      lat = when - now;
+      wbb_drain(cp, when);
+    }
+
+  cp->wbb_occupancy += cp->wbb_num;
+  cp->wbb_writes++;
+  wb = &cp->wbb[(cp->wbb_head + cp->wbb_num) % cp->wbb_size];
+  wb->baddr = baddr;
+  wb->when = now + lat;
+  cp->wbb_num++;
+
+  /* untimed accesses write straight through the buffer */
+  if (now == 0)
+    wbb_drain(cp, 0);
+
+  return lat;
+}
+
+/* remove block BADDR from the write-back buffer, returns non-zero if the
+   block was buffered */
+static int
+wbb_remove(struct cache_t *cp, md_addr_t baddr)
+{
+  int i, j;
+
+  for (i=0; i < cp->wbb_num; i++)
+    {
+      if (cp->wbb[(cp->wbb_head + i) % cp->wbb_size].baddr == baddr)
+	{
+	  /* close the gap, younger writes move up one entry */
+	  for (j=i+1; j < cp->wbb_num; j++)
+	    cp->wbb[(cp->wbb_head + j - 1) % cp->wbb_size] =
+	      cp->wbb[(cp->wbb_head + j) % cp->wbb_size];
+	  cp->wbb_num--;
+	  return TRUE;
+	}
+    }
+  return FALSE;
+}
+
+/* write dirty block BADDR (held in BLK, if not NULL) back to the next level
+   of memory at time NOW, through the write-back buffer if there is one,
+   returns the latency seen by the cache */
+static unsigned int
+cache_writeback(struct cache_t *cp, md_addr_t baddr,
+		struct cache_blk_t *blk, tick_t now)
+{
+  cp->writebacks++;
+  if (cp->wbb)
+    return wbb_insert(cp, baddr, now);
+  return cp->blk_access_fn(Write, baddr, cp->bsize, blk, now, 0);
+}
+
+/* find block BADDR in the victim cache, NULL if it is not there */
+static struct cache_vc_entry *
+vc_find(struct cache_t *cp, md_addr_t baddr)
+{
+  int i;
+
+  for (i=0; i < cp->vc_size; i++)
+    {
+      if (cp->vc[i].valid && cp->vc[i].baddr == baddr)
+	return &cp->vc[i];
+    }
+  return NULL;
+}
+
+/* a miss looks for block BADDR in the victim cache, returns non-zero if it
+   was found, and removed, and sets *DIRTY to the dirty status of the block */
+static int
+vc_remove(struct cache_t *cp, md_addr_t baddr, int *dirty)
+{
+  struct cache_vc_entry *ent = vc_find(cp, baddr);
+
+  cp->vc_lookups++;
+  cp->vc_occupancy += cp->vc_num;
+  if (!ent)
+    return FALSE;
+
+  ent->valid = FALSE;
+  cp->vc_num--;
+  cp->vc_hits++;
+  *dirty = ent->dirty;
+  return TRUE;
+}
+
+static void
+cache_excl_fill(struct cache_t *cp, md_addr_t baddr, int dirty, tick_t now);
+
+/* put block BADDR, evicted from the cache at time NOW, in the victim cache,
+   the oldest victim is written back if dirty, or handed to the exclusive
+   cache below dirty or not, returns the latency of the write back */
+static unsigned int
+vc_insert(struct cache_t *cp, md_addr_t baddr, int dirty, tick_t now)
+{
+  struct cache_vc_entry *ent = NULL;
+  unsigned int lat = 0;
+  int i;
+
+  for (i=0; i < cp->vc_size; i++)
+    {
+      if (!cp->vc[i].valid)
+	{
+	  ent = &cp->vc[i];
+	  break;
+	}
+      if (!ent || cp->vc[i].stamp < ent->stamp)
+	ent = &cp->vc[i];
+    }
+
+  if (ent->valid)
+    {
+      if (cp->excl_lower)
+	{
+	  /* clean victims too, or the block leaves the hierarchy */
+	  if (ent->dirty)
+	    cp->writebacks++;
+	  cache_excl_fill(cp->excl_lower, ent->baddr, ent->dirty, now);
+	}
+      else if (ent->dirty)
+	lat = cache_writeback(cp, ent->baddr, NULL, now);
+    }
+  else
+    cp->vc_num++;
+
+  ent->baddr = baddr;
+  ent->valid = TRUE;
+  ent->dirty = dirty;
+  ent->stamp = ++cp->vc_clock;
+  cp->vc_insertions++;
+  return lat;
+}
+
 /* parse policy */
 enum cache_policy			/* replacement policy enum */
 cache_char2policy(char c)		/* replacement policy as a char */
@@ -460,6 +1029,20 @@ cache_char2policy(char c)		/* replacement policy as a char */
   }
 }
 
+/* parse inclusion policy */
+enum cache_inclusion			/* inclusion policy enum */
+cache_str2inclusion(char *s)		/* inclusion policy as a string */
+{
+  if (!mystricmp(s, "nine"))
+    return NINE;
+  else if (!mystricmp(s, "inclusive"))
+    return Inclusive;
+  else if (!mystricmp(s, "exclusive"))
+    return Exclusive;
+  fatal("bogus inclusion policy, `%s'", s);
+  return NINE;
+}
+
 /* print cache configuration */
 void
 cache_config(struct cache_t *cp,	/* cache instance */
@@ -476,8 +1059,110 @@ cache_config(struct cache_t *cp,	/* cache instance */
 	  : cp->policy == FIFO ? "FIFO"
 	  : (abort(), ""),
 	  cp->prefetch_type);
+  if (cp->nuppers)
+    fprintf(stream,
+	    "cache: %s: `%s' inclusion of %d cache(s) above\n",
+	    cp->name,
+	    cp->inclusion == NINE ? "NINE"
+	    : cp->inclusion == Inclusive ? "inclusive"
+	    : cp->inclusion == Exclusive ? "exclusive"
+	    : (abort(), ""),
+	    cp->nuppers);
+}
+
+/* ECE552 Assignment 4 - BEGIN CODE */
+
+/* register the accounting of prefetcher SRC (called SRCNAME) of cache CP */
+static void
+pf_reg_stats(struct cache_t *cp, struct stat_sdb_t *sdb, char *name,
+	     int src, char *srcname)
+{
+  char buf[512], buf1[512], pfx[128];
+  struct pf_stats_t *ps = &cp->pf_stats[src];
+
+  sprintf(pfx, "%s.pf_%s", name, srcname);
+
+  sprintf(buf, "%s.issued", pfx);
+  stat_reg_counter(sdb, buf, "prefetch fills issued", &ps->issued, 0, NULL);
+  sprintf(buf, "%s.useful", pfx);
+  stat_reg_counter(sdb, buf, "prefetched blocks used by a demand access",
+		   &ps->useful, 0, NULL);
+  sprintf(buf, "%s.late", pfx);
+  stat_reg_counter(sdb, buf,
+		   "useful prefetches demanded before the fill completed",
+		   &ps->late, 0, NULL);
+  sprintf(buf, "%s.useless", pfx);
+  stat_reg_counter(sdb, buf, "prefetched blocks evicted before any use",
+		   &ps->useless, 0, NULL);
+  sprintf(buf, "%s.pollution", pfx);
+  stat_reg_counter(sdb, buf, "demand misses to blocks evicted by a prefetch",
+		   &ps->pollution, 0, NULL);
+  sprintf(buf, "%s.accuracy", pfx);
+  sprintf(buf1, "%s.useful / %s.issued", pfx, pfx);
+  stat_reg_formula(sdb, buf, "prefetch accuracy (i.e., useful/issued)",
+		   buf1, NULL);
+  sprintf(buf, "%s.coverage", pfx);
+  sprintf(buf1, "%s.useful / (%s.useful + %s.misses)", pfx, pfx, name);
+  stat_reg_formula(sdb, buf,
+		   "prefetch coverage (i.e., useful/(useful+misses))",
+		   buf1, NULL);
+  sprintf(buf, "%s.late_rate", pfx);
+  sprintf(buf1, "%s.late / %s.useful", pfx, pfx);
+  stat_reg_formula(sdb, buf, "fraction of useful prefetches that were late",
+		   buf1, NULL);
 }
 
+/* register the reference prediction table stats of cache CP */
+static void
+rpt_reg_stats(struct cache_t *cp, struct stat_sdb_t *sdb, char *name)
+{
+  char buf[512], buf1[512];
+
+  sprintf(buf, "%s.rpt.hits", name);
+  stat_reg_counter(sdb, buf, "RPT lookups that found the PC", &cp->rpt_hits,
+		   0, NULL);
+  sprintf(buf, "%s.rpt.misses", name);
+  stat_reg_counter(sdb, buf, "RPT lookups that allocated an entry",
+		   &cp->rpt_misses, 0, NULL);
+  sprintf(buf, "%s.rpt.evictions", name);
+  stat_reg_counter(sdb, buf, "RPT entries replaced by another PC",
+		   &cp->rpt_evictions, 0, NULL);
+  sprintf(buf, "%s.rpt.hit_rate", name);
+  sprintf(buf1, "%s.rpt.hits / (%s.rpt.hits + %s.rpt.misses)",
+	  name, name, name);
+  stat_reg_formula(sdb, buf, "RPT hit rate (i.e., hits/lookups)", buf1, NULL);
+}
+
+/* a demand access found block BLK, retire its prefetched-not-used bit,
+   untimed simulators (e.g., sim-cache) access the caches at time 0 where
+   timeliness is undefined, so lateness is only counted when NOW is set */
+#define PF_DEMAND_USE(cp, blk, now)					\
+  do {									\
+    if ((blk)->status & CACHE_BLK_PREFETCHED)				\
+      {									\
+	(blk)->status &= ~CACHE_BLK_PREFETCHED;				\
+	(cp)->pf_stats[(blk)->pf_src].useful++;				\
+	if ((now) != 0 && (blk)->ready > (now))				\
+	  (cp)->pf_stats[(blk)->pf_src].late++;				\
+      }									\
+  } while (0)
+
+/* block BLK is leaving the cache, count it if it was never used */
+#define PF_DISCARD(cp, blk)						\
+  do {									\
+    if ((blk)->status & CACHE_BLK_PREFETCHED)				\
+      (cp)->pf_stats[(blk)->pf_src].useless++;				\
+  } while (0)
+
+/* block BADDR is leaving the cache, end the SMS generation of its region */
+#define PF_EVICT(cp, baddr)						\
+  do {									\
+    if ((cp)->sms_agt)							\
+      sms_evict((cp), (baddr));						\
+  } while (0)
+
+/* ECE552 Assignment 4 - END CODE */
+
 /* register cache stats */
 void
 cache_reg_stats(struct cache_t *cp,	/* cache instance */
@@ -539,34 +1224,298 @@ cache_reg_stats(struct cache_t *cp,	/* cache instance */
   sprintf(buf, "%s.prefetch_misses", name);
   stat_reg_counter(sdb, buf, "total number of prefetch misses", &cp->prefetch_misses, 0, NULL);
 
+  if (cp->wbb)
+    {
+      sprintf(buf, "%s.wbb.writes", name);
+      stat_reg_counter(sdb, buf, "writes entering the write-back buffer",
+		       &cp->wbb_writes, 0, NULL);
+      sprintf(buf, "%s.wbb.hits", name);
+      stat_reg_counter(sdb, buf, "misses served from the write-back buffer",
+		       &cp->wbb_hits, 0, NULL);
+      sprintf(buf, "%s.wbb.full_stalls", name);
+      stat_reg_counter(sdb, buf, "writes that waited on a full buffer",
+		       &cp->wbb_full_stalls, 0, NULL);
+      sprintf(buf, "%s.wbb.occupancy", name);
+      stat_reg_counter(sdb, buf, "cumulative buffer occupancy at writes",
+		       &cp->wbb_occupancy, 0, NULL);
+      sprintf(buf, "%s.wbb.avg_occupancy", name);
+      sprintf(buf1, "%s.wbb.occupancy / %s.wbb.writes", name, name);
+      stat_reg_formula(sdb, buf, "average write-back buffer occupancy",
+		       buf1, NULL);
+    }
+
+  if (cp->vc)
+    {
+      sprintf(buf, "%s.vc.lookups", name);
+      stat_reg_counter(sdb, buf, "misses that searched the victim cache",
+		       &cp->vc_lookups, 0, NULL);
+      sprintf(buf, "%s.vc.hits", name);
+      stat_reg_counter(sdb, buf, "misses served from the victim cache",
+		       &cp->vc_hits, 0, NULL);
+      sprintf(buf, "%s.vc.insertions", name);
+      stat_reg_counter(sdb, buf, "evicted blocks put in the victim cache",
+		       &cp->vc_insertions, 0, NULL);
+      sprintf(buf, "%s.vc.hit_rate", name);
+      sprintf(buf1, "%s.vc.hits / %s.vc.lookups", name, name);
+      stat_reg_formula(sdb, buf, "victim cache hit rate (i.e., hits/lookups)",
+		       buf1, NULL);
+      sprintf(buf, "%s.vc.occupancy", name);
+      stat_reg_counter(sdb, buf,
+		       "cumulative victim cache occupancy at lookups",
+		       &cp->vc_occupancy, 0, NULL);
+      sprintf(buf, "%s.vc.avg_occupancy", name);
+      sprintf(buf1, "%s.vc.occupancy / %s.vc.lookups", name, name);
+      stat_reg_formula(sdb, buf, "average victim cache occupancy",
+		       buf1, NULL);
+    }
+
+  if (cp->nuppers)
+    {
+      if (cp->inclusion == Inclusive)
+	{
+	  sprintf(buf, "%s.back_invals", name);
+	  stat_reg_counter(sdb, buf, "blocks above invalidated by evictions",
+			   &cp->back_invals, 0, NULL);
+	  sprintf(buf, "%s.back_inval_dirty", name);
+	  stat_reg_counter(sdb, buf, "back-invalidated blocks that were dirty",
+			   &cp->back_inval_dirty, 0, NULL);
+	}
+      if (cp->inclusion == Exclusive)
+	{
+	  sprintf(buf, "%s.excl_fills", name);
+	  stat_reg_counter(sdb, buf, "blocks evicted above and filled here",
+			   &cp->excl_fills, 0, NULL);
+	  sprintf(buf, "%s.excl_moves", name);
+	  stat_reg_counter(sdb, buf, "hits that moved the block above",
+			   &cp->excl_moves, 0, NULL);
+	}
+      sprintf(buf, "%s.cap_samples", name);
+      stat_reg_counter(sdb, buf, "effective capacity samples",
+		       &cp->cap_samples, 0, NULL);
+      sprintf(buf, "%s.cap_bytes", name);
+      stat_reg_counter(sdb, buf,
+		       "cumulative distinct bytes held here and above",
+		       &cp->cap_bytes, 0, NULL);
+      sprintf(buf, "%s.eff_capacity", name);
+      sprintf(buf1, "%s.cap_bytes / %s.cap_samples", name, name);
+      stat_reg_formula(sdb, buf,
+		       "average distinct bytes held here and above",
+		       buf1, NULL);
+      sprintf(buf, "%s.eff_capacity_ratio", name);
+      sprintf(buf1, "%s.eff_capacity / %d", name,
+	      cp->nsets * cp->assoc * cp->bsize);
+      stat_reg_formula(sdb, buf,
+		       "effective capacity relative to the size of this cache",
+		       buf1, NULL);
+    }
+
+  if (cp->mshrs)
+    {
+      sprintf(buf, "%s.mshr.allocs", name);
+      stat_reg_counter(sdb, buf, "misses that allocated an MSHR",
+		       &cp->mshr_allocs, 0, NULL);
+      sprintf(buf, "%s.mshr.merges", name);
+      stat_reg_counter(sdb, buf, "secondary misses merged into an MSHR",
+		       &cp->mshr_merges, 0, NULL);
+      sprintf(buf, "%s.mshr.full_stalls", name);
+      stat_reg_counter(sdb, buf, "misses that waited for a free MSHR",
+		       &cp->mshr_full_stalls, 0, NULL);
+      sprintf(buf, "%s.mshr.target_stalls", name);
+      stat_reg_counter(sdb, buf,
+		       "secondary misses replayed for lack of a target",
+		       &cp->mshr_target_stalls, 0, NULL);
+      sprintf(buf, "%s.mshr.stall_cycles", name);
+      stat_reg_counter(sdb, buf, "cycles accesses waited on MSHRs",
+		       &cp->mshr_stall_cycles, 0, NULL);
+    }
+
+  /* ECE552 Assignment 4 - BEGIN CODE */
+  switch (cp->prefetch_type) {
+	case 0:
+		break;
+	case 1:
+		pf_reg_stats(cp, sdb, name, PF_NEXT_LINE, "next_line");
+		break;
+	case 2:
+		pf_reg_stats(cp, sdb, name, PF_STRIDE, "stride");
+		pf_reg_stats(cp, sdb, name, PF_CORRELATION, "correlation");
+		rpt_reg_stats(cp, sdb, name);
+		break;
+	case PF_TYPE_STREAM:
+		pf_reg_stats(cp, sdb, name, PF_STREAM, "stream");
+		sprintf(buf, "%s.pf_stream.allocs", name);
+		stat_reg_counter(sdb, buf, "stream buffers allocated on a miss",
+				 &cp->pf_stream_allocs, 0, NULL);
+		break;
+	case PF_TYPE_SMS:
+		pf_reg_stats(cp, sdb, name, PF_SMS, "sms");
+		sprintf(buf, "%s.pf_sms.generations", name);
+		stat_reg_counter(sdb, buf, "spatial region generations recorded",
+				 &cp->sms_generations, 0, NULL);
+		sprintf(buf, "%s.pf_sms.triggers", name);
+		stat_reg_counter(sdb, buf,
+				 "trigger accesses with a recorded pattern",
+				 &cp->sms_triggers, 0, NULL);
+		break;
+	default:
+		pf_reg_stats(cp, sdb, name, PF_STRIDE, "stride");
+		rpt_reg_stats(cp, sdb, name);
+  }
+
+  if (cp->pf_fetch)
+    pf_reg_stats(cp, sdb, name, PF_FETCH, "fetch");
+
+  if (cp->prefetch_type) {
+	sprintf(buf, "%s.pf_queue.enqueued", name);
+	stat_reg_counter(sdb, buf, "prefetch requests queued",
+			 &cp->pf_enqueued, 0, NULL);
+	sprintf(buf, "%s.pf_queue.filtered", name);
+	stat_reg_counter(sdb, buf,
+			 "prefetch requests filtered (present or duplicate)",
+			 &cp->pf_filtered, 0, NULL);
+	sprintf(buf, "%s.pf_queue.dropped", name);
+	stat_reg_counter(sdb, buf, "prefetch requests dropped on a full queue",
+			 &cp->pf_dropped, 0, NULL);
+	if (cp->pf_feedback) {
+		sprintf(buf, "%s.pf_level", name);
+		stat_reg_int(sdb, buf, "final prefetch aggressiveness level",
+			     &cp->pf_level, 0, NULL);
+		sprintf(buf, "%s.pf_level_ups", name);
+		stat_reg_counter(sdb, buf, "prefetch aggressiveness increases",
+				 &cp->pf_level_ups, 0, NULL);
+		sprintf(buf, "%s.pf_level_downs", name);
+		stat_reg_counter(sdb, buf, "prefetch aggressiveness decreases",
+				 &cp->pf_level_downs, 0, NULL);
+	}
+  }
+  /* ECE552 Assignment 4 - END CODE */
 
 }
 
 /* ECE552 Assignment 4 - BEGIN CODE */
 
-void prefetch(struct cache_t *cp, md_addr_t addr){
-	md_addr_t set = CACHE_SET(cp, addr);
-	md_addr_t tag = CACHE_TAG(cp, addr);
-	md_addr_t baddr = CACHE_MK_BADDR(cp, tag, set);
+/* feedback thresholds, per interval of PF_FB_INTERVAL prefetch fills */
+#define PF_FB_ACC_LOW	0.40	/* below this accuracy, back off */
+#define PF_FB_LATE	0.10	/* above this late fraction, get ahead */
+
+/* at the end of each feedback interval, raise the prefetch degree and
+   distance if accurate prefetches arrive late, lower them if prefetches are
+   inaccurate or pollute the cache more than they help */
+static void
+pf_feedback(struct cache_t *cp)
+{
+	struct pf_stats_t tot;
+	counter_t issued, useful, late, pollution;
+	int i;
+
+	tot.issued = tot.useful = tot.late = tot.pollution = 0;
+	for (i=0;i<PF_NUM_SOURCES;i++){
+		tot.issued += cp->pf_stats[i].issued;
+		tot.useful += cp->pf_stats[i].useful;
+		tot.late += cp->pf_stats[i].late;
+		tot.pollution += cp->pf_stats[i].pollution;
+	}
+	issued = tot.issued - cp->pf_interval.issued;
+	if (issued < PF_FB_INTERVAL){
+		return;
+	}
+	useful = tot.useful - cp->pf_interval.useful;
+	late = tot.late - cp->pf_interval.late;
+	pollution = tot.pollution - cp->pf_interval.pollution;
+	cp->pf_interval = tot;
+
+	if ((double)useful / issued < PF_FB_ACC_LOW || pollution * 4 > useful){
+		if (cp->pf_level > 0){
+			pf_set_level(cp, cp->pf_level - 1);
+			cp->pf_level_downs++;
+		}
+	}
+	else if (useful && (double)late / useful > PF_FB_LATE){
+		if (cp->pf_level < PF_NUM_LEVELS - 1){
+			pf_set_level(cp, cp->pf_level + 1);
+			cp->pf_level_ups++;
+		}
+	}
+}
+
+/* issue queued prefetches while the bus to the next level is free, each
+   prefetch holds the bus for at least a cycle; untimed simulators access the
+   caches at time 0 and have no bus to wait for, so the queue drains fully */
+static void
+pf_drain(struct cache_t *cp, tick_t now)
+{
+	md_addr_t baddr;
+	int src;
+
+	while (cp->pf_queue_num > 0 && (now == 0 || cp->bus_free <= now)){
+		/* prefetches never wait for an MSHR, they stay queued */
+		if (cp->mshrs && now != 0 && mshr_next_free(cp)->ready > now){
+			break;
+		}
+		baddr = cp->pf_queue[cp->pf_queue_head].baddr;
+		src = cp->pf_queue[cp->pf_queue_head].src;
+		cp->pf_queue_head = (cp->pf_queue_head + 1) % cp->pf_queue_size;
+		cp->pf_queue_num--;
+
+		/* a demand miss may have brought the block in while queued */
+		if (cache_probe(cp, baddr)){
+			cp->pf_filtered++;
+			continue;
+		}
+		cp->pf_src = src; // attribute the fill to this prefetcher
+		cache_access(
+			cp, 
+			Read, 
+			baddr, // aligned to cache block
+			NULL, 
+			cp->bsize, // the size of a cache block
+			now, // issued when the bus frees up
+			NULL,
+			NULL,
+			1 // we are prefetching
+		);
+		cp->pf_src = PF_NONE;
+		if (now != 0){
+			cp->bus_free = MAX(cp->bus_free, now + 1);
+		}
+		if (cp->pf_feedback){
+			pf_feedback(cp);
+		}
+	}
+}
+
+/* queue a prefetch of the block containing addr, requests for blocks that
+   are present, or already queued, are filtered */
+void prefetch(struct cache_t *cp, md_addr_t addr, tick_t now, int src){
+	md_addr_t baddr = CACHE_BADDR(cp, addr);
+	int i, tail;
 	if (cache_probe(cp, baddr)){
+		cp->pf_filtered++;
 		return;
 	}
-	cache_access(
-		cp, 
-		Read, 
-		baddr, // aligned to cache block
-		NULL, 
-		cp->bsize, // the size of a cache block
-		0, 
-		NULL,
-		NULL,
-		1 // we are prefetching
-	);
+	for (i=0;i<cp->pf_queue_num;i++){
+		if (cp->pf_queue[(cp->pf_queue_head + i) % cp->pf_queue_size].baddr == baddr){
+			cp->pf_filtered++;
+			return;
+		}
+	}
+	if (cp->pf_queue_num == cp->pf_queue_size){
+		cp->pf_dropped++;
+		return;
+	}
+	tail = (cp->pf_queue_head + cp->pf_queue_num) % cp->pf_queue_size;
+	cp->pf_queue[tail].baddr = baddr;
+	cp->pf_queue[tail].src = src;
+	cp->pf_queue_num++;
+	cp->pf_enqueued++;
 }
 	 
 /* Next Line Prefetcher */
-void next_line_prefetcher(struct cache_t *cp, md_addr_t addr) {
-	prefetch(cp, addr+cp->bsize);
+void next_line_prefetcher(struct cache_t *cp, md_addr_t addr, tick_t now) {
+	int i;
+	for (i=0;i<cp->pf_degree;i++){
+		prefetch(cp, addr + (cp->pf_distance + i) * cp->bsize, now, PF_NEXT_LINE);
+	}
 }
 
 /* applies the state transition table to the current rpt entry based on the new stride */
@@ -607,27 +1556,64 @@ void apply_state_transition(struct rpt_entry *entry, md_addr_t new_stride){
 		}
 	}
 }
+/* find the RPT entry of instruction PC, on a miss the least recently used
+   way of its set is reset for PC and *HIT is cleared */
+static struct rpt_entry *rpt_lookup(struct cache_t *cp, md_addr_t pc, int *hit){
+	struct rpt_entry *set = &cp->rpt[((pc >> 3) & cp->rpt_set_mask) * cp->rpt_assoc];
+	struct rpt_entry *entry, *victim = NULL;
+	int i;
+
+	cp->pf_clock++;
+	for (i=0;i<cp->rpt_assoc;i++){
+		entry = &set[i];
+		if (entry->state != UNINITIALIZED && entry->tag == pc){
+			entry->lru = cp->pf_clock;
+			cp->rpt_hits++;
+			*hit = TRUE;
+			return entry;
+		}
+		if (!victim || entry->state == UNINITIALIZED
+		    || (victim->state != UNINITIALIZED && entry->lru < victim->lru)){
+			victim = entry;
+		}
+	}
+	cp->rpt_misses++;
+	if (victim->state != UNINITIALIZED){
+		cp->rpt_evictions++;
+	}
+	victim->state = INITIAL;
+	victim->stride = 0;
+	victim->tag = pc;
+	victim->lru = cp->pf_clock;
+	*hit = FALSE;
+	return victim;
+}
+
+/* prefetch pf_degree strides, starting pf_distance strides past addr */
+static void stride_prefetch(struct cache_t *cp, md_addr_t addr, md_addr_t stride, tick_t now){
+	int i;
+	for (i=0;i<cp->pf_degree;i++){
+		prefetch(cp, addr + (cp->pf_distance + i) * stride, now, PF_STRIDE);
+	}
+}
+
 /* Stride Prefetcher */
-void stride_prefetcher(struct cache_t *cp, md_addr_t addr){
+void stride_prefetcher(struct cache_t *cp, md_addr_t addr, tick_t now){
 	md_addr_t new_stride;
-	int rpt_index = (get_PC() >> 3) % cp->prefetch_type;
-	struct rpt_entry *entry =  &(cp->rpt[rpt_index]);
-	md_addr_t rpt_tag = get_PC() >> 7; // addr[0:2] shared, addr[3:6] index into rpt
+	int hit;
+	struct rpt_entry *entry = rpt_lookup(cp, get_PC(), &hit);
 	/* scenario 1: there is no corresponding entry in the RPT */
-	if (entry->state == UNINITIALIZED || entry->tag != rpt_tag){
-		entry->state = INITIAL;
+	if (!hit){
 		entry->prev_addr = addr;
-		entry->stride = 0;
-		entry->tag = rpt_tag;
 		return;
 	}
 	/* scenario 2: there is a corresponding entry */
-	if (entry->state != UNINITIALIZED && entry->tag == rpt_tag){
+	else {
 		new_stride = addr - entry->prev_addr;
 		apply_state_transition(entry, new_stride);
 		entry->prev_addr = addr;
 		if (entry->state == INITIAL || entry->state == TRANSIENT || entry->state == STEADY){
-			prefetch(cp, addr + entry->stride);
+			stride_prefetch(cp, addr, entry->stride, now);
 		}
 	}
 }
@@ -660,51 +1646,174 @@ void insert_miss_queue(struct cache_t *cp, md_addr_t addr){
 }
 
 /* Open Ended Prefetcher */
-void open_ended_prefetcher(struct cache_t *cp, md_addr_t addr) {
+void open_ended_prefetcher(struct cache_t *cp, md_addr_t addr, tick_t now) {
 	// idea here is to use a miss queue that you write the addresss of the miss to everytime 
 	// a miss occurs. When looking up from miss queue, will give you the next miss that occurred
 	// the last time the current miss happened. Use the miss queue whenever stride doesn't fetch
 	// use miss queue size of 2048 and rpt size of 512 to get below 1, tune this a bit 
 	// so it doesn't look copied
 	md_addr_t new_stride, prefetch_addr;
-	int rpt_index = (get_PC() >> 3) % RPT_SIZE;
-	struct rpt_entry *entry =  &(cp->rpt[rpt_index]);
-	md_addr_t rpt_tag = get_PC() >> 7; // addr[0:2] shared, addr[3:6] index into rpt
+	int hit;
+	struct rpt_entry *entry = rpt_lookup(cp, get_PC(), &hit);
 	/* scenario 1: there is no corresponding entry in the RPT */
-	if (entry->state == UNINITIALIZED || entry->tag != rpt_tag){
-		entry->state = INITIAL;
+	if (!hit){
 		entry->prev_addr = addr;
-		entry->stride = 0;
-		entry->tag = rpt_tag;
 		prefetch_addr = search_miss_queue(cp, addr);
 		if (prefetch_addr){
-			prefetch(cp, prefetch_addr);
+			prefetch(cp, prefetch_addr, now, PF_CORRELATION);
 		}
 		return;
 	}
 	/* scenario 2: there is a corresponding entry */
-	if (entry->state != UNINITIALIZED && entry->tag == rpt_tag){
+	else {
 		new_stride = addr - entry->prev_addr;
 		apply_state_transition(entry, new_stride);
 		entry->prev_addr = addr; 
             
 		prefetch_addr = search_miss_queue(cp, addr);
 		if (prefetch_addr){
-		    prefetch(cp, prefetch_addr);
+		    prefetch(cp, prefetch_addr, now, PF_CORRELATION);
         } else {
             if (entry->state == INITIAL || entry->state == TRANSIENT || entry->state == STEADY) {
-	            prefetch(cp, addr + entry->stride);
+	            stride_prefetch(cp, addr, entry->stride, now);
             }
         }           
 	}
 }
 
+/* queue a prefetch for a prefetcher that may generate a burst of requests,
+   a full queue is first given a chance to issue to the bus */
+static void pf_push(struct cache_t *cp, md_addr_t addr, tick_t now, int src){
+	if (cp->pf_queue_num == cp->pf_queue_size){
+		pf_drain(cp, now);
+	}
+	prefetch(cp, addr, now, src);
+}
+
+/* Stream Buffer Prefetcher (Jouppi), a demand access inside the prefetched
+   window of a stream advances the stream and tops it up to pf_stream_depth
+   blocks ahead, a miss outside every stream reallocates the least recently
+   used stream to start at the next block; the prefetched blocks are filled
+   into the cache rather than held in the buffers */
+void stream_prefetcher(struct cache_t *cp, md_addr_t addr, tick_t now, int miss){
+	md_addr_t baddr = CACHE_BADDR(cp, addr);
+	md_addr_t limit;
+	struct stream_buf *sb, *victim = NULL;
+	int i;
+
+	cp->pf_clock++;
+	for (i=0;i<cp->pf_nstreams;i++){
+		sb = &cp->streams[i];
+		if (sb->valid && baddr >= sb->head && baddr < sb->tail){
+			break;
+		}
+		if (!victim || !sb->valid || (victim->valid && sb->lru < victim->lru)){
+			victim = sb;
+		}
+	}
+	if (i == cp->pf_nstreams){
+		if (!miss){
+			return;
+		}
+		/* start a new stream after the missing block */
+		sb = victim;
+		sb->valid = TRUE;
+		sb->tail = baddr + cp->bsize;
+		cp->pf_stream_allocs++;
+	}
+	sb->head = baddr + cp->bsize;
+	sb->lru = cp->pf_clock;
+
+	limit = sb->head + cp->pf_stream_depth * cp->bsize;
+	for (;sb->tail < limit;sb->tail += cp->bsize){
+		pf_push(cp, sb->tail, now, PF_STREAM);
+	}
+}
+
+/* record the pattern of generation AGT in the pattern history table */
+static void sms_end_generation(struct cache_t *cp, struct sms_agt_entry *agt){
+	int index = ((agt->pc >> 3) ^ agt->offset) & cp->sms_pht_mask;
+	struct sms_pht_entry *pht = &cp->sms_pht[index];
+
+	pht->valid = TRUE;
+	pht->pc = agt->pc;
+	pht->offset = agt->offset;
+	pht->pattern = agt->pattern;
+	agt->valid = FALSE;
+	cp->sms_generations++;
+}
+
+/* block BADDR left the cache, which ends the generation of its region */
+static void sms_evict(struct cache_t *cp, md_addr_t baddr){
+	md_addr_t region = baddr >> cp->sms_region_shift;
+	int i;
+	for (i=0;i<SMS_AGT_SIZE;i++){
+		if (cp->sms_agt[i].valid && cp->sms_agt[i].region == region){
+			sms_end_generation(cp, &cp->sms_agt[i]);
+			return;
+		}
+	}
+}
+
+/* Spatial Memory Streaming Prefetcher, the active generation table
+   accumulates the blocks accessed in each spatial region from its first
+   (trigger) access until a block of the region leaves the cache, at which
+   point the pattern is recorded under the trigger's PC and region offset;
+   a later trigger with the same PC and offset prefetches the recorded
+   pattern */
+void sms_prefetcher(struct cache_t *cp, md_addr_t addr, tick_t now){
+	md_addr_t region = addr >> cp->sms_region_shift;
+	md_addr_t rbase = region << cp->sms_region_shift;
+	int offset = (addr - rbase) / cp->bsize;
+	md_addr_t pc = get_PC();
+	struct sms_agt_entry *agt, *victim = NULL;
+	struct sms_pht_entry *pht;
+	unsigned int pattern;
+	int i;
+
+	cp->pf_clock++;
+	for (i=0;i<SMS_AGT_SIZE;i++){
+		agt = &cp->sms_agt[i];
+		if (agt->valid && agt->region == region){
+			agt->pattern |= 1u << offset;
+			agt->lru = cp->pf_clock;
+			return;
+		}
+		if (!victim || !agt->valid || (victim->valid && agt->lru < victim->lru)){
+			victim = agt;
+		}
+	}
+
+	/* trigger access, start a new generation for the region */
+	if (victim->valid){
+		sms_end_generation(cp, victim);
+	}
+	victim->valid = TRUE;
+	victim->region = region;
+	victim->pc = pc;
+	victim->offset = offset;
+	victim->pattern = 1u << offset;
+	victim->lru = cp->pf_clock;
+
+	pht = &cp->sms_pht[((pc >> 3) ^ offset) & cp->sms_pht_mask];
+	if (!pht->valid || pht->pc != pc || pht->offset != offset){
+		return;
+	}
+	cp->sms_triggers++;
+	pattern = pht->pattern & ~(1u << offset);
+	for (i=0;i<SMS_REGION_BLKS;i++){
+		if (pattern & (1u << i)){
+			pf_push(cp, rbase + i * cp->bsize, now, PF_SMS);
+		}
+	}
+}
+
 	
 
 /* ECE552 Assignment 4 - END CODE */
 
 /* cache x might generate a prefetch after a regular cache access to address addr */
-void generate_prefetch(struct cache_t *cp, md_addr_t addr) {
+void generate_prefetch(struct cache_t *cp, md_addr_t addr, tick_t now, int miss) {
 
 	switch(cp->prefetch_type) {
 		case 0:
@@ -713,15 +1822,28 @@ void generate_prefetch(struct cache_t *cp, md_addr_t addr) {
 		   break;
 		case 1:
 		   // Next Line Prefetcher
-		   next_line_prefetcher(cp, addr);
+		   next_line_prefetcher(cp, addr, now);
 		   break;
 		case 2:
 		   // Open Ended Prefetcher
-		   open_ended_prefetcher(cp, addr);
+		   open_ended_prefetcher(cp, addr, now);
+		   break;
+		case PF_TYPE_STREAM:
+		   // Stream Buffers
+		   stream_prefetcher(cp, addr, now, miss);
+		   break;
+		case PF_TYPE_SMS:
+		   // Spatial Memory Streaming
+		   sms_prefetcher(cp, addr, now);
 		   break;
 		default:
 		   // Stride Prefetcher with cp->prefetch_type number of entries in the Reference Prediction Table (RPT)
-		   stride_prefetcher(cp, addr);
+		   stride_prefetcher(cp, addr, now);
+	}
+
+	/* issue what the bus allows now, the rest waits in the queue */
+	if (cp->pf_queue_num) {
+		pf_drain(cp, now);
 	}
 
 }
@@ -745,6 +1867,216 @@ cache_stats(struct cache_t *cp,		/* cache instance */
 	  (double)cp->invalidations/sum);
 }
 
+/* find the valid block of cache CP holding ADDR, NULL if there is none */
+static struct cache_blk_t *
+cache_find_blk(struct cache_t *cp, md_addr_t addr)
+{
+  md_addr_t tag = CACHE_TAG(cp, addr);
+  md_addr_t set = CACHE_SET(cp, addr);
+  struct cache_blk_t *blk;
+
+  if (cp->hsize)
+    {
+      for (blk=cp->sets[set].hash[CACHE_HASH(cp, tag)];
+	   blk;
+	   blk=blk->hash_next)
+	{
+	  if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
+	    return blk;
+	}
+    }
+  else
+    {
+      for (blk=cp->sets[set].way_head; blk; blk=blk->way_next)
+	{
+	  if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
+	    return blk;
+	}
+    }
+  return NULL;
+}
+
+/* select the block of SET to replace, and re-link it to the appropriate
+   place in the way list */
+static struct cache_blk_t *
+cache_repl_blk(struct cache_t *cp, md_addr_t set)
+{
+  struct cache_blk_t *repl;
+
+  switch (cp->policy) {
+  case LRU:
+  case FIFO:
+    repl = cp->sets[set].way_tail;
+    update_way_list(&cp->sets[set], repl, Head);
+    break;
+  case Random:
+    {
+      int bindex = myrand() & (cp->assoc - 1);
+      repl = CACHE_BINDEX(cp, cp->sets[set].blks, bindex);
+    }
+    break;
+  default:
+    panic("bogus replacement policy");
+  }
+  return repl;
+}
+
+/* block BADDR is leaving inclusive cache CP, invalidate every copy of it in
+   the caches above, returns non-zero if one of them was dirty, the dirty
+   data then leaves with the block of CP */
+static int
+cache_back_invalidate(struct cache_t *cp, md_addr_t baddr)
+{
+  struct cache_t *up;
+  struct cache_blk_t *blk;
+  struct cache_vc_entry *ent;
+  md_addr_t addr;
+  int i, dirty = FALSE;
+
+  for (i=0; i < cp->nuppers; i++)
+    {
+      up = cp->uppers[i];
+      for (addr = baddr; addr < baddr + cp->bsize; addr += up->bsize)
+	{
+	  if ((blk = cache_find_blk(up, addr)) != NULL)
+	    {
+	      if (blk->status & CACHE_BLK_DIRTY)
+		{
+		  dirty = TRUE;
+		  cp->back_inval_dirty++;
+		}
+	      PF_DISCARD(up, blk);
+	      PF_EVICT(up, addr);
+	      blk->status &= ~(CACHE_BLK_VALID|CACHE_BLK_DIRTY
+			       |CACHE_BLK_PREFETCHED);
+	      if (up->last_blk == blk)
+		{
+		  up->last_tagset = 0;
+		  up->last_blk = NULL;
+		}
+	      update_way_list(&up->sets[CACHE_SET(up, addr)], blk, Tail);
+	      cp->back_invals++;
+	    }
+	  else if (up->vc && (ent = vc_find(up, addr)) != NULL)
+	    {
+	      if (ent->dirty)
+		{
+		  dirty = TRUE;
+		  cp->back_inval_dirty++;
+		}
+	      ent->valid = FALSE;
+	      up->vc_num--;
+	      cp->back_invals++;
+	    }
+	}
+    }
+  return dirty;
+}
+
+/* exclusive cache CP takes block BADDR, evicted (DIRTY or not) from a cache
+   above at time NOW, the fill replaces a block of CP as a miss would */
+static void
+cache_excl_fill(struct cache_t *cp, md_addr_t baddr, int dirty, tick_t now)
+{
+  md_addr_t set = CACHE_SET(cp, baddr);
+  struct cache_blk_t *repl;
+
+  cp->excl_fills++;
+
+  /* this cache's prefetcher may have brought the block in already */
+  if ((repl = cache_find_blk(cp, baddr)) != NULL)
+    {
+      if (dirty)
+	repl->status |= CACHE_BLK_DIRTY;
+      return;
+    }
+
+  repl = cache_repl_blk(cp, set);
+  if (cp->hsize)
+    unlink_htab_ent(cp, &cp->sets[set], repl);
+  cp->last_tagset = 0;
+  cp->last_blk = NULL;
+
+  if (repl->status & CACHE_BLK_VALID)
+    {
+      cp->replacements++;
+      PF_DISCARD(cp, repl);
+      PF_EVICT(cp, CACHE_MK_BADDR(cp, repl->tag, set));
+      if (cp->vc)
+	vc_insert(cp, CACHE_MK_BADDR(cp, repl->tag, set),
+		  (repl->status & CACHE_BLK_DIRTY) != 0, now);
+      else if (repl->status & CACHE_BLK_DIRTY)
+	cache_writeback(cp, CACHE_MK_BADDR(cp, repl->tag, set), repl, now);
+    }
+
+  repl->tag = CACHE_TAG(cp, baddr);
+  repl->status = CACHE_BLK_VALID | (dirty ? CACHE_BLK_DIRTY : 0);
+  repl->ready = now;
+  if (cp->hsize)
+    link_htab_ent(cp, &cp->sets[set], repl);
+}
+
+/* a read from above that hits block BLK of SET in exclusive cache CP moves
+   the block up, the copy above is filled clean so a dirty block is written
+   back on the way */
+static void
+cache_excl_move_up(struct cache_t *cp, struct cache_blk_t *blk,
+		   md_addr_t set, tick_t now)
+{
+  md_addr_t baddr = CACHE_MK_BADDR(cp, blk->tag, set);
+
+  cp->excl_moves++;
+  if (blk->status & CACHE_BLK_DIRTY)
+    cache_writeback(cp, baddr, blk, now);
+  PF_EVICT(cp, baddr);
+  blk->status &= ~(CACHE_BLK_VALID|CACHE_BLK_DIRTY|CACHE_BLK_PREFETCHED);
+  cp->last_tagset = 0;
+  cp->last_blk = NULL;
+  update_way_list(&cp->sets[set], blk, Tail);
+}
+
+/* reads from the caches above exclusive cache CP move blocks up, fills by
+   the prefetcher of CP stay in CP */
+#define CACHE_EXCL_READ(cp, cmd)					\
+  ((cp)->inclusion == Exclusive && (cmd) == Read && (cp)->pf_src == PF_NONE)
+
+/* sample the distinct bytes held by cache CP and the caches above it, a
+   block held at both levels counts once */
+static void
+cache_sample_capacity(struct cache_t *cp)
+{
+  struct cache_t *up;
+  struct cache_blk_t *blk;
+  counter_t bytes = 0;
+  int i, j;
+
+  cp->cap_countdown = CACHE_CAP_INTERVAL;
+
+  for (i=0; i < cp->nsets; i++)
+    for (blk=cp->sets[i].way_head; blk; blk=blk->way_next)
+      if (blk->status & CACHE_BLK_VALID)
+	bytes += cp->bsize;
+  for (i=0; i < cp->vc_size; i++)
+    if (cp->vc[i].valid)
+      bytes += cp->bsize;
+
+  for (j=0; j < cp->nuppers; j++)
+    {
+      up = cp->uppers[j];
+      for (i=0; i < up->nsets; i++)
+	for (blk=up->sets[i].way_head; blk; blk=blk->way_next)
+	  if ((blk->status & CACHE_BLK_VALID)
+	      && !cache_probe(cp, CACHE_MK_BADDR(up, blk->tag, i)))
+	    bytes += up->bsize;
+      for (i=0; i < up->vc_size; i++)
+	if (up->vc[i].valid && !cache_probe(cp, up->vc[i].baddr))
+	  bytes += up->bsize;
+    }
+
+  cp->cap_samples++;
+  cp->cap_bytes += bytes;
+}
+
 /* access a cache, perform a CMD operation on cache CP at address ADDR,
    places NBYTES of data at *P, returns latency of operation if initiated
    at NOW, places pointer to block user data in *UDATA, *P is untouched if
@@ -766,7 +2098,8 @@ cache_access(struct cache_t *cp,	/* cache to access */
   md_addr_t set = CACHE_SET(cp, addr);
   md_addr_t bofs = CACHE_BLK(cp, addr);
   struct cache_blk_t *blk, *repl;
-  int lat = 0;
+  struct cache_mshr *mshr = NULL;
+  int lat = 0, local_fill = FALSE, fill_dirty = FALSE;
 
   /* default replacement address */
   if (repl_addr)
@@ -785,6 +2118,10 @@ cache_access(struct cache_t *cp,	/* cache to access */
   if ((addr + nbytes) > ((addr & ~cp->blk_mask) + cp->bsize))
     fatal("cache: access error: access spans block, addr 0x%08x", addr);
 
+  /* sample the capacity this cache and the caches above it hold */
+  if (cp->nuppers && --cp->cap_countdown <= 0)
+    cache_sample_capacity(cp);
+
   /* permissions are checked on cache misses */
 
   /* check for a fast hit: access to same block */
@@ -836,30 +2173,65 @@ cache_access(struct cache_t *cp,	/* cache to access */
 		insert_miss_queue(cp, addr);
 	}
 
+	/* a demand miss to a block a prefetch evicted is cache pollution */
+	if (cp->pf_victims){
+		struct pf_victim *victim =
+			&cp->pf_victims[(addr >> cp->set_shift) & cp->pf_victims_mask];
+		if (victim->src != PF_NONE && victim->baddr == CACHE_BADDR(cp, addr)){
+			cp->pf_stats[victim->src].pollution++;
+			victim->src = PF_NONE;
+		}
+	}
 /* ECE552 Assignment 4 - END CODE */
   }
   else {
      cp->prefetch_misses++;
   }
 
+  /* the fill needs an MSHR, wait for the first one to free up if all are
+     busy, untimed accesses (NOW == 0) are not limited */
+  if (cp->mshrs && now != 0)
+    {
+      mshr = mshr_next_free(cp);
+      if (mshr->ready > now)
+	{
+	  cp->mshr_full_stalls++;
+	  cp->mshr_stall_cycles += mshr->ready - now;
+	  lat += mshr->ready - now;
+	}
+      cp->mshr_allocs++;
+    }
 
-  /* select the appropriate block to replace, and re-link this entry to
-     the appropriate place in the way list */
-  switch (cp->policy) {
-  case LRU:
-  case FIFO:
-    repl = cp->sets[set].way_tail;
-    update_way_list(&cp->sets[set], repl, Head);
-    break;
-  case Random:
+  /* an exclusive cache passes a block missing here straight up, without
+     keeping a copy of it */
+  if (CACHE_EXCL_READ(cp, cmd))
     {
-      int bindex = myrand() & (cp->assoc - 1);
-      repl = CACHE_BINDEX(cp, cp->sets[set].blks, bindex);
+      lat += cp->blk_access_fn(Read, CACHE_BADDR(cp, addr), cp->bsize,
+			       NULL, CACHE_LATER(now, lat), prefetch);
+      if (mshr)
+	{
+	  mshr->baddr = CACHE_BADDR(cp, addr);
+	  mshr->ready = now + lat;
+	  mshr->ntargets = 1;
+	}
+      if (prefetch == 0)
+	generate_prefetch(cp, addr, now, 1);
+      return lat;
     }
-    break;
-  default:
-    panic("bogus replacement policy");
-  }
+
+  /* the missing block may still be close by, in the victim cache or waiting
+     to be written back, take it out before evicting anything */
+  if (cp->vc && vc_remove(cp, CACHE_BADDR(cp, addr), &fill_dirty))
+    local_fill = TRUE;
+  else if (cp->wbb && wbb_remove(cp, CACHE_BADDR(cp, addr)))
+    {
+      cp->wbb_hits++;
+      local_fill = fill_dirty = TRUE;
+    }
+
+  /* select the appropriate block to replace, and re-link this entry to
+     the appropriate place in the way list */
+  repl = cache_repl_blk(cp, set);
 
   /* remove this block from the hash bucket chain, if hash exists */
   if (cp->hsize)
@@ -874,25 +2246,64 @@ cache_access(struct cache_t *cp,	/* cache to access */
     {
       cp->replacements++;
 
+      /* ECE552 Assignment 4 - BEGIN CODE */
+      PF_DISCARD(cp, repl);
+      PF_EVICT(cp, CACHE_MK_BADDR(cp, repl->tag, set));
+      if (prefetch && cp->pf_src != PF_NONE)
+	{
+	  /* remember the victim of this prefetch fill */
+	  md_addr_t vaddr = CACHE_MK_BADDR(cp, repl->tag, set);
+	  struct pf_victim *victim =
+	    &cp->pf_victims[(vaddr >> cp->set_shift) & cp->pf_victims_mask];
+
+	  victim->baddr = vaddr;
+	  victim->src = cp->pf_src;
+	}
+      /* ECE552 Assignment 4 - END CODE */
+
+      /* an inclusive cache takes the block out of the caches above too */
+      if (cp->inclusion == Inclusive
+	  && cache_back_invalidate(cp, CACHE_MK_BADDR(cp, repl->tag, set)))
+	repl->status |= CACHE_BLK_DIRTY;
+
       if (repl_addr)
 	*repl_addr = CACHE_MK_BADDR(cp, repl->tag, set);
  
-      /* don't replace the block until outstanding misses are satisfied */
-      lat += BOUND_POS(repl->ready - now);
+      /* don't replace the block until outstanding misses are satisfied,
+	 untimed accesses have nothing outstanding to wait for */
+      if (now != 0)
+	lat += BOUND_POS(repl->ready - now);
  
-      /* stall until the bus to next level of memory is available */
-      lat += BOUND_POS(cp->bus_free - (now + lat));
- 
-      /* track bus resource usage */
-      cp->bus_free = MAX(cp->bus_free, (now + lat)) + 1;
+      /* stall until the bus to next level of memory is available, and
+	 track bus resource usage, untimed accesses leave the bus alone */
+      if (now != 0)
+	{
+	  lat += BOUND_POS(cp->bus_free - (now + lat));
+	  cp->bus_free = MAX(cp->bus_free, (now + lat)) + 1;
+	}
 
-      if (repl->status & CACHE_BLK_DIRTY)
+      if (cp->vc)
+	{
+	  /* the victim cache catches the block, dirty or not */
+	  lat += vc_insert(cp, CACHE_MK_BADDR(cp, repl->tag, set),
+			   (repl->status & CACHE_BLK_DIRTY) != 0,
+			   CACHE_LATER(now, lat));
+	}
+      else if (cp->excl_lower)
+	{
+	  /* the exclusive cache below takes the block, dirty or not, off
+	     the critical path */
+	  if (repl->status & CACHE_BLK_DIRTY)
+	    cp->writebacks++;
+	  cache_excl_fill(cp->excl_lower, CACHE_MK_BADDR(cp, repl->tag, set),
+			  (repl->status & CACHE_BLK_DIRTY) != 0,
+			  CACHE_LATER(now, lat));
+	}
+      else if (repl->status & CACHE_BLK_DIRTY)
 	{
 	  /* write back the cache block */
-	  cp->writebacks++;
-	  lat += cp->blk_access_fn(Write,
-				   CACHE_MK_BADDR(cp, repl->tag, set),
-				   cp->bsize, repl, now+lat, 0);
+	  lat += cache_writeback(cp, CACHE_MK_BADDR(cp, repl->tag, set),
+				 repl, CACHE_LATER(now, lat));
 	}
     }
 
@@ -900,9 +2311,27 @@ cache_access(struct cache_t *cp,	/* cache to access */
   repl->tag = tag;
   repl->status = CACHE_BLK_VALID;	/* dirty bit set on update */
 
-  /* read data block */
-  lat += cp->blk_access_fn(Read, CACHE_BADDR(cp, addr), cp->bsize,
-			   repl, now+lat, prefetch);
+  /* ECE552 Assignment 4 - BEGIN CODE */
+  /* mark blocks filled by this cache's prefetcher as not yet used */
+  if (prefetch && cp->pf_src != PF_NONE)
+    {
+      repl->status |= CACHE_BLK_PREFETCHED;
+      repl->pf_src = cp->pf_src;
+      cp->pf_stats[cp->pf_src].issued++;
+    }
+  /* ECE552 Assignment 4 - END CODE */
+
+  /* read data block, a block found in the victim cache or write-back
+     buffer takes an extra cycle to move back into the cache */
+  if (local_fill)
+    {
+      lat += cp->hit_latency + 1;
+      if (fill_dirty)
+	repl->status |= CACHE_BLK_DIRTY;
+    }
+  else
+    lat += cp->blk_access_fn(Read, CACHE_BADDR(cp, addr), cp->bsize,
+			     repl, CACHE_LATER(now, lat), prefetch);
 
   /* copy data out of cache block */
   if (cp->balloc)
@@ -918,15 +2347,24 @@ cache_access(struct cache_t *cp,	/* cache to access */
   if (udata)
     *udata = repl->user_data;
 
-  /* update block status */
-  repl->ready = now+lat;
+  /* update block status, a block filled by an untimed access is ready
+     right away */
+  repl->ready = (now != 0) ? now+lat : 0;
+
+  /* the MSHR is busy until the fill completes */
+  if (mshr)
+    {
+      mshr->baddr = CACHE_BADDR(cp, addr);
+      mshr->ready = repl->ready;
+      mshr->ntargets = 1;
+    }
 
   /* link this entry back into the hash table */
   if (cp->hsize)
     link_htab_ent(cp, &cp->sets[set], repl);
 
   if (prefetch == 0) {	/* only regular cache accesses can generate a prefetch */
-  	generate_prefetch(cp, addr);
+  	generate_prefetch(cp, addr, now, 1);
   }
 
   /* return latency of the operation */
@@ -943,6 +2381,10 @@ cache_access(struct cache_t *cp,	/* cache to access */
      if (cmd == Read) {	
 	   cp->read_hits++;
      }
+
+     /* ECE552 Assignment 4 - BEGIN CODE */
+     PF_DEMAND_USE(cp, blk, now);
+     /* ECE552 Assignment 4 - END CODE */
   }
   else {
      cp->prefetch_hits++;
@@ -977,11 +2419,18 @@ cache_access(struct cache_t *cp,	/* cache to access */
     *udata = blk->user_data;
 
   if (prefetch == 0) {	/* only regular cache accesses can generate a prefetch */
-	generate_prefetch(cp, addr);
+	generate_prefetch(cp, addr, now, 0);
   }
 
 
-  /* return first cycle data is available to access */
+  /* a read from above takes the block out of an exclusive cache */
+  if (CACHE_EXCL_READ(cp, cmd))
+    cache_excl_move_up(cp, blk, set, now);
+
+  /* return first cycle data is available to access, a block still being
+     filled is a secondary miss on its MSHR */
+  if (cp->mshrs && now != 0 && blk->ready > now)
+    return mshr_merge(cp, CACHE_BADDR(cp, addr), blk->ready, now);
   return (int) MAX(cp->hit_latency, (blk->ready - now));
 
  cache_fast_hit: /* fast hit handler */
@@ -994,6 +2443,10 @@ cache_access(struct cache_t *cp,	/* cache to access */
      if (cmd == Read) {	
         cp->read_hits++;
      }
+
+     /* ECE552 Assignment 4 - BEGIN CODE */
+     PF_DEMAND_USE(cp, blk, now);
+     /* ECE552 Assignment 4 - END CODE */
   }
   else {
      cp->prefetch_hits++;
@@ -1023,10 +2476,17 @@ cache_access(struct cache_t *cp,	/* cache to access */
   cp->last_blk = blk;
 
   if (prefetch == 0) {	/* only regular cache accesses can generate a prefetch */
-     generate_prefetch(cp, addr);
+     generate_prefetch(cp, addr, now, 0);
   }
 
-  /* return first cycle data is available to access */
+  /* a read from above takes the block out of an exclusive cache */
+  if (CACHE_EXCL_READ(cp, cmd))
+    cache_excl_move_up(cp, blk, set, now);
+
+  /* return first cycle data is available to access, a block still being
+     filled is a secondary miss on its MSHR */
+  if (cp->mshrs && now != 0 && blk->ready > now)
+    return mshr_merge(cp, CACHE_BADDR(cp, addr), blk->ready, now);
   return (int) MAX(cp->hit_latency, (blk->ready - now));
 }
 
@@ -1093,7 +2553,9 @@ cache_flush(struct cache_t *cp,		/* cache instance to flush */
 	  if (blk->status & CACHE_BLK_VALID)
 	    {
 	      cp->invalidations++;
-	      blk->status &= ~CACHE_BLK_VALID;
+	      PF_DISCARD(cp, blk);
+	      PF_EVICT(cp, CACHE_MK_BADDR(cp, blk->tag, i));
+	      blk->status &= ~(CACHE_BLK_VALID|CACHE_BLK_PREFETCHED);
 
 	      if (blk->status & CACHE_BLK_DIRTY)
 		{
@@ -1101,12 +2563,39 @@ cache_flush(struct cache_t *cp,		/* cache instance to flush */
           	  cp->writebacks++;
 		  lat += cp->blk_access_fn(Write,
 					   CACHE_MK_BADDR(cp, blk->tag, i),
-					   cp->bsize, blk, now+lat, 0);
+					   cp->bsize, blk,
+					   CACHE_LATER(now, lat), 0);
 		}
 	    }
 	}
     }
 
+  /* the victim cache is flushed too */
+  for (i=0; i < cp->vc_size; i++)
+    {
+      if (cp->vc[i].valid)
+	{
+	  cp->invalidations++;
+	  cp->vc[i].valid = FALSE;
+	  if (cp->vc[i].dirty)
+	    {
+	      cp->writebacks++;
+	      lat += cp->blk_access_fn(Write, cp->vc[i].baddr, cp->bsize,
+				       NULL, CACHE_LATER(now, lat), 0);
+	    }
+	}
+    }
+  cp->vc_num = 0;
+
+  /* and buffered writes complete */
+  while (cp->wbb_num > 0)
+    {
+      lat += cp->blk_access_fn(Write, cp->wbb[cp->wbb_head].baddr,
+			       cp->bsize, NULL, CACHE_LATER(now, lat), 0);
+      cp->wbb_head = (cp->wbb_head + 1) % cp->wbb_size;
+      cp->wbb_num--;
+    }
+
   /* return latency of the flush operation */
   return lat;
 }
@@ -1151,23 +2640,49 @@ cache_flush_addr(struct cache_t *cp,	/* cache instance to flush */
   if (blk)
     {
       cp->invalidations++;
-      blk->status &= ~CACHE_BLK_VALID;
+      PF_DISCARD(cp, blk);
+      PF_EVICT(cp, CACHE_MK_BADDR(cp, blk->tag, set));
+      blk->status &= ~(CACHE_BLK_VALID|CACHE_BLK_PREFETCHED);
 
       /* blow away the last block to hit */
       cp->last_tagset = 0;
       cp->last_blk = NULL;
 
+      /* an inclusive cache takes the block out of the caches above too */
+      if (cp->inclusion == Inclusive
+	  && cache_back_invalidate(cp, CACHE_MK_BADDR(cp, blk->tag, set)))
+	blk->status |= CACHE_BLK_DIRTY;
+
       if (blk->status & CACHE_BLK_DIRTY)
 	{
 	  /* write back the invalidated block */
           cp->writebacks++;
 	  lat += cp->blk_access_fn(Write,
 				   CACHE_MK_BADDR(cp, blk->tag, set),
-				   cp->bsize, blk, now+lat, 0);
+				   cp->bsize, blk,
+				   CACHE_LATER(now, lat), 0);
 	}
       /* move this block to tail of the way (LRU) list */
       update_way_list(&cp->sets[set], blk, Tail);
     }
+  else if (cp->vc)
+    {
+      /* the block may have moved to the victim cache */
+      struct cache_vc_entry *ent = vc_find(cp, CACHE_BADDR(cp, addr));
+
+      if (ent)
+	{
+	  ent->valid = FALSE;
+	  cp->vc_num--;
+	  cp->invalidations++;
+	  if (ent->dirty)
+	    {
+	      cp->writebacks++;
+	      lat += cp->blk_access_fn(Write, CACHE_BADDR(cp, addr),
+				       cp->bsize, NULL, CACHE_LATER(now, lat), 0);
+	    }
+	}
+    }
 
   /* return latency of the operation */
   return lat;
@@ -105,10 +105,25 @@ enum cache_policy {
   FIFO		/* replace the oldest block in the set */
 };
 
+/* inclusion policy of a cache with respect to the caches directly above
+   it, i.e., the caches whose misses it serves */
+enum cache_inclusion {
+  NINE,		/* non-inclusive non-exclusive, nothing is enforced */
+  Inclusive,	/* evictions back-invalidate the caches above */
+  Exclusive	/* a block lives in this cache or a cache above, not both */
+};
+
+/* most caches that may sit directly above one cache, e.g., il1 and dl1 */
+#define CACHE_MAX_UPPERS	2
+
+/* accesses between samples of the effective capacity of a hierarchy */
+#define CACHE_CAP_INTERVAL	10000
+
 
 /* block status values */
 #define CACHE_BLK_VALID		0x00000001	/* block in valid, in use */
 #define CACHE_BLK_DIRTY		0x00000002	/* dirty block */
+#define CACHE_BLK_PREFETCHED	0x00000004	/* prefetched, not yet used */
 
 /* cache block (or line) definition */
 struct cache_blk_t
@@ -124,6 +139,8 @@ struct cache_blk_t
   unsigned int status;		/* block status, see CACHE_BLK_* defs above */
   tick_t ready;		/* time when block will be accessible, field
 				   is set when a miss fetch is initiated */
+  int pf_src;			/* prefetcher that filled the block, valid
+				   while CACHE_BLK_PREFETCHED is set */
   byte_t *user_data;		/* pointer to user defined data, e.g.,
 				   pre-decode data or physical page address */
   /* DATA should be pointer-aligned due to preceeding field */
@@ -133,6 +150,33 @@ struct cache_blk_t
 				   should probably be a multiple of 8 */
 };
 
+/* miss status holding register, tracks one outstanding block fill and the
+   accesses waiting on it */
+struct cache_mshr
+{
+  md_addr_t baddr;		/* address of the block being filled */
+  tick_t ready;			/* time when the fill completes, the entry is
+				   free from then on */
+  int ntargets;			/* accesses merged into this fill */
+};
+
+/* a dirty block waiting in the write-back buffer for the bus to the next
+   level of memory */
+struct cache_wb_entry
+{
+  md_addr_t baddr;		/* address of the written-back block */
+  tick_t when;			/* time the block entered the buffer */
+};
+
+/* a victim cache entry, holds a block recently evicted from the cache */
+struct cache_vc_entry
+{
+  md_addr_t baddr;		/* address of the block */
+  int valid;			/* entry holds a block? */
+  int dirty;			/* block is dirty? */
+  counter_t stamp;		/* insertion order, oldest entry is replaced */
+};
+
 /* cache set definition (one or more blocks sharing the same set index) */
 struct cache_set_t
 {
@@ -152,8 +196,9 @@ struct cache_set_t
 struct rpt_entry {
 	int state; // the state of rpt entry defined in enum rpt_entry_states
 	md_addr_t stride; // the difference between the last two addresses generated by PC
-	md_addr_t tag; // tag of the PC to check if the entry matches the one we want
+	md_addr_t tag; // the full PC, to check if the entry matches the one we want
 	md_addr_t prev_addr; // the previous address referenced by instruction
+	counter_t lru; // time of last use, for replacement within the set
 };
 
 enum rpt_entry_states {
@@ -166,6 +211,85 @@ enum rpt_entry_states {
 
 #define RPT_SIZE 256
 #define MISS_QUEUE_SIZE 512
+
+/* prefetch sources, used to attribute prefetch accounting to the
+   prefetcher that issued the request */
+enum pf_source {
+	PF_NONE,		// demand fill, or a prefetch from an upper level
+	PF_NEXT_LINE,		// next-line prefetcher
+	PF_STRIDE,		// RPT stride prefetcher
+	PF_CORRELATION,		// open-ended miss-queue correlation
+	PF_STREAM,		// stream buffers
+	PF_SMS,			// spatial memory streaming
+	PF_FETCH,		// fetch-directed, from a core's fetch target queue
+	PF_NUM_SOURCES
+};
+
+/* per-prefetcher accounting, a prefetched block is "not yet used" until the
+   first demand access to it */
+struct pf_stats_t {
+	counter_t issued;	// prefetch fills into the cache
+	counter_t useful;	// prefetched blocks later hit by a demand access
+	counter_t late;		// useful, but demand arrived before the fill
+	counter_t useless;	// prefetched blocks evicted or invalidated unused
+	counter_t pollution;	// demand misses to blocks a prefetch evicted
+};
+
+/* a block evicted by a prefetch fill, used to detect cache pollution */
+struct pf_victim {
+	md_addr_t baddr;	// address of the evicted block
+	int src;		// prefetcher that caused the eviction
+};
+
+/* a prefetch waiting in the request queue for the bus to the next level */
+struct pf_request {
+	md_addr_t baddr;	// block address to prefetch
+	int src;		// prefetcher that generated the request
+};
+
+#define PF_QUEUE_SIZE 8		// default prefetch request queue entries
+#define PF_FB_INTERVAL 256	// prefetch fills per feedback interval
+#define PF_NUM_LEVELS 5		// feedback aggressiveness levels
+
+/* <pref> values of the prefetchers not selected by a positive number */
+#define PF_TYPE_STREAM -1	// stream buffers
+#define PF_TYPE_SMS -2		// spatial memory streaming
+
+/* a stream buffer, blocks [head, tail) have been prefetched for the stream
+   and head is the next block the stream is expected to demand */
+struct stream_buf {
+	int valid;
+	md_addr_t head;		// next block expected by the stream
+	md_addr_t tail;		// next block to prefetch for the stream
+	counter_t lru;		// time of last use, for replacement
+};
+
+#define PF_NUM_STREAMS 4	// default number of stream buffers
+#define PF_STREAM_DEPTH 4	// default blocks prefetched ahead per stream
+
+/* an active spatial region generation, accumulating the blocks accessed in
+   the region since the trigger access */
+struct sms_agt_entry {
+	int valid;
+	md_addr_t region;	// region number, i.e., addr >> sms_region_shift
+	md_addr_t pc;		// PC of the trigger access
+	int offset;		// block offset of the trigger access in the region
+	unsigned int pattern;	// blocks accessed in the region, one bit each
+	counter_t lru;		// time of last use, for replacement
+};
+
+/* a spatial pattern learned from an ended generation, keyed by the PC and
+   region offset of the access that triggered it */
+struct sms_pht_entry {
+	int valid;
+	md_addr_t pc;		// trigger PC
+	int offset;		// trigger block offset
+	unsigned int pattern;	// blocks accessed during the generation
+};
+
+#define SMS_REGION_BLKS 32	// blocks per spatial region, one pattern bit each
+#define SMS_AGT_SIZE 32		// active generation table entries
+#define SMS_PHT_SIZE 1024	// default pattern history table entries
 /* ECE552 Assignment 4 - END CODE */
 
 /* cache definition */
@@ -185,10 +309,51 @@ struct cache_t
   /* ECE552 Assignment 4 - BEGIN CODE */
 
   struct rpt_entry *rpt;	/* the rpt for stride prefetching */
+  int rpt_assoc;		/* rpt ways per set */
+  int rpt_set_mask;		/* rpt sets - 1 */
+  counter_t rpt_hits;		/* rpt lookups that found the PC */
+  counter_t rpt_misses;		/* rpt lookups that allocated an entry */
+  counter_t rpt_evictions;	/* rpt entries replaced by another PC */
 
   md_addr_t *miss_queue;	/* a queue to store cache miss addresses */
   int queue_size;			/* the size of the miss queue */
   int queue_head;			/* the head of the queue */
+
+  int pf_src;			/* source of the prefetch being issued */
+  struct pf_stats_t pf_stats[PF_NUM_SOURCES]; /* per-prefetcher stats */
+  struct pf_victim *pf_victims;	/* blocks evicted by prefetches, indexed
+				   by block address, one entry per block */
+  int pf_victims_mask;		/* pf_victims entries - 1 */
+  int pf_fetch;			/* takes fetch-directed prefetches? */
+
+  struct pf_request *pf_queue;	/* pending prefetches, drained when the bus
+				   to the next level is free */
+  int pf_queue_size;		/* prefetch queue entries */
+  int pf_queue_head;		/* oldest pending prefetch */
+  int pf_queue_num;		/* number of pending prefetches */
+  int pf_feedback;		/* adapt degree/distance to accuracy? */
+  int pf_level;			/* current aggressiveness level */
+  int pf_distance;		/* blocks (or strides) ahead to prefetch */
+  int pf_degree;		/* prefetches generated per trigger */
+  struct pf_stats_t pf_interval;/* prefetch totals at interval start */
+  counter_t pf_enqueued;	/* prefetch requests queued */
+  counter_t pf_filtered;	/* requests dropped as present or duplicate */
+  counter_t pf_dropped;		/* requests dropped on a full queue */
+  counter_t pf_level_ups;	/* feedback aggressiveness increases */
+  counter_t pf_level_downs;	/* feedback aggressiveness decreases */
+
+  struct stream_buf *streams;	/* stream buffers */
+  int pf_nstreams;		/* number of stream buffers */
+  int pf_stream_depth;		/* blocks prefetched ahead per stream */
+  counter_t pf_stream_allocs;	/* streams allocated on a miss */
+
+  struct sms_agt_entry *sms_agt;/* SMS active generation table */
+  struct sms_pht_entry *sms_pht;/* SMS pattern history table */
+  int sms_pht_mask;		/* pattern history table entries - 1 */
+  int sms_region_shift;		/* log2 of the spatial region size */
+  counter_t pf_clock;		/* prefetcher accesses, orders LRU state */
+  counter_t sms_generations;	/* generations ended and recorded */
+  counter_t sms_triggers;	/* trigger accesses that found a pattern */
   /* ECE552 Assignment 4 - END CODE */
 
   /* miss/replacement handler, read/write BSIZE bytes starting at BADDR
@@ -227,6 +392,34 @@ struct cache_t
  				   may be more than one cycle, as specified
  				   by the miss handler */
 
+  /* miss status holding registers, the cache is blocking-free (unlimited
+     outstanding misses) when MSHRS is NULL */
+  struct cache_mshr *mshrs;	/* MSHR file */
+  int mshr_nentries;		/* MSHR entries, i.e., outstanding fills */
+  int mshr_ntargets;		/* accesses that may merge into one fill */
+
+  /* write-back buffer, dirty evictions are written to the next level of
+     memory inline when WBB is NULL */
+  struct cache_wb_entry *wbb;	/* write-back buffer, a FIFO */
+  int wbb_size;			/* write-back buffer entries */
+  int wbb_head;			/* oldest buffered write */
+  int wbb_num;			/* number of buffered writes */
+
+  /* fully-associative victim cache, between this cache and the next level
+     of memory, none when VC is NULL */
+  struct cache_vc_entry *vc;	/* victim cache entries */
+  int vc_size;			/* victim cache entries */
+  int vc_num;			/* valid victim cache entries */
+  counter_t vc_clock;		/* victim cache insertions, orders entries */
+
+  /* inclusion with the caches directly above this one */
+  enum cache_inclusion inclusion;	/* inclusion policy */
+  struct cache_t *uppers[CACHE_MAX_UPPERS]; /* caches missing into this one */
+  int nuppers;			/* number of caches above */
+  struct cache_t *excl_lower;	/* exclusive cache below that takes the
+				   blocks this cache evicts, or NULL */
+  int cap_countdown;		/* accesses until the next capacity sample */
+
   /* per-cache stats */
   counter_t hits;		/* total number of hits */
   counter_t misses;		/* total number of misses */
@@ -241,6 +434,31 @@ struct cache_t
   counter_t prefetch_hits;	/* total number of prefetch accesses that are hits */ 
   counter_t prefetch_misses;	/* total number of prefetch accesses that miss in this cache */
 
+  counter_t mshr_allocs;	/* misses that allocated an MSHR */
+  counter_t mshr_merges;	/* secondary misses merged into an MSHR */
+  counter_t mshr_full_stalls;	/* misses that waited for a free MSHR */
+  counter_t mshr_target_stalls;	/* secondary misses that found no free target */
+  counter_t mshr_stall_cycles;	/* cycles spent waiting on MSHRs */
+
+  counter_t wbb_writes;		/* writes entering the write-back buffer */
+  counter_t wbb_hits;		/* misses served from the write-back buffer */
+  counter_t wbb_full_stalls;	/* writes that waited on a full buffer */
+  counter_t wbb_occupancy;	/* cumulative buffer occupancy at writes */
+
+  counter_t vc_lookups;		/* misses that searched the victim cache */
+  counter_t vc_hits;		/* misses served from the victim cache */
+  counter_t vc_insertions;	/* evicted blocks put in the victim cache */
+  counter_t vc_occupancy;	/* cumulative victim cache occupancy at
+				   lookups */
+
+  counter_t back_invals;	/* blocks above invalidated by evictions */
+  counter_t back_inval_dirty;	/* back-invalidated blocks that were dirty */
+  counter_t excl_fills;		/* blocks evicted above and filled here */
+  counter_t excl_moves;		/* hits that moved the block above */
+  counter_t cap_samples;	/* effective capacity samples */
+  counter_t cap_bytes;		/* cumulative distinct bytes held by this
+				   cache and the caches above it */
+
 
 
   /* last block to hit, used to optimize cache hit processing */
@@ -272,10 +490,88 @@ cache_create(char *name,		/* name of the cache */
 	     unsigned int hit_latency,/* latency in cycles for a hit */
 	     int prefetch_type);      /* the type of the prefetcher for this cache */	
 
+/* give cache CP a file of NENTRIES miss status holding registers, each
+   merging up to NTARGETS accesses to the block it is filling, zero entries
+   leaves the cache with unlimited outstanding misses; MSHRs are only
+   modeled for timed accesses, i.e., NOW > 0 */
+void
+cache_mshr_config(struct cache_t *cp,	/* cache instance */
+		  int nentries,		/* MSHR entries */
+		  int ntargets);	/* targets per entry */
+
+/* give cache CP a write-back buffer of NENTRIES dirty blocks that drains
+   to the next level of memory whenever the bus is free, zero entries
+   writes dirty evictions back inline */
+void
+cache_wbb_config(struct cache_t *cp,	/* cache instance */
+		 int nentries);		/* write-back buffer entries */
+
+/* give cache CP a fully-associative victim cache of NENTRIES blocks that
+   catches its evictions, zero entries for no victim cache */
+void
+cache_vc_config(struct cache_t *cp,	/* cache instance */
+		int nentries);		/* victim cache entries */
+
+/* make cache UPPER miss into cache LOWER under inclusion policy POLICY,
+   all the caches above LOWER share its policy; exclusion needs equal
+   block sizes, inclusion an upper block no bigger than the lower block */
+void
+cache_inclusion_config(struct cache_t *lower,	/* cache below */
+		       struct cache_t *upper,	/* cache above */
+		       enum cache_inclusion policy); /* inclusion policy */
+
+/* return non-zero if an access to ADDR at time NOW would be accepted
+   without waiting for an MSHR, i.e., the block is present and not being
+   filled, its fill can take another target, or an MSHR is free */
+int
+cache_mshr_avail(struct cache_t *cp,	/* cache instance */
+		 md_addr_t addr,	/* address of access */
+		 tick_t now);		/* time of access */
+
+/* return the earliest time after NOW at which an MSHR of cache CP completes
+   its fill, zero if none is outstanding */
+tick_t
+cache_mshr_next_ready(struct cache_t *cp,	/* cache instance */
+		      tick_t now);		/* current time */
+
+/* configure the prefetch request queue of cache CP to hold QUEUE_SIZE
+   requests, and enable feedback-directed degree/distance control if
+   FEEDBACK is non-zero */
+void
+cache_pf_config(struct cache_t *cp,	/* cache instance */
+		int queue_size,		/* prefetch queue entries */
+		int feedback);		/* enable prefetch feedback? */
+
+/* size the reference prediction table (RPT_ASSOC ways), the stream buffers
+   (NSTREAMS streams of DEPTH blocks) or the SMS pattern history table
+   (PHT_SIZE entries) of cache CP, whichever its prefetcher uses */
+void
+cache_pf_tables(struct cache_t *cp,	/* cache instance */
+		int nstreams,		/* stream buffers */
+		int depth,		/* blocks ahead per stream buffer */
+		int pht_size,		/* SMS pattern history table entries */
+		int rpt_assoc);		/* RPT associativity */
+
+/* let the core's fetch-directed prefetcher prefetch into cache CP, its
+   fills are accounted to the PF_FETCH source */
+void
+cache_pf_fetch_enable(struct cache_t *cp);/* cache instance */
+
+/* fetch-directed prefetch of the block holding ADDR into cache CP at time
+   NOW, returns non-zero if a fill was issued, zero if the block is present */
+int
+cache_pf_fetch(struct cache_t *cp,	/* cache instance */
+	       md_addr_t addr,		/* address to prefetch */
+	       tick_t now);		/* time of prefetch */
+
 /* parse policy */
 enum cache_policy			/* replacement policy enum */
 cache_char2policy(char c);		/* replacement policy as a char */
 
+/* parse inclusion policy */
+enum cache_inclusion			/* inclusion policy enum */
+cache_str2inclusion(char *s);		/* inclusion policy as a string */
+
 /* print cache configuration */
 void
 cache_config(struct cache_t *cp,	/* cache instance */
@@ -297,16 +593,22 @@ void cache_stats(struct cache_t *cp, FILE *stream);
 /* figure out what type of prefetcher is used by this cache and
    call the appropriate function to generate the prefetch (e.g., next_line_prefetcher) */
 
-void generate_prefetch(struct cache_t *cp, md_addr_t addr);
+void generate_prefetch(struct cache_t *cp, md_addr_t addr, tick_t now, int miss);
 
 /* Next Line Prefetcher */
-void next_line_prefetcher(struct cache_t *cp, md_addr_t addr);
+void next_line_prefetcher(struct cache_t *cp, md_addr_t addr, tick_t now);
 
 /* Stride Prefetcher */
-void stride_prefetcher(struct cache_t *cp, md_addr_t addr);
+void stride_prefetcher(struct cache_t *cp, md_addr_t addr, tick_t now);
 
 /* Opend Ended Prefetcher */
-void open_ended_prefetcher(struct cache_t *cp, md_addr_t addr);
+void open_ended_prefetcher(struct cache_t *cp, md_addr_t addr, tick_t now);
+
+/* Stream Buffer Prefetcher */
+void stream_prefetcher(struct cache_t *cp, md_addr_t addr, tick_t now, int miss);
+
+/* Spatial Memory Streaming Prefetcher */
+void sms_prefetcher(struct cache_t *cp, md_addr_t addr, tick_t now);
 
 /* access a cache, perform a CMD operation on cache CP at address ADDR,
    places NBYTES of data at *P, returns latency of operation if initiated
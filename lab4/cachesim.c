@@ -0,0 +1,617 @@
+/* cachesim.c - functional cache hierarchy routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "cache.h"
+#include "loader.h"
+#include "options.h"
+#include "stats.h"
+#include "memtrace.h"
+#include "sim.h"
+#include "cachesim.h"
+
+/* level 1 instruction cache, entry level instruction cache */
+struct cache_t *cache_il1 = NULL;
+
+/* level 2 instruction cache */
+struct cache_t *cache_il2 = NULL;
+
+/* level 1 data cache, entry level data cache */
+struct cache_t *cache_dl1 = NULL;
+
+/* level 2 data cache */
+struct cache_t *cache_dl2 = NULL;
+
+/* instruction TLB */
+struct cache_t *itlb = NULL;
+
+/* data TLB */
+struct cache_t *dtlb = NULL;
+
+/* flush caches on system calls? */
+int flush_on_syscalls /* = FALSE */;
+
+/* convert 64-bit inst text addresses to 32-bit inst equivalents? */
+int compress_icache_addrs /* = FALSE */;
+
+/* l1 data cache l1 block miss handler function */
+static unsigned int			/* latency of block access */
+dl1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
+	      md_addr_t baddr,		/* block address to access */
+	      int bsize,		/* size of block to access */
+	      struct cache_blk_t *blk,	/* ptr to block in upper level */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* if 1 the access is a prefetch, if 0 it is a regular cache access */
+{
+  if (cache_dl2)
+    {
+      /* access next level of data cache hierarchy */
+      return cache_access(cache_dl2, cmd, baddr, NULL, bsize, 
+			  /* now */now, /* pudata */NULL, /* repl addr */NULL, prefetch);
+    }
+  else
+    {
+      /* access main memory, which is always done in the main simulator loop */
+      return /* access latency, ignored */1;
+    }
+}
+
+/* l2 data cache block miss handler function */
+static unsigned int			/* latency of block access */
+dl2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
+	      md_addr_t baddr,		/* block address to access */
+	      int bsize,		/* size of block to access */
+	      struct cache_blk_t *blk,	/* ptr to block in upper level */
+	      tick_t now,		/* time of access */
+	      int prefetch)
+	      
+{
+  /* this is a miss to the lowest level, so access main memory, which is
+     always done in the main simulator loop */
+  return /* access latency, ignored */1;
+}
+
+/* l1 inst cache l1 block miss handler function */
+static unsigned int			/* latency of block access */
+il1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
+	      md_addr_t baddr,		/* block address to access */
+	      int bsize,		/* size of block to access */
+	      struct cache_blk_t *blk,	/* ptr to block in upper level */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* if 1 the access is a prefetch, if 0 it is a regular cache access */
+
+{
+  if (cache_il2)
+    {
+      /* access next level of inst cache hierarchy */
+      return cache_access(cache_il2, cmd, baddr, NULL, bsize,
+			  /* now */now, /* pudata */NULL, /* repl addr */NULL, prefetch);
+    }
+  else
+    {
+      /* access main memory, which is always done in the main simulator loop */
+      return /* access latency, ignored */1;
+    }
+}
+
+/* l2 inst cache block miss handler function */
+static unsigned int			/* latency of block access */
+il2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
+	      md_addr_t baddr,		/* block address to access */
+	      int bsize,		/* size of block to access */
+	      struct cache_blk_t *blk,	/* ptr to block in upper level */
+	      tick_t now,		/* time of access */
+	      int prefetch)
+{
+  /* this is a miss to the lowest level, so access main memory, which is
+     always done in the main simulator loop */
+  return /* access latency, ignored */1;
+}
+
+/* inst cache block miss handler function */
+static unsigned int			/* latency of block access */
+itlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
+	       md_addr_t baddr,	/* block address to access */
+	       int bsize,		/* size of block to access */
+	       struct cache_blk_t *blk,	/* ptr to block in upper level */
+	       tick_t now,		/* time of access */
+	       int prefetch)
+{
+  md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
+
+  /* no real memory access, however, should have user data space attached */
+  assert(phy_page_ptr);
+
+  /* fake translation, for now... */
+  *phy_page_ptr = 0;
+
+  return /* access latency, ignored */1;
+}
+
+/* data cache block miss handler function */
+static unsigned int			/* latency of block access */
+dtlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
+	       md_addr_t baddr,		/* block address to access */
+	       int bsize,		/* size of block to access */
+	       struct cache_blk_t *blk,	/* ptr to block in upper level */
+	       tick_t now,		/* time of access */
+	       int prefetch)
+{
+  md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
+
+  /* no real memory access, however, should have user data space attached */
+  assert(phy_page_ptr);
+
+  /* fake translation, for now... */
+  *phy_page_ptr = 0;
+
+  return /* access latency, ignored */1;
+}
+
+/* cache/TLB options */
+static char *cache_dl1_opt /* = "none" */;
+static char *cache_dl2_opt /* = "none" */;
+static char *cache_il1_opt /* = "none" */;
+static char *cache_il2_opt /* = "none" */;
+static char *itlb_opt /* = "none" */;
+static char *dtlb_opt /* = "none" */;
+
+/* write-back buffer entries of the l1 and l2 data caches, and victim cache
+   entries of the l1 data cache, 0 for none */
+static int cache_dl1_wbb;
+static int cache_dl2_wbb;
+static int cache_dl1_vc;
+
+/* inclusion policy of the l2 caches over the l1 caches */
+static char *cache_inclusion_opt;
+
+/* prefetch request queue entries, per cache */
+static int pf_queue_size;
+
+/* adapt prefetch degree/distance to measured accuracy and lateness? */
+static int pf_feedback;
+
+/* stream buffers and blocks per stream, for the stream buffer prefetcher */
+static int pf_streams;
+static int pf_stream_depth;
+
+/* pattern history table entries, for the SMS prefetcher */
+static int pf_pht_size;
+
+/* reference prediction table ways, for the stride and open-ended prefetchers */
+static int pf_rpt_assoc;
+
+/* register cache hierarchy options */
+void
+cachesim_reg_options(struct opt_odb_t *odb)	/* options database */
+{
+  opt_reg_string(odb, "-cache:dl1",
+		 "l1 data cache config, i.e., {<config>|none}",
+		 &cache_dl1_opt, "dl1:256:32:1:l:0", /* print */TRUE, NULL);
+  opt_reg_note(odb,
+"  The cache config parameter <config> has the following format:\n"
+"\n"
+"    <name>:<nsets>:<bsize>:<assoc>:<repl>:<pref>\n"
+"\n"
+"    <name>   - name of the cache being defined\n"
+"    <nsets>  - number of sets in the cache\n"
+"    <bsize>  - block size of the cache\n"
+"    <assoc>  - associativity of the cache\n"
+"    <repl>   - block replacement strategy, 'l'-LRU, 'f'-FIFO, 'r'-random, 'n'-NRU\n"
+"    <pref>   - prefetcher type, 0 - no prefetcher, 1 - next line prefetcher,\n"
+"	       2 - open-ended prefetcher, -1 - stream buffers (see -prefetch:streams\n"
+"	       and -prefetch:depth), -2 - spatial memory streaming (see -prefetch:pht),\n"
+"	       any other number num - stride prefetcher with num entries in the Reference Prediction Table (RPT),\n"
+"	       a power of two multiple of -prefetch:rpt_assoc\n"
+"\n"
+"    Examples:   -cache:dl1 dl1:4096:32:1:l:1\n"
+"                -dtlb dtlb:128:4096:32:r:0\n"
+	       );
+  opt_reg_string(odb, "-cache:dl2",
+		 "l2 data cache config, i.e., {<config>|none}",
+		 &cache_dl2_opt, "ul2:1024:64:4:l:0", /* print */TRUE, NULL);
+  opt_reg_int(odb, "-cache:dl1wbb",
+	      "l1 data cache write-back buffer entries (0 for none)",
+	      &cache_dl1_wbb, /* default */0, /* print */TRUE, NULL);
+  opt_reg_int(odb, "-cache:dl2wbb",
+	      "l2 data cache write-back buffer entries (0 for none)",
+	      &cache_dl2_wbb, /* default */0, /* print */TRUE, NULL);
+  opt_reg_int(odb, "-cache:dl1vc",
+	      "l1 data cache victim cache entries (0 for none)",
+	      &cache_dl1_vc, /* default */0, /* print */TRUE, NULL);
+  opt_reg_string(odb, "-cache:inclusion",
+		 "inclusion of l2 over l1 caches, i.e., {nine|inclusive|exclusive}",
+		 &cache_inclusion_opt, "nine", /* print */TRUE, NULL);
+  opt_reg_string(odb, "-cache:il1",
+		 "l1 inst cache config, i.e., {<config>|dl1|dl2|none}",
+		 &cache_il1_opt, "il1:256:32:1:l:0", /* print */TRUE, NULL);
+  opt_reg_note(odb,
+"  Cache levels can be unified by pointing a level of the instruction cache\n"
+"  hierarchy at the data cache hiearchy using the \"dl1\" and \"dl2\" cache\n"
+"  configuration arguments.  Most sensible combinations are supported, e.g.,\n"
+"\n"
+"    A unified l2 cache (il2 is pointed at dl2):\n"
+"      -cache:il1 il1:128:64:1:l:0 -cache:il2 dl2\n"
+"      -cache:dl1 dl1:256:32:1:l:0 -cache:dl2 ul2:1024:64:2:l:0\n"
+"\n"
+"    Or, a fully unified cache hierarchy (il1 pointed at dl1):\n"
+"      -cache:il1 dl1\n"
+"      -cache:dl1 ul1:256:32:1:l:0 -cache:dl2 ul2:1024:64:2:l:0\n"
+	       );
+  opt_reg_string(odb, "-cache:il2",
+		 "l2 instruction cache config, i.e., {<config>|dl2|none}",
+		 &cache_il2_opt, "dl2", /* print */TRUE, NULL);
+  opt_reg_string(odb, "-tlb:itlb",
+		 "instruction TLB config, i.e., {<config>|none}",
+		 &itlb_opt, "itlb:16:4096:4:l:0", /* print */TRUE, NULL);
+  opt_reg_string(odb, "-tlb:dtlb",
+		 "data TLB config, i.e., {<config>|none}",
+		 &dtlb_opt, "dtlb:32:4096:4:l:0", /* print */TRUE, NULL);
+  opt_reg_int(odb, "-prefetch:queue",
+	      "prefetch request queue entries per cache",
+	      &pf_queue_size, /* default */PF_QUEUE_SIZE,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_flag(odb, "-prefetch:feedback",
+	       "adapt prefetch degree/distance to accuracy and lateness",
+	       &pf_feedback, /* default */FALSE, /* print */TRUE, NULL);
+  opt_reg_int(odb, "-prefetch:streams",
+	      "stream buffers per cache (stream buffer prefetcher)",
+	      &pf_streams, /* default */PF_NUM_STREAMS,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_int(odb, "-prefetch:depth",
+	      "blocks prefetched ahead per stream buffer",
+	      &pf_stream_depth, /* default */PF_STREAM_DEPTH,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_int(odb, "-prefetch:pht",
+	      "SMS pattern history table entries per cache",
+	      &pf_pht_size, /* default */SMS_PHT_SIZE,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_int(odb, "-prefetch:rpt_assoc",
+	      "reference prediction table associativity (stride prefetchers)",
+	      &pf_rpt_assoc, /* default */1,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_flag(odb, "-flush", "flush caches on system calls",
+	       &flush_on_syscalls, /* default */FALSE, /* print */TRUE, NULL);
+  opt_reg_flag(odb, "-cache:icompress",
+	       "convert 64-bit inst addresses to 32-bit inst equivalents",
+	       &compress_icache_addrs, /* default */FALSE,
+	       /* print */TRUE, NULL);
+}
+
+/* check cache hierarchy options and create the caches and TLBs */
+void
+cachesim_check_options(void)
+{
+  char name[128], c;
+  int nsets, bsize, assoc;
+  int prefetch_type;			/* this specifies the type of the prefetcher */
+
+  /* use a level 1 D-cache? */
+  if (!mystricmp(cache_dl1_opt, "none"))
+    {
+      cache_dl1 = NULL;
+
+      /* the level 2 D-cache cannot be defined */
+      if (strcmp(cache_dl2_opt, "none"))
+	fatal("the l1 data cache must defined if the l2 cache is defined");
+      cache_dl2 = NULL;
+    }
+  else /* dl1 is defined */
+    {
+      if (sscanf(cache_dl1_opt, "%[^:]:%d:%d:%d:%c:%d", 
+		 name, &nsets, &bsize, &assoc, &c, &prefetch_type) != 6)
+	fatal("bad l1 D-cache parms: <name>:<nsets>:<bsize>:<assoc>:<repl>:<pref>");
+      cache_dl1 = cache_create(name, nsets, bsize, /* balloc */FALSE,
+			       /* usize */0, assoc, cache_char2policy(c),
+			       dl1_access_fn, /* hit latency */1, prefetch_type);
+
+      /* is the level 2 D-cache defined? */
+      if (!mystricmp(cache_dl2_opt, "none"))
+	cache_dl2 = NULL;
+      else
+	{
+	  if (sscanf(cache_dl2_opt, "%[^:]:%d:%d:%d:%c:%d",
+		     name, &nsets, &bsize, &assoc, &c, &prefetch_type) != 6)
+	    fatal("bad l2 D-cache parms: "
+		  "<name>:<nsets>:<bsize>:<assoc>:<repl>:<pref>");
+	  cache_dl2 = cache_create(name, nsets, bsize, /* balloc */FALSE,
+				   /* usize */0, assoc, cache_char2policy(c), 
+				   dl2_access_fn, /* hit latency */1, prefetch_type);
+	}
+    }
+
+  /* use a level 1 I-cache? */
+  if (!mystricmp(cache_il1_opt, "none"))
+    {
+      cache_il1 = NULL;
+
+      /* the level 2 I-cache cannot be defined */
+      if (strcmp(cache_il2_opt, "none"))
+	fatal("the l1 inst cache must defined if the l2 cache is defined");
+      cache_il2 = NULL;
+    }
+  else if (!mystricmp(cache_il1_opt, "dl1"))
+    {
+      if (!cache_dl1)
+	fatal("I-cache l1 cannot access D-cache l1 as it's undefined");
+      cache_il1 = cache_dl1;
+
+      /* the level 2 I-cache cannot be defined */
+      if (strcmp(cache_il2_opt, "none"))
+	fatal("the l1 inst cache must defined if the l2 cache is defined");
+      cache_il2 = NULL;
+    }
+  else if (!mystricmp(cache_il1_opt, "dl2"))
+    {
+      if (!cache_dl2)
+	fatal("I-cache l1 cannot access D-cache l2 as it's undefined");
+      cache_il1 = cache_dl2;
+
+      /* the level 2 I-cache cannot be defined */
+      if (strcmp(cache_il2_opt, "none"))
+	fatal("the l1 inst cache must defined if the l2 cache is defined");
+      cache_il2 = NULL;
+    }
+  else /* il1 is defined */
+    {
+      if (sscanf(cache_il1_opt, "%[^:]:%d:%d:%d:%c:%d",
+		 name, &nsets, &bsize, &assoc, &c,&prefetch_type) != 6)
+	fatal("bad l1 I-cache parms: <name>:<nsets>:<bsize>:<assoc>:<repl>:<pref>");
+      cache_il1 = cache_create(name, nsets, bsize, /* balloc */FALSE,
+			       /* usize */0, assoc, cache_char2policy(c), 
+			       il1_access_fn, /* hit latency */1, prefetch_type);
+
+      /* is the level 2 D-cache defined? */
+      if (!mystricmp(cache_il2_opt, "none"))
+	cache_il2 = NULL;
+      else if (!mystricmp(cache_il2_opt, "dl2"))
+	{
+	  if (!cache_dl2)
+	    fatal("I-cache l2 cannot access D-cache l2 as it's undefined");
+	  cache_il2 = cache_dl2;
+	}
+      else
+	{
+	  if (sscanf(cache_il2_opt, "%[^:]:%d:%d:%d:%c:%d",
+		     name, &nsets, &bsize, &assoc, &c, &prefetch_type) != 6)
+	    fatal("bad l2 I-cache parms: "
+		  "<name>:<nsets>:<bsize>:<assoc>:<repl>:<pref>");
+	  cache_il2 = cache_create(name, nsets, bsize, /* balloc */FALSE,
+				   /* usize */0, assoc, cache_char2policy(c), 
+				   il2_access_fn, /* hit latency */1, prefetch_type);
+	}
+    }
+
+  /* use an I-TLB? */
+  if (!mystricmp(itlb_opt, "none"))
+    itlb = NULL;
+  else
+    {
+      if (sscanf(itlb_opt, "%[^:]:%d:%d:%d:%c:%d",
+		 name, &nsets, &bsize, &assoc, &c, &prefetch_type) != 6)
+	fatal("bad TLB parms: <name>:<nsets>:<page_size>:<assoc>:<repl>:<pref>");
+      itlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
+			  /* usize */sizeof(md_addr_t), assoc,
+			  cache_char2policy(c), itlb_access_fn,
+			  /* hit latency */1, prefetch_type);
+    }
+
+  /* use a D-TLB? */
+  if (!mystricmp(dtlb_opt, "none"))
+    dtlb = NULL;
+  else
+    {
+      if (sscanf(dtlb_opt, "%[^:]:%d:%d:%d:%c:%d",
+		 name, &nsets, &bsize, &assoc, &c, &prefetch_type) != 6)
+	fatal("bad TLB parms: <name>:<nsets>:<page_size>:<assoc>:<repl>:<pref>");
+      dtlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
+			  /* usize */sizeof(md_addr_t), assoc,
+			  cache_char2policy(c),  dtlb_access_fn,
+			  /* hit latency */1, prefetch_type);
+    }
+
+  /* write-back buffers and victim cache */
+  if (cache_dl1)
+    {
+      cache_wbb_config(cache_dl1, cache_dl1_wbb);
+      cache_vc_config(cache_dl1, cache_dl1_vc);
+    }
+  if (cache_dl2)
+    cache_wbb_config(cache_dl2, cache_dl2_wbb);
+
+  /* inclusion of each l2 cache over the l1 caches that miss into it */
+  if (cache_dl2 && cache_dl1)
+    cache_inclusion_config(cache_dl2, cache_dl1,
+			   cache_str2inclusion(cache_inclusion_opt));
+  if (cache_il2 && cache_il1)
+    cache_inclusion_config(cache_il2, cache_il1,
+			   cache_str2inclusion(cache_inclusion_opt));
+
+  /* configure the prefetch request queues and prefetcher tables */
+  if (cache_dl1)
+    {
+      cache_pf_config(cache_dl1, pf_queue_size, pf_feedback);
+      cache_pf_tables(cache_dl1, pf_streams, pf_stream_depth, pf_pht_size,
+		      pf_rpt_assoc);
+    }
+  if (cache_dl2)
+    {
+      cache_pf_config(cache_dl2, pf_queue_size, pf_feedback);
+      cache_pf_tables(cache_dl2, pf_streams, pf_stream_depth, pf_pht_size,
+		      pf_rpt_assoc);
+    }
+  if (cache_il1)
+    {
+      cache_pf_config(cache_il1, pf_queue_size, pf_feedback);
+      cache_pf_tables(cache_il1, pf_streams, pf_stream_depth, pf_pht_size,
+		      pf_rpt_assoc);
+    }
+  if (cache_il2)
+    {
+      cache_pf_config(cache_il2, pf_queue_size, pf_feedback);
+      cache_pf_tables(cache_il2, pf_streams, pf_stream_depth, pf_pht_size,
+		      pf_rpt_assoc);
+    }
+}
+
+/* register cache hierarchy statistics */
+void
+cachesim_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
+{
+  /* register cache stats */
+  if (cache_il1
+      && (cache_il1 != cache_dl1 && cache_il1 != cache_dl2))
+    cache_reg_stats(cache_il1, sdb);
+  if (cache_il2
+      && (cache_il2 != cache_dl1 && cache_il2 != cache_dl2))
+    cache_reg_stats(cache_il2, sdb);
+  if (cache_dl1)
+    cache_reg_stats(cache_dl1, sdb);
+  if (cache_dl2)
+    cache_reg_stats(cache_dl2, sdb);
+  if (itlb)
+    cache_reg_stats(itlb, sdb);
+  if (dtlb)
+    cache_reg_stats(dtlb, sdb);
+}
+
+/* fetch the instruction at PC through the I-TLB and l1 inst cache */
+void
+cachesim_fetch(md_addr_t pc)			/* instruction address */
+{
+  if (itlb)
+    cache_access(itlb, Read, IACOMPRESS(pc),
+		 NULL, ISCOMPRESS(sizeof(md_inst_t)), 0, NULL, NULL, 0);
+  if (cache_il1)
+    cache_access(cache_il1, Read, IACOMPRESS(pc),
+		 NULL, ISCOMPRESS(sizeof(md_inst_t)), 0, NULL, NULL, 0);
+}
+
+/* issue a data reference through the D-TLB and l1 data cache */
+void
+cachesim_data(enum mem_cmd cmd,			/* Read or Write */
+	      md_addr_t addr,			/* data address */
+	      int nbytes)			/* reference size */
+{
+  if (dtlb)
+    cache_access(dtlb, cmd, addr, NULL, nbytes, 0, NULL, NULL, 0);
+  if (cache_dl1)
+    cache_access(cache_dl1, cmd, addr, NULL, nbytes, 0, NULL, NULL, 0);
+}
+
+/* flush the data caches and D-TLB, as on a system call */
+void
+cachesim_flush(void)
+{
+  if (dtlb)
+    cache_flush(dtlb, 0);
+  if (cache_dl1)
+    cache_flush(cache_dl1, 0);
+  if (cache_dl2)
+    cache_flush(cache_dl2, 0);
+}
+
+/* replay memory reference trace MT through the cache hierarchy, references
+   are issued in trace order with no timing */
+void
+cachesim_replay(struct mtr_file_t *mt,		/* trace to replay */
+		unsigned int max_insts,		/* inst limit, 0 for none */
+		counter_t *num_refs,		/* loads and stores replayed */
+		md_addr_t *pc)			/* PC of current record */
+{
+  struct mtr_rec_t rec;
+  int refs_counted = FALSE;
+
+  fprintf(stderr, "sim: ** replaying memory reference trace **\n");
+
+  while (mtr_read(mt, &rec))
+    {
+      *pc = rec.pc;
+      switch (rec.kind)
+	{
+	case MTR_IFETCH:
+	  if (max_insts && sim_num_insn >= max_insts)
+	    return;
+
+	  cachesim_fetch(rec.addr);
+	  sim_num_insn++;
+	  refs_counted = FALSE;
+	  break;
+
+	case MTR_DATA:
+	  /* count loads and stores once per instruction, as double-word
+	     accesses issue two references */
+	  if (!rec.sys && !refs_counted)
+	    {
+	      (*num_refs)++;
+	      refs_counted = TRUE;
+	    }
+	  cachesim_data(rec.cmd, rec.addr, rec.nbytes);
+	  break;
+
+	case MTR_SYSCALL:
+	  if (flush_on_syscalls)
+	    cachesim_flush();
+	  break;
+
+	default:
+	  panic("bogus memory trace record");
+	}
+    }
+}
@@ -0,0 +1,147 @@
+/* cachesim.h - functional cache hierarchy interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "options.h"
+#include "stats.h"
+#include "cache.h"
+#include "loader.h"
+#include "memtrace.h"
+
+/*
+ * The functional cache hierarchy shared by the cache simulators that run
+ * without timing (sim-cache, sim-mtrace): up to two levels of instruction
+ * and data cache (with any levels unified) and one level of instruction and
+ * data TLBs.  This module owns the cache and TLB options, builds the
+ * hierarchy from them, and issues references into it, so a simulator only
+ * supplies the reference stream (and get_PC() for PC-indexed prefetchers).
+ */
+
+/* level 1 instruction cache, entry level instruction cache */
+extern struct cache_t *cache_il1;
+
+/* level 2 instruction cache */
+extern struct cache_t *cache_il2;
+
+/* level 1 data cache, entry level data cache */
+extern struct cache_t *cache_dl1;
+
+/* level 2 data cache */
+extern struct cache_t *cache_dl2;
+
+/* instruction TLB */
+extern struct cache_t *itlb;
+
+/* data TLB */
+extern struct cache_t *dtlb;
+
+/* flush caches on system calls? */
+extern int flush_on_syscalls;
+
+/* convert 64-bit inst text addresses to 32-bit inst equivalents? */
+extern int compress_icache_addrs;
+
+/* convert 64-bit inst text addresses to 32-bit inst equivalents */
+#ifdef TARGET_PISA
+#define IACOMPRESS(A)							\
+  (compress_icache_addrs ? ((((A) - ld_text_base) >> 1) + ld_text_base) : (A))
+#define ISCOMPRESS(SZ)							\
+  (compress_icache_addrs ? ((SZ) >> 1) : (SZ))
+#else /* !TARGET_PISA */
+#define IACOMPRESS(A)		(A)
+#define ISCOMPRESS(SZ)		(SZ)
+#endif /* TARGET_PISA */
+
+/* register cache hierarchy options */
+void
+cachesim_reg_options(struct opt_odb_t *odb);	/* options database */
+
+/* check cache hierarchy options and create the caches and TLBs */
+void
+cachesim_check_options(void);
+
+/* register cache hierarchy statistics */
+void
+cachesim_reg_stats(struct stat_sdb_t *sdb);	/* stats database */
+
+/* fetch the instruction at PC through the I-TLB and l1 inst cache */
+void
+cachesim_fetch(md_addr_t pc);			/* instruction address */
+
+/* issue a data reference through the D-TLB and l1 data cache */
+void
+cachesim_data(enum mem_cmd cmd,			/* Read or Write */
+	      md_addr_t addr,			/* data address */
+	      int nbytes);			/* reference size */
+
+/* flush the data caches and D-TLB, as on a system call */
+void
+cachesim_flush(void);
+
+/* replay memory reference trace MT through the cache hierarchy, until the
+   trace ends or MAX_INSTS instructions (if non-zero) have been replayed;
+   loads and stores are counted in *NUM_REFS, and the PC of each record is
+   stored in *PC so that get_PC() sees the referencing instruction */
+void
+cachesim_replay(struct mtr_file_t *mt,		/* trace to replay */
+		unsigned int max_insts,		/* inst limit, 0 for none */
+		counter_t *num_refs,		/* loads and stores replayed */
+		md_addr_t *pc);			/* PC of current record */
+
+#endif /* CACHESIM_H */
@@ -0,0 +1,362 @@
+/* dram.c - DRAM controller timing model routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+#include "dram.h"
+
+/* create a DRAM main memory of NCHANNELS channels of NBANKS banks with
+   ROW_SIZE byte rows, moving BUS_WIDTH bytes per burst; all of NCHANNELS,
+   NBANKS, ROW_SIZE and BUS_WIDTH must be powers of two */
+struct dram_t *				/* DRAM instance */
+dram_create(int nchannels,		/* number of channels */
+	    int nbanks,			/* banks per channel */
+	    int row_size,		/* bytes per row */
+	    int bus_width,		/* bytes moved per burst */
+	    int t_ctrl,			/* controller latency */
+	    int t_rcd,			/* activate to column command */
+	    int t_cas,			/* column command to data */
+	    int t_rp,			/* precharge to activate */
+	    int t_burst,		/* cycles per data burst */
+	    enum dram_sched_t sched)	/* scheduling policy */
+{
+  struct dram_t *dp;
+  int i, j;
+
+  /* check all DRAM parameters */
+  if (nchannels <= 0 || (nchannels & (nchannels-1)) != 0)
+    fatal("DRAM channels `%d' must be a positive power of two", nchannels);
+  if (nbanks <= 0 || (nbanks & (nbanks-1)) != 0)
+    fatal("DRAM banks `%d' must be a positive power of two", nbanks);
+  if (row_size <= 0 || (row_size & (row_size-1)) != 0)
+    fatal("DRAM row size `%d' must be a positive power of two", row_size);
+  if (bus_width <= 0 || (bus_width & (bus_width-1)) != 0)
+    fatal("DRAM bus width `%d' must be a positive power of two", bus_width);
+  if (t_ctrl < 0 || t_rcd < 0 || t_cas < 1 || t_rp < 0 || t_burst < 1)
+    fatal("DRAM timings must be positive (tCAS and tBURST at least 1)");
+
+  dp = calloc(1, sizeof(struct dram_t));
+  if (!dp)
+    fatal("out of virtual memory");
+
+  dp->nchannels = nchannels;
+  dp->nbanks = nbanks;
+  dp->row_size = row_size;
+  dp->bus_width = bus_width;
+  dp->t_ctrl = t_ctrl;
+  dp->t_rcd = t_rcd;
+  dp->t_cas = t_cas;
+  dp->t_rp = t_rp;
+  dp->t_burst = t_burst;
+  dp->sched = sched;
+
+  dp->col_shift = log_base2(row_size);
+  dp->chan_mask = nchannels - 1;
+  dp->chan_shift = log_base2(nchannels);
+  dp->bank_mask = nbanks - 1;
+  dp->bank_shift = log_base2(nbanks);
+
+  dp->channels = calloc(nchannels, sizeof(struct dram_channel_t));
+  if (!dp->channels)
+    fatal("out of virtual memory");
+  for (i=0; i < nchannels; i++)
+    {
+      dp->channels[i].banks = calloc(nbanks, sizeof(struct dram_bank_t));
+      if (!dp->channels[i].banks)
+	fatal("out of virtual memory");
+
+      /* all banks start out precharged */
+      for (j=0; j < nbanks; j++)
+	{
+	  dp->channels[i].banks[j].cur.row = -1;
+	  dp->channels[i].banks[j].prev.row = -1;
+	}
+    }
+
+  return dp;
+}
+
+/* parse scheduling policy */
+enum dram_sched_t			/* scheduling policy enum */
+dram_str2sched(char *s)			/* scheduling policy as a string */
+{
+  if (!mystricmp(s, "fcfs"))
+    return DRAM_FCFS;
+  else if (!mystricmp(s, "frfcfs"))
+    return DRAM_FRFCFS;
+  fatal("bogus DRAM scheduling policy, `%s'", s);
+  return DRAM_FCFS;
+}
+
+/* access BSIZE bytes at block address BADDR of DRAM DP at time NOW,
+   returns the latency of the access in cycles */
+unsigned int				/* latency of access in cycles */
+dram_access(struct dram_t *dp,		/* DRAM instance */
+	    enum mem_cmd cmd,		/* Read or Write */
+	    md_addr_t baddr,		/* block address to access */
+	    int bsize,			/* bytes to access */
+	    tick_t now)			/* time of access */
+{
+  md_addr_t raddr = baddr >> dp->col_shift;
+  struct dram_channel_t *ch = &dp->channels[raddr & dp->chan_mask];
+  struct dram_bank_t *bk =
+    &ch->banks[(raddr >> dp->chan_shift) & dp->bank_mask];
+  int row = (int)(raddr >> (dp->chan_shift + dp->bank_shift));
+  int xfer = ((bsize + dp->bus_width - 1) / dp->bus_width) * dp->t_burst;
+  struct dram_row_t *rp;
+  tick_t arrive = now + dp->t_ctrl, start, col, done, shift;
+  int act;
+
+  bk->accesses++;
+
+  /* untimed accesses (NOW == 0), e.g., functional warming, only move the
+     open row, bank and bus timing is left alone */
+  if (now == 0)
+    {
+      act = 0;
+      if (bk->cur.row == row)
+	{
+	  bk->row_hits++;
+	  dp->row_hits++;
+	}
+      else
+	{
+	  act = (bk->cur.row < 0) ? dp->t_rcd : dp->t_rp + dp->t_rcd;
+	  if (bk->cur.row < 0)
+	    {
+	      bk->row_misses++;
+	      dp->row_misses++;
+	    }
+	  else
+	    {
+	      bk->row_conflicts++;
+	      dp->row_conflicts++;
+	    }
+	  bk->prev.row = -1;
+	  bk->cur.row = row;
+	  bk->cur.open = bk->cur.col_free = bk->cur.close = 0;
+	}
+      bk->busy += act + xfer;
+      if (cmd == Read)
+	{
+	  dp->reads++;
+	  dp->read_lat += dp->t_ctrl + act + dp->t_cas + xfer;
+	}
+      else
+	dp->writes++;
+      return dp->t_ctrl + act + dp->t_cas + xfer;
+    }
+
+  if (bk->cur.row == row)
+    {
+      /* row hit, after the column commands already queued on the row */
+      rp = &bk->cur;
+      col = MAX(arrive, MAX(rp->open, rp->col_free));
+      act = 0;
+      bk->row_hits++;
+      dp->row_hits++;
+    }
+  else if (dp->sched == DRAM_FRFCFS
+	   && bk->prev.row == row
+	   && arrive < bk->prev.close)
+    {
+      /* row hit on the row a queued conflict has not closed yet, served
+	 ahead of that conflict, which opens its row that much later */
+      rp = &bk->prev;
+      col = MAX(arrive, rp->col_free);
+      shift = col + xfer - rp->close;
+      if (shift > 0)
+	{
+	  rp->close += shift;
+	  bk->cur.open += shift;
+	  bk->cur.col_free += shift;
+	}
+      act = 0;
+      bk->row_hits++;
+      dp->row_hits++;
+      dp->reorders++;
+    }
+  else
+    {
+      /* the row is opened after the requests queued on the open row */
+      start = MAX(arrive, MAX(bk->cur.open, bk->cur.col_free));
+      if (bk->cur.row < 0)
+	{
+	  act = dp->t_rcd;
+	  bk->row_misses++;
+	  dp->row_misses++;
+	}
+      else
+	{
+	  act = dp->t_rp + dp->t_rcd;
+	  bk->row_conflicts++;
+	  dp->row_conflicts++;
+	}
+      col = start + act;
+
+      bk->cur.close = start;
+      bk->prev = bk->cur;
+      bk->cur.row = row;
+      bk->cur.open = col;
+      bk->cur.close = 0;
+      bk->cur.col_free = col;
+      rp = &bk->cur;
+    }
+
+  /* the data follows the column command over the channel bus, column
+     commands to a row are spaced by the burst they move */
+  done = MAX(col + dp->t_cas, ch->bus_free) + xfer;
+  ch->bus_free = done;
+  rp->col_free = col + xfer;
+  bk->busy += act + xfer;
+
+  dp->queue_lat += (done - now) - (dp->t_ctrl + act + dp->t_cas + xfer);
+  if (cmd == Read)
+    {
+      dp->reads++;
+      dp->read_lat += done - now;
+    }
+  else
+    dp->writes++;
+
+  return (unsigned int)(done - now);
+}
+
+/* print DRAM configuration */
+void
+dram_config(struct dram_t *dp,		/* DRAM instance */
+	    FILE *stream)		/* output stream */
+{
+  fprintf(stream,
+	  "dram: %d channel(s), %d banks/channel, %d byte rows, "
+	  "%d byte bursts, `%s' scheduling\n",
+	  dp->nchannels, dp->nbanks, dp->row_size, dp->bus_width,
+	  dp->sched == DRAM_FCFS ? "FCFS"
+	  : dp->sched == DRAM_FRFCFS ? "FR-FCFS"
+	  : (abort(), ""));
+  fprintf(stream,
+	  "dram: tCTRL=%d tRCD=%d tCAS=%d tRP=%d tBURST=%d\n",
+	  dp->t_ctrl, dp->t_rcd, dp->t_cas, dp->t_rp, dp->t_burst);
+}
+
+/* register DRAM stats, per-bank utilization is relative to the simulator
+   stat CYCLES_STAT */
+void
+dram_reg_stats(struct dram_t *dp,	/* DRAM instance */
+	       struct stat_sdb_t *sdb,	/* stats database */
+	       char *cycles_stat)	/* name of the cycle count stat */
+{
+  char buf[512], buf1[512], pfx[128];
+  struct dram_bank_t *bk;
+  int i, j;
+
+  stat_reg_formula(sdb, "dram.accesses", "total number of DRAM accesses",
+		   "dram.reads + dram.writes", "%12.0f");
+  stat_reg_counter(sdb, "dram.reads", "DRAM reads (cache fills)",
+		   &dp->reads, 0, NULL);
+  stat_reg_counter(sdb, "dram.writes", "DRAM writes (write backs)",
+		   &dp->writes, 0, NULL);
+  stat_reg_counter(sdb, "dram.row_hits", "accesses to an open row",
+		   &dp->row_hits, 0, NULL);
+  stat_reg_counter(sdb, "dram.row_misses", "accesses to a precharged bank",
+		   &dp->row_misses, 0, NULL);
+  stat_reg_counter(sdb, "dram.row_conflicts",
+		   "accesses that closed another row",
+		   &dp->row_conflicts, 0, NULL);
+  stat_reg_formula(sdb, "dram.row_hit_rate",
+		   "row buffer hit rate (i.e., row hits/accesses)",
+		   "dram.row_hits / dram.accesses", NULL);
+  stat_reg_counter(sdb, "dram.reorders",
+		   "row hits served ahead of a queued row conflict",
+		   &dp->reorders, 0, NULL);
+  stat_reg_counter(sdb, "dram.read_lat", "cumulative DRAM read latency",
+		   &dp->read_lat, 0, NULL);
+  stat_reg_formula(sdb, "dram.avg_read_lat", "average DRAM read latency",
+		   "dram.read_lat / dram.reads", NULL);
+  stat_reg_counter(sdb, "dram.queue_lat",
+		   "cumulative cycles waiting on busy banks and buses",
+		   &dp->queue_lat, 0, NULL);
+  stat_reg_formula(sdb, "dram.avg_queue_lat",
+		   "average cycles an access waited on busy banks and buses",
+		   "dram.queue_lat / dram.accesses", NULL);
+
+  for (i=0; i < dp->nchannels; i++)
+    {
+      for (j=0; j < dp->nbanks; j++)
+	{
+	  bk = &dp->channels[i].banks[j];
+	  sprintf(pfx, "dram.ch%d.bank%d", i, j);
+
+	  sprintf(buf, "%s.accesses", pfx);
+	  stat_reg_counter(sdb, buf, "accesses to this bank",
+			   &bk->accesses, 0, NULL);
+	  sprintf(buf, "%s.row_hits", pfx);
+	  stat_reg_counter(sdb, buf, "accesses to an open row",
+			   &bk->row_hits, 0, NULL);
+	  sprintf(buf, "%s.row_conflicts", pfx);
+	  stat_reg_counter(sdb, buf, "accesses that closed another row",
+			   &bk->row_conflicts, 0, NULL);
+	  sprintf(buf, "%s.busy", pfx);
+	  stat_reg_counter(sdb, buf, "cycles spent on commands and data",
+			   &bk->busy, 0, NULL);
+	  sprintf(buf, "%s.util", pfx);
+	  sprintf(buf1, "%s.busy / %s", pfx, cycles_stat);
+	  stat_reg_formula(sdb, buf, "bank utilization (i.e., busy/cycles)",
+			   buf1, NULL);
+	}
+    }
+}
@@ -0,0 +1,201 @@
+/* dram.h - DRAM controller timing model interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef DRAM_H
+#define DRAM_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+
+/*
+ * This module models the timing of a DRAM main memory behind the lowest
+ * level of the cache hierarchy.  Memory is split into CHANNELS independent
+ * channels of BANKS banks each; every bank has one row buffer (open-page
+ * policy), every channel one data bus.  Addresses are mapped as
+ *
+ *	<row> <bank> <channel> <column>
+ *
+ * so that a row of ROW_SIZE bytes lives in one bank, and consecutive rows
+ * are spread over the channels first, then over the banks.
+ *
+ * An access is a row hit when its row is open in the bank (tCAS), a row
+ * miss when the bank is precharged (tRCD + tCAS) and a row conflict when
+ * another row must be closed first (tRP + tRCD + tCAS).  The block is then
+ * moved over the channel bus in BUS_WIDTH byte bursts of tBURST cycles.
+ * Each access also pays a fixed controller latency tCTRL.
+ *
+ * Like the caches, the model returns the latency of an access when it is
+ * made.  Requests to a busy bank queue behind it in arrival order (FCFS).
+ * The FR-FCFS scheduler additionally lets a row hit go first: a request to
+ * the row a bank still holds open, arriving before a queued conflict has
+ * closed it, is served on that row and the conflict opens its row later.
+ * The latency already returned for the conflict is not revised, only the
+ * requests that follow it see the delay.
+ */
+
+/* DRAM request scheduling policies */
+enum dram_sched_t {
+  DRAM_FCFS,			/* first come, first served */
+  DRAM_FRFCFS			/* first ready (row hits), first come */
+};
+
+/* a row held open in a bank, from its first column command to its
+   precharge */
+struct dram_row_t {
+  int row;			/* row number, -1 if the bank is precharged */
+  tick_t open;			/* first cycle a column command may issue */
+  tick_t close;			/* cycle of the precharge that closes the row,
+				   or 0 while no request has closed it */
+  tick_t col_free;		/* next cycle a column command may issue */
+};
+
+/* a DRAM bank */
+struct dram_bank_t {
+  struct dram_row_t cur;	/* row opened by the youngest request */
+  struct dram_row_t prev;	/* row that request closed, FR-FCFS row hits
+				   may still use it until its precharge */
+
+  /* per-bank stats */
+  counter_t accesses;		/* total accesses to this bank */
+  counter_t row_hits;		/* accesses to an open row */
+  counter_t row_misses;		/* accesses to a precharged bank */
+  counter_t row_conflicts;	/* accesses that closed another row */
+  counter_t busy;		/* cycles the bank spent on commands */
+};
+
+/* a DRAM channel */
+struct dram_channel_t {
+  tick_t bus_free;		/* next cycle the data bus is free */
+  struct dram_bank_t *banks;	/* banks of the channel */
+};
+
+/* a DRAM main memory */
+struct dram_t {
+  /* parameters */
+  int nchannels;		/* number of channels */
+  int nbanks;			/* banks per channel */
+  int row_size;			/* bytes per row (per bank) */
+  int bus_width;		/* bytes moved per burst */
+  int t_ctrl;			/* controller latency */
+  int t_rcd;			/* activate to column command */
+  int t_cas;			/* column command to data */
+  int t_rp;			/* precharge to activate */
+  int t_burst;			/* cycles per data burst */
+  enum dram_sched_t sched;	/* scheduling policy */
+
+  /* derived data, for fast decoding */
+  int col_shift;		/* log2(ROW_SIZE) */
+  int chan_mask;		/* NCHANNELS - 1 */
+  int chan_shift;		/* log2(NCHANNELS) */
+  int bank_mask;		/* NBANKS - 1 */
+  int bank_shift;		/* log2(NBANKS) */
+
+  struct dram_channel_t *channels;	/* channels of the memory */
+
+  /* stats */
+  counter_t reads;		/* read (fill) accesses */
+  counter_t writes;		/* write (write back) accesses */
+  counter_t row_hits;		/* accesses to an open row */
+  counter_t row_misses;		/* accesses to a precharged bank */
+  counter_t row_conflicts;	/* accesses that closed another row */
+  counter_t reorders;		/* FR-FCFS row hits served ahead of a
+				   queued row conflict */
+  counter_t read_lat;		/* cumulative read latency */
+  counter_t queue_lat;		/* cumulative cycles accesses waited on a
+				   busy bank or bus */
+};
+
+/* create a DRAM main memory of NCHANNELS channels of NBANKS banks with
+   ROW_SIZE byte rows, moving BUS_WIDTH bytes per burst; all of NCHANNELS,
+   NBANKS, ROW_SIZE and BUS_WIDTH must be powers of two */
+struct dram_t *				/* DRAM instance */
+dram_create(int nchannels,		/* number of channels */
+	    int nbanks,			/* banks per channel */
+	    int row_size,		/* bytes per row */
+	    int bus_width,		/* bytes moved per burst */
+	    int t_ctrl,			/* controller latency */
+	    int t_rcd,			/* activate to column command */
+	    int t_cas,			/* column command to data */
+	    int t_rp,			/* precharge to activate */
+	    int t_burst,		/* cycles per data burst */
+	    enum dram_sched_t sched);	/* scheduling policy */
+
+/* parse scheduling policy */
+enum dram_sched_t			/* scheduling policy enum */
+dram_str2sched(char *s);		/* scheduling policy as a string */
+
+/* access BSIZE bytes at block address BADDR of DRAM DP at time NOW,
+   returns the latency of the access in cycles */
+unsigned int				/* latency of access in cycles */
+dram_access(struct dram_t *dp,		/* DRAM instance */
+	    enum mem_cmd cmd,		/* Read or Write */
+	    md_addr_t baddr,		/* block address to access */
+	    int bsize,			/* bytes to access */
+	    tick_t now);		/* time of access */
+
+/* print DRAM configuration */
+void
+dram_config(struct dram_t *dp,		/* DRAM instance */
+	    FILE *stream);		/* output stream */
+
+/* register DRAM stats, per-bank utilization is relative to the simulator
+   stat CYCLES_STAT */
+void
+dram_reg_stats(struct dram_t *dp,	/* DRAM instance */
+	       struct stat_sdb_t *sdb,	/* stats database */
+	       char *cycles_stat);	/* name of the cycle count stat */
+
+#endif /* DRAM_H */
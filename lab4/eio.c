@@ -55,6 +55,7 @@
 #include <io.h>
 #else /* !_MSC_VER */
 #include <unistd.h>
+#include <fcntl.h>
 #endif
 
 #include "host.h"
@@ -462,6 +463,213 @@ eio_read_chkpt(struct regs_t *regs,		/* regs to dump */
   return trans_icnt;
 }
 
+/* host files opened on behalf of the simulated program, indexed by host
+   file descriptor, kept so native program checkpoints can reopen them */
+#define EIO_MAX_FDS		256
+static struct {
+  int valid;			/* descriptor opened by the program? */
+  char *fname;			/* file name, NULL for a dup of DUPOF */
+  int flags;			/* host open(2) flags */
+  int dupof;			/* untracked descriptor this one dups */
+} eio_fds[EIO_MAX_FDS];
+
+/* record host descriptor FD opened from file FNAME with open(2) FLAGS */
+void
+eio_fd_open(int fd, char *fname, int flags)
+{
+  if (fd < 0 || fd >= EIO_MAX_FDS)
+    return;
+
+  eio_fd_close(fd);
+  eio_fds[fd].valid = TRUE;
+  eio_fds[fd].flags = flags;
+
+  /* keep an absolute name, restored runs may start in another directory */
+#ifndef _MSC_VER
+  if (fname[0] != '/')
+    {
+      char buf[4096];
+
+      if (getcwd(buf, sizeof(buf) - strlen(fname) - 2) != NULL)
+	{
+	  strcat(buf, "/");
+	  strcat(buf, fname);
+	  eio_fds[fd].fname = mystrdup(buf);
+	  return;
+	}
+    }
+#endif /* !_MSC_VER */
+  eio_fds[fd].fname = mystrdup(fname);
+}
+
+/* record host descriptor NEWFD as a dup() of OLDFD */
+void
+eio_fd_dup(int oldfd, int newfd)
+{
+  if (newfd < 0 || newfd >= EIO_MAX_FDS || oldfd == newfd)
+    return;
+
+  if (oldfd >= 0 && oldfd < EIO_MAX_FDS
+      && eio_fds[oldfd].valid && eio_fds[oldfd].fname)
+    eio_fd_open(newfd, eio_fds[oldfd].fname, eio_fds[oldfd].flags);
+  else
+    {
+      /* a dup of a descriptor the simulator inherited, e.g., stdout */
+      eio_fd_close(newfd);
+      eio_fds[newfd].valid = TRUE;
+      eio_fds[newfd].dupof = (oldfd >= 0 && oldfd < EIO_MAX_FDS
+			      && eio_fds[oldfd].valid)
+			     ? eio_fds[oldfd].dupof : oldfd;
+    }
+}
+
+/* record that host descriptor FD was closed */
+void
+eio_fd_close(int fd)
+{
+  if (fd < 0 || fd >= EIO_MAX_FDS)
+    return;
+
+  if (eio_fds[fd].fname)
+    free(eio_fds[fd].fname);
+  eio_fds[fd].valid = FALSE;
+  eio_fds[fd].fname = NULL;
+}
+
+/* write the native program checkpoint trailer to stream FD: the warm-up
+   instruction count WARMUP that precedes the region of interest, and the
+   program's open host files with their current offsets */
+void
+eio_write_chkpt_host(FILE *fd,			/* stream to write to */
+		     counter_t warmup)		/* warm-up window, in insts */
+{
+  int i;
+  off_t offset;
+  struct exo_term_t *exo;
+
+  myfprintf(fd, "/* warm-up instructions: %n... */\n", warmup);
+  exo = exo_new(ec_integer, (exo_integer_t)warmup);
+  exo_print(exo, fd);
+  fprintf(fd, "\n\n");
+  exo_delete(exo);
+
+  /* host files, (fd, name, flags, offset), an empty name is a dup() of
+     the simulator's own descriptor in the flags field */
+  fprintf(fd, "/* open host files (fd, name, flags, offset) */\n");
+  exo = exo_new(ec_list, NULL);
+  for (i=0; i < EIO_MAX_FDS; i++)
+    {
+      /* standard input is reopened at its offset, if it is a file */
+      if (i != 0 && !eio_fds[i].valid)
+	continue;
+
+      offset = lseek(i, 0, SEEK_CUR);
+      if (i == 0 && !eio_fds[i].valid && offset == -1)
+	continue;
+
+      exo->as_list.head =
+	exo_chain(exo->as_list.head,
+		  exo_new(ec_list,
+			  exo_new(ec_integer, (exo_integer_t)i),
+			  exo_new(ec_string, eio_fds[i].fname
+				  ? eio_fds[i].fname : ""),
+			  exo_new(ec_integer, (exo_integer_t)
+				  (eio_fds[i].fname
+				   ? eio_fds[i].flags
+				   : (eio_fds[i].valid ? eio_fds[i].dupof : i))),
+			  exo_new(ec_integer, (exo_integer_t)offset),
+			  NULL));
+    }
+  exo_print(exo, fd);
+  fprintf(fd, "\n\n");
+  exo_delete(exo);
+}
+
+/* read the native program checkpoint trailer from stream FD, close the
+   stream, and reopen the program's host files (the stream's descriptor may
+   be one of them), returns the warm-up instruction count, a trailer missing
+   from the stream (e.g., a sim-eio checkpoint) reads as none */
+counter_t
+eio_read_chkpt_host(FILE *fd)			/* stream to read and close */
+{
+  counter_t warmup;
+  struct exo_term_t *exo, *elt;
+
+  exo = exo_read(fd);
+  if (!exo)
+    {
+      eio_close(fd);
+      return 0;
+    }
+  if (exo->ec != ec_integer)
+    fatal("could not read checkpoint warm-up count");
+  warmup = (counter_t)exo->as_integer.val;
+  exo_delete(exo);
+
+  exo = exo_read(fd);
+  if (!exo
+      || exo->ec != ec_list)
+    fatal("could not read checkpoint host files");
+  eio_close(fd);
+
+  for (elt = exo->as_list.head; elt != NULL; elt = elt->next)
+    {
+      int hfd, tfd, flags;
+      char *fname;
+      off_t offset;
+
+      if (elt->ec != ec_list
+	  || !elt->as_list.head
+	  || elt->as_list.head->ec != ec_integer
+	  || !elt->as_list.head->next
+	  || elt->as_list.head->next->ec != ec_string
+	  || !elt->as_list.head->next->next
+	  || elt->as_list.head->next->next->ec != ec_integer
+	  || !elt->as_list.head->next->next->next
+	  || elt->as_list.head->next->next->next->ec != ec_integer
+	  || elt->as_list.head->next->next->next->next != NULL)
+	fatal("could not read checkpoint host file");
+      tfd = (int)elt->as_list.head->as_integer.val;
+      fname = (char *)elt->as_list.head->next->as_string.str;
+      flags = (int)elt->as_list.head->next->next->as_integer.val;
+      offset = (off_t)elt->as_list.head->next->next->next->as_integer.val;
+
+      if (*fname != '\0')
+	{
+	  /* reopen the file, without wiping out what the checkpointed run
+	     wrote to it */
+	  hfd = open(fname, flags & ~(O_TRUNC|O_EXCL), 0666);
+	  if (hfd == -1)
+	    fatal("could not reopen checkpoint host file `%s'", fname);
+	  if (hfd != tfd)
+	    {
+	      if (dup2(hfd, tfd) == -1)
+		fatal("could not restore host file descriptor %d", tfd);
+	      close(hfd);
+	    }
+	  eio_fd_open(tfd, fname, flags);
+	}
+      else if (flags != tfd)
+	{
+	  if (dup2(flags, tfd) == -1)
+	    fatal("could not restore host file descriptor %d", tfd);
+	  eio_fd_dup(flags, tfd);
+	}
+
+      if (offset != -1 && lseek(tfd, offset, SEEK_SET) == -1)
+	{
+	  if (*fname != '\0')
+	    fatal("could not seek host file `%s' to its checkpoint offset",
+		  fname);
+	  warn("could not seek host file descriptor %d to its checkpoint "
+	       "offset, it is not a file", tfd);
+	}
+    }
+  exo_delete(exo);
+
+  return warmup;
+}
+
 struct mem_rec_t {
   md_addr_t addr;
   unsigned size, maxsize;
@@ -84,6 +84,29 @@ eio_read_chkpt(struct regs_t *regs,		/* regs to dump */
 		struct mem_t *mem,		/* memory to dump */
 		FILE *fd);			/* stream to read */
 
+/* record host descriptor FD opened on behalf of the simulated program from
+   file FNAME with open(2) FLAGS, so native checkpoints can reopen it */
+void eio_fd_open(int fd, char *fname, int flags);
+
+/* record host descriptor NEWFD as a dup() of OLDFD */
+void eio_fd_dup(int oldfd, int newfd);
+
+/* record that host descriptor FD was closed */
+void eio_fd_close(int fd);
+
+/* write the native program checkpoint trailer to stream FD: the warm-up
+   instruction count WARMUP that precedes the region of interest, and the
+   program's open host files with their current offsets */
+void
+eio_write_chkpt_host(FILE *fd,			/* stream to write to */
+		     counter_t warmup);		/* warm-up window, in insts */
+
+/* read the native program checkpoint trailer from stream FD, close the
+   stream, and reopen the program's host files, returns the warm-up
+   instruction count */
+counter_t
+eio_read_chkpt_host(FILE *fd);			/* stream to read and close */
+
 /* syscall proxy handler, with EIO tracing support, architect registers
    and memory are assumed to be precise when this function is called,
    register and memory are updated with the results of the sustem call */
@@ -133,6 +133,9 @@ extern md_addr_t ld_environ_base;
 /* target executable endian-ness, non-zero if big endian */
 extern int ld_target_big_endian;
 
+/* warm-up instructions recorded in the restored native checkpoint */
+extern counter_t ld_chkpt_warmup;
+
 /* register simulator-specific statistics */
 void
 ld_reg_stats(struct stat_sdb_t *sdb);	/* stats data base */
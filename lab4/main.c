@@ -131,6 +131,12 @@ static char *sim_simout = NULL;
 static char *sim_progout = NULL;
 FILE *sim_progfd = NULL;
 
+/* raw stats saved at exit, and saved stats merged instead of simulating */
+#define MAX_STATS_MERGE		1024
+static char *sim_stats_save = NULL;
+static char *sim_stats_merge[MAX_STATS_MERGE];
+static int sim_stats_nmerge = 0;
+
 /* track first argument orphan, this is the program to execute */
 static int exec_index = -1;
 
@@ -195,9 +201,10 @@ sim_print_stats(FILE *fd)		/* output stream */
   if (!running)
     return;
 
-  /* get stats time */
+  /* get stats time, merged stats keep the longest run's time */
   sim_end_time = time((time_t *)NULL);
-  sim_elapsed_time = MAX(sim_end_time - sim_start_time, 1);
+  if (!sim_stats_nmerge)
+    sim_elapsed_time = MAX(sim_end_time - sim_start_time, 1);
 
 #if 0 /* not portable... :-( */
   /* compute simulator memory usage */
@@ -218,6 +225,17 @@ exit_now(int exit_code)
   /* print simulation stats */
   sim_print_stats(stderr);
 
+  /* save raw stats for a later -stats:merge */
+  if (running && sim_stats_save)
+    {
+      FILE *fd = fopen(sim_stats_save, "w");
+
+      if (!fd)
+	fatal("unable to save stats to file `%s'", sim_stats_save);
+      stat_save(sim_sdb, fd);
+      fclose(fd);
+    }
+
   /* un-initialize the simulator */
   sim_uninit();
 
@@ -266,7 +284,7 @@ main(int argc, char **argv, char **envp)
 	      &rand_seed, /* default */1, /* print */TRUE, NULL);
   opt_reg_flag(sim_odb, "-q", "initialize and terminate immediately",
 	       &init_quit, /* default */FALSE, /* !print */FALSE, NULL);
-  opt_reg_string(sim_odb, "-chkpt", "restore EIO trace execution from <fname>",
+  opt_reg_string(sim_odb, "-chkpt", "restore execution from checkpoint <fname>",
 		 &sim_chkpt_fname, /* default */NULL, /* !print */FALSE, NULL);
 
   /* stdio redirection options */
@@ -278,6 +296,17 @@ main(int argc, char **argv, char **envp)
 		 "redirect simulated program output to file",
 		 &sim_progout, /* default */NULL, /* !print */FALSE, NULL);
 
+  /* saved stats options */
+  opt_reg_string(sim_odb, "-stats:save",
+		 "save raw stats to file at exit, for a later -stats:merge",
+		 &sim_stats_save, /* default */NULL, /* !print */FALSE, NULL);
+  opt_reg_string_list(sim_odb, "-stats:merge",
+		      "print the sum of saved stats files instead of "
+		      "simulating, needs the same options (mult uses ok)",
+		      sim_stats_merge, MAX_STATS_MERGE, &sim_stats_nmerge,
+		      /* default */NULL, /* !print */FALSE, /* format */NULL,
+		      /* accrue */TRUE);
+
 #ifndef _MSC_VER
   /* scheduling priority option */
   opt_reg_int(sim_odb, "-nice",
@@ -413,6 +442,17 @@ main(int argc, char **argv, char **envp)
   if (init_quit)
     exit_now(0);
 
+  /* merge saved stats instead of simulating, what loading the program
+     counted is not part of them */
+  if (sim_stats_nmerge)
+    {
+      stat_clear(sim_sdb);
+      for (i=0; i < sim_stats_nmerge; i++)
+	stat_merge(sim_sdb, sim_stats_merge[i]);
+      running = TRUE;
+      exit_now(0);
+    }
+
   running = TRUE;
   sim_main();
 
@@ -77,6 +77,13 @@ struct mem_t {
   char *name;				/* name of this memory space */
   struct mem_pte_t *ptab[MEM_PTAB_SIZE];/* inverted page table */
 
+  /* writes into the text segment, which pre-decoded copies of its
+     instructions must notice, see predec.h */
+  md_addr_t text_base;			/* watched text base, widened down by
+					   the largest access */
+  md_addr_t text_size;			/* watched text size, 0 = unwatched */
+  counter_t text_writes;		/* writes into the watched text */
+
   /* memory object stats */
   counter_t page_count;			/* total number of pages allocated */
   counter_t ptab_misses;		/* total first level page tbl misses */
@@ -136,6 +143,12 @@ typedef enum md_fault_type
       mem_newpage(MEM, ADDR))						\
    : (/* nada... */ (void)0))
 
+/* count a write at address ADDR if it falls in the watched text segment */
+#define MEM_TEXT_WATCH(MEM, ADDR)					\
+  ((ADDR) - (MEM)->text_base < (MEM)->text_size				\
+   ? (void)(MEM)->text_writes++						\
+   : (void)0)
+
 /* memory page iterator */
 #define MEM_FORALL(MEM, ITER, PTE)					\
   for ((ITER)=0; (ITER) < MEM_PTAB_SIZE; (ITER)++)			\
@@ -161,11 +174,13 @@ typedef enum md_fault_type
 /* FIXME: write a more efficient GNU C expression for this... */
 #define MEM_WRITE(MEM, ADDR, TYPE, VAL)					\
   (MEM_TICKLE(MEM, (md_addr_t)(ADDR)),					\
+   MEM_TEXT_WATCH(MEM, (md_addr_t)(ADDR)),				\
    *((TYPE *)(MEM_PAGE(MEM, (md_addr_t)(ADDR)) + MEM_OFFSET(ADDR))) = (VAL))
       
 /* unsafe version, works with any type */
 #define __UNCHK_MEM_WRITE(MEM, ADDR, TYPE, VAL)				\
-  (*((TYPE *)(MEM_PAGE(MEM, (md_addr_t)(ADDR)) + MEM_OFFSET(ADDR))) = (VAL))
+  (MEM_TEXT_WATCH(MEM, (md_addr_t)(ADDR)),				\
+   *((TYPE *)(MEM_PAGE(MEM, (md_addr_t)(ADDR)) + MEM_OFFSET(ADDR))) = (VAL))
 
 
 /* fast memory accessor macros, typed versions */
@@ -0,0 +1,525 @@
+/* memtrace.c - memory reference trace routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+#include "memtrace.h"
+
+/* memory trace file magic */
+#define MTR_MAGIC		"SSMTRACE"
+#define MTR_MAGIC_LEN		8
+
+/* header and block header sizes */
+#define MTR_HDR_SIZE		(MTR_MAGIC_LEN + 4 + 8)
+#define MTR_BLKHDR_SIZE		8
+
+/* largest encoded record: flags, two 64-bit varints, and a size varint */
+#define MTR_MAX_REC		(1 + 10 + 10 + 5)
+
+/* record flags fields */
+#define MTR_KIND(F)		((F) & 0x03)
+#define MTR_F_WRITE		0x04
+#define MTR_SIZE(F)		(((F) >> 3) & 0x07)
+#define MTR_SIZE_ESC		7
+#define MTR_F_SAMEPC		0x40
+#define MTR_F_SYS		0x80
+#define MTR_IRUN_MAX		63
+
+/* signed address deltas are carried at the width of the target address */
+typedef sqword_t mtr_delta_t;
+
+/* little-endian field accessors */
+static void
+put_le(byte_t *p, qword_t val, int n)
+{
+  int i;
+
+  for (i=0; i < n; i++, val >>= 8)
+    p[i] = (byte_t)(val & 0xff);
+}
+
+static qword_t
+get_le(byte_t *p, int n)
+{
+  int i;
+  qword_t val = 0;
+
+  for (i=n-1; i >= 0; i--)
+    val = (val << 8) | p[i];
+  return val;
+}
+
+/* emit VAL as an unsigned LEB128 varint into MT's block */
+static void
+put_varint(struct mtr_file_t *mt, qword_t val)
+{
+  while (val >= 0x80)
+    {
+      mt->blk[mt->blk_len++] = (byte_t)((val & 0x7f) | 0x80);
+      val >>= 7;
+    }
+  mt->blk[mt->blk_len++] = (byte_t)val;
+}
+
+/* fetch an unsigned LEB128 varint from MT's block */
+static qword_t
+get_varint(struct mtr_file_t *mt)
+{
+  qword_t val = 0;
+  int shift = 0;
+  byte_t b;
+
+  do {
+    if (mt->blk_pos >= mt->blk_len || shift > 63)
+      fatal("memory trace `%s' has a corrupt block", mt->fname);
+    b = mt->blk[mt->blk_pos++];
+    val |= (qword_t)(b & 0x7f) << shift;
+    shift += 7;
+  } while (b & 0x80);
+
+  return val;
+}
+
+/* address deltas are sign-extended from the target address width, then
+   zig-zag encoded so that small negative strides stay short */
+static qword_t
+zigzag(md_addr_t cur, md_addr_t last)
+{
+  mtr_delta_t d;
+
+  if (sizeof(md_addr_t) == sizeof(word_t))
+    d = (sword_t)((word_t)cur - (word_t)last);
+  else
+    d = (mtr_delta_t)((qword_t)cur - (qword_t)last);
+  return ((qword_t)d << 1) ^ (qword_t)(d >> 63);
+}
+
+static md_addr_t
+unzigzag(qword_t z, md_addr_t last)
+{
+  mtr_delta_t d = (mtr_delta_t)((z >> 1) ^ (~(z & 1) + 1));
+
+  return (md_addr_t)(last + d);
+}
+
+/* start a new block, resetting the delta state */
+static void
+blk_reset(struct mtr_file_t *mt)
+{
+  mt->blk_len = 0;
+  mt->blk_pos = 0;
+  mt->blk_recs = 0;
+  mt->irun = 0;
+  mt->last_pc = 0;
+  mt->last_addr = 0;
+}
+
+/* close off any pending sequential fetch run */
+static void
+flush_irun(struct mtr_file_t *mt)
+{
+  if (mt->irun)
+    {
+      mt->blk[mt->blk_len++] = (byte_t)((mt->irun << 2) | MTR_IRUN);
+      mt->blk_recs++;
+      mt->irun = 0;
+    }
+}
+
+/* write out the current block of a trace being recorded */
+static void
+blk_write(struct mtr_file_t *mt)
+{
+  byte_t hdr[MTR_BLKHDR_SIZE];
+
+  flush_irun(mt);
+  if (!mt->blk_recs)
+    return;
+
+  put_le(hdr, mt->blk_recs, 4);
+  put_le(hdr + 4, mt->blk_len, 4);
+  if (fwrite(hdr, MTR_BLKHDR_SIZE, 1, mt->fd) != 1
+      || fwrite(mt->blk, mt->blk_len, 1, mt->fd) != 1)
+    fatal("could not write memory trace `%s'", mt->fname);
+
+  mt->out_blks++;
+  mt->out_bytes += MTR_BLKHDR_SIZE + mt->blk_len;
+  blk_reset(mt);
+}
+
+/* update the stats of a trace being recorded, counting the pending block
+   as it will be written out */
+static void
+blk_count(struct mtr_file_t *mt)
+{
+  mt->nblks = mt->out_blks;
+  mt->nbytes = mt->out_bytes;
+  if (mt->blk_recs + mt->irun > 0)
+    {
+      mt->nblks++;
+      mt->nbytes += MTR_BLKHDR_SIZE + mt->blk_len + (mt->irun ? 1 : 0);
+    }
+}
+
+/* read the next block of a trace being replayed, returns zero at EOF */
+static int
+blk_read(struct mtr_file_t *mt)
+{
+  byte_t hdr[MTR_BLKHDR_SIZE];
+  unsigned int len;
+
+  blk_reset(mt);
+  if (fread(hdr, MTR_BLKHDR_SIZE, 1, mt->fd) != 1)
+    return FALSE;
+
+  mt->blk_recs = (unsigned int)get_le(hdr, 4);
+  len = (unsigned int)get_le(hdr + 4, 4);
+  if (len > MTR_BLOCK_SIZE)
+    fatal("memory trace `%s' has a corrupt block header", mt->fname);
+  if (fread(mt->blk, len, 1, mt->fd) != 1)
+    fatal("memory trace `%s' is truncated", mt->fname);
+
+  mt->blk_len = len;
+  mt->nblks++;
+  mt->nbytes += MTR_BLKHDR_SIZE + len;
+  return TRUE;
+}
+
+static struct mtr_file_t *
+mtr_new(char *fname, FILE *fd, int writing)
+{
+  struct mtr_file_t *mt;
+
+  mt = (struct mtr_file_t *)calloc(1, sizeof(struct mtr_file_t));
+  if (!mt)
+    fatal("out of virtual memory");
+  mt->blk = (byte_t *)calloc(MTR_BLOCK_SIZE, sizeof(byte_t));
+  if (!mt->blk)
+    fatal("out of virtual memory");
+  mt->fname = mystrdup(fname);
+  mt->fd = fd;
+  mt->writing = writing;
+  blk_reset(mt);
+
+  return mt;
+}
+
+/* create memory trace FNAME for recording, TEXT_BASE is the text segment
+   base of the traced program */
+struct mtr_file_t *
+mtr_create(char *fname,			/* trace file name */
+	   md_addr_t text_base)		/* program text base */
+{
+  FILE *fd;
+  struct mtr_file_t *mt;
+  byte_t hdr[MTR_HDR_SIZE];
+
+  fd = gzopen(fname, "w");
+  if (!fd)
+    fatal("unable to create memory trace `%s'", fname);
+
+  memcpy(hdr, MTR_MAGIC, MTR_MAGIC_LEN);
+  hdr[MTR_MAGIC_LEN + 0] = MTR_FILE_VERSION;
+  hdr[MTR_MAGIC_LEN + 1] = sizeof(md_addr_t);
+  hdr[MTR_MAGIC_LEN + 2] = sizeof(md_inst_t);
+  hdr[MTR_MAGIC_LEN + 3] = 0;
+  put_le(hdr + MTR_MAGIC_LEN + 4, (qword_t)text_base, 8);
+  if (fwrite(hdr, MTR_HDR_SIZE, 1, fd) != 1)
+    fatal("could not write memory trace `%s' header", fname);
+
+  mt = mtr_new(fname, fd, TRUE);
+  mt->text_base = text_base;
+  mt->out_bytes = MTR_HDR_SIZE;
+  blk_count(mt);
+
+  return mt;
+}
+
+/* open memory trace FNAME for replay */
+struct mtr_file_t *
+mtr_open(char *fname)			/* trace file name */
+{
+  FILE *fd;
+  struct mtr_file_t *mt;
+  byte_t hdr[MTR_HDR_SIZE];
+
+  fd = gzopen(fname, "r");
+  if (!fd)
+    fatal("unable to open memory trace `%s'", fname);
+
+  if (fread(hdr, MTR_HDR_SIZE, 1, fd) != 1
+      || memcmp(hdr, MTR_MAGIC, MTR_MAGIC_LEN))
+    fatal("could not read memory trace `%s' header", fname);
+
+  if (hdr[MTR_MAGIC_LEN + 0] != MTR_FILE_VERSION)
+    fatal("memory trace `%s' has incompatible version", fname);
+
+  if (hdr[MTR_MAGIC_LEN + 1] != sizeof(md_addr_t)
+      || hdr[MTR_MAGIC_LEN + 2] != sizeof(md_inst_t))
+    fatal("memory trace `%s' was recorded for a different target", fname);
+
+  mt = mtr_new(fname, fd, FALSE);
+  mt->text_base = (md_addr_t)get_le(hdr + MTR_MAGIC_LEN + 4, 8);
+  mt->nbytes = MTR_HDR_SIZE;
+
+  return mt;
+}
+
+/* returns non-zero if file FNAME has a valid memory trace header */
+int
+mtr_valid(char *fname)
+{
+  FILE *fd;
+  char buf[MTR_MAGIC_LEN];
+  int valid;
+
+  /* open possible memory trace file */
+  fd = gzopen(fname, "r");
+  if (!fd)
+    return FALSE;
+
+  /* read and check the magic */
+  valid = (fread(buf, MTR_MAGIC_LEN, 1, fd) == 1
+	   && !memcmp(buf, MTR_MAGIC, MTR_MAGIC_LEN));
+
+  gzclose(fd);
+
+  return valid;
+}
+
+/* append record REC to memory trace MT */
+void
+mtr_write(struct mtr_file_t *mt,	/* trace being recorded */
+	  struct mtr_rec_t *rec)	/* record to append */
+{
+  byte_t flags;
+  int lg;
+
+  if (!mt->writing)
+    panic("memory trace `%s' is not open for writing", mt->fname);
+
+  /* make room for the worst-case record */
+  if (mt->blk_len + MTR_MAX_REC + 1 > MTR_BLOCK_SIZE)
+    blk_write(mt);
+
+  mt->nrecs++;
+  switch (rec->kind)
+    {
+    case MTR_IFETCH:
+      if (mt->blk_recs + mt->irun > 0
+	  && rec->pc == mt->last_pc + sizeof(md_inst_t))
+	{
+	  /* extend the sequential fetch run */
+	  if (++mt->irun == MTR_IRUN_MAX)
+	    flush_irun(mt);
+	}
+      else
+	{
+	  flush_irun(mt);
+	  mt->blk[mt->blk_len++] = MTR_IFETCH;
+	  put_varint(mt, zigzag(rec->pc, mt->last_pc));
+	  mt->blk_recs++;
+	}
+      mt->last_pc = rec->pc;
+      break;
+
+    case MTR_DATA:
+      flush_irun(mt);
+      for (lg=0; lg < MTR_SIZE_ESC && (1 << lg) < rec->nbytes; lg++)
+	/* nada */;
+      if (lg == MTR_SIZE_ESC || (1 << lg) != rec->nbytes)
+	lg = MTR_SIZE_ESC;
+      flags = (byte_t)(MTR_DATA | (lg << 3)
+		       | (rec->cmd == Write ? MTR_F_WRITE : 0)
+		       | (rec->sys ? MTR_F_SYS : 0)
+		       | (mt->blk_recs && rec->pc == mt->last_pc
+			  ? MTR_F_SAMEPC : 0));
+      mt->blk[mt->blk_len++] = flags;
+      if (!(flags & MTR_F_SAMEPC))
+	put_varint(mt, zigzag(rec->pc, mt->last_pc));
+      put_varint(mt, zigzag(rec->addr, mt->last_addr));
+      if (lg == MTR_SIZE_ESC)
+	put_varint(mt, (qword_t)rec->nbytes);
+      mt->blk_recs++;
+      mt->last_pc = rec->pc;
+      mt->last_addr = rec->addr;
+      break;
+
+    case MTR_SYSCALL:
+      flush_irun(mt);
+      mt->blk[mt->blk_len++] = MTR_SYSCALL;
+      mt->blk_recs++;
+      break;
+
+    default:
+      panic("bogus memory trace record kind");
+    }
+  blk_count(mt);
+}
+
+/* read the next record of memory trace MT into REC, returns zero at the
+   end of the trace */
+int
+mtr_read(struct mtr_file_t *mt,		/* trace being replayed */
+	 struct mtr_rec_t *rec)		/* record read */
+{
+  byte_t flags;
+
+  if (mt->writing)
+    panic("memory trace `%s' is not open for reading", mt->fname);
+
+  rec->cmd = Read;
+  rec->sys = FALSE;
+  rec->nbytes = sizeof(md_inst_t);
+
+  /* drain any pending sequential fetch run */
+  if (mt->irun)
+    {
+      mt->irun--;
+      mt->last_pc += sizeof(md_inst_t);
+      rec->kind = MTR_IFETCH;
+      rec->pc = rec->addr = mt->last_pc;
+      mt->nrecs++;
+      return TRUE;
+    }
+
+  /* get the next block, if needed */
+  while (mt->blk_pos >= mt->blk_len)
+    {
+      if (!blk_read(mt))
+	return FALSE;
+    }
+
+  flags = mt->blk[mt->blk_pos++];
+  switch (MTR_KIND(flags))
+    {
+    case MTR_IFETCH:
+      mt->last_pc = unzigzag(get_varint(mt), mt->last_pc);
+      rec->kind = MTR_IFETCH;
+      rec->pc = rec->addr = mt->last_pc;
+      break;
+
+    case MTR_IRUN:
+      mt->irun = flags >> 2;
+      if (!mt->irun)
+	fatal("memory trace `%s' has a corrupt block", mt->fname);
+      mt->irun--;
+      mt->last_pc += sizeof(md_inst_t);
+      rec->kind = MTR_IFETCH;
+      rec->pc = rec->addr = mt->last_pc;
+      break;
+
+    case MTR_DATA:
+      if (!(flags & MTR_F_SAMEPC))
+	mt->last_pc = unzigzag(get_varint(mt), mt->last_pc);
+      mt->last_addr = unzigzag(get_varint(mt), mt->last_addr);
+      rec->kind = MTR_DATA;
+      rec->cmd = (flags & MTR_F_WRITE) ? Write : Read;
+      rec->sys = (flags & MTR_F_SYS) != 0;
+      rec->pc = mt->last_pc;
+      rec->addr = mt->last_addr;
+      if (MTR_SIZE(flags) == MTR_SIZE_ESC)
+	rec->nbytes = (int)get_varint(mt);
+      else
+	rec->nbytes = 1 << MTR_SIZE(flags);
+      break;
+
+    case MTR_SYSCALL:
+      rec->kind = MTR_SYSCALL;
+      rec->pc = rec->addr = mt->last_pc;
+      break;
+    }
+
+  mt->nrecs++;
+  return TRUE;
+}
+
+/* flush and close memory trace MT */
+void
+mtr_close(struct mtr_file_t *mt)
+{
+  if (mt->writing)
+    blk_write(mt);
+  gzclose(mt->fd);
+
+  free(mt->blk);
+  free(mt->fname);
+  free(mt);
+}
+
+/* register memory trace MT statistics, stats are prefixed with NAME */
+void
+mtr_reg_stats(struct mtr_file_t *mt,	/* trace instance */
+	      char *name,		/* stat name prefix */
+	      struct stat_sdb_t *sdb)	/* stats database */
+{
+  char buf[512], buf1[512];
+
+  sprintf(buf, "%s.records", name);
+  stat_reg_counter(sdb, buf, "total number of trace records",
+		   &mt->nrecs, mt->nrecs, NULL);
+  sprintf(buf, "%s.blocks", name);
+  stat_reg_counter(sdb, buf, "total number of trace blocks",
+		   &mt->nblks, mt->nblks, NULL);
+  sprintf(buf, "%s.bytes", name);
+  stat_reg_counter(sdb, buf, "total trace bytes (before gzip)",
+		   &mt->nbytes, mt->nbytes, NULL);
+  sprintf(buf, "%s.bytes_per_rec", name);
+  sprintf(buf1, "%s.bytes / %s.records", name, name);
+  stat_reg_formula(sdb, buf, "average trace bytes per record", buf1, NULL);
+}
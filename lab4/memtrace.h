@@ -0,0 +1,183 @@
+/* memtrace.h - memory reference trace interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef MEMTRACE_H
+#define MEMTRACE_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+
+/*
+ * A memory reference trace captures the reference stream seen by the
+ * entry-level caches (il1/dl1 and the TLBs) of a functional simulator, so
+ * that cache experiments can be replayed through cache_access() without
+ * re-executing the benchmark.  Each record carries the PC of the referencing
+ * instruction, so a replay can feed get_PC() for PC-indexed prefetchers.
+ *
+ * File format (all multi-byte header fields are little-endian):
+ *
+ *	header:	"SSMTRACE" <version:1> <addr bytes:1> <inst bytes:1> <pad:1>
+ *		<text base:8>
+ *	block:	<record count:4> <payload bytes:4> <payload>
+ *
+ * Records are delta-encoded against the previous record in the same block,
+ * and deltas reset at each block boundary so that every block can be decoded
+ * on its own.  A record starts with a flags byte:
+ *
+ *	bits 0-1	record kind (MTR_IFETCH, MTR_DATA, MTR_SYSCALL, MTR_IRUN)
+ *
+ *   MTR_IFETCH:	followed by the zig-zag varint PC delta
+ *   MTR_IRUN:		bits 2-7 hold a run length of 1..63 sequential fetches,
+ *			i.e., fetches at PC + sizeof(md_inst_t), no payload
+ *   MTR_DATA:		bit 2 set for Write, bits 3-5 hold log2(size) or
+ *			MTR_SIZE_ESC when an explicit varint size follows,
+ *			bit 6 set if the PC equals the previous record PC,
+ *			bit 7 set for system call (not instruction) accesses;
+ *			followed by the PC delta (unless bit 6), the zig-zag
+ *			varint address delta against the previous data
+ *			address, and the explicit size (if escaped)
+ *   MTR_SYSCALL:	a system call boundary, no payload
+ *
+ * Traces named with a ".gz" extension are additionally run through gzip by
+ * gzopen(), which typically shrinks the packed blocks by another 3-5x.
+ */
+
+/* memory trace file version */
+#define MTR_FILE_VERSION		1
+
+/* maximum payload bytes in a trace block */
+#define MTR_BLOCK_SIZE			(64*1024)
+
+/* memory trace record kinds */
+enum mtr_kind_t {
+  MTR_IFETCH = 0,		/* instruction fetch */
+  MTR_DATA = 1,			/* data reference */
+  MTR_SYSCALL = 2,		/* system call boundary */
+  MTR_IRUN = 3			/* run of sequential instruction fetches */
+};
+
+/* a decoded memory trace record, MTR_IRUN runs are returned one fetch at a
+   time as MTR_IFETCH records */
+struct mtr_rec_t {
+  enum mtr_kind_t kind;		/* record kind */
+  enum mem_cmd cmd;		/* Read or Write, for data references */
+  int sys;			/* non-zero for system call data references */
+  int nbytes;			/* reference size, for data references */
+  md_addr_t pc;			/* PC of the referencing instruction */
+  md_addr_t addr;		/* referenced address, PC for fetches */
+};
+
+/* an open memory trace */
+struct mtr_file_t {
+  FILE *fd;			/* underlying (possibly compressed) stream */
+  char *fname;			/* trace file name */
+  int writing;			/* non-zero if trace is being recorded */
+  md_addr_t text_base;		/* text base of the traced program */
+
+  /* current block state */
+  byte_t *blk;			/* block payload buffer */
+  int blk_len;			/* payload bytes used (write) or held (read) */
+  int blk_pos;			/* read position in block payload */
+  unsigned int blk_recs;	/* records in current block */
+  int irun;			/* pending sequential fetches */
+
+  /* delta state, reset at each block boundary */
+  md_addr_t last_pc;		/* PC of previous record */
+  md_addr_t last_addr;		/* address of previous data record */
+
+  /* trace stats, a trace being recorded counts its pending block too, so
+     the stats are right before the trace is closed */
+  counter_t nrecs;		/* total records written or read */
+  counter_t nblks;		/* total blocks written or read */
+  counter_t nbytes;		/* total trace bytes written or read */
+  counter_t out_blks;		/* blocks written out so far */
+  counter_t out_bytes;		/* trace bytes written out so far */
+};
+
+/* create memory trace FNAME for recording, TEXT_BASE is the text segment
+   base of the traced program */
+struct mtr_file_t *
+mtr_create(char *fname,			/* trace file name */
+	   md_addr_t text_base);	/* program text base */
+
+/* open memory trace FNAME for replay */
+struct mtr_file_t *
+mtr_open(char *fname);			/* trace file name */
+
+/* returns non-zero if file FNAME has a valid memory trace header */
+int mtr_valid(char *fname);
+
+/* append record REC to memory trace MT */
+void
+mtr_write(struct mtr_file_t *mt,	/* trace being recorded */
+	  struct mtr_rec_t *rec);	/* record to append */
+
+/* read the next record of memory trace MT into REC, returns zero at the
+   end of the trace */
+int
+mtr_read(struct mtr_file_t *mt,		/* trace being replayed */
+	 struct mtr_rec_t *rec);	/* record read */
+
+/* flush and close memory trace MT */
+void mtr_close(struct mtr_file_t *mt);
+
+/* register memory trace MT statistics, stats are prefixed with NAME */
+void
+mtr_reg_stats(struct mtr_file_t *mt,	/* trace instance */
+	      char *name,		/* stat name prefix */
+	      struct stat_sdb_t *sdb);	/* stats database */
+
+#endif /* MEMTRACE_H */
@@ -0,0 +1,227 @@
+/* predec.c - pre-decoded instruction cache routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "loader.h"
+#include "stats.h"
+#include "predec.h"
+
+/*
+ * register dependence decoders, the numbering of the performance simulators
+ */
+
+#define DNA			(0)
+
+#if defined(TARGET_PISA)
+
+#include "decode.def"
+
+#elif defined(TARGET_ALPHA)
+
+/* general register dependence decoders, $r31 maps to DNA (0) */
+#define DGPR(N)			(31 - (N))
+
+/* floating point register dependence decoders */
+#define DFPR(N)			(((N) == 31) ? DNA : ((N)+32))
+
+/* miscellaneous register dependence decoders */
+#define DFPCR			(0+32+32)
+#define DUNIQ			(1+32+32)
+#define DTMP			(2+32+32)
+
+#else
+#error No ISA target defined...
+#endif
+
+/* create a pre-decoded instruction cache of NENTS entries for the text
+   segment of memory space MEM, which must already hold the loaded program;
+   NENTS must be a power of two */
+struct predec_t *			/* pre-decode cache instance */
+predec_create(struct mem_t *mem,	/* memory space to decode from */
+	      int nents)		/* number of entries */
+{
+  struct predec_t *pdc;
+
+  if (nents <= 0 || (nents & (nents-1)) != 0)
+    fatal("pre-decode cache entries `%d' must be a positive power of two",
+	  nents);
+  if (!ld_text_size)
+    panic("pre-decode cache created before the program was loaded");
+
+  pdc = calloc(1, sizeof(struct predec_t));
+  if (!pdc)
+    fatal("out of virtual memory");
+  pdc->ents = calloc(nents + 1, sizeof(struct predec_ent));
+  if (!pdc->ents)
+    fatal("out of virtual memory");
+  pdc->mem = mem;
+  pdc->text_base = ld_text_base;
+  pdc->text_bound = ld_text_base + ld_text_size;
+  pdc->nents = nents;
+  pdc->mask = nents - 1;
+
+  /* have the memory space count writes into the text, an access as wide as
+     a quadword that starts just below the text still writes into it */
+  mem->text_base = ld_text_base - sizeof(qword_t) + 1;
+  mem->text_size = ld_text_size + sizeof(qword_t) - 1;
+  pdc->text_writes = mem->text_writes;
+
+  return pdc;
+}
+
+/* install handler table IMPLS, indexed by opcode, into pre-decode cache
+   PDC, the cached instructions pick up their handlers from it */
+void
+predec_set_impls(struct predec_t *pdc,	/* pre-decode cache instance */
+		 void **impls)		/* handlers, by opcode */
+{
+  pdc->impls = impls;
+  predec_flush(pdc);
+}
+
+/* invalidate every entry of pre-decode cache PDC */
+void
+predec_flush(struct predec_t *pdc)	/* pre-decode cache instance */
+{
+  int i;
+
+  for (i=0; i < pdc->nents; i++)
+    pdc->ents[i].addr = 0;
+  pdc->text_writes = pdc->mem->text_writes;
+}
+
+/* decode the instruction at address PC into pre-decode cache PDC, flushing
+   the cache first if the text segment was written since the last flush,
+   returns the decoded instruction */
+struct predec_ent *			/* decoded instruction */
+predec_decode(struct predec_t *pdc,	/* pre-decode cache instance */
+	      md_addr_t PC)		/* instruction address */
+{
+  struct predec_ent *ent;
+  struct mem_t *mem = pdc->mem;
+  md_inst_t inst;
+  enum md_opcode op;
+
+  if (pdc->text_writes != mem->text_writes)
+    {
+      pdc->flushes++;
+      predec_flush(pdc);
+    }
+  pdc->misses++;
+
+  /* only text is cached, decode anything else into the scratch entry */
+  if (PC >= pdc->text_base && PC < pdc->text_bound)
+    ent = &pdc->ents[PREDEC_INDEX(pdc, PC)];
+  else
+    ent = &pdc->scratch[0];
+
+  MD_FETCH_INST(inst, mem, PC);
+  MD_SET_OPCODE(op, inst);
+
+  ent->addr = PC;
+  ent->inst = inst;
+  ent->op = op;
+  ent->flags = MD_OP_FLAGS(op);
+  ent->fu = MD_OP_FUCLASS(op);
+  ent->impl = pdc->impls ? pdc->impls[op] : NULL;
+
+  switch (op)
+    {
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,CLASS,O1,O2,I1,I2,I3)		\
+    case OP:								\
+      ent->out1 = O1; ent->out2 = O2;					\
+      ent->in1 = I1; ent->in2 = I2; ent->in3 = I3;			\
+      break;
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+    case OP:								\
+      ent->out1 = ent->out2 = DNA;					\
+      ent->in1 = ent->in2 = ent->in3 = DNA;				\
+      break;
+#define CONNECT(OP)
+#include "machine.def"
+    default:
+      /* bogus opcode, the simulator faults when it executes it */
+      ent->out1 = ent->out2 = DNA;
+      ent->in1 = ent->in2 = ent->in3 = DNA;
+    }
+
+  return ent;
+}
+
+/* register pre-decode cache stats, named after its memory space */
+void
+predec_reg_stats(struct predec_t *pdc,	/* pre-decode cache instance */
+		 struct stat_sdb_t *sdb)	/* stats database */
+{
+  char buf[512], buf1[512];
+  char *name = pdc->mem->name;
+
+  sprintf(buf, "%s.predec_lookups", name);
+  stat_reg_counter(sdb, buf, "total pre-decode cache lookups",
+		   &pdc->lookups, 0, NULL);
+
+  sprintf(buf, "%s.predec_misses", name);
+  stat_reg_counter(sdb, buf, "lookups that decoded the instruction",
+		   &pdc->misses, 0, NULL);
+
+  sprintf(buf, "%s.predec_miss_rate", name);
+  sprintf(buf1, "%s.predec_misses / %s.predec_lookups", name, name);
+  stat_reg_formula(sdb, buf, "pre-decode cache miss rate", buf1, NULL);
+
+  sprintf(buf, "%s.predec_flushes", name);
+  stat_reg_counter(sdb, buf, "flushes after writes to the text segment",
+		   &pdc->flushes, 0, NULL);
+}
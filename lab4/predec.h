@@ -0,0 +1,156 @@
+/* predec.h - pre-decoded instruction cache interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#ifndef PREDEC_H
+#define PREDEC_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+
+/*
+ * This module keeps the text segment of a program pre-decoded, so that a
+ * simulator does not fetch each instruction from the memory pages and decode
+ * it again every time it executes.  The cache is direct-mapped and indexed by
+ * instruction address; an entry holds the raw instruction, its opcode, flags
+ * and functional unit class, its register dependences (in the numbering of
+ * decode.def) and the simulator's handler for the opcode, if it installed a
+ * handler table with predec_set_impls().
+ *
+ * Only addresses in the text segment are kept.  The cache asks the memory
+ * space to count writes into the text segment, any such write, by a store,
+ * a system call or the loader, flushes the whole cache at its next lookup.
+ *
+ * Every entry is followed by another one, a guard that never matches after
+ * the last table entry and after the scratch entry, so a simulator that has
+ * an entry ENT can test ENT[1].addr for the instruction that follows it in
+ * the text without going through PREDEC_LOOKUP().  ENT[1] is only current if
+ * the text was not written since ENT was looked up.
+ */
+
+/* a pre-decoded instruction */
+struct predec_ent {
+  md_addr_t addr;		/* instruction address, 0 if invalid */
+  md_inst_t inst;		/* raw instruction */
+  enum md_opcode op;		/* decoded opcode */
+  unsigned int flags;		/* opcode flags, MD_OP_FLAGS(op) */
+  enum md_fu_class fu;		/* functional unit class, MD_OP_FUCLASS(op) */
+  int out1, out2;		/* output register dependences, DNA if none */
+  int in1, in2, in3;		/* input register dependences, DNA if none */
+  void *impl;			/* simulator handler for OP, or NULL */
+};
+
+/* a pre-decoded instruction cache */
+struct predec_t {
+  struct mem_t *mem;		/* memory space decoded from */
+  md_addr_t text_base;		/* program text base */
+  md_addr_t text_bound;		/* program text bound, one past the end */
+  int nents;			/* number of entries */
+  md_addr_t mask;		/* index mask, NENTS - 1 */
+  struct predec_ent *ents;	/* decoded instructions, plus a guard */
+  struct predec_ent scratch[2];	/* decodes of non-text addresses, guard */
+  void **impls;			/* simulator handlers, by opcode, or NULL */
+  counter_t text_writes;	/* MEM->text_writes when last flushed */
+
+  /* stats */
+  counter_t lookups;		/* total lookups */
+  counter_t misses;		/* lookups that decoded the instruction */
+  counter_t flushes;		/* flushes after writes to the text */
+};
+
+/* default number of entries, enough for 512k of PISA text */
+#define PREDEC_NENTS		(64*1024)
+
+/* index of the entry for instruction address PC */
+#define PREDEC_INDEX(PDC, PC)						\
+  (((PC) / sizeof(md_inst_t)) & (PDC)->mask)
+
+/* return the pre-decoded instruction at address PC, decoding it on a miss */
+#define PREDEC_LOOKUP(PDC, PC)						\
+  ((PDC)->lookups++,							\
+   ((PDC)->ents[PREDEC_INDEX(PDC, PC)].addr == (PC)			\
+    && (PDC)->text_writes == (PDC)->mem->text_writes)			\
+   ? &(PDC)->ents[PREDEC_INDEX(PDC, PC)]				\
+   : predec_decode((PDC), (PC)))
+
+/* create a pre-decoded instruction cache of NENTS entries for the text
+   segment of memory space MEM, which must already hold the loaded program;
+   NENTS must be a power of two */
+struct predec_t *			/* pre-decode cache instance */
+predec_create(struct mem_t *mem,	/* memory space to decode from */
+	      int nents);		/* number of entries */
+
+/* install handler table IMPLS, indexed by opcode, into pre-decode cache
+   PDC, the cached instructions pick up their handlers from it */
+void
+predec_set_impls(struct predec_t *pdc,	/* pre-decode cache instance */
+		 void **impls);		/* handlers, by opcode */
+
+/* decode the instruction at address PC into pre-decode cache PDC, flushing
+   the cache first if the text segment was written since the last flush,
+   returns the decoded instruction */
+struct predec_ent *			/* decoded instruction */
+predec_decode(struct predec_t *pdc,	/* pre-decode cache instance */
+	      md_addr_t PC);		/* instruction address */
+
+/* invalidate every entry of pre-decode cache PDC */
+void
+predec_flush(struct predec_t *pdc);	/* pre-decode cache instance */
+
+/* register pre-decode cache stats, named after its memory space */
+void
+predec_reg_stats(struct predec_t *pdc,	/* pre-decode cache instance */
+		 struct stat_sdb_t *sdb);	/* stats database */
+
+#endif /* PREDEC_H */
@@ -58,6 +58,7 @@
 #include "machine.h"
 #include "regs.h"
 #include "memory.h"
+#include "predec.h"
 #include "loader.h"
 #include "syscall.h"
 #include "dlite.h"
@@ -76,6 +77,9 @@ static struct regs_t regs;
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
+/* pre-decoded program text */
+static struct predec_t *predec = NULL;
+
 /* maximum number of inst's to execute */
 static unsigned int max_insts;
 
@@ -287,6 +291,7 @@ sim_reg_stats(struct stat_sdb_t *sdb)
   /* register predictor stats */
   if (pred)
     bpred_reg_stats(pred, sdb);
+  predec_reg_stats(predec, sdb);
 }
 
 /* initialize the simulator */
@@ -326,6 +331,9 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
+  /* keep the program text pre-decoded */
+  predec = predec_create(mem, PREDEC_NENTS);
+
   /* initialize the DLite debugger */
   dlite_init(md_reg_obj, dlite_mem_obj, bpred_mstate_obj);
 }
@@ -440,6 +448,7 @@ sim_uninit(void)
 void
 sim_main(void)
 {
+  struct predec_ent *pd;
   md_inst_t inst;
   register md_addr_t addr, target_PC = 0;
   enum md_opcode op;
@@ -466,7 +475,8 @@ sim_main(void)
 #endif /* TARGET_ALPHA */
 
       /* get the next instruction to execute */
-      MD_FETCH_INST(inst, mem, regs.regs_PC);
+      pd = PREDEC_LOOKUP(predec, regs.regs_PC);
+      inst = pd->inst;
 
       /* keep an instruction count */
       sim_num_insn++;
@@ -477,8 +487,8 @@ sim_main(void)
       /* set default fault - none */
       fault = md_fault_none;
 
-      /* decode the instruction */
-      MD_SET_OPCODE(op, inst);
+      /* the instruction is pre-decoded */
+      op = pd->op;
 
       /* execute the instruction */
       switch (op)
@@ -501,14 +511,14 @@ sim_main(void)
       if (fault != md_fault_none)
 	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
 
-      if (MD_OP_FLAGS(op) & F_MEM)
+      if (pd->flags & F_MEM)
 	{
 	  sim_num_refs++;
-	  if (MD_OP_FLAGS(op) & F_STORE)
+	  if (pd->flags & F_STORE)
 	    is_write = TRUE;
 	}
 
-      if (MD_OP_FLAGS(op) & F_CTRL)
+      if (pd->flags & F_CTRL)
 	{
 	  md_addr_t pred_PC;
 	  struct bpred_update_t update_rec;
@@ -60,10 +60,13 @@
 #include "machine.h"
 #include "regs.h"
 #include "memory.h"
+#include "predec.h"
 #include "cache.h"
 #include "loader.h"
 #include "syscall.h"
 #include "dlite.h"
+#include "memtrace.h"
+#include "cachesim.h"
 #include "sim.h"
 
 /*
@@ -80,29 +83,20 @@ static struct regs_t regs;
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
+/* pre-decoded program text */
+static struct predec_t *predec = NULL;
+
 /* track number of insn and refs */
 static counter_t sim_num_refs = 0;
 
 /* maximum number of inst's to execute */
 static unsigned int max_insts;
 
-/* level 1 instruction cache, entry level instruction cache */
-static struct cache_t *cache_il1 = NULL;
-
-/* level 1 instruction cache */
-static struct cache_t *cache_il2 = NULL;
-
-/* level 1 data cache, entry level data cache */
-static struct cache_t *cache_dl1 = NULL;
-
-/* level 2 data cache */
-static struct cache_t *cache_dl2 = NULL;
+/* memory reference trace being recorded, if any */
+static struct mtr_file_t *mtr_out = NULL;
 
-/* instruction TLB */
-static struct cache_t *itlb = NULL;
-
-/* data TLB */
-static struct cache_t *dtlb = NULL;
+/* memory reference trace being replayed, if the program is a trace */
+static struct mtr_file_t *mtr_in = NULL;
 
 /* text-based stat profiles */
 #define MAX_PCSTAT_VARS 8
@@ -124,145 +118,13 @@ md_addr_t get_PC() {	// return the current program counter (PC)
 	 ? *((STAT)->variant.for_counter.var)				\
 	 : (panic("bad stat class"), 0))))
 
-/* l1 data cache l1 block miss handler function */
-static unsigned int			/* latency of block access */
-dl1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
-	      md_addr_t baddr,		/* block address to access */
-	      int bsize,		/* size of block to access */
-	      struct cache_blk_t *blk,	/* ptr to block in upper level */
-	      tick_t now,		/* time of access */
-	      int prefetch)		/* if 1 the access is a prefetch, if 0 it is a regular cache access */
-{
-  if (cache_dl2)
-    {
-      /* access next level of data cache hierarchy */
-      return cache_access(cache_dl2, cmd, baddr, NULL, bsize, 
-			  /* now */now, /* pudata */NULL, /* repl addr */NULL, prefetch);
-    }
-  else
-    {
-      /* access main memory, which is always done in the main simulator loop */
-      return /* access latency, ignored */1;
-    }
-}
-
-/* l2 data cache block miss handler function */
-static unsigned int			/* latency of block access */
-dl2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
-	      md_addr_t baddr,		/* block address to access */
-	      int bsize,		/* size of block to access */
-	      struct cache_blk_t *blk,	/* ptr to block in upper level */
-	      tick_t now,		/* time of access */
-	      int prefetch)
-	      
-{
-  /* this is a miss to the lowest level, so access main memory, which is
-     always done in the main simulator loop */
-  return /* access latency, ignored */1;
-}
-
-/* l1 inst cache l1 block miss handler function */
-static unsigned int			/* latency of block access */
-il1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
-	      md_addr_t baddr,		/* block address to access */
-	      int bsize,		/* size of block to access */
-	      struct cache_blk_t *blk,	/* ptr to block in upper level */
-	      tick_t now,		/* time of access */
-	      int prefetch)		/* if 1 the access is a prefetch, if 0 it is a regular cache access */
-
-{
-  if (cache_il2)
-    {
-      /* access next level of inst cache hierarchy */
-      return cache_access(cache_il2, cmd, baddr, NULL, bsize,
-			  /* now */now, /* pudata */NULL, /* repl addr */NULL, prefetch);
-    }
-  else
-    {
-      /* access main memory, which is always done in the main simulator loop */
-      return /* access latency, ignored */1;
-    }
-}
-
-/* l2 inst cache block miss handler function */
-static unsigned int			/* latency of block access */
-il2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
-	      md_addr_t baddr,		/* block address to access */
-	      int bsize,		/* size of block to access */
-	      struct cache_blk_t *blk,	/* ptr to block in upper level */
-	      tick_t now,		/* time of access */
-	      int prefetch)
-{
-  /* this is a miss to the lowest level, so access main memory, which is
-     always done in the main simulator loop */
-  return /* access latency, ignored */1;
-}
-
-/* inst cache block miss handler function */
-static unsigned int			/* latency of block access */
-itlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
-	       md_addr_t baddr,	/* block address to access */
-	       int bsize,		/* size of block to access */
-	       struct cache_blk_t *blk,	/* ptr to block in upper level */
-	       tick_t now,		/* time of access */
-	       int prefetch)
-{
-  md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
-
-  /* no real memory access, however, should have user data space attached */
-  assert(phy_page_ptr);
-
-  /* fake translation, for now... */
-  *phy_page_ptr = 0;
-
-  return /* access latency, ignored */1;
-}
-
-/* data cache block miss handler function */
-static unsigned int			/* latency of block access */
-dtlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
-	       md_addr_t baddr,		/* block address to access */
-	       int bsize,		/* size of block to access */
-	       struct cache_blk_t *blk,	/* ptr to block in upper level */
-	       tick_t now,		/* time of access */
-	       int prefetch)
-{
-  md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
-
-  /* no real memory access, however, should have user data space attached */
-  assert(phy_page_ptr);
-
-  /* fake translation, for now... */
-  *phy_page_ptr = 0;
-
-  return /* access latency, ignored */1;
-}
-
-/* cache/TLB options */
-static char *cache_dl1_opt /* = "none" */;
-static char *cache_dl2_opt /* = "none" */;
-static char *cache_il1_opt /* = "none" */;
-static char *cache_il2_opt /* = "none" */;
-static char *itlb_opt /* = "none" */;
-static char *dtlb_opt /* = "none" */;
-static int flush_on_syscalls /* = FALSE */;
-static int compress_icache_addrs /* = FALSE */;
+/* memory reference trace output file name */
+static char *mtrace_fname /* = NULL */;
 
 /* text-based stat profiles */
 static int pcstat_nelt = 0;
 static char *pcstat_vars[MAX_PCSTAT_VARS];
 
-/* convert 64-bit inst text addresses to 32-bit inst equivalents */
-#ifdef TARGET_PISA
-#define IACOMPRESS(A)							\
-  (compress_icache_addrs ? ((((A) - ld_text_base) >> 1) + ld_text_base) : (A))
-#define ISCOMPRESS(SZ)							\
-  (compress_icache_addrs ? ((SZ) >> 1) : (SZ))
-#else /* !TARGET_PISA */
-#define IACOMPRESS(A)		(A)
-#define ISCOMPRESS(SZ)		(SZ)
-#endif /* TARGET_PISA */
-
 /* Registe simulator-specific options */
 void
 sim_reg_options(struct opt_odb_t *odb)	/* options database */
@@ -280,66 +142,25 @@ sim_reg_options(struct opt_odb_t *odb)	/* options database */
 	       &max_insts, /* default */0,
 	       /* print */TRUE, /* format */NULL);
 
-  opt_reg_string(odb, "-cache:dl1",
-		 "l1 data cache config, i.e., {<config>|none}",
-		 &cache_dl1_opt, "dl1:256:32:1:l:0", /* print */TRUE, NULL);
-  opt_reg_note(odb,
-"  The cache config parameter <config> has the following format:\n"
-"\n"
-"    <name>:<nsets>:<bsize>:<assoc>:<repl>:<pref>\n"
-"\n"
-"    <name>   - name of the cache being defined\n"
-"    <nsets>  - number of sets in the cache\n"
-"    <bsize>  - block size of the cache\n"
-"    <assoc>  - associativity of the cache\n"
-"    <repl>   - block replacement strategy, 'l'-LRU, 'f'-FIFO, 'r'-random, 'n'-NRU\n"
-"    <pref>   - prefetcher type, 0 - no prefetcher, 1 - next line prefetcher,\n"
-"	       2 - open-ended prefetcher, \n"
-"	       any other number num - stride prefetcher with num entries in the Reference Prediction Table (RPT)\n"
-"\n"
-"    Examples:   -cache:dl1 dl1:4096:32:1:l:1\n"
-"                -dtlb dtlb:128:4096:32:r:0\n"
-	       );
-  opt_reg_string(odb, "-cache:dl2",
-		 "l2 data cache config, i.e., {<config>|none}",
-		 &cache_dl2_opt, "ul2:1024:64:4:l:0", /* print */TRUE, NULL);
-  opt_reg_string(odb, "-cache:il1",
-		 "l1 inst cache config, i.e., {<config>|dl1|dl2|none}",
-		 &cache_il1_opt, "il1:256:32:1:l:0", /* print */TRUE, NULL);
-  opt_reg_note(odb,
-"  Cache levels can be unified by pointing a level of the instruction cache\n"
-"  hierarchy at the data cache hiearchy using the \"dl1\" and \"dl2\" cache\n"
-"  configuration arguments.  Most sensible combinations are supported, e.g.,\n"
-"\n"
-"    A unified l2 cache (il2 is pointed at dl2):\n"
-"      -cache:il1 il1:128:64:1:l:0 -cache:il2 dl2\n"
-"      -cache:dl1 dl1:256:32:1:l:0 -cache:dl2 ul2:1024:64:2:l:0\n"
-"\n"
-"    Or, a fully unified cache hierarchy (il1 pointed at dl1):\n"
-"      -cache:il1 dl1\n"
-"      -cache:dl1 ul1:256:32:1:l:0 -cache:dl2 ul2:1024:64:2:l:0\n"
-	       );
-  opt_reg_string(odb, "-cache:il2",
-		 "l2 instruction cache config, i.e., {<config>|dl2|none}",
-		 &cache_il2_opt, "dl2", /* print */TRUE, NULL);
-  opt_reg_string(odb, "-tlb:itlb",
-		 "instruction TLB config, i.e., {<config>|none}",
-		 &itlb_opt, "itlb:16:4096:4:l:0", /* print */TRUE, NULL);
-  opt_reg_string(odb, "-tlb:dtlb",
-		 "data TLB config, i.e., {<config>|none}",
-		 &dtlb_opt, "dtlb:32:4096:4:l:0", /* print */TRUE, NULL);
-  opt_reg_flag(odb, "-flush", "flush caches on system calls",
-	       &flush_on_syscalls, /* default */FALSE, /* print */TRUE, NULL);
-  opt_reg_flag(odb, "-cache:icompress",
-	       "convert 64-bit inst addresses to 32-bit inst equivalents",
-	       &compress_icache_addrs, /* default */FALSE,
-	       /* print */TRUE, NULL);
+  /* cache hierarchy */
+  cachesim_reg_options(odb);
 
   opt_reg_string_list(odb, "-pcstat",
 		      "profile stat(s) against text addr's (mult uses ok)",
 		      pcstat_vars, MAX_PCSTAT_VARS, &pcstat_nelt, NULL,
 		      /* !print */FALSE, /* format */NULL, /* accrue */TRUE);
 
+  opt_reg_string(odb, "-mtrace",
+		 "record memory reference trace to file (.gz to compress)",
+		 &mtrace_fname, /* default */NULL, /* print */TRUE, NULL);
+  opt_reg_note(odb,
+"  A memory reference trace recorded with -mtrace can be given in place of\n"
+"  the program to replay its reference stream through the configured caches\n"
+"  and TLBs, without re-executing the benchmark, e.g.,\n"
+"\n"
+"    sim-cache -mtrace go.mtr.gz go.alpha 50 9 2stone9.in\n"
+"    sim-cache -cache:dl1 dl1:64:64:4:l:16 go.mtr.gz\n"
+	       );
 }
 
 /* check simulator-specific option values */
@@ -347,133 +168,7 @@ void
 sim_check_options(struct opt_odb_t *odb,	/* options database */
 		  int argc, char **argv)	/* command line arguments */
 {
-  char name[128], c;
-  int nsets, bsize, assoc;
-  int prefetch_type;			/* this specifies the type of the prefetcher */
-
-  /* use a level 1 D-cache? */
-  if (!mystricmp(cache_dl1_opt, "none"))
-    {
-      cache_dl1 = NULL;
-
-      /* the level 2 D-cache cannot be defined */
-      if (strcmp(cache_dl2_opt, "none"))
-	fatal("the l1 data cache must defined if the l2 cache is defined");
-      cache_dl2 = NULL;
-    }
-  else /* dl1 is defined */
-    {
-      if (sscanf(cache_dl1_opt, "%[^:]:%d:%d:%d:%c:%d", 
-		 name, &nsets, &bsize, &assoc, &c, &prefetch_type) != 6)
-	fatal("bad l1 D-cache parms: <name>:<nsets>:<bsize>:<assoc>:<repl>:<pref>");
-      cache_dl1 = cache_create(name, nsets, bsize, /* balloc */FALSE,
-			       /* usize */0, assoc, cache_char2policy(c),
-			       dl1_access_fn, /* hit latency */1, prefetch_type);
-
-      /* is the level 2 D-cache defined? */
-      if (!mystricmp(cache_dl2_opt, "none"))
-	cache_dl2 = NULL;
-      else
-	{
-	  if (sscanf(cache_dl2_opt, "%[^:]:%d:%d:%d:%c:%d",
-		     name, &nsets, &bsize, &assoc, &c, &prefetch_type) != 6)
-	    fatal("bad l2 D-cache parms: "
-		  "<name>:<nsets>:<bsize>:<assoc>:<repl>:<pref>");
-	  cache_dl2 = cache_create(name, nsets, bsize, /* balloc */FALSE,
-				   /* usize */0, assoc, cache_char2policy(c), 
-				   dl2_access_fn, /* hit latency */1, prefetch_type);
-	}
-    }
-
-  /* use a level 1 I-cache? */
-  if (!mystricmp(cache_il1_opt, "none"))
-    {
-      cache_il1 = NULL;
-
-      /* the level 2 I-cache cannot be defined */
-      if (strcmp(cache_il2_opt, "none"))
-	fatal("the l1 inst cache must defined if the l2 cache is defined");
-      cache_il2 = NULL;
-    }
-  else if (!mystricmp(cache_il1_opt, "dl1"))
-    {
-      if (!cache_dl1)
-	fatal("I-cache l1 cannot access D-cache l1 as it's undefined");
-      cache_il1 = cache_dl1;
-
-      /* the level 2 I-cache cannot be defined */
-      if (strcmp(cache_il2_opt, "none"))
-	fatal("the l1 inst cache must defined if the l2 cache is defined");
-      cache_il2 = NULL;
-    }
-  else if (!mystricmp(cache_il1_opt, "dl2"))
-    {
-      if (!cache_dl2)
-	fatal("I-cache l1 cannot access D-cache l2 as it's undefined");
-      cache_il1 = cache_dl2;
-
-      /* the level 2 I-cache cannot be defined */
-      if (strcmp(cache_il2_opt, "none"))
-	fatal("the l1 inst cache must defined if the l2 cache is defined");
-      cache_il2 = NULL;
-    }
-  else /* il1 is defined */
-    {
-      if (sscanf(cache_il1_opt, "%[^:]:%d:%d:%d:%c:%d",
-		 name, &nsets, &bsize, &assoc, &c,&prefetch_type) != 6)
-	fatal("bad l1 I-cache parms: <name>:<nsets>:<bsize>:<assoc>:<repl>:<pref>");
-      cache_il1 = cache_create(name, nsets, bsize, /* balloc */FALSE,
-			       /* usize */0, assoc, cache_char2policy(c), 
-			       il1_access_fn, /* hit latency */1, prefetch_type);
-
-      /* is the level 2 D-cache defined? */
-      if (!mystricmp(cache_il2_opt, "none"))
-	cache_il2 = NULL;
-      else if (!mystricmp(cache_il2_opt, "dl2"))
-	{
-	  if (!cache_dl2)
-	    fatal("I-cache l2 cannot access D-cache l2 as it's undefined");
-	  cache_il2 = cache_dl2;
-	}
-      else
-	{
-	  if (sscanf(cache_il2_opt, "%[^:]:%d:%d:%d:%c:%d",
-		     name, &nsets, &bsize, &assoc, &c, &prefetch_type) != 6)
-	    fatal("bad l2 I-cache parms: "
-		  "<name>:<nsets>:<bsize>:<assoc>:<repl>:<pref>");
-	  cache_il2 = cache_create(name, nsets, bsize, /* balloc */FALSE,
-				   /* usize */0, assoc, cache_char2policy(c), 
-				   il2_access_fn, /* hit latency */1, prefetch_type);
-	}
-    }
-
-  /* use an I-TLB? */
-  if (!mystricmp(itlb_opt, "none"))
-    itlb = NULL;
-  else
-    {
-      if (sscanf(itlb_opt, "%[^:]:%d:%d:%d:%c:%d",
-		 name, &nsets, &bsize, &assoc, &c, &prefetch_type) != 6)
-	fatal("bad TLB parms: <name>:<nsets>:<page_size>:<assoc>:<repl>:<pref>");
-      itlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
-			  /* usize */sizeof(md_addr_t), assoc,
-			  cache_char2policy(c), itlb_access_fn,
-			  /* hit latency */1, prefetch_type);
-    }
-
-  /* use a D-TLB? */
-  if (!mystricmp(dtlb_opt, "none"))
-    dtlb = NULL;
-  else
-    {
-      if (sscanf(dtlb_opt, "%[^:]:%d:%d:%d:%c:%d",
-		 name, &nsets, &bsize, &assoc, &c, &prefetch_type) != 6)
-	fatal("bad TLB parms: <name>:<nsets>:<page_size>:<assoc>:<repl>:<pref>");
-      dtlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
-			  /* usize */sizeof(md_addr_t), assoc,
-			  cache_char2policy(c),  dtlb_access_fn,
-			  /* hit latency */1, prefetch_type);
-    }
+  cachesim_check_options();
 }
 
 /* initialize the simulator */
@@ -510,8 +205,23 @@ sim_load_prog(char *fname,		/* program to load */
 	      int argc, char **argv,	/* program arguments */
 	      char **envp)		/* program environment */
 {
-  /* load program text and data, set up environment, memory, and regs */
-  ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
+  if (mtr_valid(fname))
+    {
+      /* replay a memory reference trace, no program is executed */
+      if (mtrace_fname)
+	fatal("cannot record a memory trace while replaying one");
+      mtr_in = mtr_open(fname);
+      ld_text_base = mtr_in->text_base;
+    }
+  else
+    {
+      /* load program text and data, set up environment, memory, and regs */
+      ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
+      predec = predec_create(mem, PREDEC_NENTS);
+
+      if (mtrace_fname)
+	mtr_out = mtr_create(mtrace_fname, ld_text_base);
+    }
 
   /* initialize the DLite debugger */
   dlite_init(md_reg_obj, dlite_mem_obj, cache_mstate_obj);
@@ -545,20 +255,7 @@ sim_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
 		   "sim_num_insn / sim_elapsed_time", NULL);
 
   /* register cache stats */
-  if (cache_il1
-      && (cache_il1 != cache_dl1 && cache_il1 != cache_dl2))
-    cache_reg_stats(cache_il1, sdb);
-  if (cache_il2
-      && (cache_il2 != cache_dl1 && cache_il2 != cache_dl2))
-    cache_reg_stats(cache_il2, sdb);
-  if (cache_dl1)
-    cache_reg_stats(cache_dl1, sdb);
-  if (cache_dl2)
-    cache_reg_stats(cache_dl2, sdb);
-  if (itlb)
-    cache_reg_stats(itlb, sdb);
-  if (dtlb)
-    cache_reg_stats(dtlb, sdb);
+  cachesim_reg_stats(sdb);
 
   for (i=0; i<pcstat_nelt; i++)
     {
@@ -590,8 +287,15 @@ sim_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
 					/* format */"0x%p %u %.2f",
 					/* print fn */NULL);
     }
+  if (mtr_out)
+    mtr_reg_stats(mtr_out, "mtrace", sdb);
+  if (mtr_in)
+    mtr_reg_stats(mtr_in, "mtrace", sdb);
+
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
+  if (predec)
+    predec_reg_stats(predec, sdb);
 }
 
 /* dump simulator-specific auxiliary simulator statistics */
@@ -605,7 +309,9 @@ sim_aux_stats(FILE *stream)		/* output stream */
 void
 sim_uninit(void)
 {
-  /* nada */
+  if (mtr_out)
+    mtr_close(mtr_out);
+  mtr_out = NULL;
 }
 
 /*
@@ -662,16 +368,33 @@ sim_uninit(void)
 #error No ISA target defined...
 #endif
 
+/* record a reference to the memory trace, if one is being recorded */
+static int
+mtrace_ref(enum mtr_kind_t kind,	/* record kind */
+	   enum mem_cmd cmd,		/* Read or Write */
+	   md_addr_t addr,		/* referenced address */
+	   int nbytes,			/* reference size */
+	   int sys)			/* non-zero for syscall accesses */
+{
+  struct mtr_rec_t rec;
+
+  rec.kind = kind;
+  rec.cmd = cmd;
+  rec.sys = sys;
+  rec.nbytes = nbytes;
+  rec.pc = regs.regs_PC;
+  rec.addr = addr;
+  mtr_write(mtr_out, &rec);
+
+  return 0;
+}
+
 /* precise architected memory state accessor macros */
 #define __READ_CACHE(addr, SRC_T)					\
-  ((dtlb								\
-    ? cache_access(dtlb, Read, (addr), NULL,				\
-		   sizeof(SRC_T), 0, NULL, NULL, 0)			\
+  ((mtr_out								\
+    ? mtrace_ref(MTR_DATA, Read, (addr), sizeof(SRC_T), FALSE)		\
     : 0),								\
-   (cache_dl1								\
-    ? cache_access(cache_dl1, Read, (addr), NULL,			\
-		   sizeof(SRC_T), 0, NULL, NULL, 0)			\
-    : 0))
+   cachesim_data(Read, (addr), sizeof(SRC_T)))
 
 #define READ_BYTE(SRC, FAULT)						\
   ((FAULT) = md_fault_none, addr = (SRC),				\
@@ -689,14 +412,10 @@ sim_uninit(void)
 #endif /* HOST_HAS_QWORD */
 
 #define __WRITE_CACHE(addr, DST_T)					\
-  ((dtlb								\
-    ? cache_access(dtlb, Write, (addr), NULL,				\
-		   sizeof(DST_T), 0, NULL, NULL, 0)			\
+  ((mtr_out								\
+    ? mtrace_ref(MTR_DATA, Write, (addr), sizeof(DST_T), FALSE)		\
     : 0),								\
-   (cache_dl1								\
-    ? cache_access(cache_dl1, Write, (addr), NULL,			\
-		   sizeof(DST_T), 0,  NULL, NULL, 0)			\
-    : 0))
+   cachesim_data(Write, (addr), sizeof(DST_T)))
 
 #define WRITE_BYTE(SRC, DST, FAULT)					\
   ((FAULT) = md_fault_none, addr = (DST),				\
@@ -721,19 +440,17 @@ dcache_access_fn(struct mem_t *mem,	/* memory space to access */
 		 void *p,		/* data input/output buffer */
 		 int nbytes)		/* number of bytes to access */
 {
-  if (dtlb)
-    cache_access(dtlb, cmd, addr, NULL, nbytes, 0, NULL, NULL, 0);
-  if (cache_dl1)
-    cache_access(cache_dl1, cmd, addr, NULL, nbytes, 0, NULL, NULL, 0);
+  if (mtr_out)
+    mtrace_ref(MTR_DATA, cmd, addr, nbytes, TRUE);
+  cachesim_data(cmd, addr, nbytes);
   return mem_access(mem, cmd, addr, p, nbytes);
 }
 
 /* system call handler macro */
 #define SYSCALL(INST)							\
-  (flush_on_syscalls							\
-   ? ((dtlb ? cache_flush(dtlb, 0) : 0),				\
-      (cache_dl1 ? cache_flush(cache_dl1, 0) : 0),			\
-      (cache_dl2 ? cache_flush(cache_dl2, 0) : 0),			\
+  ((mtr_out ? mtrace_ref(MTR_SYSCALL, Read, 0, 0, FALSE) : 0),		\
+   flush_on_syscalls							\
+   ? (cachesim_flush(),							\
       sys_syscall(&regs, mem_access, mem, INST, TRUE))			\
    : sys_syscall(&regs, dcache_access_fn, mem, INST, TRUE))
 
@@ -742,11 +459,19 @@ void
 sim_main(void)
 {
   int i;
+  struct predec_ent *pd;
   md_inst_t inst;
   register md_addr_t addr;
   enum md_opcode op;
   register int is_write;
   enum md_fault_type fault;
+
+  if (mtr_in)
+    {
+      /* the PC of each record is installed in regs_PC for get_PC() */
+      cachesim_replay(mtr_in, max_insts, &sim_num_refs, &regs.regs_PC);
+      return;
+    }
  
   fprintf(stderr, "sim: ** starting functional simulation w/ caches **\n");
 
@@ -767,13 +492,11 @@ sim_main(void)
 #endif /* TARGET_ALPHA */
 
       /* get the next instruction to execute */
-      if (itlb)
-	cache_access(itlb, Read, IACOMPRESS(regs.regs_PC),
-		     NULL, ISCOMPRESS(sizeof(md_inst_t)), 0, NULL, NULL, 0);
-      if (cache_il1)
-	cache_access(cache_il1, Read, IACOMPRESS(regs.regs_PC),
-		     NULL, ISCOMPRESS(sizeof(md_inst_t)), 0, NULL, NULL, 0);
-      MD_FETCH_INST(inst, mem, regs.regs_PC);
+      if (mtr_out)
+	mtrace_ref(MTR_IFETCH, Read, regs.regs_PC, sizeof(md_inst_t), FALSE);
+      cachesim_fetch(regs.regs_PC);
+      pd = PREDEC_LOOKUP(predec, regs.regs_PC);
+      inst = pd->inst;
 
       /* keep an instruction count */
       sim_num_insn++;
@@ -784,8 +507,8 @@ sim_main(void)
       /* set default fault - none */
       fault = md_fault_none;
 
-      /* decode the instruction */
-      MD_SET_OPCODE(op, inst);
+      /* the instruction is pre-decoded */
+      op = pd->op;
 
       /* execute the instruction */
       switch (op)
@@ -808,10 +531,10 @@ sim_main(void)
       if (fault != md_fault_none)
 	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
 
-      if (MD_OP_FLAGS(op) & F_MEM)
+      if (pd->flags & F_MEM)
 	{
 	  sim_num_refs++;
-	  if (MD_OP_FLAGS(op) & F_STORE)
+	  if (pd->flags & F_STORE)
 	    is_write = TRUE;
 	}
 
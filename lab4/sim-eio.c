@@ -58,6 +58,7 @@
 #include "machine.h"
 #include "regs.h"
 #include "memory.h"
+#include "predec.h"
 #include "loader.h"
 #include "syscall.h"
 #include "dlite.h"
@@ -80,6 +81,9 @@ static struct regs_t regs;
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
+/* pre-decoded program text */
+static struct predec_t *predec = NULL;
+
 /* track number of refs */
 static counter_t sim_num_refs = 0;
 
@@ -202,6 +206,7 @@ sim_reg_stats(struct stat_sdb_t *sdb)
 		   "sim_num_insn / sim_elapsed_time", NULL);
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
+  predec_reg_stats(predec, sdb);
 }
 
 /* initialize the simulator */
@@ -227,6 +232,9 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
+  /* keep the program text pre-decoded */
+  predec = predec_create(mem, PREDEC_NENTS);
+
   if (chkpt_nelt == 2)
     {
       char *errstr;
@@ -398,6 +406,7 @@ sim_uninit(void)
 void
 sim_main(void)
 {
+  struct predec_ent *pd;
   md_inst_t inst;
   register md_addr_t addr;
   enum md_opcode op;
@@ -430,7 +439,8 @@ sim_main(void)
 #endif /* TARGET_ALPHA */
 
 	  /* get the next instruction to execute */
-	  MD_FETCH_INST(inst, mem, regs.regs_PC);
+	  pd = PREDEC_LOOKUP(predec, regs.regs_PC);
+	  inst = pd->inst;
 
 	  /* set default reference address */
 	  addr = 0; is_write = FALSE;
@@ -438,8 +448,8 @@ sim_main(void)
 	  /* set default fault - none */
 	  fault = md_fault_none;
 
-	  /* decode the instruction */
-	  MD_SET_OPCODE(op, inst);
+	  /* the instruction is pre-decoded */
+	  op = pd->op;
 
 	  /* execute the instruction */
 	  switch (op)
@@ -464,9 +474,9 @@ sim_main(void)
 	    fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
 
 	  /* update memory access stats */
-	  if (MD_OP_FLAGS(op) & F_MEM)
+	  if (pd->flags & F_MEM)
 	    {
-	      if (MD_OP_FLAGS(op) & F_STORE)
+	      if (pd->flags & F_STORE)
 		is_write = TRUE;
 	    }
 
@@ -543,7 +553,8 @@ sim_main(void)
 	}
 
       /* get the next instruction to execute */
-      MD_FETCH_INST(inst, mem, regs.regs_PC);
+      pd = PREDEC_LOOKUP(predec, regs.regs_PC);
+      inst = pd->inst;
 
       /* keep an instruction count */
       sim_num_insn++;
@@ -554,8 +565,8 @@ sim_main(void)
       /* set default fault - none */
       fault = md_fault_none;
 
-      /* decode the instruction */
-      MD_SET_OPCODE(op, inst);
+      /* the instruction is pre-decoded */
+      op = pd->op;
 
       /* execute the instruction */
       switch (op)
@@ -578,10 +589,10 @@ sim_main(void)
       if (fault != md_fault_none)
 	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
 
-      if (MD_OP_FLAGS(op) & F_MEM)
+      if (pd->flags & F_MEM)
 	{
 	  sim_num_refs++;
-	  if (MD_OP_FLAGS(op) & F_STORE)
+	  if (pd->flags & F_STORE)
 	    is_write = TRUE;
 	}
 
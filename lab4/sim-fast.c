@@ -52,6 +52,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 
 /*
  * This file implements a very fast functional simulator.  This functional
@@ -70,10 +71,10 @@
 #undef NO_INSN_COUNT
 
 #ifdef __GNUC__
-/* faster dispatch mechanism, requires GNU GCC C extensions, CAVEAT: some
-   versions of GNU GCC core dump when optimizing the jump table code with
-   optimization levels higher than -O1 */
-/* #define USE_JUMP_TABLE */
+/* faster dispatch mechanism, requires GNU GCC C extensions: the pre-decoded
+   text carries the address of each instruction's implementing code, which
+   jumps straight on to the next instruction's code (direct threading) */
+#define USE_JUMP_TABLE
 #endif /* __GNUC__ */
 
 #include "host.h"
@@ -84,18 +85,60 @@
 #include "loader.h"
 #include "syscall.h"
 #include "dlite.h"
+#include "eio.h"
+#include "predec.h"
 #include "sim.h"
 
+#if defined(USE_JUMP_TABLE) && defined(TARGET_PISA)
+/* fastest dispatch mechanism, builds on the jump table: straight-line runs
+   of instructions, followed through direct jumps, are translated once into
+   superblocks of micro-operations with their instruction fields already
+   extracted, the superblocks are chained to the ones they exit to */
+#define USE_SUPERBLOCKS
+#endif /* USE_JUMP_TABLE && TARGET_PISA */
+
 /* simulated registers */
 static struct regs_t regs;
 
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
-#ifdef TARGET_ALPHA
-/* predecoded text memory */
-static struct mem_t *dec = NULL;
-#endif
+/* pre-decoded program text */
+static struct predec_t *predec = NULL;
+
+#ifdef USE_JUMP_TABLE
+/* execute with direct-threaded code, rather than the switch loop */
+static int threaded;
+#endif /* USE_JUMP_TABLE */
+
+#ifdef USE_SUPERBLOCKS
+/* execute superblocks of micro-operations, rather than instructions */
+static int superblocks;
+
+/* superblocks translated, and superblock cache flushes */
+static counter_t sb_translations = 0;
+static counter_t sb_flushes = 0;
+#endif /* USE_SUPERBLOCKS */
+
+/* checkpoint file name, a `%d' in it is replaced with the checkpoint
+   number */
+static char *chkpt_fname = NULL;
+
+/* instruction counts to write checkpoints at */
+#define MAX_CHKPTS		64
+static int chkpt_nelt = 0;
+static char *chkpt_opts[MAX_CHKPTS];
+static counter_t chkpt_at[MAX_CHKPTS];
+
+/* warm-up instructions each checkpoint is taken ahead of its count */
+static unsigned int chkpt_warmup;
+
+/* exit after writing the last checkpoint */
+static int chkpt_exit;
+
+/* checkpoints written, and the instruction count of the next one */
+static int chkpt_num = 0;
+static counter_t chkpt_next_icnt = -1;
 
 /* register simulator-specific options */
 void
@@ -110,14 +153,88 @@ sim_reg_options(struct opt_odb_t *odb)
 "causing sim-fast to execute incorrectly or dump core.  Such is the\n"
 "price we pay for speed!!!!\n"
 		 );
+
+#ifdef USE_SUPERBLOCKS
+  opt_reg_flag(odb, "-superblocks",
+	       "execute superblocks of pre-translated micro-operations",
+	       &superblocks, /* default */TRUE, /* print */TRUE, NULL);
+#endif /* USE_SUPERBLOCKS */
+
+#ifdef USE_JUMP_TABLE
+  opt_reg_flag(odb, "-threaded", "execute with direct-threaded code",
+	       &threaded, /* default */TRUE, /* print */TRUE, NULL);
+#endif /* USE_JUMP_TABLE */
+
+  opt_reg_string(odb, "-chkpt:file",
+		 "checkpoint file name, a `%d' in it is replaced with the "
+		 "checkpoint number",
+		 &chkpt_fname, /* default */NULL, /* print */TRUE, NULL);
+
+  opt_reg_string_list(odb, "-chkpt:at",
+		      "instruction count to write a checkpoint at "
+		      "(mult uses ok)",
+		      chkpt_opts, MAX_CHKPTS, &chkpt_nelt, /* default */NULL,
+		      /* print */TRUE, /* format */NULL, /* accrue */TRUE);
+
+  opt_reg_uint(odb, "-chkpt:warmup",
+	       "warm-up instructions to take each checkpoint ahead of its "
+	       "count",
+	       &chkpt_warmup, /* default */0, /* print */TRUE, NULL);
+
+  opt_reg_flag(odb, "-chkpt:exit", "exit after writing the last checkpoint",
+	       &chkpt_exit, /* default */TRUE, /* print */TRUE, NULL);
+
+  opt_reg_note(odb,
+"  Checkpoints hold the program's registers, memory and open host files,\n"
+"  and restore with `-chkpt <file>' in any simulator, including runs of\n"
+"  plain program binaries.  A checkpoint taken with -chkpt:warmup starts\n"
+"  that many instructions ahead of its count, and sim-outorder simulates\n"
+"  those in detail before it starts collecting statistics.\n"
+		 );
+
+#ifdef USE_SUPERBLOCKS
+  opt_reg_note(odb,
+"  -superblocks takes precedence over -threaded, with both off sim-fast\n"
+"  executes its switch loop.\n"
+		 );
+#endif /* USE_SUPERBLOCKS */
 }
 
 /* check simulator-specific option values */
 void
 sim_check_options(struct opt_odb_t *odb, int argc, char **argv)
 {
+  int i;
+
   if (dlite_active)
     fatal("sim-fast does not support DLite debugging");
+
+  if (chkpt_nelt > 0)
+    {
+#ifdef NO_INSN_COUNT
+      fatal("checkpoints need the instruction count, "
+	    "rebuild without NO_INSN_COUNT");
+#endif /* NO_INSN_COUNT */
+      if (!chkpt_fname)
+	fatal("-chkpt:at needs a -chkpt:file name");
+      if (chkpt_nelt > 1 && strchr(chkpt_fname, '%') == NULL)
+	fatal("more than one checkpoint needs a printf-style "
+	      "-chkpt:file name");
+
+      for (i=0; i < chkpt_nelt; i++)
+	{
+	  if (sscanf(chkpt_opts[i], "%Ld", &chkpt_at[i]) != 1
+	      || chkpt_at[i] < 0)
+	    fatal("can't parse checkpoint instruction count '%s'",
+		  chkpt_opts[i]);
+	  if (chkpt_at[i] < (counter_t)chkpt_warmup)
+	    fatal("checkpoint at instruction %s is inside its warm-up window",
+		  chkpt_opts[i]);
+	  if (i > 0 && chkpt_at[i] <= chkpt_at[i-1])
+	    fatal("-chkpt:at instruction counts must be increasing");
+	}
+      chkpt_next_icnt = chkpt_at[0] - chkpt_warmup;
+    }
 }
 
 /* register simulator-specific statistics */
@@ -139,9 +256,17 @@ sim_reg_stats(struct stat_sdb_t *sdb)
 #endif /* !NO_INSN_COUNT */
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
-#ifdef TARGET_ALPHA
-  mem_reg_stats(dec, sdb);
-#endif
+  predec_reg_stats(predec, sdb);
+#ifdef USE_SUPERBLOCKS
+  if (superblocks)
+    {
+      stat_reg_counter(sdb, "sb.translations", "superblocks translated",
+		       &sb_translations, 0, NULL);
+      stat_reg_counter(sdb, "sb.flushes",
+		       "superblock cache flushes, on text writes or when full",
+		       &sb_flushes, 0, NULL);
+    }
+#endif /* USE_SUPERBLOCKS */
 }
 
 /* initialize the simulator */
@@ -165,38 +290,8 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
-#ifdef TARGET_ALPHA
-  /* pre-decode text segment */
-  {
-    unsigned i, num_insn = (ld_text_size + 3) / 4;
-
-    fprintf(stderr, "** pre-decoding %u insts...", num_insn);
-
-    /* allocate decoded text space */
-    dec = mem_create("dec");
-
-    for (i=0; i < num_insn; i++)
-      {
-	enum md_opcode op;
-	md_inst_t inst;
-	md_addr_t PC;
-
-	/* compute PC */
-	PC = ld_text_base + i * sizeof(md_inst_t);
-
-	/* get instruction from memory */
-	MD_FETCH_INST(inst, mem, PC);
-
-	/* decode the instruction */
-	MD_SET_OPCODE(op, inst);
-
-	/* insert into decoded opcode space */
-	MEM_WRITE_WORD(dec, PC << 1, (word_t)op);
-	MEM_WRITE_WORD(dec, (PC << 1)+sizeof(word_t), inst);
-      }
-    fprintf(stderr, "done\n");
-  }
-#endif /* TARGET_ALPHA */
+  /* pre-decode the program text as it executes */
+  predec = predec_create(mem, PREDEC_NENTS);
 }
 
 /* print simulator-specific configuration information */
@@ -220,6 +315,48 @@ sim_uninit(void)
   /* nada */
 }
 
+/* write the next checkpoint, the program is about to execute the
+   instruction at PC */
+static void
+chkpt_write(md_addr_t PC)
+{
+  char fname[256];
+  FILE *fd;
+  md_addr_t saved_PC = regs.regs_PC, saved_NPC = regs.regs_NPC;
+
+  /* the checkpoint resumes at PC */
+  regs.regs_PC = PC;
+  regs.regs_NPC = PC + sizeof(md_inst_t);
+
+  /* 'chkpt_fname' may be a printf format string */
+  sprintf(fname, chkpt_fname, chkpt_num + 1);
+  fd = eio_create(fname);
+
+  myfprintf(stderr, "sim: writing checkpoint file `%s' @ inst %n...\n",
+	    fname, sim_num_insn);
+
+  /* write the checkpoint file */
+  eio_write_chkpt(&regs, mem, fd);
+  eio_write_chkpt_host(fd, (counter_t)chkpt_warmup);
+
+  /* close the checkpoint file */
+  eio_close(fd);
+
+  regs.regs_PC = saved_PC;
+  regs.regs_NPC = saved_NPC;
+
+  if (++chkpt_num < chkpt_nelt)
+    chkpt_next_icnt = chkpt_at[chkpt_num] - chkpt_warmup;
+  else
+    {
+      chkpt_next_icnt = -1;
+
+      /* exit jumps to the target set in main() */
+      if (chkpt_exit)
+	longjmp(sim_exit_buf, /* exitcode + fudge */0+1);
+    }
+}
+
 /*
  * configure the execution engine
  */
@@ -302,24 +439,300 @@ sim_uninit(void)
 #define INC_INSN_CTR()	/* nada */
 #endif /* NO_INSN_COUNT */
 
+/* write a checkpoint before the instruction at PC? */
+#ifndef NO_INSN_COUNT
+#define CHKPT_CHECK(PC)							\
+  if (sim_num_insn == chkpt_next_icnt) chkpt_write(PC)
+#else /* !NO_INSN_COUNT */
+#define CHKPT_CHECK(PC)	/* nada */
+#endif /* NO_INSN_COUNT */
+
 #ifdef TARGET_ALPHA
 #define ZERO_FP_REG()	regs.regs_F.d[MD_REG_ZERO] = 0.0
 #else
 #define ZERO_FP_REG()	/* nada... */
 #endif
 
+#ifdef USE_JUMP_TABLE
+/* thread on to the next instruction; one that cannot write memory cannot
+   change the text, so the entry after its own is still current, and it is
+   the next instruction whenever it holds the next PC, i.e., on fall-through */
+#define THREAD_NEXT(FLAGS)						\
+  pd = (!((FLAGS) & (F_STORE|F_TRAP)) && pd[1].addr == regs.regs_PC)	\
+    ? pd + 1 : PREDEC_LOOKUP(predec, regs.regs_PC);			\
+  goto *pd->impl
+#endif /* USE_JUMP_TABLE */
+
+#ifdef USE_SUPERBLOCKS
+/*
+ * superblock translation: a superblock starts at an instruction in the
+ * program text and follows it through conditional branches (not taken) and
+ * direct jumps, until an indirect jump, a trap, the end of the text, or
+ * SB_MAX_INSN instructions; each instruction becomes one micro-operation
+ * (uop) holding its implementation and its fields, plus a uop that clears
+ * $r0 after an instruction that writes it; execution leaves a superblock at
+ * a taken branch or at its end, and each exit remembers the superblock it
+ * last went to
+ */
+
+/* a superblock micro-operation */
+struct sb_uop {
+  void *impl;			/* implementing code */
+  struct sblock *exit;		/* superblock last exited to, if chained */
+  md_addr_t PC;			/* instruction address */
+  md_addr_t tpc;		/* PC the superblock continues at, for control
+				   insts, the exit PC for the end uop */
+  int n;			/* instructions executed up to this uop */
+  unsigned char rs, rt, rd;	/* register fields */
+  unsigned char shamt;		/* shift amount field */
+  int imm;			/* sign-extended immediate field */
+  unsigned int uimm;		/* zero-extended immediate field */
+  md_inst_t inst;		/* raw instruction */
+};
+
+/* a superblock */
+struct sblock {
+  md_addr_t PC;			/* entry address */
+  int ninsn;			/* instructions on its longest path */
+  int nuops;			/* uops, including the end uop */
+  struct sblock *next;		/* next superblock in hash bucket chain */
+  struct sb_uop *uops;		/* micro-operations */
+};
+
+/* most instructions in a superblock, and most uops it needs */
+#define SB_MAX_INSN		64
+#define SB_MAX_UOPS		(2*SB_MAX_INSN + 1)
+
+/* superblock cache size, it is flushed when full */
+#define SB_NBLOCKS		(8*1024)
+#define SB_NUOPS		(64*1024)
+
+/* superblock cache hash table */
+#define SB_NHASH		4096
+#define SB_HASH(PC)		(((PC) / sizeof(md_inst_t)) & (SB_NHASH-1))
+
+/* an instruction count no superblock run reaches */
+#define SB_NO_LIMIT		((counter_t)1 << 62)
+
+/* superblock cache */
+static struct sblock *sb_hash[SB_NHASH];
+static struct sblock *sb_blocks;
+static int sb_nblocks;
+static struct sb_uop *sb_uops;
+static int sb_nuops;
+
+/* MEM->text_writes as of the last flush */
+static counter_t sb_text_writes;
+
+/* uncached superblock, for code outside the text and for runs up to a
+   checkpoint */
+static struct sblock sb_scratch;
+static struct sb_uop sb_scratch_uops[SB_MAX_UOPS];
+
+/* uop implementations, by opcode, and of the $r0 clearing and end uops */
+static void **sb_impls;
+static void *sb_impl_zero;
+static void *sb_impl_end;
+
+/* allocate the superblock cache */
+static void
+sb_init(void)
+{
+  sb_blocks = calloc(SB_NBLOCKS, sizeof(struct sblock));
+  sb_uops = calloc(SB_NUOPS, sizeof(struct sb_uop));
+  if (!sb_blocks || !sb_uops)
+    fatal("out of virtual memory");
+  sb_text_writes = mem->text_writes;
+}
+
+/* discard every translated superblock */
+static void
+sb_flush(void)
+{
+  int i;
+
+  for (i=0; i < SB_NHASH; i++)
+    sb_hash[i] = NULL;
+  sb_nblocks = 0;
+  sb_nuops = 0;
+  sb_text_writes = mem->text_writes;
+  sb_flushes++;
+}
+
+/* does the instruction write integer register $r0? */
+#define DNA			0
+#define DGPR(N)			((N) == MD_REG_ZERO)
+#define DGPR_D(N)		(((N) & ~1) == MD_REG_ZERO)
+#define DFPR_L(N)		0
+#define DFPR_F(N)		0
+#define DFPR_D(N)		0
+#define DHI			0
+#define DLO			0
+#define DFCC			0
+#define DTMP			0
+
+/* translate at most MAX instructions starting at PC into superblock BLK,
+   with uops at UOPS */
+static struct sblock *
+sb_translate(struct sblock *blk, struct sb_uop *uops, md_addr_t PC, int max)
+{
+  struct predec_ent *pd;
+  struct sb_uop *u = uops, *cu;
+  md_inst_t inst;
+  int n = 0, r0;
+
+  blk->PC = PC;
+  blk->uops = uops;
+  while (n < max)
+    {
+      /* only the first instruction may lie outside the text */
+      if (n > 0 && (PC < predec->text_base || PC >= predec->text_bound))
+	break;
+
+      pd = PREDEC_LOOKUP(predec, PC);
+      inst = pd->inst;
+      n++;
+
+      cu = u++;
+      cu->impl = sb_impls[pd->op];
+      cu->exit = NULL;
+      cu->PC = PC;
+      cu->tpc = PC + sizeof(md_inst_t);
+      cu->n = n;
+      cu->rs = RS;
+      cu->rt = RT;
+      cu->rd = RD;
+      cu->shamt = SHAMT;
+      cu->imm = IMM;
+      cu->uimm = UIMM;
+      cu->inst = inst;
+
+      switch (pd->op)
+	{
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+	case OP:							\
+	  r0 = (O1) || (O2);						\
+	  break;
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+	case OP:							\
+	  r0 = FALSE;							\
+	  break;
+#define CONNECT(OP)
+#include "machine.def"
+	default:
+	  r0 = FALSE;
+	}
+      if (r0)
+	{
+	  u->impl = sb_impl_zero;
+	  u->exit = NULL;
+	  u->PC = PC;
+	  u->n = n;
+	  u++;
+	}
+
+      if (pd->flags & F_CTRL)
+	{
+	  if ((pd->flags & (F_UNCOND|F_DIRJMP)) == (F_UNCOND|F_DIRJMP))
+	    {
+	      /* follow direct jumps */
+	      cu->tpc = (PC & 036000000000) | (TARG << 2);
+	      PC = cu->tpc;
+	      continue;
+	    }
+	  PC += sizeof(md_inst_t);
+	  if (!(pd->flags & F_COND))
+	    break;
+	}
+      else if (pd->flags & F_TRAP)
+	{
+	  PC += sizeof(md_inst_t);
+	  break;
+	}
+      else
+	PC += sizeof(md_inst_t);
+    }
+
+  /* leave the superblock for PC */
+  u->impl = sb_impl_end;
+  u->exit = NULL;
+  u->PC = PC;
+  u->tpc = PC;
+  u->n = n;
+  u++;
+
+  blk->ninsn = n;
+  blk->nuops = u - uops;
+  sb_translations++;
+
+  return blk;
+}
+
+#undef DNA
+#undef DGPR
+#undef DGPR_D
+#undef DFPR_L
+#undef DFPR_F
+#undef DFPR_D
+#undef DHI
+#undef DLO
+#undef DFCC
+#undef DTMP
+
+/* return the superblock at PC, translating it if needed, that runs at most
+   MAX instructions */
+static struct sblock *
+sb_lookup(md_addr_t PC, counter_t max)
+{
+  struct sblock *blk;
+
+  /* the text was written, drop all translations */
+  if (mem->text_writes != sb_text_writes)
+    sb_flush();
+
+  if (PC < predec->text_base || PC >= predec->text_bound)
+    return sb_translate(&sb_scratch, sb_scratch_uops, PC, 1);
+
+  for (blk = sb_hash[SB_HASH(PC)]; blk != NULL; blk = blk->next)
+    if (blk->PC == PC)
+      break;
+
+  if (!blk)
+    {
+      if (sb_nblocks == SB_NBLOCKS || sb_nuops + SB_MAX_UOPS > SB_NUOPS)
+	sb_flush();
+
+      blk = sb_translate(&sb_blocks[sb_nblocks++], &sb_uops[sb_nuops],
+			 PC, SB_MAX_INSN);
+      sb_nuops += blk->nuops;
+      blk->next = sb_hash[SB_HASH(PC)];
+      sb_hash[SB_HASH(PC)] = blk;
+    }
+
+  /* too long to run to the next checkpoint, translate a shorter one */
+  if (blk->ninsn > max)
+    blk = sb_translate(&sb_scratch, sb_scratch_uops, PC, (int)max);
+
+  return blk;
+}
+
+/* is uop U in the uncached superblock? */
+#define SB_IS_SCRATCH(U)						\
+  ((U) >= sb_scratch_uops && (U) < sb_scratch_uops + SB_MAX_UOPS)
+#endif /* USE_SUPERBLOCKS */
+
 /* start simulation, program loaded, processor precise state initialized */
 void
 sim_main(void)
 {
 #ifdef USE_JUMP_TABLE
   /* the jump table employs GNU GCC label extensions to construct an array
-     of pointers to instruction implementation code, the simulator then uses
-     the table to lookup the location of instruction's implementing code, a
-     GNU GCC `goto' extension is then used to jump to the inst's implementing
-     code through the op_jump table; as a result, there is no need for
-     a main simulator loop, which eliminates one branch from the simulator
-     interpreter - crazy, no!?!? */
+     of pointers to instruction implementation code, the pre-decoded text
+     carries these pointers, and each instruction's implementing code ends
+     by jumping through the next instruction's pointer, a GNU GCC `goto'
+     extension; as a result, there is no need for a main simulator loop,
+     and an instruction that falls through to the next one in the text
+     finds it without a lookup - crazy, no!?!? */
 
   /* instruction jump table, this code is GNU GCC specific */
   static void *op_jump[/* max opcodes */] = {
@@ -333,28 +746,70 @@ sim_main(void)
   };
 #endif /* USE_JUMP_TABLE */
 
+#ifdef USE_SUPERBLOCKS
+  /* uop jump table, a superblock's uops point into this code */
+  static void *sb_jump[/* max opcodes */] = {
+    &&sb_NA, /* NA */
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+    &&sb_##OP,
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+    &&sb_##OP,
+#define CONNECT(OP)
+#include "machine.def"
+  };
+
+  /* current uop, uop that exited to the superblock being looked up */
+  register struct sb_uop *u = NULL;
+  struct sb_uop *from = NULL;
+
+  /* current superblock */
+  struct sblock *blk;
+
+  /* next PC after a control uop */
+  md_addr_t sb_npc = 0;
+
+  /* flushes before a lookup, instruction count of the next checkpoint */
+  counter_t sb_gen, sb_limit = SB_NO_LIMIT;
+#endif /* USE_SUPERBLOCKS */
+
   /* register allocate instruction buffer */
   register md_inst_t inst;
 
   /* decoded opcode */
   register enum md_opcode op;
 
+  /* pre-decoded instruction */
+  register struct predec_ent *pd = NULL;
+
   fprintf(stderr, "sim: ** starting *fast* functional simulation **\n");
 
   /* must have natural byte/word ordering */
   if (sim_swap_bytes || sim_swap_words)
     fatal("sim: *fast* functional simulation cannot swap bytes or words");
 
-#ifdef USE_JUMP_TABLE
+#ifdef USE_SUPERBLOCKS
+  if (superblocks)
+    {
+      sb_init();
+      sb_impls = sb_jump;
+      sb_impl_zero = &&sb_zero;
+      sb_impl_end = &&sb_end;
+
+      /* start at the superblock at the first instruction */
+      goto sb_dispatch;
+    }
+#endif /* USE_SUPERBLOCKS */
 
-  regs.regs_NPC = regs.regs_PC;
+#ifdef USE_JUMP_TABLE
 
-  /* load instruction */
-  MD_FETCH_INST(inst, mem, regs.regs_NPC);
+  if (threaded)
+    {
+      /* the pre-decoded text picks up the implementation addresses */
+      predec_set_impls(predec, op_jump);
 
-  /* jump to instruction implementation */
-  MD_SET_OPCODE(op, inst);
-  goto *op_jump[op];
+      /* jump to the first instruction's implementation */
+      pd = PREDEC_LOOKUP(predec, regs.regs_PC);
+      goto *pd->impl;
 
 #define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
   opcode_##OP:								\
@@ -362,24 +817,22 @@ sim_main(void)
     regs.regs_R[MD_REG_ZERO] = 0;					\
     ZERO_FP_REG();							\
 									\
+    /* write a checkpoint here? */					\
+    CHKPT_CHECK(regs.regs_PC);						\
+									\
     /* keep an instruction count */					\
     INC_INSN_CTR();							\
 									\
-    /* locate next instruction */					\
-    regs.regs_PC = regs.regs_NPC;					\
-									\
     /* set up default next PC */					\
-    regs.regs_NPC += sizeof(md_inst_t);					\
-									\
-    /* execute the instruction */					\
-    SYMCAT(OP,_IMPL);							\
+    inst = pd->inst;							\
+    regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);			\
 									\
-    /* get the next instruction */					\
-    MD_FETCH_INST(inst, mem, regs.regs_NPC);				\
+    /* execute the instruction, a fault breaks out of it */		\
+    do { SYMCAT(OP,_IMPL); } while (0);					\
 									\
-    /* jump to instruction implementation */				\
-    MD_SET_OPCODE(op, inst);						\
-    goto *op_jump[op];
+    /* locate next instruction, and jump to its implementation */	\
+    regs.regs_PC = regs.regs_NPC;					\
+    THREAD_NEXT(FLAGS);
 
 #define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
   opcode_##OP:								\
@@ -389,13 +842,11 @@ sim_main(void)
 	  { /* uncaught... */break; }
 #include "machine.def"
 
-  opcode_NA:
-    panic("attempted to execute a bogus opcode");
-
-  /* should not get here... */
-  panic("exited sim-fast main loop");
+    opcode_NA:
+      panic("attempted to execute a bogus opcode");
+    }
 
-#else /* !USE_JUMP_TABLE */
+#endif /* USE_JUMP_TABLE */
 
   /* set up initial default next PC */
   regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
@@ -408,23 +859,18 @@ sim_main(void)
       regs.regs_F.d[MD_REG_ZERO] = 0.0;
 #endif /* TARGET_ALPHA */
 
+      /* write a checkpoint here? */
+      CHKPT_CHECK(regs.regs_PC);
+
       /* keep an instruction count */
 #ifndef NO_INSN_COUNT
       sim_num_insn++;
 #endif /* !NO_INSN_COUNT */
 
-#ifdef TARGET_ALPHA
-      /* load predecoded instruction */
-      op = (enum md_opcode)__UNCHK_MEM_READ(dec, regs.regs_PC << 1, word_t);
-      inst =
-	__UNCHK_MEM_READ(dec, (regs.regs_PC << 1)+sizeof(word_t), md_inst_t);
-#else /* !TARGET_ALPHA */
-      /* load instruction */
-      MD_FETCH_INST(inst, mem, regs.regs_PC);
-
-      /* decode the instruction */
-      MD_SET_OPCODE(op, inst);
-#endif
+      /* load pre-decoded instruction */
+      pd = PREDEC_LOOKUP(predec, regs.regs_PC);
+      inst = pd->inst;
+      op = pd->op;
 
       /* execute the instruction */
       switch (op)
@@ -449,5 +895,120 @@ sim_main(void)
       regs.regs_NPC += sizeof(md_inst_t);
     }
 
-#endif /* USE_JUMP_TABLE */
+#ifdef USE_SUPERBLOCKS
+
+  /* superblock executor, the instruction fields come from the uops, and
+     control instructions set SB_NPC */
+#undef RS
+#define RS			(u->rs)
+#undef RT
+#define RT			(u->rt)
+#undef RD
+#define RD			(u->rd)
+#undef SHAMT
+#define SHAMT			(u->shamt)
+#undef IMM
+#define IMM			(u->imm)
+#undef UIMM
+#define UIMM			(u->uimm)
+#undef TARG
+#define TARG			(u->inst.b & 0x3ffffff)
+#undef BCODE
+#define BCODE			(u->inst.b & 0xfffff)
+#undef CPC
+#define CPC			(u->PC)
+#undef SET_NPC
+#define SET_NPC(EXPR)		(sb_npc = (EXPR))
+#undef SYSCALL
+#define SYSCALL(INST)	sys_syscall(&regs, mem_access, mem, u->inst, TRUE)
+
+ sb_dispatch:
+  /* look up and enter the superblock at regs.regs_PC, chaining the uop
+     that exited to it, if any */
+  CHKPT_CHECK(regs.regs_PC);
+  sb_limit = (chkpt_next_icnt > sim_num_insn) ? chkpt_next_icnt : SB_NO_LIMIT;
+  sb_gen = sb_flushes;
+  blk = sb_lookup(regs.regs_PC, sb_limit - sim_num_insn);
+  if (from && sb_gen == sb_flushes
+      && !SB_IS_SCRATCH(from) && blk != &sb_scratch)
+    from->exit = blk;
+  u = blk->uops;
+  goto *u->impl;
+
+ sb_exit:
+  /* leave the superblock at uop U for SB_NPC, straight into the superblock
+     the uop is chained to if it starts there and the next checkpoint is not
+     inside it */
+  regs.regs_R[MD_REG_ZERO] = 0;
+  sim_num_insn += u->n;
+  blk = u->exit;
+  if (blk && blk->PC == sb_npc && sim_num_insn + blk->ninsn <= sb_limit)
+    {
+      u = blk->uops;
+      goto *u->impl;
+    }
+  regs.regs_PC = sb_npc;
+  from = u;
+  goto sb_dispatch;
+
+ sb_zero:
+  /* maintain $r0 semantics after an instruction that writes it */
+  regs.regs_R[MD_REG_ZERO] = 0;
+  goto *(++u)->impl;
+
+ sb_end:
+  /* end of the superblock */
+  sb_npc = u->tpc;
+  goto sb_exit;
+
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+  sb_##OP:								\
+    /* a trap sees precise state, it ends the superblock */		\
+    if ((FLAGS) & F_TRAP)						\
+      {									\
+	sim_num_insn += u->n;						\
+	regs.regs_PC = u->PC;						\
+	regs.regs_NPC = u->PC + sizeof(md_inst_t);			\
+      }									\
+    if ((FLAGS) & F_CTRL)						\
+      sb_npc = u->PC + sizeof(md_inst_t);				\
+									\
+    /* execute the instruction, a fault breaks out of it */		\
+    do { SYMCAT(OP,_IMPL); } while (0);					\
+									\
+    if ((FLAGS) & F_CTRL)						\
+      {									\
+	/* stay in the superblock or leave it */			\
+	if (sb_npc == u->tpc)						\
+	  goto *(++u)->impl;						\
+	goto sb_exit;							\
+      }									\
+    if ((FLAGS) & F_TRAP)						\
+      {									\
+	regs.regs_PC = regs.regs_NPC;					\
+	from = NULL;							\
+	goto sb_dispatch;						\
+      }									\
+    if (((FLAGS) & F_STORE) && mem->text_writes != sb_text_writes)	\
+      {									\
+	/* the store wrote the text, retranslate from the next PC */	\
+	sim_num_insn += u->n;						\
+	regs.regs_PC = u->PC + sizeof(md_inst_t);			\
+	from = NULL;							\
+	goto sb_dispatch;						\
+      }									\
+    goto *(++u)->impl;
+
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+  sb_##OP:								\
+    panic("attempted to execute a linking opcode");
+#define CONNECT(OP)
+#define DECLARE_FAULT(FAULT)						\
+	  { /* uncaught... */break; }
+#include "machine.def"
+
+  sb_NA:
+    panic("attempted to execute a bogus opcode");
+
+#endif /* USE_SUPERBLOCKS */
 }
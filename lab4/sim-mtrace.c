@@ -0,0 +1,196 @@
+/* sim-mtrace.c - memory reference trace replay cache simulator */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "cache.h"
+#include "loader.h"
+#include "options.h"
+#include "stats.h"
+#include "memtrace.h"
+#include "cachesim.h"
+#include "sim.h"
+
+/*
+ * This file implements a standalone trace-driven cache simulator.  A memory
+ * reference trace recorded with `sim-cache -mtrace' is replayed directly
+ * through cache_access() for a user-selected cache and TLB configuration,
+ * without loading or executing the traced program.  The PC of each trace
+ * record is returned by get_PC(), so PC-indexed prefetchers see the same
+ * reference stream as under sim-cache.
+ */
+
+/* memory reference trace being replayed */
+static struct mtr_file_t *mtr_in = NULL;
+
+/* PC of the trace record being replayed */
+static md_addr_t trace_PC = 0;
+
+/* track number of refs */
+static counter_t sim_num_refs = 0;
+
+/* maximum number of inst's to replay */
+static unsigned int max_insts;
+
+md_addr_t get_PC() {	// return the PC of the trace record being replayed
+   return trace_PC;
+}
+
+/* register simulator-specific options */
+void
+sim_reg_options(struct opt_odb_t *odb)	/* options database */
+{
+  opt_reg_header(odb, 
+"sim-mtrace: This simulator replays a memory reference trace, recorded with\n"
+"`sim-cache -mtrace', through a user-selected cache and TLB configuration.\n"
+"The traced program is not executed, so cache and prefetcher experiments run\n"
+"at trace decode speed.  The trace file is given in place of the program.\n"
+		 );
+
+  /* instruction limit */
+  opt_reg_uint(odb, "-max:inst", "maximum number of inst's to replay",
+	       &max_insts, /* default */0,
+	       /* print */TRUE, /* format */NULL);
+
+  /* cache hierarchy */
+  cachesim_reg_options(odb);
+}
+
+/* check simulator-specific option values */
+void
+sim_check_options(struct opt_odb_t *odb,	/* options database */
+		  int argc, char **argv)	/* command line arguments */
+{
+  cachesim_check_options();
+}
+
+/* initialize the simulator */
+void
+sim_init(void)
+{
+  sim_num_refs = 0;
+}
+
+/* load memory reference trace to replay */
+void
+sim_load_prog(char *fname,		/* trace to replay */
+	      int argc, char **argv,	/* program arguments (ignored) */
+	      char **envp)		/* program environment (ignored) */
+{
+  if (!mtr_valid(fname))
+    fatal("`%s' is not a memory reference trace", fname);
+
+  mtr_in = mtr_open(fname);
+  ld_text_base = mtr_in->text_base;
+}
+
+/* print simulator-specific configuration information */
+void
+sim_aux_config(FILE *stream)		/* output stream */
+{
+  /* nada */
+}
+
+/* register simulator-specific statistics */
+void
+sim_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
+{
+  /* register baseline stats */
+  stat_reg_counter(sdb, "sim_num_insn",
+		   "total number of instructions replayed",
+		   &sim_num_insn, sim_num_insn, NULL);
+  stat_reg_counter(sdb, "sim_num_refs",
+		   "total number of loads and stores replayed",
+		   &sim_num_refs, 0, NULL);
+  stat_reg_int(sdb, "sim_elapsed_time",
+	       "total simulation time in seconds",
+	       &sim_elapsed_time, 0, NULL);
+  stat_reg_formula(sdb, "sim_inst_rate",
+		   "simulation speed (in insts/sec)",
+		   "sim_num_insn / sim_elapsed_time", NULL);
+
+  /* register cache stats */
+  cachesim_reg_stats(sdb);
+
+  if (mtr_in)
+    mtr_reg_stats(mtr_in, "mtrace", sdb);
+}
+
+/* dump simulator-specific auxiliary simulator statistics */
+void
+sim_aux_stats(FILE *stream)		/* output stream */
+{
+  /* nada */
+}
+
+/* un-initialize the simulator */
+void
+sim_uninit(void)
+{
+  if (mtr_in)
+    mtr_close(mtr_in);
+  mtr_in = NULL;
+}
+
+/* replay the trace, references are issued in trace order with no timing */
+void
+sim_main(void)
+{
+  cachesim_replay(mtr_in, max_insts, &sim_num_refs, &trace_PC);
+}
@@ -60,7 +60,10 @@
 #include "machine.h"
 #include "regs.h"
 #include "memory.h"
+#include "predec.h"
 #include "cache.h"
+#include "dram.h"
+#include "tcache.h"
 #include "loader.h"
 #include "syscall.h"
 #include "bpred.h"
@@ -86,6 +89,9 @@ static struct regs_t regs;
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
+/* pre-decoded program text */
+static struct predec_t *predec = NULL;
+
 
 /*
  * simulator options
@@ -97,6 +103,14 @@ static unsigned int max_insts;
 /* number of insts skipped before timing starts */
 static int fastfwd_count;
 
+/* number of final fast forwarded insts that also warm the caches, TLBs and
+   branch predictor, -1 warms them all */
+static int fastfwd_warm;
+
+/* number of insts simulated before statistics collection starts, -1 takes
+   the warm-up window of a restored checkpoint */
+static int warmup_count;
+
 /* pipeline trace range and output filename */
 static int ptrace_nelt = 0;
 static char *ptrace_opts[2];
@@ -110,6 +124,25 @@ static int ruu_branch_penalty;
 /* speed of front-end of machine relative to execution core */
 static int fetch_speed;
 
+/* fetch target queue entries of the decoupled front end, 0 fetches in step
+   with the branch predictor */
+static int ftq_size;
+
+/* most insts in a fetch block */
+static int ftq_block;
+
+/* fetch blocks predicted, and fetched, per cycle */
+static int ftq_width;
+
+/* FTQ entries the fetch-directed I-cache prefetcher runs ahead of fetch */
+static int ftq_prefetch;
+
+/* trace cache config, i.e., {<sets>:<assoc>:<insts>:<branches>|none} */
+static char *tcache_opt;
+
+/* trace cache in front of the I-cache, NULL for none */
+static struct tcache_t *tcache = NULL;
+
 /* branch predictor type {nottaken|taken|perfect|bimod|2lev} */
 static char *pred_type;
 
@@ -145,6 +178,10 @@ static int ruu_issue_width;
 /* run pipeline with in-order issue */
 static int ruu_inorder_issue;
 
+/* ready queue select policy */
+static char *issue_select_opt;
+static enum { issue_select_list, issue_select_oldest } issue_select;
+
 /* issue instructions down wrong execution paths */
 static int ruu_include_spec = TRUE;
 
@@ -154,21 +191,59 @@ static int ruu_commit_width;
 /* register update unit (RUU) size */
 static int RUU_size = 8;
 
+/* physical register file size, RUU holds results if 0 */
+static int prf_size;
+
+/* rename map checkpoints available for branch recovery */
+static int prf_nckpts;
+
+/* issue queue size, ready insts issue from the whole RUU if 0 */
+static int iq_size;
+
 /* load/store queue (LSQ) size */
 static int LSQ_size = 4;
 
+/* memory dependence predictor, i.e., {conservative|storeset} */
+static char *mdp_opt;
+static enum { mdp_conservative, mdp_storeset } mdp_type;
+
+/* store set predictor table sizes, SSIT (by PC) and LFST (by store set) */
+static int mdp_ssit_size;
+static int mdp_lfst_size;
+
+/* cycles between store set SSIT clears, never cleared if 0 */
+static int mdp_clear_interval;
+
 /* l1 data cache config, i.e., {<config>|none} */
 static char *cache_dl1_opt;
 
 /* l1 data cache hit latency (in cycles) */
 static int cache_dl1_lat;
 
+/* l1 data cache MSHRs (<entries> <targets>), no limit if 0 entries */
+static int cache_dl1_mshr_nelt = 2;
+static int cache_dl1_mshr[2] = { /* entries */0, /* targets */0 };
+
 /* l2 data cache config, i.e., {<config>|none} */
 static char *cache_dl2_opt;
 
 /* l2 data cache hit latency (in cycles) */
 static int cache_dl2_lat;
 
+/* l2 data cache MSHRs (<entries> <targets>), no limit if 0 entries */
+static int cache_dl2_mshr_nelt = 2;
+static int cache_dl2_mshr[2] = { /* entries */0, /* targets */0 };
+
+/* write-back buffer entries of the l1 and l2 data caches, 0 for none */
+static int cache_dl1_wbb;
+static int cache_dl2_wbb;
+
+/* l1 data cache victim cache entries, 0 for none */
+static int cache_dl1_vc;
+
+/* inclusion policy of the l2 caches, i.e., {nine|inclusive|exclusive} */
+static char *cache_inclusion_opt;
+
 /* l1 instruction cache config, i.e., {<config>|dl1|dl2|none} */
 static char *cache_il1_opt;
 
@@ -195,12 +270,43 @@ static int mem_lat[2] =
 /* memory access bus width (in bytes) */
 static int mem_bus_width;
 
+/* DRAM main memory config, i.e., {<channels>:<banks>:<row_size>|none} */
+static char *mem_dram_opt;
+
+/* DRAM timing (<ctrl> <tRCD> <tCAS> <tRP> <tBURST>) */
+static int dram_nelt = 5;
+static int dram_lat[5] =
+  { /* controller */10, /* tRCD */15, /* tCAS */15, /* tRP */15,
+    /* per bus width burst */2 };
+
+/* DRAM scheduling policy, i.e., {fcfs|frfcfs} */
+static char *mem_dram_sched;
+
+/* DRAM main memory, NULL if memory has the fixed -mem:lat latency */
+static struct dram_t *dram = NULL;
+
 /* instruction TLB config, i.e., {<config>|none} */
 static char *itlb_opt;
 
 /* data TLB config, i.e., {<config>|none} */
 static char *dtlb_opt;
 
+/* prefetch request queue entries, per cache */
+static int pf_queue_size;
+
+/* adapt prefetch degree/distance to measured accuracy and lateness? */
+static int pf_feedback;
+
+/* stream buffers and blocks per stream, for the stream buffer prefetcher */
+static int pf_streams;
+static int pf_stream_depth;
+
+/* pattern history table entries, for the SMS prefetcher */
+static int pf_pht_size;
+
+/* reference prediction table ways, for the stride and open-ended prefetchers */
+static int pf_rpt_assoc;
+
 /* inst/data TLB miss latency (in cycles) */
 static int tlb_miss_lat;
 
@@ -238,6 +344,25 @@ static char *pcstat_vars[MAX_PCSTAT_VARS];
 /* operate in backward-compatible bugs mode (for testing only) */
 static int bugcompat_mode;
 
+/* simultaneous multithreading (SMT), maximum hardware contexts */
+#define SMT_MAX_THREADS		8
+#define SMT_THREAD_BITS		3	/* log2(SMT_MAX_THREADS) */
+
+/* programs (with arguments) run by the additional hardware contexts */
+static int smt_prog_nelt = 0;
+static char *smt_progs[SMT_MAX_THREADS-1];
+
+/* total hardware contexts, one plus the number of -smt:prog programs */
+static int smt_nthreads = 1;
+
+/* SMT fetch policy */
+static char *smt_fetch_opt;
+static enum { smt_fetch_icount, smt_fetch_rr } smt_fetch_policy;
+
+/* IPC of each program running alone, for the weighted speedup */
+static int smt_ipc_nelt = 0;
+static double smt_ipc_alone[SMT_MAX_THREADS];
+
 /*
  * functional unit resource configuration
  */
@@ -330,6 +455,16 @@ static counter_t sim_total_branches = 0;
 /* cycle counter */
 static tick_t sim_cycle = 0;
 
+/* skip the cycles in which a stalled pipeline only waits? */
+static int cycle_skip;
+
+/* non-zero if a pipeline stage changed the machine state this cycle, other
+   than counting down a fetch or functional unit delay */
+static int pipe_progress = TRUE;
+
+/* cycles skipped while the pipeline was stalled */
+static counter_t sim_skipped_cycles = 0;
+
 /* occupancy counters */
 static counter_t IFQ_count;		/* cumulative IFQ occupancy */
 static counter_t IFQ_fcount;		/* cumulative IFQ full count */
@@ -337,10 +472,49 @@ static counter_t RUU_count;		/* cumulative RUU occupancy */
 static counter_t RUU_fcount;		/* cumulative RUU full count */
 static counter_t LSQ_count;		/* cumulative LSQ occupancy */
 static counter_t LSQ_fcount;		/* cumulative LSQ full count */
+static counter_t FTQ_count;		/* cumulative FTQ occupancy */
+static counter_t FTQ_fcount;		/* cumulative FTQ full count */
+
+/* fetch blocks predicted, and the insts in them */
+static counter_t ftq_blocks;
+static counter_t ftq_insts;
+
+/* cycles fetch was stalled, by cause */
+static counter_t fetch_stall_recover;	/* branch mis-prediction recovery */
+static counter_t fetch_stall_icache;	/* I-cache or I-TLB miss */
+static counter_t fetch_stall_ifq_full;	/* IFETCH -> DISPATCH queue full */
+static counter_t fetch_stall_ftq_empty;	/* no predicted fetch blocks */
 
 /* total non-speculative bogus addresses seen (debug var) */
 static counter_t sim_invalid_addrs;
 
+/* load issue attempts refused because the l1 data cache MSHRs were full */
+static counter_t sim_mshr_stalls;
+
+/* physical register file and issue queue counters */
+static counter_t sim_prf_full_stalls;	/* dispatch stalls, no free regs */
+static counter_t sim_prf_ckpt_misses;	/* branches without a checkpoint */
+static counter_t sim_prf_ckpt_recovers;	/* recoveries from a checkpoint */
+static counter_t sim_prf_walk_recovers;	/* recoveries by walking the RUU */
+static counter_t sim_prf_walk_cycles;	/* cycles spent walking */
+static counter_t PRF_count;		/* cumulative in-flight phys regs */
+static struct stat_stat_t *prf_occ_dist;/* in-flight phys reg distribution */
+static counter_t sim_iq_full_stalls;	/* dispatch stalls, issue queue full */
+static counter_t IQ_count;		/* cumulative IQ occupancy */
+static struct stat_stat_t *iq_occ_dist;	/* IQ occupancy distribution */
+
+/* per hardware context instructions committed, and cycles run before the
+   program exited */
+static counter_t smt_num_insn[SMT_MAX_THREADS];
+static counter_t smt_cycles[SMT_MAX_THREADS];
+
+/* memory dependence prediction counters (store set policy) */
+static counter_t sim_mdp_spec_loads;	/* loads issued past unknown STAs */
+static counter_t sim_mdp_pred_deps;	/* loads given a store dependence */
+static counter_t sim_mdp_false_deps;	/* ... on a store that did not alias */
+static counter_t sim_mdp_violations;	/* memory ordering violations */
+static counter_t sim_mdp_replays;	/* insts squashed and replayed */
+
 /*
  * simulator state variables
  */
@@ -360,6 +534,22 @@ static int spec_mode = FALSE;
 /* cycles until fetch issue resumes */
 static unsigned ruu_fetch_issue_delay = 0;
 
+/* is the fetch delay an I-cache/I-TLB miss, rather than a recovery? */
+static int fetch_delay_miss = FALSE;
+
+/* the hardware context whose state is currently installed (see
+   smt_switch()), contexts whose program has exited, and the number of RUU
+   entries each context has waiting to issue (its ICOUNT) */
+static int smt_cur = 0;
+static int smt_done[SMT_MAX_THREADS];
+static int smt_icount[SMT_MAX_THREADS];
+
+/* the current context's address as seen by the shared caches, TLBs and
+   memory system, the context number is folded into the top address bits so
+   that contexts do not share lines for the same virtual address */
+#define SMT_ADDR(ADDR)							\
+  ((ADDR) ^ ((md_addr_t)smt_cur << (sizeof(md_addr_t)*8 - SMT_THREAD_BITS)))
+
 /* perfect prediction enabled */
 static int pred_perfect = FALSE;
 
@@ -385,6 +575,15 @@ static struct cache_t *itlb;
 /* data TLB */
 static struct cache_t *dtlb;
 
+/* PC of the instruction accessing the caches, seen by PC-indexed prefetchers
+   through get_PC(), the stages access the caches out of program order so
+   this is set at each cache access rather than read from regs_PC */
+static md_addr_t cache_access_PC = 0;
+
+md_addr_t get_PC() {	// return the PC of the instruction accessing the cache
+   return cache_access_PC;
+}
+
 /* branch predictor */
 static struct bpred_t *pred;
 
@@ -409,12 +608,19 @@ static struct stat_stat_t *pcstat_sdists[MAX_PCSTAT_VARS];
 
 /* memory access latency, assumed to not cross a page boundary */
 static unsigned int			/* total latency of access */
-mem_access_latency(int blk_sz)		/* block size accessed */
+mem_access_latency(enum mem_cmd cmd,	/* Read or Write */
+		   md_addr_t baddr,	/* block address accessed */
+		   int blk_sz,		/* block size accessed */
+		   tick_t now)		/* time of access */
 {
   int chunks = (blk_sz + (mem_bus_width - 1)) / mem_bus_width;
 
   assert(chunks > 0);
 
+  /* the DRAM model times the access against its banks and channels */
+  if (dram)
+    return dram_access(dram, cmd, baddr, blk_sz, now);
+
   return (/* first chunk latency */mem_lat[0] +
 	  (/* remainder chunk latency */mem_lat[1] * (chunks - 1)));
 }
@@ -430,7 +636,8 @@ dl1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 	      md_addr_t baddr,		/* block address to access */
 	      int bsize,		/* size of block to access */
 	      struct cache_blk_t *blk,	/* ptr to block in upper level */
-	      tick_t now)		/* time of access */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* non-zero if the access is a prefetch */
 {
   unsigned int lat;
 
@@ -438,7 +645,8 @@ dl1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
     {
       /* access next level of data cache hierarchy */
       lat = cache_access(cache_dl2, cmd, baddr, NULL, bsize,
-			 /* now */now, /* pudata */NULL, /* repl addr */NULL);
+			 /* now */now, /* pudata */NULL, /* repl addr */NULL,
+			 prefetch);
       if (cmd == Read)
 	return lat;
       else
@@ -451,10 +659,13 @@ dl1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
     {
       /* access main memory */
       if (cmd == Read)
-	return mem_access_latency(bsize);
+	return mem_access_latency(cmd, baddr, bsize, now);
       else
 	{
-	  /* FIXME: unlimited write buffers */
+	  /* FIXME: unlimited write buffers, but the write still occupies
+	     the DRAM */
+	  if (dram)
+	    mem_access_latency(cmd, baddr, bsize, now);
 	  return 0;
 	}
     }
@@ -466,14 +677,18 @@ dl2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 	      md_addr_t baddr,		/* block address to access */
 	      int bsize,		/* size of block to access */
 	      struct cache_blk_t *blk,	/* ptr to block in upper level */
-	      tick_t now)		/* time of access */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* non-zero if the access is a prefetch */
 {
   /* this is a miss to the lowest level, so access main memory */
   if (cmd == Read)
-    return mem_access_latency(bsize);
+    return mem_access_latency(cmd, baddr, bsize, now);
   else
     {
-      /* FIXME: unlimited write buffers */
+      /* FIXME: unlimited write buffers, but the write still occupies the
+	 DRAM */
+      if (dram)
+	mem_access_latency(cmd, baddr, bsize, now);
       return 0;
     }
 }
@@ -484,7 +699,8 @@ il1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 	      md_addr_t baddr,		/* block address to access */
 	      int bsize,		/* size of block to access */
 	      struct cache_blk_t *blk,	/* ptr to block in upper level */
-	      tick_t now)		/* time of access */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* non-zero if the access is a prefetch */
 {
   unsigned int lat;
 
@@ -492,7 +708,8 @@ if (cache_il2)
     {
       /* access next level of inst cache hierarchy */
       lat = cache_access(cache_il2, cmd, baddr, NULL, bsize,
-			 /* now */now, /* pudata */NULL, /* repl addr */NULL);
+			 /* now */now, /* pudata */NULL, /* repl addr */NULL,
+			 prefetch);
       if (cmd == Read)
 	return lat;
       else
@@ -502,7 +719,7 @@ if (cache_il2)
     {
       /* access main memory */
       if (cmd == Read)
-	return mem_access_latency(bsize);
+	return mem_access_latency(cmd, baddr, bsize, now);
       else
 	panic("writes to instruction memory not supported");
     }
@@ -514,11 +731,12 @@ il2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 	      md_addr_t baddr,		/* block address to access */
 	      int bsize,		/* size of block to access */
 	      struct cache_blk_t *blk,	/* ptr to block in upper level */
-	      tick_t now)		/* time of access */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* non-zero if the access is a prefetch */
 {
   /* this is a miss to the lowest level, so access main memory */
   if (cmd == Read)
-    return mem_access_latency(bsize);
+    return mem_access_latency(cmd, baddr, bsize, now);
   else
     panic("writes to instruction memory not supported");
 }
@@ -534,7 +752,8 @@ itlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
 	       md_addr_t baddr,		/* block address to access */
 	       int bsize,		/* size of block to access */
 	       struct cache_blk_t *blk,	/* ptr to block in upper level */
-	       tick_t now)		/* time of access */
+	       tick_t now,		/* time of access */
+	       int prefetch)		/* non-zero if the access is a prefetch */
 {
   md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
 
@@ -554,7 +773,8 @@ dtlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
 	       md_addr_t baddr,	/* block address to access */
 	       int bsize,		/* size of block to access */
 	       struct cache_blk_t *blk,	/* ptr to block in upper level */
-	       tick_t now)		/* time of access */
+	       tick_t now,		/* time of access */
+	       int prefetch)		/* non-zero if the access is a prefetch */
 {
   md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
 
@@ -591,6 +811,16 @@ sim_reg_options(struct opt_odb_t *odb)
   opt_reg_int(odb, "-fastfwd", "number of insts skipped before timing starts",
 	      &fastfwd_count, /* default */0,
 	      /* print */TRUE, /* format */NULL);
+  opt_reg_int(odb, "-fastfwd:warm",
+	      "number of final fast forwarded insts that also warm the caches, "
+	      "TLBs and branch predictor (-1 warms all of them)",
+	      &fastfwd_warm, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_int(odb, "-warmup",
+	      "number of insts simulated before statistics collection starts "
+	      "(-1 uses the checkpoint's warm-up window)",
+	      &warmup_count, /* default */-1,
+	      /* print */TRUE, /* format */NULL);
   opt_reg_string_list(odb, "-ptrace",
 	      "generate pipetrace, i.e., <fname|stdout|stderr> <range>",
 	      ptrace_opts, /* arr_sz */2, &ptrace_nelt, /* default */NULL,
@@ -631,6 +861,57 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &fetch_speed, /* default */1,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_int(odb, "-fetch:ftq",
+	      "fetch target queue entries, 0 fetches in step with the branch "
+	      "predictor",
+	      &ftq_size, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-fetch:ftq_block", "most insts in a fetch block",
+	      &ftq_block, /* default */8,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-fetch:ftq_width",
+	      "fetch blocks predicted, and fetched, per cycle",
+	      &ftq_width, /* default */2,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-fetch:ftq_prefetch",
+	      "FTQ entries the I-cache prefetcher runs ahead of fetch, "
+	      "0 for none",
+	      &ftq_prefetch, /* default */4,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  With -fetch:ftq, the front end is decoupled: each cycle the branch\n"
+"  predictor runs ahead of fetch, breaking the predicted path into fetch\n"
+"  blocks that end at a predicted taken branch or after -fetch:ftq_block\n"
+"  insts, and queues them in the fetch target queue (FTQ).  Fetch takes\n"
+"  insts from up to -fetch:ftq_width blocks per cycle, so it can cross\n"
+"  taken branches, and an I-cache or I-TLB miss no longer stops the\n"
+"  predictor.  The I-cache lines of queued blocks are prefetched, one\n"
+"  block per cycle, within -fetch:ftq_prefetch entries of the FTQ head.\n"
+	       );
+
+  opt_reg_string(odb, "-tcache",
+		 "trace cache config, i.e., "
+		 "{<sets>:<assoc>:<insts>:<branches>|none}",
+		 &tcache_opt, "none", /* print */TRUE, NULL);
+
+  opt_reg_note(odb,
+"  The trace cache holds <sets> x <assoc> traces of up to <insts> committed\n"
+"  insts and <branches> conditional branches, built by a fill unit at\n"
+"  commit; traces end early at indirect jumps and traps.  A trace is found\n"
+"  by its start address, traces that start at the same address but follow\n"
+"  other branch paths share the set.  On a hit, fetch bypasses the I-cache\n"
+"  and takes the trace up to the first branch the predictor sends off it,\n"
+"  crossing taken branches, bounded only by the room in the IFQ (so raise\n"
+"  -fetch:ifqsize with it); on a miss the I-cache is fetched as usual.\n"
+"  It needs the coupled front end (-fetch:ftq 0).\n"
+"\n"
+"    Examples:   -tcache 64:4:16:3 -fetch:ifqsize 16\n"
+	       );
+
   /* branch predictor options */
 
   opt_reg_note(odb,
@@ -707,6 +988,11 @@ sim_reg_options(struct opt_odb_t *odb)
 	       &ruu_inorder_issue, /* default */FALSE,
 	       /* print */TRUE, /* format */NULL);
 
+  opt_reg_string(odb, "-issue:select",
+		 "ready instruction select policy, i.e., {list|oldest}",
+		 &issue_select_opt, /* default */"list",
+		 /* print */TRUE, /* format */NULL);
+
   opt_reg_flag(odb, "-issue:wrongpath",
 	       "issue instructions down wrong execution paths",
 	       &ruu_include_spec, /* default */TRUE,
@@ -726,6 +1012,32 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &RUU_size, /* default */16,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_int(odb, "-ruu:prf",
+	      "physical registers (int and fp, merged), 0 = results in RUU",
+	      &prf_size, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-ruu:ckpts",
+	      "rename map checkpoints for branch recovery (with -ruu:prf)",
+	      &prf_nckpts, /* default */8,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-ruu:iq",
+	      "issue queue size, 0 = issue from the whole RUU",
+	      &iq_size, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  With -ruu:prf, each instruction result is renamed onto a physical\n"
+"  register taken from a free list, the register mapped before it is freed\n"
+"  when the instruction commits, and dispatch stalls while fewer than two\n"
+"  registers are free.  Conditional and indirect branches take a rename map\n"
+"  checkpoint, a mis-predicted branch with a checkpoint restores the map at\n"
+"  once, one without has its map rebuilt by walking the squashed entries at\n"
+"  -decode:width entries per cycle, which delays fetch redirection.  With\n"
+"  -ruu:iq, dispatch also stalls while that many RUU entries wait to issue.\n"
+	       );
+
   /* memory scheduler options  */
 
   opt_reg_int(odb, "-lsq:size",
@@ -733,6 +1045,35 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &LSQ_size, /* default */8,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_string(odb, "-lsq:mdp",
+		 "memory dependence predictor {conservative|storeset}",
+		 &mdp_opt, /* default */"conservative",
+		 /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-lsq:ssit",
+	      "store set id table (SSIT) entries",
+	      &mdp_ssit_size, /* default */1024,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-lsq:lfst",
+	      "last fetched store table (LFST) entries",
+	      &mdp_lfst_size, /* default */128,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-lsq:ssit_clear",
+	      "cycles between SSIT clears (0 = never)",
+	      &mdp_clear_interval, /* default */1000000,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  The conservative memory dependence policy holds every load until all\n"
+"  earlier store addresses are known.  The storeset policy lets loads issue\n"
+"  ahead of unresolved stores unless a store set predictor ties them to an\n"
+"  earlier store; a load that reads a location before an earlier store to\n"
+"  it resolves is squashed with all later instructions, which are replayed\n"
+"  after -fetch:mplat cycles.\n"
+	       );
+
   /* cache options */
 
   opt_reg_string(odb, "-cache:dl1",
@@ -743,13 +1084,14 @@ sim_reg_options(struct opt_odb_t *odb)
   opt_reg_note(odb,
 "  The cache config parameter <config> has the following format:\n"
 "\n"
-"    <name>:<nsets>:<bsize>:<assoc>:<repl>\n"
+"    <name>:<nsets>:<bsize>:<assoc>:<repl>[:<pref>]\n"
 "\n"
 "    <name>   - name of the cache being defined\n"
 "    <nsets>  - number of sets in the cache\n"
 "    <bsize>  - block size of the cache\n"
 "    <assoc>  - associativity of the cache\n"
 "    <repl>   - block replacement strategy, 'l'-LRU, 'f'-FIFO, 'r'-random\n"
+"    <pref>   - optional prefetcher type, as for sim-cache (default 0, none)\n"
 "\n"
 "    Examples:   -cache:dl1 dl1:4096:32:1:l\n"
 "                -dtlb dtlb:128:4096:32:r\n"
@@ -760,6 +1102,13 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &cache_dl1_lat, /* default */1,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_int_list(odb, "-cache:dl1mshr",
+		   "l1 data cache MSHRs (<entries> <targets>), 0 entries for"
+		   " unlimited misses",
+		   cache_dl1_mshr, cache_dl1_mshr_nelt, &cache_dl1_mshr_nelt,
+		   cache_dl1_mshr, /* print */TRUE, /* format */NULL,
+		   /* !accrue */FALSE);
+
   opt_reg_string(odb, "-cache:dl2",
 		 "l2 data cache config, i.e., {<config>|none}",
 		 &cache_dl2_opt, "ul2:1024:64:4:l",
@@ -770,6 +1119,32 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &cache_dl2_lat, /* default */6,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_int_list(odb, "-cache:dl2mshr",
+		   "l2 data cache MSHRs (<entries> <targets>), 0 entries for"
+		   " unlimited misses",
+		   cache_dl2_mshr, cache_dl2_mshr_nelt, &cache_dl2_mshr_nelt,
+		   cache_dl2_mshr, /* print */TRUE, /* format */NULL,
+		   /* !accrue */FALSE);
+
+  opt_reg_int(odb, "-cache:dl1wbb",
+	      "l1 data cache write-back buffer entries (0 for none)",
+	      &cache_dl1_wbb, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-cache:dl2wbb",
+	      "l2 data cache write-back buffer entries (0 for none)",
+	      &cache_dl2_wbb, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-cache:dl1vc",
+	      "l1 data cache victim cache entries (0 for none)",
+	      &cache_dl1_vc, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_string(odb, "-cache:inclusion",
+		 "inclusion of l2 over l1 caches, i.e., {nine|inclusive|exclusive}",
+		 &cache_inclusion_opt, "nine", /* print */TRUE, NULL);
+
   opt_reg_string(odb, "-cache:il1",
 		 "l1 inst cache config, i.e., {<config>|dl1|dl2|none}",
 		 &cache_il1_opt, "il1:512:32:1:l",
@@ -822,6 +1197,30 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &mem_bus_width, /* default */8,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_string(odb, "-mem:dram",
+		 "DRAM config, i.e., {<channels>:<banks>:<row_size>|none}",
+		 &mem_dram_opt, "none", /* print */TRUE, NULL);
+
+  opt_reg_int_list(odb, "-mem:dram_lat",
+		   "DRAM timing (<ctrl> <tRCD> <tCAS> <tRP> <tBURST>)",
+		   dram_lat, dram_nelt, &dram_nelt, dram_lat,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
+  opt_reg_string(odb, "-mem:dram_sched",
+		 "DRAM scheduling policy, i.e., {fcfs|frfcfs}",
+		 &mem_dram_sched, "frfcfs", /* print */TRUE, NULL);
+
+  opt_reg_note(odb,
+"  The DRAM model replaces the fixed -mem:lat memory latency when -mem:dram\n"
+"  is not `none'.  Memory is split into <channels> channels of <banks> banks\n"
+"  with <row_size> byte row buffers; an access pays <ctrl> cycles in the\n"
+"  controller, tCAS on a row hit, tRCD+tCAS on a precharged bank or\n"
+"  tRP+tRCD+tCAS on a row conflict, and tBURST cycles per -mem:width bytes\n"
+"  on the channel bus.  FR-FCFS serves row hits ahead of queued conflicts.\n"
+"\n"
+"    Examples:   -mem:dram 2:8:2048 -mem:dram_sched fcfs\n"
+	       );
+
   /* TLB options */
 
   opt_reg_string(odb, "-tlb:itlb",
@@ -837,6 +1236,30 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &tlb_miss_lat, /* default */30,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_int(odb, "-prefetch:queue",
+	      "prefetch request queue entries per cache",
+	      &pf_queue_size, /* default */PF_QUEUE_SIZE,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_flag(odb, "-prefetch:feedback",
+	       "adapt prefetch degree/distance to accuracy and lateness",
+	       &pf_feedback, /* default */FALSE, /* print */TRUE, NULL);
+  opt_reg_int(odb, "-prefetch:streams",
+	      "stream buffers per cache (stream buffer prefetcher)",
+	      &pf_streams, /* default */PF_NUM_STREAMS,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_int(odb, "-prefetch:depth",
+	      "blocks prefetched ahead per stream buffer",
+	      &pf_stream_depth, /* default */PF_STREAM_DEPTH,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_int(odb, "-prefetch:pht",
+	      "SMS pattern history table entries per cache",
+	      &pf_pht_size, /* default */SMS_PHT_SIZE,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_int(odb, "-prefetch:rpt_assoc",
+	      "reference prediction table associativity (stride prefetchers)",
+	      &pf_rpt_assoc, /* default */1,
+	      /* print */TRUE, /* format */NULL);
+
   /* resource configuration */
 
   opt_reg_int(odb, "-res:ialu",
@@ -864,11 +1287,50 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &res_fpmult, /* default */fu_config[FU_FPMULT_INDEX].quantity,
 	      /* print */TRUE, /* format */NULL);
 
+  /* simultaneous multithreading options */
+
+  opt_reg_string_list(odb, "-smt:prog",
+		      "program and arguments (one quoted string) for another "
+		      "hardware context (mult uses ok)",
+		      smt_progs, SMT_MAX_THREADS-1, &smt_prog_nelt, NULL,
+		      /* print */TRUE, /* format */NULL, /* accrue */TRUE);
+
+  opt_reg_string(odb, "-smt:fetch",
+		 "SMT fetch policy, i.e., {icount|rr}",
+		 &smt_fetch_opt, /* default */"icount",
+		 /* print */TRUE, /* format */NULL);
+
+  opt_reg_double_list(odb, "-smt:ipc_alone",
+		      "IPC of each program run alone, for weighted speedup",
+		      smt_ipc_alone, SMT_MAX_THREADS, &smt_ipc_nelt,
+		      /* default */NULL, /* print */TRUE, /* format */NULL,
+		      /* !accrue */FALSE);
+
+  opt_reg_note(odb,
+"  Each -smt:prog program runs in its own hardware context next to the\n"
+"  program named on the command line (context 0), with its own registers,\n"
+"  memory, fetch queue and RUU/LSQ ordering, sharing the RUU and LSQ\n"
+"  capacity, the functional units, caches, TLBs and branch predictor.\n"
+"  Contexts share the simulator's standard input and output.  Each cycle\n"
+"  one context fetches: with icount the one with the fewest instructions\n"
+"  in its fetch queue or waiting to issue, with rr the next in turn; dispatch\n"
+"  and commit bandwidth is shared round-robin.  A context stops when its\n"
+"  program exits, the simulation ends with the last program.  With\n"
+"  -smt:ipc_alone (one value per context) the weighted speedup, the sum of\n"
+"  each program's IPC over its IPC alone, is reported.\n"
+"\n"
+"    Example:   -smt:prog \"test-math\" -smt:prog \"anagram words\"\n"
+	       );
+
   opt_reg_string_list(odb, "-pcstat",
 		      "profile stat(s) against text addr's (mult uses ok)",
 		      pcstat_vars, MAX_PCSTAT_VARS, &pcstat_nelt, NULL,
 		      /* !print */FALSE, /* format */NULL, /* accrue */TRUE);
 
+  opt_reg_flag(odb, "-cycle:skip",
+	       "skip the cycles in which a stalled pipeline only waits",
+	       &cycle_skip, /* default */TRUE, /* print */TRUE, NULL);
+
   opt_reg_flag(odb, "-bugcompat",
 	       "operate in backward-compatible bugs mode (for testing only)",
 	       &bugcompat_mode, /* default */FALSE, /* print */TRUE, NULL);
@@ -880,10 +1342,15 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 		  int argc, char **argv)        /* command line arguments */
 {
   char name[128], c;
-  int nsets, bsize, assoc;
+  int i, nsets, bsize, assoc;
+  int prefetch_type;			/* prefetcher type, 0 if none given */
 
   if (fastfwd_count < 0 || fastfwd_count >= 2147483647)
     fatal("bad fast forward count: %d", fastfwd_count);
+  if (fastfwd_warm < -1)
+    fatal("bad fast forward warming count: %d", fastfwd_warm);
+  if (warmup_count < -1)
+    fatal("bad warm-up count: %d", warmup_count);
 
   if (ruu_ifq_size < 1 || (ruu_ifq_size & (ruu_ifq_size - 1)) != 0)
     fatal("inst fetch queue size must be positive > 0 and a power of two");
@@ -894,6 +1361,12 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
   if (fetch_speed < 1)
     fatal("front-end speed must be positive and non-zero");
 
+  if (ftq_size < 0)
+    fatal("fetch target queue size must be non-negative");
+  if (ftq_size && (ftq_block < 1 || ftq_width < 1 || ftq_prefetch < 0))
+    fatal("fetch blocks and FTQ width must be positive, and the FTQ "
+	  "prefetch distance non-negative");
+
   if (!mystricmp(pred_type, "perfect"))
     {
       /* perfect predictor */
@@ -996,9 +1469,54 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
   if (RUU_size < 2 || (RUU_size & (RUU_size-1)) != 0)
     fatal("RUU size must be a positive number > 1 and a power of two");
 
+  if (prf_size != 0 && prf_size < MD_TOTAL_REGS + 2)
+    fatal("physical register file must hold at least %d registers",
+	  MD_TOTAL_REGS + 2);
+  if (prf_size < 0 || prf_nckpts < 0 || iq_size < 0)
+    fatal("register file, checkpoint and issue queue sizes must be >= 0");
+
   if (LSQ_size < 2 || (LSQ_size & (LSQ_size-1)) != 0)
     fatal("LSQ size must be a positive number > 1 and a power of two");
 
+  if (!mystricmp(mdp_opt, "conservative"))
+    mdp_type = mdp_conservative;
+  else if (!mystricmp(mdp_opt, "storeset"))
+    mdp_type = mdp_storeset;
+  else
+    fatal("unknown memory dependence predictor `%s'", mdp_opt);
+
+  if (mdp_ssit_size < 1 || (mdp_ssit_size & (mdp_ssit_size-1)) != 0)
+    fatal("SSIT size must be a positive number and a power of two");
+  if (mdp_lfst_size < 1 || (mdp_lfst_size & (mdp_lfst_size-1)) != 0)
+    fatal("LFST size must be a positive number and a power of two");
+  if (mdp_clear_interval < 0)
+    fatal("SSIT clear interval must be non-negative");
+
+  if (!mystricmp(issue_select_opt, "list"))
+    issue_select = issue_select_list;
+  else if (!mystricmp(issue_select_opt, "oldest"))
+    issue_select = issue_select_oldest;
+  else
+    fatal("unknown ready instruction select policy `%s'", issue_select_opt);
+
+  smt_nthreads = 1 + smt_prog_nelt;
+  if (!mystricmp(smt_fetch_opt, "icount"))
+    smt_fetch_policy = smt_fetch_icount;
+  else if (!mystricmp(smt_fetch_opt, "rr"))
+    smt_fetch_policy = smt_fetch_rr;
+  else
+    fatal("unknown SMT fetch policy `%s'", smt_fetch_opt);
+  if (smt_ipc_nelt != 0 && smt_ipc_nelt != smt_nthreads)
+    fatal("-smt:ipc_alone needs one IPC for each of the %d contexts",
+	  smt_nthreads);
+  for (i=0; i<smt_ipc_nelt; i++)
+    {
+      if (smt_ipc_alone[i] <= 0.0)
+	fatal("-smt:ipc_alone IPCs must be > 0");
+    }
+  if (smt_nthreads > 1 && (prf_size || mdp_type == mdp_storeset))
+    fatal("-ruu:prf and -lsq:mdp storeset support only one hardware context");
+
   /* use a level 1 D-cache? */
   if (!mystricmp(cache_dl1_opt, "none"))
     {
@@ -1011,25 +1529,30 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
     }
   else /* dl1 is defined */
     {
-      if (sscanf(cache_dl1_opt, "%[^:]:%d:%d:%d:%c",
-		 name, &nsets, &bsize, &assoc, &c) != 5)
-	fatal("bad l1 D-cache parms: <name>:<nsets>:<bsize>:<assoc>:<repl>");
+      prefetch_type = 0;
+      if (sscanf(cache_dl1_opt, "%[^:]:%d:%d:%d:%c:%d",
+		 name, &nsets, &bsize, &assoc, &c, &prefetch_type) < 5)
+	fatal("bad l1 D-cache parms: "
+	      "<name>:<nsets>:<bsize>:<assoc>:<repl>[:<pref>]");
       cache_dl1 = cache_create(name, nsets, bsize, /* balloc */FALSE,
 			       /* usize */0, assoc, cache_char2policy(c),
-			       dl1_access_fn, /* hit lat */cache_dl1_lat);
+			       dl1_access_fn, /* hit lat */cache_dl1_lat,
+			       prefetch_type);
 
       /* is the level 2 D-cache defined? */
       if (!mystricmp(cache_dl2_opt, "none"))
 	cache_dl2 = NULL;
       else
 	{
-	  if (sscanf(cache_dl2_opt, "%[^:]:%d:%d:%d:%c",
-		     name, &nsets, &bsize, &assoc, &c) != 5)
+	  prefetch_type = 0;
+	  if (sscanf(cache_dl2_opt, "%[^:]:%d:%d:%d:%c:%d",
+		     name, &nsets, &bsize, &assoc, &c, &prefetch_type) < 5)
 	    fatal("bad l2 D-cache parms: "
-		  "<name>:<nsets>:<bsize>:<assoc>:<repl>");
+		  "<name>:<nsets>:<bsize>:<assoc>:<repl>[:<pref>]");
 	  cache_dl2 = cache_create(name, nsets, bsize, /* balloc */FALSE,
 				   /* usize */0, assoc, cache_char2policy(c),
-				   dl2_access_fn, /* hit lat */cache_dl2_lat);
+				   dl2_access_fn, /* hit lat */cache_dl2_lat,
+				   prefetch_type);
 	}
     }
 
@@ -1067,12 +1590,15 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
     }
   else /* il1 is defined */
     {
-      if (sscanf(cache_il1_opt, "%[^:]:%d:%d:%d:%c",
-		 name, &nsets, &bsize, &assoc, &c) != 5)
-	fatal("bad l1 I-cache parms: <name>:<nsets>:<bsize>:<assoc>:<repl>");
+      prefetch_type = 0;
+      if (sscanf(cache_il1_opt, "%[^:]:%d:%d:%d:%c:%d",
+		 name, &nsets, &bsize, &assoc, &c, &prefetch_type) < 5)
+	fatal("bad l1 I-cache parms: "
+	      "<name>:<nsets>:<bsize>:<assoc>:<repl>[:<pref>]");
       cache_il1 = cache_create(name, nsets, bsize, /* balloc */FALSE,
 			       /* usize */0, assoc, cache_char2policy(c),
-			       il1_access_fn, /* hit lat */cache_il1_lat);
+			       il1_access_fn, /* hit lat */cache_il1_lat,
+			       prefetch_type);
 
       /* is the level 2 D-cache defined? */
       if (!mystricmp(cache_il2_opt, "none"))
@@ -1085,13 +1611,15 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 	}
       else
 	{
-	  if (sscanf(cache_il2_opt, "%[^:]:%d:%d:%d:%c",
-		     name, &nsets, &bsize, &assoc, &c) != 5)
+	  prefetch_type = 0;
+	  if (sscanf(cache_il2_opt, "%[^:]:%d:%d:%d:%c:%d",
+		     name, &nsets, &bsize, &assoc, &c, &prefetch_type) < 5)
 	    fatal("bad l2 I-cache parms: "
-		  "<name>:<nsets>:<bsize>:<assoc>:<repl>");
+		  "<name>:<nsets>:<bsize>:<assoc>:<repl>[:<pref>]");
 	  cache_il2 = cache_create(name, nsets, bsize, /* balloc */FALSE,
 				   /* usize */0, assoc, cache_char2policy(c),
-				   il2_access_fn, /* hit lat */cache_il2_lat);
+				   il2_access_fn, /* hit lat */cache_il2_lat,
+				   prefetch_type);
 	}
     }
 
@@ -1100,13 +1628,15 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
     itlb = NULL;
   else
     {
-      if (sscanf(itlb_opt, "%[^:]:%d:%d:%d:%c",
-		 name, &nsets, &bsize, &assoc, &c) != 5)
-	fatal("bad TLB parms: <name>:<nsets>:<page_size>:<assoc>:<repl>");
+      prefetch_type = 0;
+      if (sscanf(itlb_opt, "%[^:]:%d:%d:%d:%c:%d",
+		 name, &nsets, &bsize, &assoc, &c, &prefetch_type) < 5)
+	fatal("bad TLB parms: "
+	      "<name>:<nsets>:<page_size>:<assoc>:<repl>[:<pref>]");
       itlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
 			  /* usize */sizeof(md_addr_t), assoc,
 			  cache_char2policy(c), itlb_access_fn,
-			  /* hit latency */1);
+			  /* hit latency */1, prefetch_type);
     }
 
   /* use a D-TLB? */
@@ -1114,14 +1644,73 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
     dtlb = NULL;
   else
     {
-      if (sscanf(dtlb_opt, "%[^:]:%d:%d:%d:%c",
-		 name, &nsets, &bsize, &assoc, &c) != 5)
-	fatal("bad TLB parms: <name>:<nsets>:<page_size>:<assoc>:<repl>");
+      prefetch_type = 0;
+      if (sscanf(dtlb_opt, "%[^:]:%d:%d:%d:%c:%d",
+		 name, &nsets, &bsize, &assoc, &c, &prefetch_type) < 5)
+	fatal("bad TLB parms: "
+	      "<name>:<nsets>:<page_size>:<assoc>:<repl>[:<pref>]");
       dtlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
 			  /* usize */sizeof(md_addr_t), assoc,
 			  cache_char2policy(c), dtlb_access_fn,
-			  /* hit latency */1);
+			  /* hit latency */1, prefetch_type);
+    }
+
+  /* configure the prefetch request queues and prefetcher tables */
+  if (cache_dl1)
+    {
+      cache_pf_config(cache_dl1, pf_queue_size, pf_feedback);
+      cache_pf_tables(cache_dl1, pf_streams, pf_stream_depth, pf_pht_size,
+		      pf_rpt_assoc);
+    }
+  if (cache_dl2)
+    {
+      cache_pf_config(cache_dl2, pf_queue_size, pf_feedback);
+      cache_pf_tables(cache_dl2, pf_streams, pf_stream_depth, pf_pht_size,
+		      pf_rpt_assoc);
+    }
+  if (cache_il1)
+    {
+      cache_pf_config(cache_il1, pf_queue_size, pf_feedback);
+      cache_pf_tables(cache_il1, pf_streams, pf_stream_depth, pf_pht_size,
+		      pf_rpt_assoc);
+    }
+  if (cache_il2)
+    {
+      cache_pf_config(cache_il2, pf_queue_size, pf_feedback);
+      cache_pf_tables(cache_il2, pf_streams, pf_stream_depth, pf_pht_size,
+		      pf_rpt_assoc);
+    }
+
+  /* fetch-directed I-cache prefetching from the fetch target queue */
+  if (cache_il1 && ftq_size && ftq_prefetch)
+    cache_pf_fetch_enable(cache_il1);
+
+  /* non-blocking data caches */
+  if (cache_dl1_mshr_nelt != 2)
+    fatal("bad l1 data cache MSHRs (<entries> <targets>)");
+  if (cache_dl1)
+    cache_mshr_config(cache_dl1, cache_dl1_mshr[0], cache_dl1_mshr[1]);
+  if (cache_dl2_mshr_nelt != 2)
+    fatal("bad l2 data cache MSHRs (<entries> <targets>)");
+  if (cache_dl2)
+    cache_mshr_config(cache_dl2, cache_dl2_mshr[0], cache_dl2_mshr[1]);
+
+  /* write-back buffers and victim cache */
+  if (cache_dl1)
+    {
+      cache_wbb_config(cache_dl1, cache_dl1_wbb);
+      cache_vc_config(cache_dl1, cache_dl1_vc);
     }
+  if (cache_dl2)
+    cache_wbb_config(cache_dl2, cache_dl2_wbb);
+
+  /* inclusion of each l2 cache over the l1 caches that miss into it */
+  if (cache_dl2 && cache_dl1)
+    cache_inclusion_config(cache_dl2, cache_dl1,
+			   cache_str2inclusion(cache_inclusion_opt));
+  if (cache_il2 && cache_il1)
+    cache_inclusion_config(cache_il2, cache_il1,
+			   cache_str2inclusion(cache_inclusion_opt));
 
   if (cache_dl1_lat < 1)
     fatal("l1 data cache latency must be greater than zero");
@@ -1144,6 +1733,38 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
   if (mem_bus_width < 1 || (mem_bus_width & (mem_bus_width-1)) != 0)
     fatal("memory bus width must be positive non-zero and a power of two");
 
+  /* use a DRAM model? */
+  if (!mystricmp(mem_dram_opt, "none"))
+    dram = NULL;
+  else
+    {
+      int nchannels, nbanks, row_size;
+
+      if (sscanf(mem_dram_opt, "%d:%d:%d",
+		 &nchannels, &nbanks, &row_size) != 3)
+	fatal("bad DRAM parms: <channels>:<banks>:<row_size>");
+      if (dram_nelt != 5)
+	fatal("bad DRAM timing (<ctrl> <tRCD> <tCAS> <tRP> <tBURST>)");
+      dram = dram_create(nchannels, nbanks, row_size, mem_bus_width,
+			 dram_lat[0], dram_lat[1], dram_lat[2], dram_lat[3],
+			 dram_lat[4], dram_str2sched(mem_dram_sched));
+    }
+
+  /* use a trace cache? */
+  if (!mystricmp(tcache_opt, "none"))
+    tcache = NULL;
+  else
+    {
+      int nsets, assoc, insts, branches;
+
+      if (sscanf(tcache_opt, "%d:%d:%d:%d",
+		 &nsets, &assoc, &insts, &branches) != 4)
+	fatal("bad trace cache parms: <sets>:<assoc>:<insts>:<branches>");
+      if (ftq_size)
+	fatal("the trace cache needs the coupled front end (-fetch:ftq 0)");
+      tcache = tcache_create(nsets, assoc, insts, branches, smt_nthreads);
+    }
+
   if (tlb_miss_lat < 1)
     fatal("TLB miss latency must be greater than zero");
 
@@ -1182,7 +1803,10 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 void
 sim_aux_config(FILE *stream)            /* output stream */
 {
-  /* nada */
+  if (dram)
+    dram_config(dram, stream);
+  if (tcache)
+    tcache_config(tcache, stream);
 }
 
 /* register simulator-specific statistics */
@@ -1232,6 +1856,9 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
   stat_reg_counter(sdb, "sim_cycle",
 		   "total simulation time in cycles",
 		   &sim_cycle, /* initial value */0, /* format */NULL);
+  stat_reg_counter(sdb, "sim_skipped_cycles",
+		   "cycles skipped while the pipeline waited (-cycle:skip)",
+		   &sim_skipped_cycles, /* initial value */0, /* format */NULL);
   stat_reg_formula(sdb, "sim_IPC",
 		   "instructions per cycle",
 		   "sim_num_insn / sim_cycle", /* format */NULL);
@@ -1245,6 +1872,36 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
 		   "instruction per branch",
 		   "sim_num_insn / sim_num_branches", /* format */NULL);
 
+  /* per hardware context performance stats */
+  if (smt_nthreads > 1)
+    {
+      char buf[128], buf1[128], formula[128];
+      char speedup[SMT_MAX_THREADS * 48];
+
+      speedup[0] = '\0';
+      for (i=0; i<smt_nthreads; i++)
+	{
+	  sprintf(buf, "smt_t%d_num_insn", i);
+	  sprintf(buf1, "context %d instructions committed", i);
+	  stat_reg_counter(sdb, buf, buf1, &smt_num_insn[i], 0, NULL);
+	  sprintf(buf, "smt_t%d_cycles", i);
+	  sprintf(buf1, "context %d cycles before its program exited", i);
+	  stat_reg_counter(sdb, buf, buf1, &smt_cycles[i], 0, NULL);
+	  sprintf(buf, "smt_t%d_IPC", i);
+	  sprintf(buf1, "context %d instructions per cycle", i);
+	  sprintf(formula, "smt_t%d_num_insn / smt_t%d_cycles", i, i);
+	  stat_reg_formula(sdb, buf, buf1, formula, /* format */NULL);
+
+	  if (smt_ipc_nelt)
+	    sprintf(speedup + strlen(speedup), "%ssmt_t%d_IPC / %.6f",
+		    i ? " + " : "", i, smt_ipc_alone[i]);
+	}
+      if (smt_ipc_nelt)
+	stat_reg_formula(sdb, "smt_weighted_speedup",
+			 "sum over contexts of IPC / IPC alone",
+			 speedup, /* format */NULL);
+    }
+
   /* occupancy stats */
   stat_reg_counter(sdb, "IFQ_count", "cumulative IFQ occupancy",
                    &IFQ_count, /* initial value */0, /* format */NULL);
@@ -1259,6 +1916,42 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
   stat_reg_formula(sdb, "ifq_full", "fraction of time (cycle's) IFQ was full",
                    "IFQ_fcount / sim_cycle", /* format */NULL);
 
+  if (ftq_size)
+    {
+      stat_reg_counter(sdb, "FTQ_count", "cumulative FTQ occupancy",
+		       &FTQ_count, /* initial value */0, /* format */NULL);
+      stat_reg_counter(sdb, "FTQ_fcount", "cumulative FTQ full count",
+		       &FTQ_fcount, /* initial value */0, /* format */NULL);
+      stat_reg_formula(sdb, "ftq_occupancy", "avg FTQ occupancy (blocks)",
+		       "FTQ_count / sim_cycle", /* format */NULL);
+      stat_reg_formula(sdb, "ftq_full",
+		       "fraction of time (cycle's) FTQ was full",
+		       "FTQ_fcount / sim_cycle", /* format */NULL);
+      stat_reg_counter(sdb, "ftq_blocks", "total fetch blocks predicted",
+		       &ftq_blocks, /* initial value */0, /* format */NULL);
+      stat_reg_counter(sdb, "ftq_insts",
+		       "total insts in predicted fetch blocks",
+		       &ftq_insts, /* initial value */0, /* format */NULL);
+      stat_reg_formula(sdb, "ftq_block_size",
+		       "avg insts per predicted fetch block",
+		       "ftq_insts / ftq_blocks", /* format */NULL);
+    }
+
+  stat_reg_counter(sdb, "fetch_stall_recover",
+		   "cycles fetch waited on branch mis-prediction recovery",
+		   &fetch_stall_recover, /* initial value */0, /* format */NULL);
+  stat_reg_counter(sdb, "fetch_stall_icache",
+		   "cycles fetch waited on an I-cache or I-TLB miss",
+		   &fetch_stall_icache, /* initial value */0, /* format */NULL);
+  stat_reg_counter(sdb, "fetch_stall_ifq_full",
+		   "cycles fetch waited on a full IFQ",
+		   &fetch_stall_ifq_full, /* initial value */0, /* format */NULL);
+  if (ftq_size)
+    stat_reg_counter(sdb, "fetch_stall_ftq_empty",
+		     "cycles fetch had no predicted fetch blocks",
+		     &fetch_stall_ftq_empty, /* initial value */0,
+		     /* format */NULL);
+
   stat_reg_counter(sdb, "RUU_count", "cumulative RUU occupancy",
                    &RUU_count, /* initial value */0, /* format */NULL);
   stat_reg_counter(sdb, "RUU_fcount", "cumulative RUU full count",
@@ -1285,6 +1978,65 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
   stat_reg_formula(sdb, "lsq_full", "fraction of time (cycle's) LSQ was full",
                    "LSQ_fcount / sim_cycle", /* format */NULL);
 
+  if (prf_size)
+    {
+      stat_reg_counter(sdb, "PRF_count",
+		       "cumulative in-flight physical registers",
+		       &PRF_count, /* initial value */0, /* format */NULL);
+      stat_reg_formula(sdb, "prf_occupancy",
+		       "avg in-flight physical registers",
+		       "PRF_count / sim_cycle", /* format */NULL);
+      prf_occ_dist =
+	stat_reg_dist(sdb, "prf_occ_dist",
+		      "in-flight physical register distribution",
+		      /* initial value */0,
+		      /* array size */16,
+		      /* bucket size */(prf_size - MD_TOTAL_REGS + 15) / 16,
+		      /* print format */(PF_COUNT|PF_PDF),
+		      /* format */NULL, /* index map */NULL,
+		      /* print fn */NULL);
+      stat_reg_counter(sdb, "prf_full_stalls",
+		       "cycles dispatch stalled on a full register file",
+		       &sim_prf_full_stalls, /* initial value */0,
+		       /* format */NULL);
+      stat_reg_counter(sdb, "prf_ckpt_misses",
+		       "branches renamed with no free map checkpoint",
+		       &sim_prf_ckpt_misses, /* initial value */0,
+		       /* format */NULL);
+      stat_reg_counter(sdb, "prf_ckpt_recovers",
+		       "mis-predictions recovered from a map checkpoint",
+		       &sim_prf_ckpt_recovers, /* initial value */0,
+		       /* format */NULL);
+      stat_reg_counter(sdb, "prf_walk_recovers",
+		       "squashes recovered by walking the RUU",
+		       &sim_prf_walk_recovers, /* initial value */0,
+		       /* format */NULL);
+      stat_reg_counter(sdb, "prf_walk_cycles",
+		       "cycles spent walking the RUU to restore the map",
+		       &sim_prf_walk_cycles, /* initial value */0,
+		       /* format */NULL);
+    }
+
+  if (iq_size)
+    {
+      stat_reg_counter(sdb, "IQ_count", "cumulative IQ occupancy",
+		       &IQ_count, /* initial value */0, /* format */NULL);
+      stat_reg_formula(sdb, "iq_occupancy", "avg IQ occupancy (insn's)",
+		       "IQ_count / sim_cycle", /* format */NULL);
+      iq_occ_dist =
+	stat_reg_dist(sdb, "iq_occ_dist", "IQ occupancy distribution",
+		      /* initial value */0,
+		      /* array size */16,
+		      /* bucket size */(iq_size + 16) / 16,
+		      /* print format */(PF_COUNT|PF_PDF),
+		      /* format */NULL, /* index map */NULL,
+		      /* print fn */NULL);
+      stat_reg_counter(sdb, "iq_full_stalls",
+		       "cycles dispatch stalled on a full issue queue",
+		       &sim_iq_full_stalls, /* initial value */0,
+		       /* format */NULL);
+    }
+
   stat_reg_counter(sdb, "sim_slip",
                    "total number of slip cycles",
                    &sim_slip, 0, NULL);
@@ -1312,6 +2064,42 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
     cache_reg_stats(itlb, sdb);
   if (dtlb)
     cache_reg_stats(dtlb, sdb);
+  if (dram)
+    dram_reg_stats(dram, sdb, "sim_cycle");
+  if (tcache)
+    tcache_reg_stats(tcache, sdb, "sim_cycle", "sim_total_insn");
+
+  stat_reg_counter(sdb, "sim_mshr_stalls",
+		   "load issues stalled on full l1 data cache MSHRs",
+		   &sim_mshr_stalls, /* initial value */0, /* format */NULL);
+
+  if (mdp_type == mdp_storeset)
+    {
+      stat_reg_counter(sdb, "mdp_spec_loads",
+		       "loads issued ahead of an unresolved store address",
+		       &sim_mdp_spec_loads, /* initial value */0,
+		       /* format */NULL);
+      stat_reg_counter(sdb, "mdp_pred_deps",
+		       "loads made to wait on a store by the store set pred",
+		       &sim_mdp_pred_deps, /* initial value */0,
+		       /* format */NULL);
+      stat_reg_counter(sdb, "mdp_false_deps",
+		       "predicted dependences that held a load on a "
+		       "non-aliasing store",
+		       &sim_mdp_false_deps, /* initial value */0,
+		       /* format */NULL);
+      stat_reg_counter(sdb, "mdp_violations",
+		       "memory ordering violations (load replays)",
+		       &sim_mdp_violations, /* initial value */0,
+		       /* format */NULL);
+      stat_reg_counter(sdb, "mdp_replays",
+		       "instructions squashed and replayed on violations",
+		       &sim_mdp_replays, /* initial value */0,
+		       /* format */NULL);
+      stat_reg_formula(sdb, "mdp_violation_rate",
+		       "memory ordering violations per committed load",
+		       "mdp_violations / sim_num_loads", /* format */NULL);
+    }
 
   /* debug variable(s) */
   stat_reg_counter(sdb, "sim_invalid_addrs",
@@ -1350,17 +2138,22 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
     }
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
+  predec_reg_stats(predec, sdb);
 }
 
 /* forward declarations */
 static void ruu_init(void);
 static void lsq_init(void);
+static void prf_init(void);
 static void rslink_init(int nlinks);
 static void eventq_init(void);
 static void readyq_init(void);
 static void cv_init(void);
 static void tracer_init(void);
 static void fetch_init(void);
+static void smt_init(char **envp);
+static void smt_switch(int thread);
+static void smt_syscall(md_inst_t inst);
 
 /* initialize the simulator */
 void
@@ -1411,6 +2204,9 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
+  /* keep the program text pre-decoded */
+  predec = predec_create(mem, PREDEC_NENTS);
+
   /* initialize here, so symbols can be loaded */
   if (ptrace_nelt == 2)
     {
@@ -1434,6 +2230,12 @@ sim_load_prog(char *fname,		/* program to load */
   readyq_init();
   ruu_init();
   lsq_init();
+  if (prf_size)
+    prf_init();
+
+  /* load the programs of the other hardware contexts */
+  if (smt_nthreads > 1)
+    smt_init(envp);
 
   /* initialize the DLite debugger */
   dlite_init(simoo_reg_obj, simoo_mem_obj, simoo_mstate_obj);
@@ -1522,6 +2324,14 @@ struct RUU_station {
      operands are known to be read (see lsq_refresh() for details on
      enforcing memory dependencies) */
   int idep_ready[MAX_IDEPS];		/* input operand ready? */
+  int inames[MAX_IDEPS];		/* input logical names (NA=unused) */
+
+  /* physical register renaming state, used with -ruu:prf */
+  int pdst[MAX_ODEPS];			/* allocated phys regs (-1=none) */
+  int pprev[MAX_ODEPS];			/* prior mappings, freed at commit */
+  int ckpt;				/* rename map checkpoint (-1=none) */
+
+  int thread;				/* hardware context (with SMT) */
 };
 
 /* non-zero if all register operands are ready, update with MAX_IDEPS */
@@ -1652,60 +2462,340 @@ static int LSQ_num;                     /* num entries currently in LSQ */
 #define STORE_OP_READY(RS)              ((RS)->idep_ready[STORE_OP_INDEX])
 #define STORE_ADDR_READY(RS)            ((RS)->idep_ready[STORE_ADDR_INDEX])
 
+/* load and store predicates for LSQ entries */
+#define LSQ_IS_STORE(RS)						\
+  ((MD_OP_FLAGS((RS)->op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE))
+#define LSQ_IS_LOAD(RS)							\
+  ((MD_OP_FLAGS((RS)->op) & (F_MEM|F_LOAD)) == (F_MEM|F_LOAD))
+
+/* distance of LSQ slot INDEX from the LSQ head, i.e., its age rank */
+#define LSQ_POS(INDEX)							\
+  (((INDEX) + LSQ_size - LSQ_head) % LSQ_size)
+
+/*
+ * memory disambiguation state, kept up to date as entries enter and leave
+ * the LSQ so that lsq_refresh() and store forwarding do not have to walk
+ * the whole queue every cycle:
+ *
+ *   - every store in the LSQ is chained (youngest first) off a hash bucket
+ *     selected by its word address, a load finds the nearest earlier store
+ *     to its address by walking a single, usually very short, chain
+ *   - LSQ_STA_KNOWN counts the entries from the LSQ head known to hold no
+ *     store with an unresolved address (STA), with the conservative policy
+ *     no later load may issue
+ *   - loads that have not yet been handed to the ready queue sit on a
+ *     doubly linked list in program order, loads that issued ahead of an
+ *     unresolved store (store set policy only) sit on a second list until
+ *     all earlier store addresses are known
+ */
+#define LSQ_NIL				(-1)
+#define LSQ_SHASH(ADDR)			(((ADDR) >> 2) & lsq_shash_mask)
+
+/* load list membership, kept in LSQ_LSTATE[] */
+#define LSQ_LD_NONE			0	/* on no list */
+#define LSQ_LD_PENDING			1	/* waiting to be scheduled */
+#define LSQ_LD_SPEC			2	/* issued past an unknown STA */
+
+static int *lsq_shash;			/* store hash buckets */
+static int lsq_shash_mask;		/* store hash index mask */
+static int *lsq_snext;			/* next (older) store in hash chain */
+static int lsq_sta_known;		/* entries known free of STA unknowns */
+static int *lsq_lnext, *lsq_lprev;	/* load list links */
+static int *lsq_lstate;			/* load list membership */
+static int lsq_pend_head, lsq_pend_tail;/* pending load list */
+static int lsq_spec_head, lsq_spec_tail;/* speculatively issued load list */
+
+/*
+ * store set memory dependence predictor (Chrysos and Emer, ISCA 1998): the
+ * store set id table (SSIT), indexed by instruction PC, places loads and
+ * the stores they have conflicted with into a common store set, the last
+ * fetched store table (LFST), indexed by store set id, names the most
+ * recently dispatched store of each set, a load that finds a live store in
+ * its set's LFST entry waits for that store to execute, all other loads
+ * may issue ahead of stores whose addresses are still unknown
+ */
+#define MDP_SSIT_INDEX(PC)						\
+  (((PC) / sizeof(md_inst_t)) & (mdp_ssit_size - 1))
+
+static int *mdp_ssit;			/* SSIT: store set id, or LSQ_NIL */
+static struct mdp_lfst_ent {
+  int index;				/* LSQ index of last fetched store */
+  INST_SEQ_TYPE seq;			/* its sequence number */
+} *mdp_lfst;				/* LFST */
+static tick_t mdp_next_clear;		/* cycle of next SSIT clear */
+static int *lsq_sdep;			/* predicted store dependence */
+static INST_SEQ_TYPE *lsq_sdep_seq;	/* " ditto " sequence number */
+static int *lsq_sdep_waited;		/* load was held by dependence */
+
+/* instructions squashed by a memory ordering violation wait in the replay
+   buffer, in program order, to be dispatched again (see ruu_replay()) */
+struct mdp_replay_rec {
+  struct RUU_station rs;		/* RUU entry */
+  struct RUU_station lsq;		/* LSQ entry, if RS is an ea_comp */
+};
+static struct mdp_replay_rec *replay_buf;
+static int replay_head, replay_num;
+static tick_t replay_ready;		/* first cycle replay may start */
+
 /* allocate and initialize the load/store queue (LSQ) */
 static void
 lsq_init(void)
 {
+  int i, nbuckets;
+
   LSQ = calloc(LSQ_size, sizeof(struct RUU_station));
   if (!LSQ)
     fatal("out of virtual memory");
 
+  /* size the store hash at twice the LSQ size, rounded up to a power of two */
+  for (nbuckets = 1; nbuckets < 2*LSQ_size; nbuckets <<= 1)
+    /* nada */;
+  lsq_shash_mask = nbuckets - 1;
+  lsq_shash = calloc(nbuckets, sizeof(int));
+  lsq_snext = calloc(LSQ_size, sizeof(int));
+  lsq_lnext = calloc(LSQ_size, sizeof(int));
+  lsq_lprev = calloc(LSQ_size, sizeof(int));
+  lsq_lstate = calloc(LSQ_size, sizeof(int));
+  if (!lsq_shash || !lsq_snext || !lsq_lnext || !lsq_lprev || !lsq_lstate)
+    fatal("out of virtual memory");
+  for (i=0; i<nbuckets; i++)
+    lsq_shash[i] = LSQ_NIL;
+  lsq_sta_known = 0;
+  lsq_pend_head = lsq_pend_tail = LSQ_NIL;
+  lsq_spec_head = lsq_spec_tail = LSQ_NIL;
+
+  if (mdp_type == mdp_storeset)
+    {
+      mdp_ssit = calloc(mdp_ssit_size, sizeof(int));
+      mdp_lfst = calloc(mdp_lfst_size, sizeof(struct mdp_lfst_ent));
+      lsq_sdep = calloc(LSQ_size, sizeof(int));
+      lsq_sdep_seq = calloc(LSQ_size, sizeof(INST_SEQ_TYPE));
+      lsq_sdep_waited = calloc(LSQ_size, sizeof(int));
+      if (!mdp_ssit || !mdp_lfst
+	  || !lsq_sdep || !lsq_sdep_seq || !lsq_sdep_waited)
+	fatal("out of virtual memory");
+      for (i=0; i<mdp_ssit_size; i++)
+	mdp_ssit[i] = LSQ_NIL;
+      for (i=0; i<mdp_lfst_size; i++)
+	mdp_lfst[i].index = LSQ_NIL;
+      mdp_next_clear = mdp_clear_interval;
+
+      /* the RUU and replay buffer together never hold more than RUU_size
+	 instructions, see ruu_dispatch() */
+      replay_buf = calloc(RUU_size, sizeof(struct mdp_replay_rec));
+      if (!replay_buf)
+	fatal("out of virtual memory");
+      replay_head = replay_num = 0;
+    }
+
   LSQ_num = 0;
   LSQ_head = LSQ_tail = 0;
   LSQ_count = 0;
   LSQ_fcount = 0;
 }
 
-/* dump the contents of the RUU */
+/* append LSQ slot INDEX to the load list HEAD, TAIL */
 static void
-lsq_dump(FILE *stream)				/* output stream */
+lsq_list_append(int index, int *head, int *tail)
 {
-  int num, head;
-  struct RUU_station *rs;
+  lsq_lnext[index] = LSQ_NIL;
+  lsq_lprev[index] = *tail;
+  if (*tail != LSQ_NIL)
+    lsq_lnext[*tail] = index;
+  else
+    *head = index;
+  *tail = index;
+}
 
-  if (!stream)
-    stream = stderr;
+/* unlink LSQ slot INDEX from the load list HEAD, TAIL */
+static void
+lsq_list_unlink(int index, int *head, int *tail)
+{
+  if (lsq_lprev[index] != LSQ_NIL)
+    lsq_lnext[lsq_lprev[index]] = lsq_lnext[index];
+  else
+    *head = lsq_lnext[index];
+  if (lsq_lnext[index] != LSQ_NIL)
+    lsq_lprev[lsq_lnext[index]] = lsq_lprev[index];
+  else
+    *tail = lsq_lprev[index];
+}
 
-  fprintf(stream, "** LSQ state **\n");
-  fprintf(stream, "LSQ_head: %d, LSQ_tail: %d\n", LSQ_head, LSQ_tail);
-  fprintf(stream, "LSQ_num: %d\n", LSQ_num);
+/* non-zero if LSQ slot INDEX still holds the un-executed store SEQ */
+#define LSQ_STORE_WAITING(INDEX, SEQ)					\
+  (LSQ_POS(INDEX) < LSQ_num						\
+   && LSQ[INDEX].seq == (SEQ) && !LSQ[INDEX].completed)
 
-  num = LSQ_num;
-  head = LSQ_head;
-  while (num)
+/* enter the load or store in LSQ slot INDEX into the disambiguation state,
+   entries must be entered in program order */
+static void
+lsq_enter(int index)
+{
+  struct RUU_station *rs = &LSQ[index];
+  int bucket, ssid;
+
+  if (LSQ_IS_STORE(rs))
     {
-      rs = &LSQ[head];
-      ruu_dumpent(rs, rs - LSQ, stream, /* header */TRUE);
-      head = (head + 1) % LSQ_size;
-      num--;
+      /* youngest store goes to the front of its chain */
+      bucket = LSQ_SHASH(rs->addr);
+      lsq_snext[index] = lsq_shash[bucket];
+      lsq_shash[bucket] = index;
+
+      /* the store becomes the last fetched store of its store set */
+      if (mdp_type == mdp_storeset
+	  && (ssid = mdp_ssit[MDP_SSIT_INDEX(rs->PC)]) != LSQ_NIL)
+	{
+	  mdp_lfst[ssid].index = index;
+	  mdp_lfst[ssid].seq = rs->seq;
+	}
+    }
+  else if (LSQ_IS_LOAD(rs))
+    {
+      /* append to the pending load list */
+      lsq_lstate[index] = LSQ_LD_PENDING;
+      lsq_list_append(index, &lsq_pend_head, &lsq_pend_tail);
+
+      /* wait on the last fetched store of the load's store set, if any */
+      if (mdp_type == mdp_storeset)
+	{
+	  lsq_sdep[index] = LSQ_NIL;
+	  lsq_sdep_waited[index] = FALSE;
+	  ssid = mdp_ssit[MDP_SSIT_INDEX(rs->PC)];
+	  if (ssid != LSQ_NIL
+	      && mdp_lfst[ssid].index != LSQ_NIL
+	      && mdp_lfst[ssid].seq < rs->seq
+	      && LSQ_STORE_WAITING(mdp_lfst[ssid].index, mdp_lfst[ssid].seq))
+	    {
+	      lsq_sdep[index] = mdp_lfst[ssid].index;
+	      lsq_sdep_seq[index] = mdp_lfst[ssid].seq;
+	      sim_mdp_pred_deps++;
+	    }
+	}
     }
 }
 
+/* remove the load in LSQ slot INDEX from whichever load list holds it */
+static void
+lsq_unpend(int index)
+{
+  if (lsq_lstate[index] == LSQ_LD_PENDING)
+    lsq_list_unlink(index, &lsq_pend_head, &lsq_pend_tail);
+  else if (lsq_lstate[index] == LSQ_LD_SPEC)
+    lsq_list_unlink(index, &lsq_spec_head, &lsq_spec_tail);
+  lsq_lstate[index] = LSQ_LD_NONE;
+}
 
-/*
- * RS_LINK defs and decls
- */
+/* remove the load or store in LSQ slot INDEX from the disambiguation state,
+   called as the entry commits or is squashed */
+static void
+lsq_leave(int index)
+{
+  int *link;
 
-/* a reservation station link: this structure links elements of a RUU
-   reservation station list; used for ready instruction queue, event queue, and
-   output dependency lists; each RS_LINK node contains a pointer to the RUU
-   entry it references along with an instance tag, the RS_LINK is only valid if
-   the instruction instance tag matches the instruction RUU entry instance tag;
-   this strategy allows entries in the RUU can be squashed and reused without
-   updating the lists that point to it, which significantly improves the
-   performance of (all to frequent) squash events */
-struct RS_link {
-  struct RS_link *next;			/* next entry in list */
+  if (LSQ_IS_STORE(&LSQ[index]))
+    {
+      /* committing stores sit at the end of their chain, squashed stores at
+	 the front, either way the chain is short */
+      for (link = &lsq_shash[LSQ_SHASH(LSQ[index].addr)];
+	   *link != index;
+	   link = &lsq_snext[*link])
+	{
+	  if (*link == LSQ_NIL)
+	    panic("store missing from LSQ store hash");
+	}
+      *link = lsq_snext[index];
+    }
+  else
+    lsq_unpend(index);
+}
+
+/* return the youngest store in the LSQ that is older than load RS and
+   writes the same address, or NULL if there is no such store; if KNOWN_ONLY
+   is set, stores whose address is not yet known are not visible */
+static struct RUU_station *
+lsq_store_match(struct RUU_station *rs, int known_only)
+{
+  int index;
+
+  for (index = lsq_shash[LSQ_SHASH(rs->addr)];
+       index != LSQ_NIL;
+       index = lsq_snext[index])
+    {
+      /* FIXME: not dealing with partials! */
+      if (LSQ[index].seq < rs->seq && LSQ[index].addr == rs->addr
+	  && (!known_only || STORE_ADDR_READY(&LSQ[index])))
+	return &LSQ[index];
+    }
+  return NULL;
+}
+
+/* place the store and load at ST_PC and LD_PC, which have just caused a
+   memory ordering violation, into a common store set */
+static void
+mdp_train(md_addr_t st_PC, md_addr_t ld_PC)
+{
+  int *st_id = &mdp_ssit[MDP_SSIT_INDEX(st_PC)];
+  int *ld_id = &mdp_ssit[MDP_SSIT_INDEX(ld_PC)];
+
+  if (*st_id == LSQ_NIL && *ld_id == LSQ_NIL)
+    {
+      /* neither is in a set, create a new one named after the store */
+      *st_id = *ld_id = MDP_SSIT_INDEX(st_PC) & (mdp_lfst_size - 1);
+    }
+  else if (*st_id == LSQ_NIL)
+    *st_id = *ld_id;
+  else if (*ld_id == LSQ_NIL)
+    *ld_id = *st_id;
+  else
+    {
+      /* both in sets, the lower numbered set wins */
+      *st_id = *ld_id = MIN(*st_id, *ld_id);
+    }
+}
+
+/* dump the contents of the RUU */
+static void
+lsq_dump(FILE *stream)				/* output stream */
+{
+  int num, head;
+  struct RUU_station *rs;
+
+  if (!stream)
+    stream = stderr;
+
+  fprintf(stream, "** LSQ state **\n");
+  fprintf(stream, "LSQ_head: %d, LSQ_tail: %d\n", LSQ_head, LSQ_tail);
+  fprintf(stream, "LSQ_num: %d\n", LSQ_num);
+  fprintf(stream, "STA known: %d, pending loads: %d..%d, spec loads: %d..%d\n",
+	  lsq_sta_known, lsq_pend_head, lsq_pend_tail,
+	  lsq_spec_head, lsq_spec_tail);
+
+  num = LSQ_num;
+  head = LSQ_head;
+  while (num)
+    {
+      rs = &LSQ[head];
+      ruu_dumpent(rs, rs - LSQ, stream, /* header */TRUE);
+      head = (head + 1) % LSQ_size;
+      num--;
+    }
+}
+
+
+/*
+ * RS_LINK defs and decls
+ */
+
+/* a reservation station link: this structure links elements of a RUU
+   reservation station list; used for ready instruction queue, event queue, and
+   output dependency lists; each RS_LINK node contains a pointer to the RUU
+   entry it references along with an instance tag, the RS_LINK is only valid if
+   the instruction instance tag matches the instruction RUU entry instance tag;
+   this strategy allows entries in the RUU can be squashed and reused without
+   updating the lists that point to it, which significantly improves the
+   performance of (all to frequent) squash events */
+struct RS_link {
+  struct RS_link *next;			/* next entry in list */
   struct RUU_station *rs;		/* referenced RUU resv station */
   INST_TAG_TYPE tag;			/* inst instance sequence number */
   union {
@@ -1809,16 +2899,129 @@ ruu_release_fu(void)
  * drains this queue
  */
 
-/* pending event queue, sorted from soonest to latest event (in time), NOTE:
-   RS_LINK nodes are used for the event queue list so that it need not be
-   updated during squash events */
-static struct RS_link *event_queue;
+/* pending event queue, a timing wheel of EVENTQ_WHEEL_SIZE cycles with one
+   event list per cycle, events further out than the wheel wait in a binary
+   heap and move onto the wheel as it turns; each list holds the events of
+   one cycle, most recently queued first, which is the order a single list
+   sorted by time would keep them in, NOTE: RS_LINK nodes are used for the
+   event lists so that they need not be updated during squash events */
+#define EVENTQ_WHEEL_SIZE	1024
+static struct RS_link *eventq_wheel[EVENTQ_WHEEL_SIZE];
+
+/* earliest cycle whose events may still be on the wheel, the wheel holds
+   the events of cycles EVENTQ_CYCLE to EVENTQ_CYCLE+EVENTQ_WHEEL_SIZE-1 */
+static tick_t eventq_cycle;
+
+/* an event waiting to move onto the wheel */
+struct eventq_ovfl {
+  tick_t when;				/* time of the event */
+  counter_t seq;			/* order the event was queued in */
+  struct RS_link *ev;			/* the event */
+};
+
+/* overflow heap, ordered by time then queue order */
+static struct eventq_ovfl *eventq_heap;
+static int eventq_heap_num;
+static int eventq_heap_size;
+static counter_t eventq_seq;
 
 /* initialize the event queue structures */
 static void
 eventq_init(void)
 {
-  event_queue = NULL;
+  int i;
+
+  for (i=0; i < EVENTQ_WHEEL_SIZE; i++)
+    eventq_wheel[i] = NULL;
+  eventq_cycle = sim_cycle;
+  eventq_heap_num = 0;
+  eventq_seq = 0;
+}
+
+/* non-zero if overflow event A must leave the heap before B */
+#define EVENTQ_OVFL_BEFORE(A, B)					\
+  ((A)->when < (B)->when || ((A)->when == (B)->when && (A)->seq < (B)->seq))
+
+/* put event EV for time WHEN in the overflow heap */
+static void
+eventq_heap_push(struct RS_link *ev, tick_t when)
+{
+  struct eventq_ovfl ent;
+  int i;
+
+  if (eventq_heap_num == eventq_heap_size)
+    {
+      eventq_heap_size = eventq_heap_size ? 2 * eventq_heap_size : 64;
+      eventq_heap = realloc(eventq_heap,
+			    eventq_heap_size * sizeof(struct eventq_ovfl));
+      if (!eventq_heap)
+	fatal("out of virtual memory");
+    }
+
+  ent.when = when;
+  ent.seq = eventq_seq++;
+  ent.ev = ev;
+
+  /* sift up */
+  for (i = eventq_heap_num++;
+       i > 0 && EVENTQ_OVFL_BEFORE(&ent, &eventq_heap[(i-1)/2]);
+       i = (i-1)/2)
+    eventq_heap[i] = eventq_heap[(i-1)/2];
+  eventq_heap[i] = ent;
+}
+
+/* take the earliest event out of the overflow heap */
+static struct RS_link *
+eventq_heap_pop(void)
+{
+  struct RS_link *ev = eventq_heap[0].ev;
+  struct eventq_ovfl last = eventq_heap[--eventq_heap_num];
+  int i, child;
+
+  /* sift down */
+  for (i=0; (child = 2*i + 1) < eventq_heap_num; i = child)
+    {
+      if (child + 1 < eventq_heap_num
+	  && EVENTQ_OVFL_BEFORE(&eventq_heap[child+1], &eventq_heap[child]))
+	child++;
+      if (!EVENTQ_OVFL_BEFORE(&eventq_heap[child], &last))
+	break;
+      eventq_heap[i] = eventq_heap[child];
+    }
+  eventq_heap[i] = last;
+  return ev;
+}
+
+/* move the overflow events the wheel now reaches onto it, oldest first so
+   that the most recently queued event of a cycle ends up first */
+static void
+eventq_turn_wheel(void)
+{
+  struct RS_link *ev, **slot;
+
+  while (eventq_heap_num > 0
+	 && eventq_heap[0].when < eventq_cycle + EVENTQ_WHEEL_SIZE)
+    {
+      ev = eventq_heap_pop();
+      slot = &eventq_wheel[ev->x.when & (EVENTQ_WHEEL_SIZE - 1)];
+      ev->next = *slot;
+      *slot = ev;
+    }
+}
+
+/* dump event EV of the event queue, if it is still valid */
+static void
+eventq_dumpent(struct RS_link *ev, FILE *stream)
+{
+  if (RSLINK_VALID(ev))
+    {
+      struct RUU_station *rs = RSLINK_RS(ev);
+
+      fprintf(stream, "idx: %2d: @ %.0f\n",
+	      (int)(rs - (rs->in_LSQ ? LSQ : RUU)), (double)ev->x.when);
+      ruu_dumpent(rs, rs - (rs->in_LSQ ? LSQ : RUU),
+		  stream, /* !header */FALSE);
+    }
 }
 
 /* dump the contents of the event queue */
@@ -1826,34 +3029,34 @@ static void
 eventq_dump(FILE *stream)			/* output stream */
 {
   struct RS_link *ev;
+  tick_t cycle;
+  int i;
 
   if (!stream)
     stream = stderr;
 
   fprintf(stream, "** event queue state **\n");
 
-  for (ev = event_queue; ev != NULL; ev = ev->next)
+  for (cycle = eventq_cycle; cycle < eventq_cycle + EVENTQ_WHEEL_SIZE; cycle++)
     {
-      /* is event still valid? */
-      if (RSLINK_VALID(ev))
-	{
-	  struct RUU_station *rs = RSLINK_RS(ev);
-
-	  fprintf(stream, "idx: %2d: @ %.0f\n",
-		  (int)(rs - (rs->in_LSQ ? LSQ : RUU)), (double)ev->x.when);
-	  ruu_dumpent(rs, rs - (rs->in_LSQ ? LSQ : RUU),
-		      stream, /* !header */FALSE);
-	}
+      for (ev = eventq_wheel[cycle & (EVENTQ_WHEEL_SIZE - 1)];
+	   ev != NULL;
+	   ev = ev->next)
+	eventq_dumpent(ev, stream);
     }
+
+  /* events beyond the wheel, in heap order */
+  for (i=0; i < eventq_heap_num; i++)
+    eventq_dumpent(eventq_heap[i].ev, stream);
 }
 
-/* insert an event for RS into the event queue, event queue is sorted from
-   earliest to latest event, event and associated side-effects will be
-   apparent at the start of cycle WHEN */
+/* insert an event for RS into the event queue, events of the same cycle are
+   kept most recently queued first, event and associated side-effects will
+   be apparent at the start of cycle WHEN */
 static void
 eventq_queue_event(struct RUU_station *rs, tick_t when)
 {
-  struct RS_link *prev, *ev, *new_ev;
+  struct RS_link *new_ev, **slot;
 
   if (rs->completed)
     panic("event completed");
@@ -1865,23 +3068,18 @@ eventq_queue_event(struct RUU_station *rs, tick_t when)
   RSLINK_NEW(new_ev, rs);
   new_ev->x.when = when;
 
-  /* locate insertion point */
-  for (prev=NULL, ev=event_queue;
-       ev && ev->x.when < when;
-       prev=ev, ev=ev->next);
+  /* overflow events the wheel reaches go on it before this event */
+  eventq_turn_wheel();
 
-  if (prev)
+  if (when - eventq_cycle < EVENTQ_WHEEL_SIZE)
     {
-      /* insert middle or end */
-      new_ev->next = prev->next;
-      prev->next = new_ev;
+      /* insert at the beginning of the cycle's list */
+      slot = &eventq_wheel[when & (EVENTQ_WHEEL_SIZE - 1)];
+      new_ev->next = *slot;
+      *slot = new_ev;
     }
   else
-    {
-      /* insert at beginning */
-      new_ev->next = event_queue;
-      event_queue = new_ev;
-    }
+    eventq_heap_push(new_ev, when);
 }
 
 /* return the next event that has already occurred, returns NULL when no
@@ -1889,13 +3087,23 @@ eventq_queue_event(struct RUU_station *rs, tick_t when)
 static struct RUU_station *
 eventq_next_event(void)
 {
-  struct RS_link *ev;
+  struct RS_link *ev, **slot;
 
-  if (event_queue && event_queue->x.when <= sim_cycle)
+  while (eventq_cycle <= sim_cycle)
     {
-      /* unlink and return first event on priority list */
-      ev = event_queue;
-      event_queue = event_queue->next;
+      eventq_turn_wheel();
+
+      slot = &eventq_wheel[eventq_cycle & (EVENTQ_WHEEL_SIZE - 1)];
+      if (!*slot)
+	{
+	  /* all events of this cycle are done, turn the wheel */
+	  eventq_cycle++;
+	  continue;
+	}
+
+      /* unlink the first event of the cycle */
+      ev = *slot;
+      *slot = ev->next;
 
       /* event still valid? */
       if (RSLINK_VALID(ev))
@@ -1908,20 +3116,31 @@ eventq_next_event(void)
 	  /* event is valid, return resv station */
 	  return rs;
 	}
-      else
-	{
-	  /* reclaim event record */
-	  RSLINK_FREE(ev);
 
-	  /* receiving inst was squashed, return next event */
-	  return eventq_next_event();
-	}
+      /* receiving inst was squashed, reclaim event record and try the next
+	 event */
+      RSLINK_FREE(ev);
     }
-  else
+
+  /* no event or no event is ready */
+  return NULL;
+}
+
+/* return the earliest cycle with a (possibly squashed) event still in the
+   event queue, zero if the queue is empty, all events up to the current
+   cycle must have been serviced */
+static tick_t
+eventq_next_time(void)
+{
+  tick_t cycle;
+
+  for (cycle = MAX(eventq_cycle, sim_cycle);
+       cycle < eventq_cycle + EVENTQ_WHEEL_SIZE; cycle++)
     {
-      /* no event or no event is ready */
-      return NULL;
+      if (eventq_wheel[cycle & (EVENTQ_WHEEL_SIZE - 1)])
+	return cycle;
     }
+  return eventq_heap_num > 0 ? eventq_heap[0].when : 0;
 }
 
 
@@ -1937,14 +3156,58 @@ eventq_next_event(void)
  * updated during squash events
  */
 
-/* the ready instruction queue */
-static struct RS_link *ready_queue;
+/* the ready instruction queue, under the list select policy it is a list
+   of RS_LINK nodes in issue order, under the oldest select policy it is a
+   binary heap of RS_LINK nodes ordered by issue priority, so an instruction
+   is queued and the next one to issue is found in O(log n) time (see
+   readyq_enqueue() for both policies) */
+struct readyq_ent {
+  int prio;				/* priority class, 0 goes first */
+  struct RS_link *link;			/* queued instruction */
+};
+static struct RS_link *ready_list;
+static struct readyq_ent *ready_queue;
+static int readyq_size;
+
+/* ready list being visited by ruu_issue() this cycle, list select policy */
+static struct RS_link *ready_scan;
+
+/* number of queued nodes, including squashed ones, NOTE: under the list
+   select policy the nodes being visited this cycle are not counted */
+static int readyq_num;
+
+/* non-zero if ready queue entry A issues before B, i.e., it is in a higher
+   priority class or is older in the same class */
+#define READYQ_BEFORE(A, B)						\
+  ((A)->prio < (B)->prio						\
+   || ((A)->prio == (B)->prio && (A)->link->x.seq < (B)->link->x.seq))
 
 /* initialize the event queue structures */
 static void
 readyq_init(void)
 {
-  ready_queue = NULL;
+  ready_list = NULL;
+  ready_scan = NULL;
+  readyq_num = 0;
+  readyq_size = RUU_size + LSQ_size;
+  ready_queue = calloc(readyq_size, sizeof(struct readyq_ent));
+  if (!ready_queue)
+    fatal("out of virtual memory");
+}
+
+/* dump ready queue node LINK, if it is still valid */
+static void
+readyq_dumpent(struct RS_link *link,		/* node to dump */
+	       FILE *stream)			/* output stream */
+{
+  /* is entry still valid? */
+  if (RSLINK_VALID(link))
+    {
+      struct RUU_station *rs = RSLINK_RS(link);
+
+      ruu_dumpent(rs, rs - (rs->in_LSQ ? LSQ : RUU),
+		  stream, /* header */TRUE);
+    }
 }
 
 /* dump the contents of the ready queue */
@@ -1952,22 +3215,23 @@ static void
 readyq_dump(FILE *stream)			/* output stream */
 {
   struct RS_link *link;
+  int i;
 
   if (!stream)
     stream = stderr;
 
   fprintf(stream, "** ready queue state **\n");
 
-  for (link = ready_queue; link != NULL; link = link->next)
+  /* entries in list or heap order */
+  if (issue_select == issue_select_list)
     {
-      /* is entry still valid? */
-      if (RSLINK_VALID(link))
-	{
-	  struct RUU_station *rs = RSLINK_RS(link);
-
-	  ruu_dumpent(rs, rs - (rs->in_LSQ ? LSQ : RUU),
-		      stream, /* header */TRUE);
-	}
+      for (link = ready_list; link != NULL; link = link->next)
+	readyq_dumpent(link, stream);
+    }
+  else
+    {
+      for (i=0; i < readyq_num; i++)
+	readyq_dumpent(ready_queue[i].link, stream);
     }
 }
 
@@ -1980,14 +3244,21 @@ readyq_dump(FILE *stream)			/* output stream */
 
      all other instructions, oldest instructions first
 
-  this policy works well because branches pass through the machine quicker
-  which works to reduce branch misprediction latencies, and very long latency
-  instructions (such loads and multiplies) get priority since they are very
-  likely on the program's critical path */
+   under the list select policy, memory, long latency and branch
+   instructions go to the head of the list, newest first, and the others
+   go ahead of the first node that is not older, so an old instruction can
+   pass younger high priority ones; under the oldest select policy each
+   class issues strictly oldest first; this policy works well because
+   branches pass through the machine quicker which works to reduce branch
+   misprediction latencies, and very long latency instructions (such loads
+   and multiplies) get priority since they are very likely on the program's
+   critical path */
 static void
 readyq_enqueue(struct RUU_station *rs)		/* RS to enqueue */
 {
   struct RS_link *prev, *node, *new_node;
+  struct readyq_ent ent;
+  int i;
 
   /* node is now queued */
   if (rs->queued)
@@ -1997,33 +3268,142 @@ readyq_enqueue(struct RUU_station *rs)		/* RS to enqueue */
   /* get a free ready list node */
   RSLINK_NEW(new_node, rs);
   new_node->x.seq = rs->seq;
+  ent.link = new_node;
+  ent.prio = (rs->in_LSQ || MD_OP_FLAGS(rs->op) & (F_LONGLAT|F_CTRL)) ? 0 : 1;
 
-  /* locate insertion point */
-  if (rs->in_LSQ || MD_OP_FLAGS(rs->op) & (F_LONGLAT|F_CTRL))
+  if (issue_select == issue_select_list)
     {
-      /* insert loads/stores and long latency ops at the head of the queue */
-      prev = NULL;
-      node = ready_queue;
+      /* locate insertion point */
+      if (ent.prio == 0)
+	{
+	  /* insert loads/stores and long latency ops at the head of the
+	     queue */
+	  prev = NULL;
+	  node = ready_list;
+	}
+      else
+	{
+	  /* otherwise insert in program order (earliest seq first) */
+	  for (prev=NULL, node=ready_list;
+	       node && node->x.seq < rs->seq;
+	       prev=node, node=node->next);
+	}
+
+      if (prev)
+	{
+	  /* insert middle or end */
+	  new_node->next = prev->next;
+	  prev->next = new_node;
+	}
+      else
+	{
+	  /* insert at beginning */
+	  new_node->next = ready_list;
+	  ready_list = new_node;
+	}
+      readyq_num++;
+      return;
     }
-  else
+
+  /* squashed entries linger until they reach the top, so grow if needed */
+  if (readyq_num == readyq_size)
     {
-      /* otherwise insert in program order (earliest seq first) */
-      for (prev=NULL, node=ready_queue;
-	   node && node->x.seq < rs->seq;
-	   prev=node, node=node->next);
+      readyq_size *= 2;
+      ready_queue = realloc(ready_queue,
+			    readyq_size * sizeof(struct readyq_ent));
+      if (!ready_queue)
+	fatal("out of virtual memory");
     }
 
-  if (prev)
+  /* sift up to the insertion point */
+  for (i = readyq_num++;
+       i > 0 && READYQ_BEFORE(&ent, &ready_queue[(i-1)/2]);
+       i = (i-1)/2)
+    ready_queue[i] = ready_queue[(i-1)/2];
+  ready_queue[i] = ent;
+}
+
+/* remove and return the next node to visit for issue this cycle, NULL if
+   there is none; under the list select policy the whole ready list is
+   visited in order, after readyq_scan_start() takes it */
+static struct RS_link *
+readyq_dequeue(void)
+{
+  struct RS_link *link;
+  struct readyq_ent last;
+  int i, child;
+
+  if (issue_select == issue_select_list)
     {
-      /* insert middle or end */
-      new_node->next = prev->next;
-      prev->next = new_node;
+      if ((link = ready_scan) != NULL)
+	ready_scan = link->next;
+      return link;
     }
-  else
+
+  if (!readyq_num)
+    return NULL;
+
+  link = ready_queue[0].link;
+  last = ready_queue[--readyq_num];
+
+  /* sift the last entry down from the top */
+  for (i=0; (child = 2*i + 1) < readyq_num; i = child)
+    {
+      if (child + 1 < readyq_num
+	  && READYQ_BEFORE(&ready_queue[child+1], &ready_queue[child]))
+	child++;
+      if (!READYQ_BEFORE(&ready_queue[child], &last))
+	break;
+      ready_queue[i] = ready_queue[child];
+    }
+  ready_queue[i] = last;
+
+  return link;
+}
+
+/* start this cycle's visit of the ready queue, under the list select policy
+   the ready list is taken whole, and ruu_issue() rebuilds it from the nodes
+   that do not issue, NOTE: this ensures that the ready list is always
+   properly sorted */
+static void
+readyq_scan_start(void)
+{
+  if (issue_select == issue_select_list)
+    {
+      ready_scan = ready_list;
+      ready_list = NULL;
+      readyq_num = 0;
+    }
+}
+
+/* end this cycle's visit of the ready queue, under the list select policy
+   the nodes not visited go back into the ready list */
+static void
+readyq_scan_end(void)
+{
+  struct RS_link *node;
+
+  if (issue_select != issue_select_list)
+    return;
+
+  while ((node = readyq_dequeue()) != NULL)
     {
-      /* insert at beginning */
-      new_node->next = ready_queue;
-      ready_queue = new_node;
+      /* still valid? */
+      if (RSLINK_VALID(node))
+	{
+	  struct RUU_station *rs = RSLINK_RS(node);
+
+	  /* node is now un-queued */
+	  rs->queued = FALSE;
+
+	  /* not issued, put operation back onto the ready list, we'll try
+	     to issue it again next cycle */
+	  readyq_enqueue(rs);
+	}
+      /* else, RUU entry was squashed */
+
+      /* reclaim ready list entry */
+      RSLINK_FREE(node);
     }
 }
 
@@ -2053,13 +3433,13 @@ static struct CV_link CVLINK_NULL = { NULL, 0 };
    for fast recovery during wrong path execute (see tracer_recover() for
    details on this process */
 static BITMAP_TYPE(MD_TOTAL_REGS, use_spec_cv);
-static struct CV_link create_vector[MD_TOTAL_REGS];
-static struct CV_link spec_create_vector[MD_TOTAL_REGS];
+static struct CV_link *create_vector;
+static struct CV_link *spec_create_vector;
 
 /* these arrays shadow the create vector an indicate when a register was
    last created */
-static tick_t create_vector_rt[MD_TOTAL_REGS];
-static tick_t spec_create_vector_rt[MD_TOTAL_REGS];
+static tick_t *create_vector_rt;
+static tick_t *spec_create_vector_rt;
 
 /* read a create vector entry */
 #define CREATE_VECTOR(N)        (BITMAP_SET_P(use_spec_cv, CV_BMAP_SZ, (N))\
@@ -2083,6 +3463,15 @@ cv_init(void)
 {
   int i;
 
+  /* each hardware context has its own create vector */
+  create_vector = calloc(MD_TOTAL_REGS, sizeof(struct CV_link));
+  spec_create_vector = calloc(MD_TOTAL_REGS, sizeof(struct CV_link));
+  create_vector_rt = calloc(MD_TOTAL_REGS, sizeof(tick_t));
+  spec_create_vector_rt = calloc(MD_TOTAL_REGS, sizeof(tick_t));
+  if (!create_vector || !spec_create_vector
+      || !create_vector_rt || !spec_create_vector_rt)
+    fatal("out of virtual memory");
+
   /* initially all registers are valid in the architected register file,
      i.e., the create vector entry is CVLINK_NULL */
   for (i=0; i < MD_TOTAL_REGS; i++)
@@ -2122,21 +3511,149 @@ cv_dump(FILE *stream)				/* output stream */
 }
 
 
+/*
+ * physical register file (-ruu:prf): register results are renamed onto a
+ * merged integer/FP physical register file, the RUU remains the reorder
+ * buffer and the create vector still tracks which in-flight operation will
+ * produce each value, the rename map and free list only model capacity
+ *
+ * the free list is a circular queue, registers are allocated at its head
+ * (dispatch) and returned at its tail (commit), so the registers allocated
+ * by squashed instructions are always the ones just behind the head; a
+ * rename map checkpoint therefore need only save the map and the head
+ */
+
+/* a rename map checkpoint */
+struct prf_ckpt {
+  int map[MD_TOTAL_REGS];		/* logical -> physical map */
+  int free_head;			/* free list head */
+};
+
+static int prf_map[MD_TOTAL_REGS];	/* logical -> physical map */
+static int *prf_free;			/* free list */
+static int prf_free_head, prf_free_num;	/* free list head, free regs */
+static struct prf_ckpt *prf_ckpts;	/* checkpoint pool */
+static int *prf_ckpt_free;		/* free checkpoint stack */
+static int prf_ckpt_nfree;		/* free checkpoints */
+
+/* number of RUU entries dispatched but not yet issued (with -ruu:iq) */
+static int iq_num;
+
+/* initialize the physical register file, the logical registers start out
+   mapped onto the first MD_TOTAL_REGS physical registers */
+static void
+prf_init(void)
+{
+  int i;
+
+  prf_free = calloc(prf_size, sizeof(int));
+  prf_ckpts = calloc(MAX(prf_nckpts, 1), sizeof(struct prf_ckpt));
+  prf_ckpt_free = calloc(MAX(prf_nckpts, 1), sizeof(int));
+  if (!prf_free || !prf_ckpts || !prf_ckpt_free)
+    fatal("out of virtual memory");
+
+  for (i=0; i < MD_TOTAL_REGS; i++)
+    prf_map[i] = i;
+  prf_free_head = 0;
+  prf_free_num = prf_size - MD_TOTAL_REGS;
+  for (i=0; i < prf_free_num; i++)
+    prf_free[i] = MD_TOTAL_REGS + i;
+
+  for (i=0; i < prf_nckpts; i++)
+    prf_ckpt_free[i] = i;
+  prf_ckpt_nfree = prf_nckpts;
+}
+
+/* return physical register PREG to the tail of the free list */
+static void
+prf_release(int preg)
+{
+  if (prf_free_num == prf_size)
+    panic("physical register free list overflow");
+  prf_free[(prf_free_head + prf_free_num) % prf_size] = preg;
+  prf_free_num++;
+}
+
+/* give up the rename map checkpoint held by RS, if any */
+static void
+prf_ckpt_release(struct RUU_station *rs)
+{
+  if (rs->ckpt < 0)
+    return;
+  prf_ckpt_free[prf_ckpt_nfree++] = rs->ckpt;
+  rs->ckpt = -1;
+}
+
+/* RS is committing, the registers its results replaced are now dead */
+static void
+prf_commit(struct RUU_station *rs)
+{
+  int i;
+
+  for (i=0; i<MAX_ODEPS; i++)
+    {
+      if (rs->pdst[i] >= 0)
+	prf_release(rs->pprev[i]);
+    }
+  prf_ckpt_release(rs);
+}
+
+/* RS is being squashed, youngest first; if RESTORE is set, undo its
+   renames, else a checkpoint will restore the map once the walk is done;
+   returns the number of registers RS had allocated */
+static int
+prf_squash(struct RUU_station *rs, int restore)
+{
+  int i, n = 0;
+
+  for (i=MAX_ODEPS-1; i >= 0; i--)
+    {
+      if (rs->pdst[i] < 0)
+	continue;
+      n++;
+      if (restore)
+	{
+	  prf_map[rs->onames[i]] = rs->pprev[i];
+	  prf_free_head = (prf_free_head + (prf_size-1)) % prf_size;
+	  prf_free_num++;
+	  if (prf_free[prf_free_head] != rs->pdst[i])
+	    panic("physical register free list out of order");
+	}
+    }
+  prf_ckpt_release(rs);
+  return n;
+}
+
+/* restore the rename map and free list from the checkpoint held by RS */
+static void
+prf_restore(struct RUU_station *rs)
+{
+  struct prf_ckpt *ckpt = &prf_ckpts[rs->ckpt];
+
+  memcpy(prf_map, ckpt->map, sizeof(prf_map));
+  prf_free_num += (prf_free_head + prf_size - ckpt->free_head) % prf_size;
+  prf_free_head = ckpt->free_head;
+  if (prf_free_num > prf_size)
+    panic("physical register free list overflow");
+}
+
+
 /*
  *  RUU_COMMIT() - instruction retirement pipeline stage
  */
 
 /* this function commits the results of the oldest completed entries from the
    RUU and LSQ to the architected reg file, stores in the LSQ will commit
-   their store data to the data cache at this point as well */
-static void
-ruu_commit(void)
+   their store data to the data cache at this point as well, at most WIDTH
+   instructions are committed, returns the number committed */
+static int
+ruu_commit(int width)				/* commit B/W left */
 {
   int i, lat, events, committed = 0;
   static counter_t sim_ret_insn = 0;
 
   /* all values must be retired to the architected reg file in program order */
-  while (RUU_num > 0 && committed < ruu_commit_width)
+  while (RUU_num > 0 && committed < width)
     {
       struct RUU_station *rs = &(RUU[RUU_head]);
 
@@ -2185,9 +3702,11 @@ ruu_commit(void)
 		  if (cache_dl1)
 		    {
 		      /* commit store value to D-cache */
+		      cache_access_PC = LSQ[LSQ_head].PC;
 		      lat =
-			cache_access(cache_dl1, Write, (LSQ[LSQ_head].addr&~3),
-				     NULL, 4, sim_cycle, NULL, NULL);
+			cache_access(cache_dl1, Write,
+				     SMT_ADDR(LSQ[LSQ_head].addr&~3),
+				     NULL, 4, sim_cycle, NULL, NULL, 0);
 		      if (lat > cache_dl1_lat)
 			events |= PEV_CACHEMISS;
 		    }
@@ -2197,8 +3716,9 @@ ruu_commit(void)
 		    {
 		      /* access the D-TLB */
 		      lat =
-			cache_access(dtlb, Read, (LSQ[LSQ_head].addr & ~3),
-				     NULL, 4, sim_cycle, NULL, NULL);
+			cache_access(dtlb, Read,
+				     SMT_ADDR(LSQ[LSQ_head].addr & ~3),
+				     NULL, 4, sim_cycle, NULL, NULL, 0);
 		      if (lat > 1)
 			events |= PEV_TLBMISS;
 		    }
@@ -2211,6 +3731,9 @@ ruu_commit(void)
 	    }
 
 	  /* invalidate load/store operation instance */
+	  lsq_leave(LSQ_head);
+	  if (prf_size)
+	    prf_commit(&LSQ[LSQ_head]);
 	  LSQ[LSQ_head].tag++;
           sim_slip += (sim_cycle - LSQ[LSQ_head].slip);
    
@@ -2221,6 +3744,8 @@ ruu_commit(void)
 	  /* commit head of LSQ as well */
 	  LSQ_head = (LSQ_head + 1) % LSQ_size;
 	  LSQ_num--;
+	  if (lsq_sta_known > 0)
+	    lsq_sta_known--;
 	}
 
       if (pred
@@ -2239,7 +3764,14 @@ ruu_commit(void)
                        /* dir predictor update pointer */&rs->dir_update);
 	}
 
+      /* the fill unit builds traces from the committed insts */
+      if (tcache)
+	tcache_fill(tcache, smt_cur, SMT_ADDR(rs->PC), rs->IR, rs->op,
+		    SMT_ADDR(rs->next_PC));
+
       /* invalidate RUU operation instance */
+      if (prf_size)
+	prf_commit(rs);
       RUU[RUU_head].tag++;
       sim_slip += (sim_cycle - RUU[RUU_head].slip);
       /* print retirement trace if in verbose mode */
@@ -2271,6 +3803,9 @@ ruu_commit(void)
 	    panic ("retired instruction has odeps\n");
         }
     }
+  if (committed)
+    pipe_progress = TRUE;
+  return committed;
 }
 
 
@@ -2279,12 +3814,16 @@ ruu_commit(void)
  */
 
 /* recover processor microarchitecture state back to point of the
-   mis-predicted branch at RUU[BRANCH_INDEX] */
-static void
+   mis-predicted branch at RUU[BRANCH_INDEX], returns the number of cycles
+   needed to restore the rename map by walking the squashed entries, zero
+   unless a physical register file is in use and the branch did not hold a
+   rename map checkpoint */
+static int
 ruu_recover(int branch_index)			/* index of mis-pred branch */
 {
   int i, RUU_index = RUU_tail, LSQ_index = LSQ_tail;
   int RUU_prev_tail = RUU_tail, LSQ_prev_tail = LSQ_tail;
+  int n_walked = 0, walk = prf_size && RUU[branch_index].ckpt < 0;
 
   /* recover from the tail of the RUU towards the head until the branch index
      is reached, this direction ensures that the LSQ can be synchronized with
@@ -2321,6 +3860,9 @@ ruu_recover(int branch_index)			/* index of mis-pred branch */
 	    }
       
 	  /* squash this LSQ entry */
+	  lsq_leave(LSQ_index);
+	  if (prf_size)
+	    n_walked += prf_squash(&LSQ[LSQ_index], walk);
 	  LSQ[LSQ_index].tag++;
 
 	  /* indicate in pipetrace that this instruction was squashed */
@@ -2341,6 +3883,14 @@ ruu_recover(int branch_index)			/* index of mis-pred branch */
 	}
       
       /* squash this RUU entry */
+      if (prf_size)
+	n_walked += prf_squash(&RUU[RUU_index], walk);
+      if (!RUU[RUU_index].issued)
+	{
+	  smt_icount[smt_cur]--;
+	  if (iq_size)
+	    iq_num--;
+	}
       RUU[RUU_index].tag++;
 
       /* indicate in pipetrace that this instruction was squashed */
@@ -2355,6 +3905,8 @@ ruu_recover(int branch_index)			/* index of mis-pred branch */
   /* reset head/tail pointers to point to the mis-predicted branch */
   RUU_tail = RUU_prev_tail;
   LSQ_tail = LSQ_prev_tail;
+  if (lsq_sta_known > LSQ_num)
+    lsq_sta_known = LSQ_num;
 
   /* revert create vector back to last precise create vector state, NOTE:
      this is accomplished by resetting all the copied-on-write bits in the
@@ -2362,12 +3914,193 @@ ruu_recover(int branch_index)			/* index of mis-pred branch */
   BITMAP_CLEAR_MAP(use_spec_cv, CV_BMAP_SZ);
 
   /* FIXME: could reset functional units at squash time */
-}
 
+  if (!prf_size)
+    return 0;
 
-/*
- *  RUU_WRITEBACK() - instruction result writeback pipeline stage
- */
+  if (!walk)
+    {
+      /* the branch's checkpoint restores the rename map at once */
+      prf_restore(&RUU[branch_index]);
+      prf_ckpt_release(&RUU[branch_index]);
+      sim_prf_ckpt_recovers++;
+      return 0;
+    }
+
+  /* else, the map was rebuilt one entry at a time, -decode:width renames
+     per cycle */
+  sim_prf_walk_recovers++;
+  n_walked = (n_walked + ruu_decode_width - 1) / ruu_decode_width;
+  sim_prf_walk_cycles += n_walked;
+  return n_walked;
+}
+
+
+/*
+ *  MDP_RECOVER() - squash and replay after a memory ordering violation
+ */
+
+/* the oldest load found this cycle to have read memory ahead of an earlier
+   store to the same address, and that store's PC */
+static struct RS_link mdp_viol = RSLINK_NULL_DATA;
+static md_addr_t mdp_viol_st_PC;
+
+/* store ST has just resolved its address, look for a load that issued
+   ahead of it and should have received its value */
+static void
+mdp_check_violation(struct RUU_station *st)
+{
+  int index;
+  struct RUU_station *ld;
+
+  for (index = lsq_spec_head; index != LSQ_NIL; index = lsq_lnext[index])
+    {
+      ld = &LSQ[index];
+      if (ld->seq > st->seq
+	  && ld->addr == st->addr
+	  && lsq_store_match(ld, /* known_only */FALSE) == st
+	  && (!mdp_viol.rs || !RSLINK_VALID(&mdp_viol)
+	      || ld->seq < mdp_viol.rs->seq))
+	{
+	  RSLINK_INIT(mdp_viol, ld);
+	  mdp_viol_st_PC = st->PC;
+	}
+    }
+}
+
+/* make RS the creator of its outputs in the create vector it was
+   dispatched under, a completed RS leaves its values in the register file */
+static void
+cv_reinstall(struct RUU_station *rs)
+{
+  int i;
+  struct CV_link cv;
+
+  for (i=0; i<MAX_ODEPS; i++)
+    {
+      if (rs->onames[i] == NA)
+	continue;
+
+      if (rs->completed)
+	cv = CVLINK_NULL;
+      else
+	CVLINK_INIT(cv, rs, i);
+
+      if (rs->spec_mode)
+	{
+	  BITMAP_SET(use_spec_cv, CV_BMAP_SZ, rs->onames[i]);
+	  spec_create_vector[rs->onames[i]] = cv;
+	}
+      else
+	create_vector[rs->onames[i]] = cv;
+    }
+}
+
+/* recover from the violation recorded in MDP_VIOL: the violating load is
+   reset to re-execute and every later instruction is squashed with
+   ruu_recover(); since instruction results were computed at dispatch, the
+   squashed instructions are not re-fetched but saved in the replay buffer
+   and dispatched again once the front end would have refilled */
+static void
+mdp_recover(void)
+{
+  int i, n, ea_index, ruu_index, lsq_index, walk;
+  struct RUU_station *ld;
+  struct mdp_replay_rec *rec;
+
+  if (!mdp_viol.rs)
+    return;
+  ld = RSLINK_VALID(&mdp_viol) ? mdp_viol.rs : NULL;
+  mdp_viol = RSLINK_NULL;
+  if (!ld)
+    {
+      /* violating load was squashed by a branch mis-prediction */
+      return;
+    }
+
+  sim_mdp_violations++;
+  mdp_train(mdp_viol_st_PC, ld->PC);
+
+  /* locate the load's effective address computation, it is the Nth
+     ea_comp from the RUU tail, where N-1 LSQ entries follow the load */
+  n = LSQ_num - LSQ_POS(ld - LSQ);
+  for (ea_index = RUU_tail; ; )
+    {
+      ea_index = (ea_index + (RUU_size-1)) % RUU_size;
+      if (RUU[ea_index].ea_comp && --n == 0)
+	break;
+    }
+
+  /* save the instructions about to be squashed, youngest first, onto the
+     front of the replay buffer, any already there are younger still */
+  for (ruu_index = RUU_tail, lsq_index = LSQ_tail; ; )
+    {
+      ruu_index = (ruu_index + (RUU_size-1)) % RUU_size;
+      if (ruu_index == ea_index)
+	break;
+
+      if (replay_num == RUU_size)
+	panic("replay buffer overflow");
+      replay_head = (replay_head + (RUU_size-1)) & (RUU_size-1);
+      replay_num++;
+      sim_mdp_replays++;
+
+      rec = &replay_buf[replay_head];
+      rec->rs = RUU[ruu_index];
+
+      /* a branch that has already recovered must not do so again */
+      if (RUU[ruu_index].completed)
+	rec->rs.recover_inst = FALSE;
+      if (RUU[ruu_index].ea_comp)
+	{
+	  lsq_index = (lsq_index + (LSQ_size-1)) % LSQ_size;
+	  rec->lsq = LSQ[lsq_index];
+	}
+    }
+
+  /* squash everything after the load */
+  walk = ruu_recover(ea_index);
+
+  /* reset the load to re-execute, dropping any in-flight result */
+  for (i=0; i<MAX_ODEPS; i++)
+    {
+      RSLINK_FREE_LIST(ld->odep_list[i]);
+      ld->odep_list[i] = NULL;
+    }
+  ld->tag++;
+  ld->queued = ld->issued = ld->completed = FALSE;
+  lsq_unpend(ld - LSQ);
+  lsq_enter(ld - LSQ);
+
+  /* rebuild the create vector from the surviving instructions, in
+     program order, ruu_recover() only discards speculative state */
+  for (i=0; i < MD_TOTAL_REGS; i++)
+    {
+      create_vector[i] = CVLINK_NULL;
+      spec_create_vector[i] = CVLINK_NULL;
+    }
+  BITMAP_CLEAR_MAP(use_spec_cv, CV_BMAP_SZ);
+  for (i=0, ruu_index=RUU_head, lsq_index=LSQ_head;
+       i < RUU_num;
+       i++, ruu_index=(ruu_index + 1) % RUU_size)
+    {
+      cv_reinstall(&RUU[ruu_index]);
+      if (RUU[ruu_index].ea_comp)
+	{
+	  cv_reinstall(&LSQ[lsq_index]);
+	  lsq_index = (lsq_index + 1) % LSQ_size;
+	}
+    }
+
+  /* charge the same front end refill time as a branch mis-prediction,
+     plus any time taken to restore the rename map */
+  replay_ready = sim_cycle + ruu_branch_penalty + walk;
+}
+
+
+/*
+ *  RUU_WRITEBACK() - instruction result writeback pipeline stage
+ */
 
 /* forward declarations */
 static void tracer_recover(void);
@@ -2380,16 +4113,21 @@ static void tracer_recover(void);
 static void
 ruu_writeback(void)
 {
-  int i;
+  int i, walk;
   struct RUU_station *rs;
 
   /* service all completed events */
   while ((rs = eventq_next_event()))
     {
+      pipe_progress = TRUE;
+
       /* RS has completed execution and (possibly) produced a result */
       if (!OPERANDS_READY(rs) || rs->queued || !rs->issued || rs->completed)
 	panic("inst completed and !ready, !issued, or completed");
 
+      /* recovery and the create vector belong to RS's hardware context */
+      smt_switch(rs->thread);
+
       /* operation has completed */
       rs->completed = TRUE;
 
@@ -2400,16 +4138,25 @@ ruu_writeback(void)
 	    panic("mis-predicted load or store?!?!?");
 
 	  /* recover processor state and reinit fetch to correct path */
-	  ruu_recover(rs - RUU);
+	  walk = ruu_recover(rs - RUU);
 	  tracer_recover();
 	  bpred_recover(pred, rs->PC, rs->stack_recover_idx);
 
-	  /* stall fetch until I-fetch and I-decode recover */
-	  ruu_fetch_issue_delay = ruu_branch_penalty;
+	  /* instructions waiting to be replayed are on the wrong path */
+	  replay_num = 0;
+
+	  /* stall fetch until I-fetch and I-decode recover, and the rename
+	     map has been restored */
+	  ruu_fetch_issue_delay = ruu_branch_penalty + walk;
+	  fetch_delay_miss = FALSE;
 
 	  /* continue writeback of the branch/control instruction */
 	}
 
+      /* a resolved branch no longer needs its rename map checkpoint */
+      if (prf_size)
+	prf_ckpt_release(rs);
+
       /* if we speculatively update branch-predictor, do it here */
       if (pred
 	  && bpred_spec_update == spec_WB
@@ -2485,6 +4232,14 @@ ruu_writeback(void)
 		      /* input is now ready */
 		      olink->rs->idep_ready[olink->x.opnum] = TRUE;
 
+		      /* a store address resolving may reveal a load that
+			 issued ahead of it */
+		      if (mdp_type == mdp_storeset
+			  && olink->rs->in_LSQ
+			  && olink->x.opnum == STORE_ADDR_INDEX
+			  && LSQ_IS_STORE(olink->rs))
+			mdp_check_violation(olink->rs);
+
 		      /* are all the register operands of target ready? */
 		      if (OPERANDS_READY(olink->rs))
 			{
@@ -2514,6 +4269,8 @@ ruu_writeback(void)
 
    } /* for all writeback events */
 
+  /* squash and replay from a load that read memory too early, if any */
+  mdp_recover();
 }
 
 
@@ -2522,76 +4279,92 @@ ruu_writeback(void)
  */
 
 /* this function locates ready instructions whose memory dependencies have
-   been satisfied, this is accomplished by walking the LSQ for loads, looking
-   for blocking memory dependency condition (e.g., earlier store with an
-   unknown address) */
-#define MAX_STD_UNKNOWNS		64
+   been satisfied, a load may issue once the nearest earlier store to the
+   same address, if its address is known, has its data (STD) ready; the
+   conservative policy further holds loads until no earlier store has an
+   unknown address (STA unknown), the store set policy instead holds a load
+   only on the store its store set predicts it depends on; rather than
+   rescanning the LSQ, only the loads on the pending list are examined, and
+   the nearest earlier store is found through the store hash */
 static void
 lsq_refresh(void)
 {
-  int i, j, index, n_std_unknowns;
-  md_addr_t std_unknowns[MAX_STD_UNKNOWNS];
-
-  /* scan entire queue for ready loads: scan from oldest instruction
-     (head) until we reach the tail or an unresolved store, after which no
-     other instruction will become ready */
-  for (i=0, index=LSQ_head, n_std_unknowns=0;
-       i < LSQ_num;
-       i++, index=(index + 1) % LSQ_size)
-    {
-      /* terminate search for ready loads after first unresolved store,
-	 as no later load could be resolved in its presence */
-      if (/* store? */
-	  (MD_OP_FLAGS(LSQ[index].op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE))
-	{
-	  if (!STORE_ADDR_READY(&LSQ[index]))
-	    {
-	      /* FIXME: a later STD + STD known could hide the STA unknown */
-	      /* sta unknown, blocks all later loads, stop search */
-	      break;
-	    }
-	  else if (!OPERANDS_READY(&LSQ[index]))
-	    {
-	      /* sta known, but std unknown, may block a later store, record
-		 this address for later referral, we use an array here because
-		 for most simulations the number of entries to search will be
-		 very small */
-	      if (n_std_unknowns == MAX_STD_UNKNOWNS)
-		fatal("STD unknown array overflow, increase MAX_STD_UNKNOWNS");
-	      std_unknowns[n_std_unknowns++] = LSQ[index].addr;
-	    }
-	  else /* STORE_ADDR_READY() && OPERANDS_READY() */
-	    {
-	      /* a later STD known hides an earlier STD unknown */
-	      for (j=0; j<n_std_unknowns; j++)
-		{
-		  if (std_unknowns[j] == /* STA/STD known */LSQ[index].addr)
-		    std_unknowns[j] = /* bogus addr */0;
-		}
-	    }
-	}
+  int index, next;
+  struct RUU_station *rs, *st;
+
+  /* advance the STA known boundary past resolved entries, it only moves
+     toward the tail until the LSQ drains or is squashed */
+  while (lsq_sta_known < LSQ_num)
+    {
+      index = (LSQ_head + lsq_sta_known) % LSQ_size;
+      rs = &LSQ[index];
+
+      /* FIXME: a later STD + STD known could hide the STA unknown */
+      /* sta unknown, blocks all later loads, stop here */
+      if (LSQ_IS_STORE(rs) && !STORE_ADDR_READY(rs))
+	break;
+
+      /* a speculatively issued load can no longer be violated */
+      if (lsq_lstate[index] == LSQ_LD_SPEC)
+	lsq_unpend(index);
+      lsq_sta_known++;
+      pipe_progress = TRUE;
+    }
+
+  if (mdp_type == mdp_storeset
+      && mdp_clear_interval && sim_cycle >= mdp_next_clear)
+    {
+      /* periodically forget store sets, clearing out false dependences */
+      for (index=0; index<mdp_ssit_size; index++)
+	mdp_ssit[index] = LSQ_NIL;
+      mdp_next_clear = sim_cycle + mdp_clear_interval;
+      pipe_progress = TRUE;
+    }
+
+  /* scan pending loads in program order */
+  for (index = lsq_pend_head; index != LSQ_NIL; index = next)
+    {
+      next = lsq_lnext[index];
 
-      if (/* load? */
-	  ((MD_OP_FLAGS(LSQ[index].op) & (F_MEM|F_LOAD)) == (F_MEM|F_LOAD))
-	  && /* queued? */!LSQ[index].queued
-	  && /* waiting? */!LSQ[index].issued
-	  && /* completed? */!LSQ[index].completed
-	  && /* regs ready? */OPERANDS_READY(&LSQ[index]))
+      /* conservatively, no load after the first STA unknown may issue */
+      if (mdp_type == mdp_conservative && LSQ_POS(index) >= lsq_sta_known)
+	break;
+
+      rs = &LSQ[index];
+      if (/* regs ready? */!OPERANDS_READY(rs))
+	continue;
+
+      /* hold the load until its predicted store has executed */
+      if (mdp_type == mdp_storeset && lsq_sdep[index] != LSQ_NIL)
 	{
-	  /* no STA unknown conflict (because we got to this check), check for
-	     a STD unknown conflict */
-	  for (j=0; j<n_std_unknowns; j++)
-	    {
-	      /* found a relevant STD unknown? */
-	      if (std_unknowns[j] == LSQ[index].addr)
-		break;
-	    }
-	  if (j == n_std_unknowns)
+	  int dep = lsq_sdep[index];
+
+	  if (LSQ_STORE_WAITING(dep, lsq_sdep_seq[index]))
 	    {
-	      /* no STA or STD unknown conflicts, put load on ready queue */
-	      readyq_enqueue(&LSQ[index]);
+	      if (!lsq_sdep_waited[index])
+		pipe_progress = TRUE;
+	      lsq_sdep_waited[index] = TRUE;
+	      continue;
 	    }
+	  if (lsq_sdep_waited[index]
+	      && LSQ[dep].seq == lsq_sdep_seq[index]
+	      && LSQ[dep].addr != rs->addr)
+	    sim_mdp_false_deps++;
+	  lsq_sdep[index] = LSQ_NIL;
+	  pipe_progress = TRUE;
 	}
+
+      /* check for a STD unknown conflict, a later STD known hides an
+	 earlier STD unknown so only the nearest earlier store (with a
+	 known address) to this address counts */
+      st = lsq_store_match(rs, /* known_only */TRUE);
+      if (st && !OPERANDS_READY(st))
+	continue;
+
+      /* no STA or STD unknown conflicts, put load on ready queue */
+      lsq_unpend(index);
+      readyq_enqueue(rs);
+      pipe_progress = TRUE;
     }
 }
 
@@ -2610,29 +4383,19 @@ lsq_refresh(void)
 static void
 ruu_issue(void)
 {
-  int i, load_lat, tlb_lat, n_issued;
-  struct RS_link *node, *next_node;
+  int load_lat, tlb_lat, n_issued;
+  struct RS_link *node, *retry = NULL;
   struct res_template *fu;
 
-  /* FIXME: could be a little more efficient when scanning the ready queue */
-
-  /* copy and then blow away the ready list, NOTE: the ready list is
-     always totally reclaimed each cycle, and instructions that are not
-     issue are explicitly reinserted into the ready instruction queue,
-     this management strategy ensures that the ready instruction queue
-     is always properly sorted */
-  node = ready_queue;
-  ready_queue = NULL;
-
-  /* visit all ready instructions (i.e., insts whose register input
-     dependencies have been satisfied, stop issue when no more instructions
-     are available or issue bandwidth is exhausted */
+  /* visit ready instructions (i.e., insts whose register input dependencies
+     have been satisfied) in priority order, stop issue when no more
+     instructions are available or issue bandwidth is exhausted, the ones
+     not visited stay queued */
+  readyq_scan_start();
   for (n_issued=0;
-       node && n_issued < ruu_issue_width;
-       node = next_node)
+       n_issued < ruu_issue_width && (node = readyq_dequeue()) != NULL;
+       /* nada */)
     {
-      next_node = node->next;
-
       /* still valid? */
       if (RSLINK_VALID(node))
 	{
@@ -2669,14 +4432,38 @@ ruu_issue(void)
 	    }
 	  else
 	    {
+	      /* loads probe their own context's LSQ and address space */
+	      if (rs->in_LSQ)
+		smt_switch(rs->thread);
+
 	      /* issue the instruction to a functional unit */
 	      if (MD_OP_FUCLASS(rs->op) != NA)
 		{
-		  fu = res_get(fu_pool, MD_OP_FUCLASS(rs->op));
+		  /* a load that would miss with all the D-cache MSHRs busy
+		     waits in the ready queue, NOTE: loads that would be
+		     forwarded from the LSQ are (conservatively) held too */
+		  if (cache_dl1 && rs->in_LSQ
+		      && ((MD_OP_FLAGS(rs->op) & (F_MEM|F_LOAD))
+			  == (F_MEM|F_LOAD))
+		      && MD_VALID_ADDR(rs->addr)
+		      && !cache_mshr_avail(cache_dl1, SMT_ADDR(rs->addr & ~3),
+					   sim_cycle))
+		    {
+		      sim_mshr_stalls++;
+		      fu = NULL;
+		    }
+		  else
+		    fu = res_get(fu_pool, MD_OP_FUCLASS(rs->op));
 		  if (fu)
 		    {
 		      /* got one! issue inst to functional unit */
 		      rs->issued = TRUE;
+		      if (!rs->in_LSQ)
+			{
+			  smt_icount[rs->thread]--;
+			  if (iq_size)
+			    iq_num--;
+			}
 		      /* reserve the functional unit */
 		      if (fu->master->busy)
 			panic("functional unit already in use");
@@ -2692,30 +4479,26 @@ ruu_issue(void)
 			  int events = 0;
 
 			  /* for loads, determine cache access latency:
-			     first scan LSQ to see if a store forward is
-			     possible, if not, access the data cache */
+			     first probe the LSQ store hash to see if a store
+			     forward is possible, if not, access the data
+			     cache */
 			  load_lat = 0;
-			  i = (rs - LSQ);
-			  if (i != LSQ_head)
+			  if (lsq_store_match(rs, /* known_only */TRUE))
 			    {
-			      for (;;)
-				{
-				  /* go to next earlier LSQ entry */
-				  i = (i + (LSQ_size-1)) % LSQ_size;
-
-				  /* FIXME: not dealing with partials! */
-				  if ((MD_OP_FLAGS(LSQ[i].op) & F_STORE)
-				      && (LSQ[i].addr == rs->addr))
-				    {
-				      /* hit in the LSQ */
-				      load_lat = 1;
-				      break;
-				    }
-
-				  /* scan finished? */
-				  if (i == LSQ_head)
-				    break;
-				}
+			      /* hit in the LSQ */
+			      load_lat = 1;
+			    }
+
+			  /* a load issued ahead of an unresolved store
+			     address waits on the speculative load list for
+			     the address to resolve */
+			  if (mdp_type == mdp_storeset
+			      && LSQ_POS(rs - LSQ) >= lsq_sta_known)
+			    {
+			      sim_mdp_spec_loads++;
+			      lsq_lstate[rs - LSQ] = LSQ_LD_SPEC;
+			      lsq_list_append(rs - LSQ, &lsq_spec_head,
+					      &lsq_spec_tail);
 			    }
 
 			  /* was the value store forwared from the LSQ? */
@@ -2730,10 +4513,11 @@ ruu_issue(void)
 			      if (cache_dl1 && valid_addr)
 				{
 				  /* access the cache if non-faulting */
+				  cache_access_PC = rs->PC;
 				  load_lat =
 				    cache_access(cache_dl1, Read,
-						 (rs->addr & ~3), NULL, 4,
-						 sim_cycle, NULL, NULL);
+						 SMT_ADDR(rs->addr & ~3), NULL, 4,
+						 sim_cycle, NULL, NULL, 0);
 				  if (load_lat > cache_dl1_lat)
 				    events |= PEV_CACHEMISS;
 				}
@@ -2750,8 +4534,8 @@ ruu_issue(void)
 			      /* access the D-DLB, NOTE: this code will
 				 initiate speculative TLB misses */
 			      tlb_lat =
-				cache_access(dtlb, Read, (rs->addr & ~3),
-					     NULL, 4, sim_cycle, NULL, NULL);
+				cache_access(dtlb, Read, SMT_ADDR(rs->addr & ~3),
+					     NULL, 4, sim_cycle, NULL, NULL, 0);
 			      if (tlb_lat > 1)
 				events |= PEV_TLBMISS;
 
@@ -2780,19 +4564,36 @@ ruu_issue(void)
 		      /* one more inst issued */
 		      n_issued++;
 		    }
-		  else /* no functional unit */
+		  else if (issue_select == issue_select_list)
 		    {
 		      /* insufficient functional unit resources, put operation
 			 back onto the ready list, we'll try to issue it
 			 again next cycle */
 		      readyq_enqueue(rs);
 		    }
+		  else /* no functional unit */
+		    {
+		      /* insufficient functional unit resources, put operation
+			 back onto the ready queue once this cycle's issue is
+			 done, we'll try to issue it again next cycle */
+		      struct RS_link *link;
+
+		      RSLINK_NEW(link, rs);
+		      link->next = retry;
+		      retry = link;
+		    }
 		}
 	      else /* does not require a functional unit! */
 		{
 		  /* FIXME: need better solution for these */
 		  /* the instruction does not need a functional unit */
 		  rs->issued = TRUE;
+		  if (!rs->in_LSQ)
+		    {
+		      smt_icount[rs->thread]--;
+		      if (iq_size)
+			iq_num--;
+		    }
 
 		  /* schedule a result event */
 		  eventq_queue_event(rs, sim_cycle + 1);
@@ -2807,39 +4608,30 @@ ruu_issue(void)
 	    } /* !store */
 
 	}
-      /* else, RUU entry was squashed */
+      else
+	{
+	  /* RUU entry was squashed, it leaves the ready queue */
+	  pipe_progress = TRUE;
+	}
 
       /* reclaim ready list entry, NOTE: this is done whether or not the
-         instruction issued, since the instruction was once again reinserted
-         into the ready queue if it did not issue, this ensures that the ready
-         queue is always properly sorted */
+         instruction issued, an instruction that did not issue is put back
+         into the ready queue below */
       RSLINK_FREE(node);
     }
 
-  /* put any instruction not issued back into the ready queue, go through
-     normal channels to ensure instruction stay ordered correctly */
-  for (; node; node = next_node)
-    {
-      next_node = node->next;
-
-      /* still valid? */
-      if (RSLINK_VALID(node))
-        {
-	  struct RUU_station *rs = RSLINK_RS(node);
-
-          /* node is now un-queued */
-          rs->queued = FALSE;
+  if (n_issued)
+    pipe_progress = TRUE;
 
-	  /* not issued, put operation back onto the ready list, we'll try to
-	     issue it again next cycle */
-          readyq_enqueue(rs);
-        }
-      /* else, RUU entry was squashed */
+  /* put any instruction not visited back into the ready list */
+  readyq_scan_end();
 
-      /* reclaim ready list entry, NOTE: this is done whether or not the
-         instruction issued, since the instruction was once again reinserted
-         into the ready queue if it did not issue, this ensures that the ready
-         queue is always properly sorted */
+  /* put the instructions that found no functional unit back into the ready
+     queue, they were valid when they were visited this cycle */
+  for (node = retry; node; node = retry)
+    {
+      retry = node->next;
+      readyq_enqueue(RSLINK_RS(node));
       RSLINK_FREE(node);
     }
 }
@@ -2949,6 +4741,35 @@ static struct fetch_rec *fetch_data;	/* IFETCH -> DISPATCH inst queue */
 static int fetch_num;			/* num entries in IF -> DIS queue */
 static int fetch_tail, fetch_head;	/* head and tail pointers of queue */
 
+/* fetch target queue (FTQ) definition, a fetch block is a run of up to
+   FTQ_BLOCK insts on the predicted path, ending at a predicted taken
+   branch, with the prediction made for each of its insts */
+struct ftq_pred {
+  md_addr_t pred_PC;			/* predicted next PC */
+  struct bpred_update_t dir_update;	/* bpred direction update info */
+  int stack_recover_idx;		/* branch predictor RSB index */
+};
+struct ftq_ent {
+  md_addr_t start_PC;			/* first inst of the block */
+  int ninsts;				/* insts in the block */
+  int nfetched;				/* insts fetched so far */
+  int prefetched;			/* I-cache lines prefetched? */
+  struct ftq_pred *preds;		/* per inst predictions */
+};
+static struct ftq_ent *ftq;		/* predictor -> IFETCH block queue */
+static int ftq_num;			/* num entries in the FTQ */
+static int ftq_head;			/* head of the FTQ */
+static md_addr_t bpu_PC;		/* next PC the predictor works on */
+
+/* empty the FTQ, and restart the branch predictor at PC */
+static void
+ftq_flush(md_addr_t PC)			/* new predicted path */
+{
+  ftq_num = 0;
+  ftq_head = 0;
+  bpu_PC = PC;
+}
+
 /* recover instruction trace generator state to precise state state immediately
    before the first mis-predicted branch; this is accomplished by resetting
    all register value copied-on-write bitmasks are reset, and the speculative
@@ -3003,6 +4824,8 @@ tracer_recover(void)
   fetch_num = 0;
   fetch_tail = fetch_head = 0;
   fetch_pred_PC = fetch_regs_PC = recover_PC;
+  if (ftq_size)
+    ftq_flush(recover_PC);
 }
 
 /* initialize the speculative instruction state generator state */
@@ -3288,6 +5111,9 @@ ruu_link_idep(struct RUU_station *rs,		/* rs station to link */
   struct CV_link head;
   struct RS_link *link;
 
+  /* record input name, used to relink the operation if it is replayed */
+  rs->inames[idep_num] = idep_name;
+
   /* any dependence? */
   if (idep_name == NA)
     {
@@ -3571,7 +5397,9 @@ ruu_install_odep(struct RUU_station *rs,	/* creating RUU station */
 #define SYSCALL(INST)							\
   (/* only execute system calls in non-speculative mode */		\
    (spec_mode ? panic("speculative syscall") : (void) 0),		\
-   sys_syscall(&regs, mem_access, mem, INST, TRUE))
+   (smt_nthreads > 1							\
+    ? smt_syscall(INST)							\
+    : sys_syscall(&regs, mem_access, mem, INST, TRUE)))
 
 /* default register state accessor, used by DLite */
 static char *					/* err str, NULL for no err */
@@ -3694,11 +5522,153 @@ simoo_reg_obj(struct regs_t *xregs,		/* registers to access */
    implementing in-order issue */
 static struct RS_link last_op = RSLINK_NULL_DATA;
 
+/* rename the results of RS onto free physical registers, and give a
+   conditional or indirect branch a rename map checkpoint if one is free,
+   the caller has made sure enough registers are free */
+static void
+prf_rename(struct RUU_station *rs)
+{
+  int i;
+  struct prf_ckpt *ckpt;
+
+  for (i=0; i<MAX_ODEPS; i++)
+    {
+      rs->pdst[i] = -1;
+
+      /* the effective address temporary is not held in the register file */
+      if (rs->onames[i] == NA || rs->onames[i] == DTMP)
+	continue;
+
+      if (!prf_free_num)
+	panic("physical register file exhausted");
+      rs->pdst[i] = prf_free[prf_free_head];
+      prf_free_head = (prf_free_head + 1) % prf_size;
+      prf_free_num--;
+      rs->pprev[i] = prf_map[rs->onames[i]];
+      prf_map[rs->onames[i]] = rs->pdst[i];
+    }
+
+  rs->ckpt = -1;
+  if (!rs->in_LSQ && (MD_OP_FLAGS(rs->op) & (F_COND|F_INDIRJMP)))
+    {
+      if (prf_ckpt_nfree)
+	{
+	  rs->ckpt = prf_ckpt_free[--prf_ckpt_nfree];
+	  ckpt = &prf_ckpts[rs->ckpt];
+	  memcpy(ckpt->map, prf_map, sizeof(prf_map));
+	  ckpt->free_head = prf_free_head;
+	}
+      else
+	sim_prf_ckpt_misses++;
+    }
+}
+
+/* dispatch instructions from the replay buffer (see mdp_recover()): these
+   were executed when first dispatched, so only their RUU/LSQ entries and
+   dependence chains are rebuilt; returns the number of insts dispatched */
+static int
+ruu_replay(void)
+{
+  int i, n_dispatched = 0, saved_spec_mode = spec_mode;
+  struct mdp_replay_rec *rec;
+  struct RUU_station *rs, *lsq;
+  INST_TAG_TYPE tag;
+
+  while (/* instructions to replay? */replay_num > 0
+	 /* front end refilled? */
+	 && sim_cycle >= replay_ready
+	 /* instruction decode B/W left? */
+	 && n_dispatched < (ruu_decode_width * fetch_speed)
+	 /* RUU and LSQ not full? */
+	 && RUU_num < RUU_size && LSQ_num < LSQ_size
+	 /* physical registers and issue queue entry available? */
+	 && (!prf_size || prf_free_num >= MAX_ODEPS)
+	 && (!iq_size || iq_num < iq_size)
+	 /* on an acceptable trace path */
+	 && (ruu_include_spec || !replay_buf[replay_head].rs.spec_mode))
+    {
+      rec = &replay_buf[replay_head];
+      replay_head = (replay_head + 1) & (RUU_size-1);
+      replay_num--;
+
+      /* install the outputs in the create vector the instruction was
+	 originally dispatched under */
+      spec_mode = rec->rs.spec_mode;
+
+      /* refill the RUU reservation station, keeping its slot tag */
+      rs = &RUU[RUU_tail];
+      tag = rs->tag;
+      *rs = rec->rs;
+      rs->tag = tag;
+      rs->seq = ++inst_seq;
+      rs->queued = rs->issued = rs->completed = FALSE;
+      rs->ptrace_seq = ptrace_seq++;
+      ptrace_newinst(rs->ptrace_seq, rs->IR, rs->PC, 0);
+      ptrace_newstage(rs->ptrace_seq, PST_DISPATCH, 0);
+
+      for (i=0; i<MAX_IDEPS; i++)
+	ruu_link_idep(rs, i, rec->rs.inames[i]);
+      for (i=0; i<MAX_ODEPS; i++)
+	{
+	  rs->odep_list[i] = NULL;
+	  ruu_install_odep(rs, i, rec->rs.onames[i]);
+	}
+      if (prf_size)
+	prf_rename(rs);
+
+      if (rs->ea_comp)
+	{
+	  /* and the LSQ station of the memory access */
+	  lsq = &LSQ[LSQ_tail];
+	  tag = lsq->tag;
+	  *lsq = rec->lsq;
+	  lsq->tag = tag;
+	  lsq->seq = ++inst_seq;
+	  lsq->queued = lsq->issued = lsq->completed = FALSE;
+	  lsq->ptrace_seq = ptrace_seq++;
+	  ptrace_newuop(lsq->ptrace_seq, "internal ld/st", lsq->PC, 0);
+	  ptrace_newstage(lsq->ptrace_seq, PST_DISPATCH, 0);
+
+	  for (i=0; i<MAX_IDEPS; i++)
+	    ruu_link_idep(lsq, i, rec->lsq.inames[i]);
+	  for (i=0; i<MAX_ODEPS; i++)
+	    {
+	      lsq->odep_list[i] = NULL;
+	      ruu_install_odep(lsq, i, rec->lsq.onames[i]);
+	    }
+	  if (prf_size)
+	    prf_rename(lsq);
+
+	  lsq_enter(LSQ_tail);
+	  LSQ_tail = (LSQ_tail + 1) % LSQ_size;
+	  LSQ_num++;
+	}
+
+      n_dispatched++;
+      RUU_tail = (RUU_tail + 1) % RUU_size;
+      RUU_num++;
+      smt_icount[smt_cur]++;
+      if (iq_size)
+	iq_num++;
+
+      if (OPERANDS_READY(rs))
+	readyq_enqueue(rs);
+    }
+
+  spec_mode = saved_spec_mode;
+  return n_dispatched;
+}
+
+/* RUU and LSQ entries held by the hardware contexts not dispatching, these
+   share the RUU_size and LSQ_size capacity with the one that is */
+static int smt_ruu_others, smt_lsq_others;
+
 /* dispatch instructions from the IFETCH -> DISPATCH queue: instructions are
    first decoded, then they allocated RUU (and LSQ for load/stores) resources
-   and input and output dependence chains are updated accordingly */
-static void
-ruu_dispatch(void)
+   and input and output dependence chains are updated accordingly, at most
+   WIDTH instructions are dispatched, returns the number dispatched */
+static int
+ruu_dispatch(int width)				/* decode B/W left */
 {
   int i;
   int n_dispatched;			/* total insts dispatched */
@@ -3725,13 +5695,23 @@ ruu_dispatch(void)
   enum md_fault_type fault;
 
   made_check = FALSE;
-  n_dispatched = 0;
+
+  /* instructions squashed by a memory ordering violation go first, they
+     are older than anything in the fetch queue, NOTE: while any remain the
+     RUU and replay buffer together hold at most RUU_size instructions */
+  n_dispatched = replay_num ? ruu_replay() : 0;
+
   while (/* instruction decode B/W left? */
-	 n_dispatched < (ruu_decode_width * fetch_speed)
+	 n_dispatched < width
 	 /* RUU and LSQ not full? */
-	 && RUU_num < RUU_size && LSQ_num < LSQ_size
+	 && RUU_num + smt_ruu_others < RUU_size
+	 && LSQ_num + smt_lsq_others < LSQ_size
 	 /* insts still available from fetch unit? */
 	 && fetch_num != 0
+	 /* program has not exited? */
+	 && !smt_done[smt_cur]
+	 /* no older instructions waiting to be replayed? */
+	 && !replay_num
 	 /* on an acceptable trace path */
 	 && (ruu_include_spec || !spec_mode))
     {
@@ -3744,6 +5724,19 @@ ruu_dispatch(void)
 	  break;
 	}
 
+      /* stall while the physical register file or issue queue is full,
+	 NOTE: no instruction renames more than MAX_ODEPS results */
+      if (prf_size && prf_free_num < MAX_ODEPS)
+	{
+	  sim_prf_full_stalls++;
+	  break;
+	}
+      if (iq_size && iq_num >= iq_size)
+	{
+	  sim_iq_full_stalls++;
+	  break;
+	}
+
       /* get the next instruction from the IFETCH -> DISPATCH queue */
       inst = fetch_data[fetch_head].IR;
       regs.regs_PC = fetch_data[fetch_head].regs_PC;
@@ -3780,6 +5773,7 @@ ruu_dispatch(void)
 	{
 	  /* one more non-speculative instruction executed */
 	  sim_num_insn++;
+	  smt_num_insn[smt_cur]++;
 	}
 
       /* default effective address (none) and access */
@@ -3889,7 +5883,12 @@ ruu_dispatch(void)
 	  fetch_tail = 0;
 
 	  if (!pred_perfect)
-	    ruu_fetch_issue_delay = ruu_branch_penalty;
+	    {
+	      ruu_fetch_issue_delay = ruu_branch_penalty;
+	      fetch_delay_miss = FALSE;
+	    }
+	  if (ftq_size)
+	    ftq_flush(regs.regs_NPC);
 
 	  fetch_redirected = TRUE;
 	}
@@ -3930,6 +5929,7 @@ ruu_dispatch(void)
 	  rs->seq = ++inst_seq;
 	  rs->queued = rs->issued = rs->completed = FALSE;
 	  rs->ptrace_seq = pseq;
+	  rs->thread = smt_cur;
 
 	  /* split ld/st's into two operations: eff addr comp + mem access */
 	  if (MD_OP_FLAGS(op) & F_MEM)
@@ -3957,6 +5957,7 @@ ruu_dispatch(void)
 	      lsq->seq = ++inst_seq;
 	      lsq->queued = lsq->issued = lsq->completed = FALSE;
 	      lsq->ptrace_seq = ptrace_seq++;
+	      lsq->thread = smt_cur;
 
 	      /* pipetrace this uop */
 	      ptrace_newuop(lsq->ptrace_seq, "internal ld/st", lsq->PC, 0);
@@ -3984,10 +5985,21 @@ ruu_dispatch(void)
 	      ruu_install_odep(lsq, /* odep_list[] index */0, out1);
 	      ruu_install_odep(lsq, /* odep_list[] index */1, out2);
 
+	      /* rename results onto physical registers */
+	      if (prf_size)
+		{
+		  prf_rename(rs);
+		  prf_rename(lsq);
+		}
+
 	      /* install operation in the RUU and LSQ */
 	      n_dispatched++;
+	      lsq_enter(LSQ_tail);
 	      RUU_tail = (RUU_tail + 1) % RUU_size;
 	      RUU_num++;
+	      smt_icount[smt_cur]++;
+	      if (iq_size)
+		iq_num++;
 	      LSQ_tail = (LSQ_tail + 1) % LSQ_size;
 	      LSQ_num++;
 
@@ -4019,10 +6031,17 @@ ruu_dispatch(void)
 	      ruu_install_odep(rs, /* odep_list[] index */0, out1);
 	      ruu_install_odep(rs, /* odep_list[] index */1, out2);
 
+	      /* rename results onto physical registers */
+	      if (prf_size)
+		prf_rename(rs);
+
 	      /* install operation in the RUU */
 	      n_dispatched++;
 	      RUU_tail = (RUU_tail + 1) % RUU_size;
 	      RUU_num++;
+	      smt_icount[smt_cur]++;
+	      if (iq_size)
+		iq_num++;
 
 	      /* issue op if all its reg operands are ready (no mem input) */
 	      if (OPERANDS_READY(rs))
@@ -4132,6 +6151,10 @@ ruu_dispatch(void)
 			    addr, sim_num_insn, sim_cycle))
 	dlite_main(regs.regs_PC, /* no next PC */0, sim_cycle, &regs, mem);
     }
+
+  if (n_dispatched)
+    pipe_progress = TRUE;
+  return n_dispatched;
 }
 
 
@@ -4153,6 +6176,24 @@ fetch_init(void)
   fetch_tail = fetch_head = 0;
   IFQ_count = 0;
   IFQ_fcount = 0;
+
+  /* allocate the fetch target queue */
+  if (ftq_size)
+    {
+      int i;
+
+      ftq = (struct ftq_ent *)calloc(ftq_size, sizeof(struct ftq_ent));
+      if (!ftq)
+	fatal("out of virtual memory");
+      for (i=0; i < ftq_size; i++)
+	{
+	  ftq[i].preds =
+	    (struct ftq_pred *)calloc(ftq_block, sizeof(struct ftq_pred));
+	  if (!ftq[i].preds)
+	    fatal("out of virtual memory");
+	}
+      ftq_flush(0);
+    }
 }
 
 /* dump contents of fetch stage registers and fetch queue */
@@ -4195,147 +6236,750 @@ fetch_dump(FILE *stream)			/* output stream */
 static int last_inst_missed = FALSE;
 static int last_inst_tmissed = FALSE;
 
-/* fetch up as many instruction as one branch prediction and one cache line
-   acess will support without overflowing the IFETCH -> DISPATCH QUEUE */
-static void
-ruu_fetch(void)
+/* address of the last instruction fetch that missed, with SMT another
+   context can evict the line before it is fetched again, the refetch then
+   takes the instruction the fill delivered, so fetch cannot livelock */
+static md_addr_t fetch_miss_PC = 0;
+
+/* is PC a valid text address? (bogus ones can occur on the mis-spec path) */
+#define FETCH_TEXT_OK(PC)						\
+  (ld_text_base <= (PC) && (PC) < (ld_text_base+ld_text_size)		\
+   && !((PC) & (sizeof(md_inst_t)-1)))
+
+/* read the instruction at FETCH_REGS_PC into INSTP, accessing the I-cache
+   and I-TLB, returns FALSE and blocks fetch if the access missed */
+static int
+fetch_icache(md_inst_t *instp)			/* fetched inst */
 {
-  int i, lat, tlb_lat, done = FALSE;
+  int lat, tlb_lat;
   md_inst_t inst;
-  int stack_recover_idx;
-  int branch_cnt;
 
-  for (i=0, branch_cnt=0;
-       /* fetch up to as many instruction as the DISPATCH stage can decode */
-       i < (ruu_decode_width * fetch_speed)
-       /* fetch until IFETCH -> DISPATCH queue fills */
-       && fetch_num < ruu_ifq_size
-       /* and no IFETCH blocking condition encountered */
-       && !done;
-       i++)
+  /* is this a bogus text address? (can happen on mis-spec path) */
+  if (!FETCH_TEXT_OK(fetch_regs_PC))
     {
-      /* fetch an instruction at the next predicted fetch address */
-      fetch_regs_PC = fetch_pred_PC;
-
-      /* is this a bogus text address? (can happen on mis-spec path) */
-      if (ld_text_base <= fetch_regs_PC
-	  && fetch_regs_PC < (ld_text_base+ld_text_size)
-	  && !(fetch_regs_PC & (sizeof(md_inst_t)-1)))
-	{
-	  /* read instruction from memory */
-	  MD_FETCH_INST(inst, mem, fetch_regs_PC);
+      /* fetch PC is bogus, send a NOP down the pipeline */
+      *instp = MD_NOP_INST;
+      return TRUE;
+    }
 
-	  /* address is within program text, read instruction from memory */
-	  lat = cache_il1_lat;
-	  if (cache_il1)
-	    {
-	      /* access the I-cache */
-	      lat =
-		cache_access(cache_il1, Read, IACOMPRESS(fetch_regs_PC),
-			     NULL, ISCOMPRESS(sizeof(md_inst_t)), sim_cycle,
-			     NULL, NULL);
-	      if (lat > cache_il1_lat)
-		last_inst_missed = TRUE;
-	    }
+  /* read the pre-decoded instruction */
+  inst = PREDEC_LOOKUP(predec, fetch_regs_PC)->inst;
 
-	  if (itlb)
-	    {
-	      /* access the I-TLB, NOTE: this code will initiate
-		 speculative TLB misses */
-	      tlb_lat =
-		cache_access(itlb, Read, IACOMPRESS(fetch_regs_PC),
-			     NULL, ISCOMPRESS(sizeof(md_inst_t)), sim_cycle,
-			     NULL, NULL);
-	      if (tlb_lat > 1)
-		last_inst_tmissed = TRUE;
-
-	      /* I-cache/I-TLB accesses occur in parallel */
-	      lat = MAX(tlb_lat, lat);
-	    }
+  /* address is within program text, read instruction from memory */
+  lat = cache_il1_lat;
+  if (cache_il1)
+    {
+      /* access the I-cache */
+      cache_access_PC = fetch_regs_PC;
+      lat =
+	cache_access(cache_il1, Read,
+		     SMT_ADDR(IACOMPRESS(fetch_regs_PC)),
+		     NULL, ISCOMPRESS(sizeof(md_inst_t)), sim_cycle,
+		     NULL, NULL, 0);
+      if (lat > cache_il1_lat)
+	last_inst_missed = TRUE;
+    }
 
-	  /* I-cache/I-TLB miss? assumes I-cache hit >= I-TLB hit */
-	  if (lat != cache_il1_lat)
-	    {
-	      /* I-cache miss, block fetch until it is resolved */
-	      ruu_fetch_issue_delay += lat - 1;
-	      break;
-	    }
-	  /* else, I-cache/I-TLB hit */
-	}
-      else
-	{
-	  /* fetch PC is bogus, send a NOP down the pipeline */
-	  inst = MD_NOP_INST;
-	}
+  if (itlb)
+    {
+      /* access the I-TLB, NOTE: this code will initiate
+	 speculative TLB misses */
+      tlb_lat =
+	cache_access(itlb, Read,
+		     SMT_ADDR(IACOMPRESS(fetch_regs_PC)),
+		     NULL, ISCOMPRESS(sizeof(md_inst_t)), sim_cycle,
+		     NULL, NULL, 0);
+      if (tlb_lat > 1)
+	last_inst_tmissed = TRUE;
+
+      /* I-cache/I-TLB accesses occur in parallel */
+      lat = MAX(tlb_lat, lat);
+    }
 
-      /* have a valid inst, here */
+  /* I-cache/I-TLB miss? assumes I-cache hit >= I-TLB hit */
+  if (lat != cache_il1_lat
+      && (smt_nthreads == 1 || fetch_regs_PC != fetch_miss_PC))
+    {
+      /* I-cache miss, block fetch until it is resolved */
+      ruu_fetch_issue_delay += lat - 1;
+      fetch_delay_miss = TRUE;
+      fetch_miss_PC = fetch_regs_PC;
+      pipe_progress = TRUE;
+      return FALSE;
+    }
+  /* else, I-cache/I-TLB hit */
+  fetch_miss_PC = 0;
 
-      /* possibly use the BTB target */
-      if (pred)
-	{
-	  enum md_opcode op;
-
-	  /* pre-decode instruction, used for bpred stats recording */
-	  MD_SET_OPCODE(op, inst);
-	  
-	  /* get the next predicted fetch address; only use branch predictor
-	     result for branches (assumes pre-decode bits); NOTE: returned
-	     value may be 1 if bpred can only predict a direction */
-	  if (MD_OP_FLAGS(op) & F_CTRL)
-	    fetch_pred_PC =
-	      bpred_lookup(pred,
-			   /* branch address */fetch_regs_PC,
-			   /* target address *//* FIXME: not computed */0,
-			   /* opcode */op,
-			   /* call? */MD_IS_CALL(op),
-			   /* return? */MD_IS_RETURN(op),
-			   /* updt */&(fetch_data[fetch_tail].dir_update),
-			   /* RSB index */&stack_recover_idx);
-	  else
-	    fetch_pred_PC = 0;
+  *instp = inst;
+  return TRUE;
+}
 
-	  /* valid address returned from branch predictor? */
-	  if (!fetch_pred_PC)
-	    {
-	      /* no predicted taken target, attempt not taken target */
-	      fetch_pred_PC = fetch_regs_PC + sizeof(md_inst_t);
+/* commit INST, fetched from FETCH_REGS_PC and predicted to continue at
+   FETCH_PRED_PC, to the IFETCH -> DISPATCH queue, the caller has filled in
+   the entry's direction update info */
+static void
+fetch_enqueue(md_inst_t inst,			/* fetched inst */
+	      int stack_recover_idx)		/* branch predictor RSB index */
+{
+  /* commit this instruction to the IFETCH -> DISPATCH queue */
+  fetch_data[fetch_tail].IR = inst;
+  fetch_data[fetch_tail].regs_PC = fetch_regs_PC;
+  fetch_data[fetch_tail].pred_PC = fetch_pred_PC;
+  fetch_data[fetch_tail].stack_recover_idx = stack_recover_idx;
+  fetch_data[fetch_tail].ptrace_seq = ptrace_seq++;
+
+  /* for pipe trace */
+  ptrace_newinst(fetch_data[fetch_tail].ptrace_seq,
+		 inst, fetch_data[fetch_tail].regs_PC,
+		 0);
+  ptrace_newstage(fetch_data[fetch_tail].ptrace_seq,
+		  PST_IFETCH,
+		  ((last_inst_missed ? PEV_CACHEMISS : 0)
+		   | (last_inst_tmissed ? PEV_TLBMISS : 0)));
+  last_inst_missed = FALSE;
+  last_inst_tmissed = FALSE;
+
+  /* adjust instruction fetch queue */
+  fetch_tail = (fetch_tail + 1) & (ruu_ifq_size - 1);
+  fetch_num++;
+  pipe_progress = TRUE;
+}
+
+/* predict the inst INST at FETCH_REGS_PC into FETCH_PRED_PC, as the BTB
+   would, returns non-zero if a taken branch was predicted */
+static int
+fetch_predict(md_inst_t inst,			/* fetched inst */
+	      int *stack_recover_idx)		/* RSB index */
+{
+  enum md_opcode op;
+
+  /* no predictor, just default to predict not taken, and continue fetching
+     instructions linearly */
+  if (!pred)
+    {
+      fetch_pred_PC = fetch_regs_PC + sizeof(md_inst_t);
+      return FALSE;
+    }
+
+  /* pre-decode instruction, used for bpred stats recording */
+  MD_SET_OPCODE(op, inst);
+
+  /* get the next predicted fetch address; only use branch predictor result
+     for branches (assumes pre-decode bits); NOTE: returned value may be 1
+     if bpred can only predict a direction */
+  if (MD_OP_FLAGS(op) & F_CTRL)
+    fetch_pred_PC =
+      bpred_lookup(pred,
+		   /* branch address */fetch_regs_PC,
+		   /* target address *//* FIXME: not computed */0,
+		   /* opcode */op,
+		   /* call? */MD_IS_CALL(op),
+		   /* return? */MD_IS_RETURN(op),
+		   /* updt */&(fetch_data[fetch_tail].dir_update),
+		   /* RSB index */stack_recover_idx);
+  else
+    fetch_pred_PC = 0;
+
+  /* valid address returned from branch predictor? */
+  if (!fetch_pred_PC)
+    {
+      /* no predicted taken target, attempt not taken target */
+      fetch_pred_PC = fetch_regs_PC + sizeof(md_inst_t);
+      return FALSE;
+    }
+  return TRUE;
+}
+
+/* fetch from the trace cache, following the traces that start at the
+   predicted fetch address for as long as the branch predictor agrees with
+   them, returns FALSE on a trace cache miss */
+static int
+tcache_fetch(void)
+{
+  struct tcache_line_t *ways[TCACHE_MAX_ASSOC], *line;
+  int i, j, n, stack_recover_idx, partial = FALSE;
+
+  n = tcache_lookup(tcache, SMT_ADDR(fetch_pred_PC), ways);
+  if (!n)
+    return FALSE;
+
+  /* start on the most recently used trace */
+  line = ways[0];
+  for (i=0; i < line->ninsts && fetch_num < ruu_ifq_size; i++)
+    {
+      fetch_regs_PC = SMT_ADDR(line->PCs[i]);
+      fetch_predict(line->insts[i], &stack_recover_idx);
+      fetch_enqueue(line->insts[i], stack_recover_idx);
+
+      if (i+1 == line->ninsts
+	  || line->PCs[i+1] == SMT_ADDR(fetch_pred_PC))
+	continue;
+
+      /* the prediction leaves this trace, continue on a trace that follows
+	 the predicted path, if there is one */
+      for (j=0; j < n; j++)
+	{
+	  if (ways[j]->ninsts > i+1
+	      && ways[j]->PCs[i+1] == SMT_ADDR(fetch_pred_PC))
+	    break;
+	}
+      if (j == n)
+	{
+	  partial = TRUE;
+	  i++;
+	  break;
+	}
+      line = ways[j];
+    }
+
+  /* stopped on a full IFQ? */
+  if (i < line->ninsts)
+    partial = TRUE;
+
+  tcache_hit(tcache, line, i, partial);
+  return TRUE;
+}
+
+/* fetch up as many instruction as one branch prediction and one cache line
+   acess will support without overflowing the IFETCH -> DISPATCH QUEUE */
+static void
+ruu_fetch(void)
+{
+  int i, done = FALSE;
+  md_inst_t inst;
+  int stack_recover_idx;
+  int branch_cnt;
+
+  /* a trace cache hit bypasses the I-cache */
+  if (tcache && tcache_fetch())
+    return;
+
+  for (i=0, branch_cnt=0;
+       /* fetch up to as many instruction as the DISPATCH stage can decode */
+       i < (ruu_decode_width * fetch_speed)
+       /* fetch until IFETCH -> DISPATCH queue fills */
+       && fetch_num < ruu_ifq_size
+       /* and no IFETCH blocking condition encountered */
+       && !done;
+       i++)
+    {
+      /* fetch an instruction at the next predicted fetch address */
+      fetch_regs_PC = fetch_pred_PC;
+      if (!fetch_icache(&inst))
+	break;
+
+      /* have a valid inst, here */
+
+      /* possibly use the BTB target */
+      if (fetch_predict(inst, &stack_recover_idx))
+	{
+	  /* go with target, NOTE: discontinuous fetch, so terminate */
+	  branch_cnt++;
+	  if (branch_cnt >= fetch_speed)
+	    done = TRUE;
+	}
+
+      fetch_enqueue(inst, stack_recover_idx);
+    }
+}
+
+/* decoupled front end: the branch predictor runs ahead of fetch, filling
+   the FTQ with predicted fetch blocks, fetch follows the FTQ and is no
+   longer bounded by one prediction per cycle, and the blocks waiting in the
+   FTQ direct prefetches into the I-cache */
+
+/* predict up to FTQ_WIDTH fetch blocks into the FTQ, starting at BPU_PC */
+static void
+ftq_predict(void)
+{
+  int b, n;
+  struct predec_ent *pd;
+  md_inst_t inst;
+  enum md_opcode op;
+  md_addr_t target;
+  struct ftq_ent *ent;
+  struct ftq_pred *p;
+
+  for (b=0; b < ftq_width && ftq_num < ftq_size; b++)
+    {
+      ent = &ftq[(ftq_head + ftq_num) % ftq_size];
+      ent->start_PC = bpu_PC;
+      ent->nfetched = 0;
+      ent->prefetched = FALSE;
+
+      for (n=0; n < ftq_block; )
+	{
+	  p = &ent->preds[n++];
+
+	  /* pre-decode the inst, bogus text addresses fetch NOPs */
+	  target = 0;
+	  if (pred && FETCH_TEXT_OK(bpu_PC))
+	    {
+	      pd = PREDEC_LOOKUP(predec, bpu_PC);
+	      inst = pd->inst;
+	      op = pd->op;
+
+	      /* only use branch predictor result for branches, NOTE: returned
+		 value may be 1 if bpred can only predict a direction */
+	      if (pd->flags & F_CTRL)
+		target =
+		  bpred_lookup(pred,
+			       /* branch address */bpu_PC,
+			       /* target address *//* FIXME: not computed */0,
+			       /* opcode */op,
+			       /* call? */MD_IS_CALL(op),
+			       /* return? */MD_IS_RETURN(op),
+			       /* updt */&p->dir_update,
+			       /* RSB index */&p->stack_recover_idx);
 	    }
-	  else
+
+	  if (target)
 	    {
-	      /* go with target, NOTE: discontinuous fetch, so terminate */
-	      branch_cnt++;
-	      if (branch_cnt >= fetch_speed)
-		done = TRUE;
+	      /* predicted taken, the block ends here */
+	      p->pred_PC = bpu_PC = target;
+	      break;
 	    }
+	  p->pred_PC = bpu_PC = bpu_PC + sizeof(md_inst_t);
 	}
+
+      ent->ninsts = n;
+      ftq_num++;
+      ftq_blocks++;
+      ftq_insts += n;
+      pipe_progress = TRUE;
+    }
+}
+
+/* fetch instructions of the fetch blocks at the head of the FTQ, up to as
+   many as the DISPATCH stage can decode from up to FTQ_WIDTH blocks */
+static void
+ftq_fetch(void)
+{
+  int i, blocks;
+  md_inst_t inst;
+  struct ftq_ent *ent;
+  struct ftq_pred *p;
+
+  if (!ftq_num)
+    {
+      fetch_stall_ftq_empty++;
+      return;
+    }
+
+  for (i=0, blocks=0;
+       i < (ruu_decode_width * fetch_speed)
+       && fetch_num < ruu_ifq_size
+       && ftq_num > 0;
+       i++)
+    {
+      ent = &ftq[ftq_head];
+      p = &ent->preds[ent->nfetched];
+
+      fetch_regs_PC = ent->start_PC + ent->nfetched * sizeof(md_inst_t);
+      if (!fetch_icache(&inst))
+	break;
+
+      /* the prediction was made when the block was queued */
+      fetch_pred_PC = p->pred_PC;
+      fetch_data[fetch_tail].dir_update = p->dir_update;
+      fetch_enqueue(inst, p->stack_recover_idx);
+
+      /* retire the block once all its insts are fetched */
+      if (++ent->nfetched == ent->ninsts)
+	{
+	  ftq_head = (ftq_head + 1) % ftq_size;
+	  ftq_num--;
+	  if (++blocks >= ftq_width)
+	    break;
+	}
+    }
+}
+
+/* prefetch the I-cache blocks of the oldest fetch block within FTQ_PREFETCH
+   entries of the FTQ head that has not yet been prefetched */
+static void
+ftq_prefetch_blocks(void)
+{
+  int i;
+  md_addr_t addr, end;
+  struct ftq_ent *ent;
+
+  for (i=0; i < ftq_num && i < ftq_prefetch; i++)
+    {
+      ent = &ftq[(ftq_head + i) % ftq_size];
+      if (ent->prefetched)
+	continue;
+      ent->prefetched = TRUE;
+      pipe_progress = TRUE;
+
+      end = ent->start_PC + ent->ninsts * sizeof(md_inst_t);
+      for (addr = ent->start_PC & ~(md_addr_t)(cache_il1->bsize - 1);
+	   addr < end; addr += cache_il1->bsize)
+	{
+	  if (FETCH_TEXT_OK(addr))
+	    cache_pf_fetch(cache_il1, SMT_ADDR(IACOMPRESS(addr)), sim_cycle);
+	}
+      break;
+    }
+}
+
+
+/*
+ *  SMT - simultaneous multithreading support
+ */
+
+/* the state each hardware context keeps to itself, the running context's
+   copy lives in the usual simulator variables, so the pipeline stages need
+   no changes to work on it, the others' copies are kept here and
+   smt_switch() exchanges the two; the functional units, ready and event
+   queues, caches, TLBs and branch predictor are shared */
+struct smt_context {
+  /* architected state and program loader results */
+  struct regs_t regs;
+  struct mem_t *mem;
+  struct predec_t *predec;
+  md_addr_t ld_text_base;
+  unsigned int ld_text_size;
+  md_addr_t ld_data_base;
+  unsigned int ld_data_size;
+  md_addr_t ld_brk_point;
+  md_addr_t ld_stack_base;
+  unsigned int ld_stack_size;
+  md_addr_t ld_stack_min;
+  char *ld_prog_fname;
+  md_addr_t ld_prog_entry;
+  md_addr_t ld_environ_base;
+  FILE *sim_eio_fd;
+
+  /* instruction trace generator (mis-speculation) state */
+  int spec_mode;
+  BITMAP_TYPE(MD_NUM_IREGS, use_spec_R);
+  md_gpr_t spec_regs_R;
+  BITMAP_TYPE(MD_NUM_FREGS, use_spec_F);
+  md_fpr_t spec_regs_F;
+  BITMAP_TYPE(MD_NUM_FREGS, use_spec_C);
+  md_ctrl_t spec_regs_C;
+  struct spec_mem_ent *store_htable[STORE_HASH_SIZE];
+
+  /* create vector */
+  BITMAP_TYPE(MD_TOTAL_REGS, use_spec_cv);
+  struct CV_link *create_vector;
+  struct CV_link *spec_create_vector;
+  tick_t *create_vector_rt;
+  tick_t *spec_create_vector_rt;
+
+  /* RUU and LSQ, each context keeps its own program order */
+  struct RUU_station *RUU;
+  int RUU_head, RUU_tail, RUU_num;
+  struct RUU_station *LSQ;
+  int LSQ_head, LSQ_tail, LSQ_num;
+  int *lsq_shash, *lsq_snext, lsq_sta_known;
+  int *lsq_lnext, *lsq_lprev, *lsq_lstate;
+  int lsq_pend_head, lsq_pend_tail;
+  int lsq_spec_head, lsq_spec_tail;
+
+  /* front end */
+  md_addr_t pred_PC, recover_PC;
+  md_addr_t fetch_regs_PC, fetch_pred_PC;
+  struct fetch_rec *fetch_data;
+  int fetch_num, fetch_tail, fetch_head;
+  unsigned ruu_fetch_issue_delay;
+  struct RS_link last_op;
+  int last_inst_missed, last_inst_tmissed;
+  md_addr_t fetch_miss_PC;
+  int fetch_delay_miss;
+  struct ftq_ent *ftq;
+  int ftq_num, ftq_head;
+  md_addr_t bpu_PC;
+};
+
+/* saved state of the hardware contexts, the running context's entry is
+   stale until it is switched out */
+static struct smt_context smt_ctx[SMT_MAX_THREADS];
+
+/* per context variable VAR of context T, wherever it currently lives */
+#define SMT_VAR(T, VAR)							\
+  (*((T) == smt_cur ? &(VAR) : &smt_ctx[T].VAR))
+
+/* save the running context's state into CTX, or install it from CTX */
+#define SMT_MOVE(VAR)							\
+  (save									\
+   ? memcpy(&ctx->VAR, &(VAR), sizeof(VAR))				\
+   : memcpy(&(VAR), &ctx->VAR, sizeof(VAR)))
+
+static void
+smt_move(struct smt_context *ctx, int save)
+{
+  SMT_MOVE(regs); SMT_MOVE(mem); SMT_MOVE(predec);
+  SMT_MOVE(ld_text_base); SMT_MOVE(ld_text_size);
+  SMT_MOVE(ld_data_base); SMT_MOVE(ld_data_size);
+  SMT_MOVE(ld_brk_point); SMT_MOVE(ld_stack_base);
+  SMT_MOVE(ld_stack_size); SMT_MOVE(ld_stack_min);
+  SMT_MOVE(ld_prog_fname); SMT_MOVE(ld_prog_entry);
+  SMT_MOVE(ld_environ_base); SMT_MOVE(sim_eio_fd);
+
+  SMT_MOVE(spec_mode);
+  SMT_MOVE(use_spec_R); SMT_MOVE(spec_regs_R);
+  SMT_MOVE(use_spec_F); SMT_MOVE(spec_regs_F);
+  SMT_MOVE(use_spec_C); SMT_MOVE(spec_regs_C);
+  SMT_MOVE(store_htable);
+
+  SMT_MOVE(use_spec_cv);
+  SMT_MOVE(create_vector); SMT_MOVE(spec_create_vector);
+  SMT_MOVE(create_vector_rt); SMT_MOVE(spec_create_vector_rt);
+
+  SMT_MOVE(RUU); SMT_MOVE(RUU_head); SMT_MOVE(RUU_tail); SMT_MOVE(RUU_num);
+  SMT_MOVE(LSQ); SMT_MOVE(LSQ_head); SMT_MOVE(LSQ_tail); SMT_MOVE(LSQ_num);
+  SMT_MOVE(lsq_shash); SMT_MOVE(lsq_snext); SMT_MOVE(lsq_sta_known);
+  SMT_MOVE(lsq_lnext); SMT_MOVE(lsq_lprev); SMT_MOVE(lsq_lstate);
+  SMT_MOVE(lsq_pend_head); SMT_MOVE(lsq_pend_tail);
+  SMT_MOVE(lsq_spec_head); SMT_MOVE(lsq_spec_tail);
+
+  SMT_MOVE(pred_PC); SMT_MOVE(recover_PC);
+  SMT_MOVE(fetch_regs_PC); SMT_MOVE(fetch_pred_PC);
+  SMT_MOVE(fetch_data);
+  SMT_MOVE(fetch_num); SMT_MOVE(fetch_tail); SMT_MOVE(fetch_head);
+  SMT_MOVE(ruu_fetch_issue_delay); SMT_MOVE(last_op);
+  SMT_MOVE(last_inst_missed); SMT_MOVE(last_inst_tmissed);
+  SMT_MOVE(fetch_miss_PC); SMT_MOVE(fetch_delay_miss);
+  SMT_MOVE(ftq); SMT_MOVE(ftq_num); SMT_MOVE(ftq_head); SMT_MOVE(bpu_PC);
+}
+
+/* make hardware context THREAD the running context */
+static void
+smt_switch(int thread)
+{
+  if (thread == smt_cur)
+    return;
+
+  smt_move(&smt_ctx[smt_cur], /* save */TRUE);
+  smt_move(&smt_ctx[thread], /* save */FALSE);
+  smt_cur = thread;
+}
+
+/* most arguments accepted in a -smt:prog program string */
+#define SMT_MAX_ARGS			64
+
+/* load the -smt:prog programs, each into a fresh hardware context */
+static void
+smt_init(char **envp)				/* program environment */
+{
+  int t, argc;
+  char *argv[SMT_MAX_ARGS+1], *arg, name[32];
+  char *chkpt_fname = sim_chkpt_fname;
+
+  /* a -chkpt checkpoint restores context 0 only */
+  sim_chkpt_fname = NULL;
+
+  for (t=1; t < smt_nthreads; t++)
+    {
+      /* the context starts out zeroed */
+      smt_switch(t);
+
+      /* split the program string into its arguments */
+      argc = 0;
+      for (arg = strtok(mystrdup(smt_progs[t-1]), " \t"); arg;
+	   arg = strtok(NULL, " \t"))
+	{
+	  if (argc == SMT_MAX_ARGS)
+	    fatal("too many arguments in -smt:prog `%s'", smt_progs[t-1]);
+	  argv[argc++] = arg;
+	}
+      if (!argc)
+	fatal("-smt:prog names no program");
+      argv[argc] = NULL;
+
+      /* give the context its own registers, memory and pipeline state */
+      regs_init(&regs);
+      sprintf(name, "mem%d", t);
+      mem = mem_create(name);
+      mem_init(mem);
+      ld_load_prog(argv[0], argc, argv, envp, &regs, mem, TRUE);
+      predec = predec_create(mem, PREDEC_NENTS);
+
+      tracer_init();
+      fetch_init();
+      cv_init();
+      ruu_init();
+      lsq_init();
+    }
+
+  sim_chkpt_fname = chkpt_fname;
+  smt_switch(0);
+}
+
+/* execute a system call for the running context, with more than one
+   context running the exit of any but the last program retires only its
+   own context */
+static void
+smt_syscall(md_inst_t inst)			/* system call inst */
+{
+  jmp_buf exit_buf;
+  counter_t num_insn = sim_num_insn;
+  int exit_code;
+
+  /* EIO traces are checked against the context's own instruction count */
+  sim_num_insn = smt_num_insn[smt_cur];
+  memcpy(exit_buf, sim_exit_buf, sizeof(jmp_buf));
+  exit_code = setjmp(sim_exit_buf);
+  if (!exit_code)
+    sys_syscall(&regs, mem_access, mem, inst, TRUE);
+  memcpy(sim_exit_buf, exit_buf, sizeof(jmp_buf));
+  sim_num_insn = num_insn;
+
+  if (exit_code)
+    {
+      int t, nlive = 0;
+
+      /* the program has exited, its context fetches no more */
+      smt_done[smt_cur] = TRUE;
+      for (t=0; t < smt_nthreads; t++)
+	nlive += !smt_done[t];
+
+      /* the last program to exit ends the simulation */
+      if (!nlive)
+	{
+	  smt_switch(0);
+	  longjmp(sim_exit_buf, exit_code);
+	}
+    }
+}
+
+/* commit from each hardware context in turn, sharing the commit B/W */
+static void
+smt_commit(void)
+{
+  int i, width = ruu_commit_width;
+
+  for (i=0; i < smt_nthreads && width > 0; i++)
+    {
+      smt_switch((sim_cycle + i) % smt_nthreads);
+      width -= ruu_commit(width);
+    }
+}
+
+/* schedule the ready loads of every hardware context */
+static void
+smt_refresh(void)
+{
+  int i;
+
+  for (i=0; i < smt_nthreads; i++)
+    {
+      smt_switch((sim_cycle + i) % smt_nthreads);
+      lsq_refresh();
+    }
+}
+
+/* dispatch from each running hardware context in turn, sharing the decode
+   B/W and the RUU and LSQ capacity */
+static void
+smt_dispatch(void)
+{
+  int i, t, u, width = ruu_decode_width * fetch_speed;
+
+  for (i=0; i < smt_nthreads && width > 0; i++)
+    {
+      t = (sim_cycle + i) % smt_nthreads;
+      if (smt_done[t])
+	continue;
+
+      smt_switch(t);
+      smt_ruu_others = smt_lsq_others = 0;
+      for (u=0; u < smt_nthreads; u++)
+	{
+	  if (u != t)
+	    {
+	      smt_ruu_others += smt_ctx[u].RUU_num;
+	      smt_lsq_others += smt_ctx[u].LSQ_num;
+	    }
+	}
+      width -= ruu_dispatch(width);
+    }
+}
+
+/* pick the hardware context that fetches this cycle: with ICOUNT the one
+   with the fewest instructions in its fetch queue or waiting to issue,
+   with round-robin the first in turn, contexts whose fetch is blocked
+   count down their delay; with a decoupled front end, every context's
+   branch predictor then runs ahead into its FTQ */
+static void
+smt_fetch(void)
+{
+  int i, t, count, pick = -1, best = 0;
+
+  for (i=0; i < smt_nthreads; i++)
+    {
+      t = (sim_cycle + i) % smt_nthreads;
+      if (smt_done[t])
+	continue;
+
+      if (SMT_VAR(t, ruu_fetch_issue_delay))
+	{
+	  if (SMT_VAR(t, fetch_delay_miss))
+	    fetch_stall_icache++;
+	  else
+	    fetch_stall_recover++;
+	  SMT_VAR(t, ruu_fetch_issue_delay)--;
+	  continue;
+	}
+      if (SMT_VAR(t, fetch_num) >= ruu_ifq_size)
+	{
+	  fetch_stall_ifq_full++;
+	  continue;
+	}
+
+      count = ((smt_fetch_policy == smt_fetch_icount)
+	       ? SMT_VAR(t, fetch_num) + smt_icount[t] : 0);
+      if (pick < 0 || count < best)
+	{
+	  pick = t;
+	  best = count;
+	}
+    }
+
+  if (pick >= 0)
+    {
+      smt_switch(pick);
+      if (ftq_size)
+	ftq_fetch();
       else
+	ruu_fetch();
+    }
+
+  if (ftq_size)
+    {
+      pick = smt_cur;
+      for (t=0; t < smt_nthreads; t++)
 	{
-	  /* no predictor, just default to predict not taken, and
-	     continue fetching instructions linearly */
-	  fetch_pred_PC = fetch_regs_PC + sizeof(md_inst_t);
+	  if (smt_done[t])
+	    continue;
+	  smt_switch(t);
+	  ftq_predict();
+	  if (cache_il1 && ftq_prefetch)
+	    ftq_prefetch_blocks();
 	}
+      smt_switch(pick);
+    }
+}
+
+/* total fetch queue, RUU and LSQ occupancy over all hardware contexts */
+static void
+smt_occupancy(int *ifq, int *ruu, int *lsq)
+{
+  int t;
 
-      /* commit this instruction to the IFETCH -> DISPATCH queue */
-      fetch_data[fetch_tail].IR = inst;
-      fetch_data[fetch_tail].regs_PC = fetch_regs_PC;
-      fetch_data[fetch_tail].pred_PC = fetch_pred_PC;
-      fetch_data[fetch_tail].stack_recover_idx = stack_recover_idx;
-      fetch_data[fetch_tail].ptrace_seq = ptrace_seq++;
-
-      /* for pipe trace */
-      ptrace_newinst(fetch_data[fetch_tail].ptrace_seq,
-		     inst, fetch_data[fetch_tail].regs_PC,
-		     0);
-      ptrace_newstage(fetch_data[fetch_tail].ptrace_seq,
-		      PST_IFETCH,
-		      ((last_inst_missed ? PEV_CACHEMISS : 0)
-		       | (last_inst_tmissed ? PEV_TLBMISS : 0)));
-      last_inst_missed = FALSE;
-      last_inst_tmissed = FALSE;
-
-      /* adjust instruction fetch queue */
-      fetch_tail = (fetch_tail + 1) & (ruu_ifq_size - 1);
-      fetch_num++;
+  *ifq = fetch_num;
+  *ruu = RUU_num;
+  *lsq = LSQ_num;
+  for (t=0; t < smt_nthreads; t++)
+    {
+      if (t != smt_cur)
+	{
+	  *ifq += smt_ctx[t].fetch_num;
+	  *ruu += smt_ctx[t].RUU_num;
+	  *lsq += smt_ctx[t].LSQ_num;
+	}
     }
 }
 
@@ -4421,110 +7065,373 @@ simoo_mstate_obj(FILE *stream,			/* output stream */
 }
 
 
-/* start simulation, program loaded, processor precise state initialized */
-void
-sim_main(void)
+/* last I-cache block and I-TLB page warmed by the fast forward loop */
+static md_addr_t fastfwd_iblk;
+static md_addr_t fastfwd_ipage;
+
+/* warm the caches, TLBs, branch predictor and trace cache with instruction
+   INST (opcode OP) at PC, which went to NEXT_PC and accessed ADDR if it is
+   a load or store; the accesses are untimed (NOW == 0), so only tag and
+   predictor state move */
+static void
+fastfwd_warm_inst(md_addr_t PC,			/* inst address */
+		  md_addr_t next_PC,		/* actual next inst address */
+		  md_inst_t inst,		/* inst bits */
+		  enum md_opcode op,		/* inst opcode */
+		  md_addr_t addr)		/* effective address */
 {
-  /* ignore any floating point exceptions, they may occur on mis-speculated
-     execution paths */
-  signal(SIGFPE, SIG_IGN);
+  md_addr_t iaddr, pred_PC;
+  struct bpred_update_t dir_update;
+  int stack_recover_idx;
+
+  /* fetch, a run of insts from one block only needs its first access */
+  iaddr = SMT_ADDR(IACOMPRESS(PC));
+  if (cache_il1 && (iaddr & ~(cache_il1->bsize - 1)) != fastfwd_iblk)
+    {
+      fastfwd_iblk = iaddr & ~(cache_il1->bsize - 1);
+      cache_access_PC = PC;
+      cache_access(cache_il1, Read, iaddr, NULL,
+		   ISCOMPRESS(sizeof(md_inst_t)), /* now */0, NULL, NULL, 0);
+    }
+  if (itlb && (iaddr & ~(itlb->bsize - 1)) != fastfwd_ipage)
+    {
+      fastfwd_ipage = iaddr & ~(itlb->bsize - 1);
+      cache_access(itlb, Read, iaddr, NULL,
+		   ISCOMPRESS(sizeof(md_inst_t)), /* now */0, NULL, NULL, 0);
+    }
+
+  /* loads and stores */
+  if (MD_OP_FLAGS(op) & F_MEM)
+    {
+      if (cache_dl1)
+	{
+	  cache_access_PC = PC;
+	  cache_access(cache_dl1,
+		       (MD_OP_FLAGS(op) & F_STORE) ? Write : Read,
+		       SMT_ADDR(addr & ~3), NULL, 4, /* now */0, NULL, NULL, 0);
+	}
+      if (dtlb)
+	cache_access(dtlb, Read, SMT_ADDR(addr & ~3), NULL, 4, /* now */0,
+		     NULL, NULL, 0);
+    }
+
+  /* predict and update right away, there is no wrong path to recover */
+  if (pred && (MD_OP_FLAGS(op) & F_CTRL))
+    {
+      pred_PC = bpred_lookup(pred,
+			     /* branch address */PC,
+			     /* target address */0,
+			     /* opcode */op,
+			     /* call? */MD_IS_CALL(op),
+			     /* return? */MD_IS_RETURN(op),
+			     /* updt */&dir_update,
+			     /* RSB index */&stack_recover_idx);
+      if (!pred_PC)
+	pred_PC = PC + sizeof(md_inst_t);
+      bpred_update(pred,
+		   /* branch address */PC,
+		   /* actual target address */next_PC,
+		   /* taken? */next_PC != (PC + sizeof(md_inst_t)),
+		   /* pred taken? */pred_PC != (PC + sizeof(md_inst_t)),
+		   /* correct pred? */pred_PC == next_PC,
+		   /* opcode */op,
+		   /* dir predictor update pointer */&dir_update);
+    }
+
+  if (tcache)
+    tcache_fill(tcache, smt_cur, SMT_ADDR(PC), inst, op, SMT_ADDR(next_PC));
+}
 
-  /* set up program entry state */
-  regs.regs_PC = ld_prog_entry;
-  regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
-
-  /* check for DLite debugger entry condition */
-  if (dlite_check_break(regs.regs_PC, /* no access */0, /* addr */0, 0, 0))
-    dlite_main(regs.regs_PC, regs.regs_PC + sizeof(md_inst_t),
-	       sim_cycle, &regs, mem);
-
-  /* fast forward simulator loop, performs functional simulation for
-     FASTFWD_COUNT insts, then turns on performance (timing) simulation */
-  if (fastfwd_count > 0)
-    {
-      int icount;
-      md_inst_t inst;			/* actual instruction bits */
-      enum md_opcode op;		/* decoded opcode enum */
-      md_addr_t target_PC;		/* actual next/target PC address */
-      md_addr_t addr;			/* effective address, if load/store */
-      int is_write;			/* store? */
-      byte_t temp_byte = 0;		/* temp variable for spec mem access */
-      half_t temp_half = 0;		/* " ditto " */
-      word_t temp_word = 0;		/* " ditto " */
+/* fast forward the running hardware context COUNT instructions with
+   functional simulation only, stopping early if its program exits; the
+   last FASTFWD_WARM of them also warm the caches, TLBs and predictor */
+static void
+sim_fastfwd(int count)				/* insts to skip */
+{
+  int icount, warm_start;
+  struct predec_ent *pd;
+  md_inst_t inst;			/* actual instruction bits */
+  enum md_opcode op;			/* decoded opcode enum */
+  md_addr_t target_PC;			/* actual next/target PC address */
+  md_addr_t addr;			/* effective address, if load/store */
+  int is_write;				/* store? */
+  byte_t temp_byte = 0;			/* temp variable for spec mem access */
+  half_t temp_half = 0;			/* " ditto " */
+  word_t temp_word = 0;			/* " ditto " */
 #ifdef HOST_HAS_QWORD
-      qword_t temp_qword = 0;		/* " ditto " */
+  qword_t temp_qword = 0;		/* " ditto " */
 #endif /* HOST_HAS_QWORD */
-      enum md_fault_type fault;
+  enum md_fault_type fault;
 
-      fprintf(stderr, "sim: ** fast forwarding %d insts **\n", fastfwd_count);
+  warm_start = count;
+  if (fastfwd_warm < 0 || fastfwd_warm >= count)
+    warm_start = 0;
+  else if (fastfwd_warm > 0)
+    warm_start = count - fastfwd_warm;
+  fastfwd_iblk = fastfwd_ipage = (md_addr_t)-1;
 
-      for (icount=0; icount < fastfwd_count; icount++)
-	{
-	  /* maintain $r0 semantics */
-	  regs.regs_R[MD_REG_ZERO] = 0;
+  if (warm_start < count)
+    fprintf(stderr, "sim: ** fast forwarding %d insts, warming the last %d **\n",
+	    count, count - warm_start);
+  else
+    fprintf(stderr, "sim: ** fast forwarding %d insts **\n", count);
+
+  for (icount=0; icount < count && !smt_done[smt_cur]; icount++)
+    {
+      /* maintain $r0 semantics */
+      regs.regs_R[MD_REG_ZERO] = 0;
 #ifdef TARGET_ALPHA
-	  regs.regs_F.d[MD_REG_ZERO] = 0.0;
+      regs.regs_F.d[MD_REG_ZERO] = 0.0;
 #endif /* TARGET_ALPHA */
 
-	  /* get the next instruction to execute */
-	  MD_FETCH_INST(inst, mem, regs.regs_PC);
+      /* get the next instruction to execute */
+      pd = PREDEC_LOOKUP(predec, regs.regs_PC);
+      inst = pd->inst;
 
-	  /* set default reference address */
-	  addr = 0; is_write = FALSE;
+      /* set default reference address */
+      addr = 0; is_write = FALSE;
 
-	  /* set default fault - none */
-	  fault = md_fault_none;
+      /* set default fault - none */
+      fault = md_fault_none;
 
-	  /* decode the instruction */
-	  MD_SET_OPCODE(op, inst);
+      /* the instruction is pre-decoded */
+      op = pd->op;
 
-	  /* execute the instruction */
-	  switch (op)
-	    {
+      /* execute the instruction */
+      switch (op)
+	{
 #define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
-	    case OP:							\
-	      SYMCAT(OP,_IMPL);						\
-	      break;
+	case OP:							\
+	  SYMCAT(OP,_IMPL);						\
+	  break;
 #define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
-	    case OP:							\
-	      panic("attempted to execute a linking opcode");
+	case OP:							\
+	  panic("attempted to execute a linking opcode");
 #define CONNECT(OP)
 #undef DECLARE_FAULT
 #define DECLARE_FAULT(FAULT)						\
-	      { fault = (FAULT); break; }
+	  { fault = (FAULT); break; }
 #include "machine.def"
-	    default:
-	      panic("attempted to execute a bogus opcode");
-	    }
+	default:
+	  panic("attempted to execute a bogus opcode");
+	}
 
-	  if (fault != md_fault_none)
-	    fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
+      if (fault != md_fault_none)
+	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
 
-	  /* update memory access stats */
-	  if (MD_OP_FLAGS(op) & F_MEM)
-	    {
-	      if (MD_OP_FLAGS(op) & F_STORE)
-		is_write = TRUE;
-	    }
+      /* update memory access stats */
+      if (pd->flags & F_MEM)
+	{
+	  if (pd->flags & F_STORE)
+	    is_write = TRUE;
+	}
+
+      /* functional warming */
+      if (icount >= warm_start)
+	fastfwd_warm_inst(regs.regs_PC, regs.regs_NPC, inst, op, addr);
 
-	  /* check for DLite debugger entry condition */
-	  if (dlite_check_break(regs.regs_NPC,
-				is_write ? ACCESS_WRITE : ACCESS_READ,
-				addr, sim_num_insn, sim_num_insn))
-	    dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
+      /* check for DLite debugger entry condition */
+      if (dlite_check_break(regs.regs_NPC,
+			    is_write ? ACCESS_WRITE : ACCESS_READ,
+			    addr, sim_num_insn, sim_num_insn))
+	dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
 
-	  /* go to the next instruction */
-	  regs.regs_PC = regs.regs_NPC;
-	  regs.regs_NPC += sizeof(md_inst_t);
+      /* go to the next instruction */
+      regs.regs_PC = regs.regs_NPC;
+      regs.regs_NPC += sizeof(md_inst_t);
+    }
+}
+
+/* add the buffer occupancies, over all hardware contexts, to the occupancy
+   stats for N cycles */
+static void
+occupancy_stats(int n)				/* cycles */
+{
+  int t, ifq_num, ruu_num, lsq_num;
+
+  smt_occupancy(&ifq_num, &ruu_num, &lsq_num);
+  IFQ_count += (counter_t)n * ifq_num;
+  IFQ_fcount += ((ifq_num == smt_nthreads * ruu_ifq_size) ? n : 0);
+  if (ftq_size)
+    {
+      int full = TRUE;
+
+      for (t=0; t < smt_nthreads; t++)
+	{
+	  FTQ_count += (counter_t)n * SMT_VAR(t, ftq_num);
+	  if (SMT_VAR(t, ftq_num) < ftq_size)
+	    full = FALSE;
 	}
+      FTQ_fcount += full ? n : 0;
+    }
+  RUU_count += (counter_t)n * ruu_num;
+  RUU_fcount += ((ruu_num == RUU_size) ? n : 0);
+  if (prf_size)
+    {
+      PRF_count += (counter_t)n * (prf_size - MD_TOTAL_REGS - prf_free_num);
+      stat_add_samples(prf_occ_dist,
+		       prf_size - MD_TOTAL_REGS - prf_free_num, n);
+    }
+  if (iq_size)
+    {
+      IQ_count += (counter_t)n * iq_num;
+      stat_add_samples(iq_occ_dist, iq_num, n);
     }
+  LSQ_count += (counter_t)n * lsq_num;
+  LSQ_fcount += ((lsq_num == LSQ_size) ? n : 0);
 
-  fprintf(stderr, "sim: ** starting performance simulation **\n");
+  /* charge the cycles to each context whose program is still running */
+  for (t=0; t < smt_nthreads; t++)
+    {
+      if (!smt_done[t])
+	smt_cycles[t] += n;
+    }
+}
+
+/* most cycles skipped at once */
+#define CYCLE_SKIP_MAX		(1 << 20)
+
+/* return the first cycle, after the current one, in which a stalled
+   pipeline may do anything but wait, the current cycle if it may do so
+   itself; the previous cycle must have made no progress, the current cycle
+   then repeats it, as does every cycle until an event completes, a
+   functional unit or MSHR needed to issue frees up, fetch resumes, or
+   replay or a store set clear is due */
+static tick_t
+cycle_skip_until(void)
+{
+  tick_t until = sim_cycle + CYCLE_SKIP_MAX, next;
+  int i, t;
+
+  for (t=0; t < smt_nthreads; t++)
+    {
+      /* a completed inst at the RUU head that did not commit is a store
+	 waiting on a port, unless the store itself waits on its data */
+      if (SMT_VAR(t, RUU_num) > 0
+	  && SMT_VAR(t, RUU)[SMT_VAR(t, RUU_head)].completed
+	  && (!SMT_VAR(t, RUU)[SMT_VAR(t, RUU_head)].ea_comp
+	      || SMT_VAR(t, LSQ)[SMT_VAR(t, LSQ_head)].completed))
+	return sim_cycle;
+
+      /* fetch must be blocked, until its delay runs out or for good */
+      if (smt_done[t])
+	continue;
+      if (SMT_VAR(t, ruu_fetch_issue_delay))
+	until = MIN(until, sim_cycle + SMT_VAR(t, ruu_fetch_issue_delay));
+      else if (SMT_VAR(t, fetch_num) < ruu_ifq_size)
+	return sim_cycle;
+    }
+
+  /* insts left in the ready queue wait on a functional unit, which frees up
+     in the cycle its busy count reaches zero, or on a D-cache MSHR */
+  if (readyq_num)
+    {
+      for (i=0; i < fu_pool->num_resources; i++)
+	{
+	  if (fu_pool->resources[i].busy > 0)
+	    until = MIN(until, sim_cycle + fu_pool->resources[i].busy - 1);
+	}
+      if (cache_dl1 && (next = cache_mshr_next_ready(cache_dl1, sim_cycle)))
+	until = MIN(until, next);
+    }
+
+  if ((next = eventq_next_time()))
+    until = MIN(until, next);
+  if (replay_num && replay_ready > sim_cycle)
+    until = MIN(until, replay_ready);
+  if (mdp_type == mdp_storeset && mdp_clear_interval)
+    until = MIN(until, mdp_next_clear);
 
-  /* set up timing simulation entry state */
-  fetch_regs_PC = regs.regs_PC - sizeof(md_inst_t);
-  fetch_pred_PC = regs.regs_PC;
-  regs.regs_PC = regs.regs_PC - sizeof(md_inst_t);
+  return MAX(until, sim_cycle);
+}
+
+/* counters a stalled pipeline bumps in every cycle it waits */
+static counter_t *cycle_skip_stalls[] = {
+  &fetch_stall_recover, &fetch_stall_icache,
+  &fetch_stall_ifq_full, &fetch_stall_ftq_empty,
+  &sim_prf_full_stalls, &sim_iq_full_stalls, &sim_mshr_stalls
+};
+#define CYCLE_SKIP_NSTALLS						\
+  (sizeof(cycle_skip_stalls) / sizeof(cycle_skip_stalls[0]))
+
+/* skip N cycles of a stalled pipeline, each of them repeats the cycle just
+   simulated, which started with the stall counters at STALLS */
+static void
+cycle_skip_run(int n,				/* cycles to skip */
+	       counter_t *stalls)		/* stall counts before cycle */
+{
+  int i, t;
+
+  for (i=0; i < CYCLE_SKIP_NSTALLS; i++)
+    *cycle_skip_stalls[i] +=
+      (counter_t)n * (*cycle_skip_stalls[i] - stalls[i]);
+  occupancy_stats(n);
+
+  /* functional units and fetch count down the skipped cycles */
+  for (i=0; i < fu_pool->num_resources; i++)
+    fu_pool->resources[i].busy = MAX(fu_pool->resources[i].busy - n, 0);
+  for (t=0; t < smt_nthreads; t++)
+    {
+      if (!smt_done[t] && SMT_VAR(t, ruu_fetch_issue_delay))
+	SMT_VAR(t, ruu_fetch_issue_delay) -= n;
+    }
+
+  /* no events fall in the skipped cycles, turn the wheel past them */
+  sim_cycle += n;
+  sim_skipped_cycles += n;
+  eventq_cycle = MAX(eventq_cycle, sim_cycle);
+  eventq_turn_wheel();
+}
+
+/* start simulation, program loaded, processor precise state initialized */
+void
+sim_main(void)
+{
+  int i, t;
+  counter_t warmup_insts, stalls[CYCLE_SKIP_NSTALLS];
+  tick_t skip_until;
+
+  /* ignore any floating point exceptions, they may occur on mis-speculated
+     execution paths */
+  signal(SIGFPE, SIG_IGN);
+
+  /* bring each hardware context up to the start of timing simulation,
+     finishing with context 0 */
+  for (t=smt_nthreads-1; t >= 0; t--)
+    {
+      smt_switch(t);
+
+      /* set up program entry state */
+      regs.regs_PC = ld_prog_entry;
+      regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
+
+      /* check for DLite debugger entry condition */
+      if (dlite_check_break(regs.regs_PC, /* no access */0, /* addr */0, 0, 0))
+	dlite_main(regs.regs_PC, regs.regs_PC + sizeof(md_inst_t),
+		   sim_cycle, &regs, mem);
+
+      /* fast forward simulator loop, performs functional simulation for
+	 FASTFWD_COUNT insts, then turns on performance (timing) simulation */
+      if (fastfwd_count > 0)
+	sim_fastfwd(fastfwd_count);
+
+      /* set up timing simulation entry state */
+      fetch_regs_PC = regs.regs_PC - sizeof(md_inst_t);
+      fetch_pred_PC = regs.regs_PC;
+      if (ftq_size)
+	ftq_flush(regs.regs_PC);
+      regs.regs_PC = regs.regs_PC - sizeof(md_inst_t);
+    }
+
+  /* functional warming counted cache and predictor accesses, start the
+     statistics over */
+  if (fastfwd_count > 0 && fastfwd_warm != 0)
+    stat_clear(sim_sdb);
+
+  /* insts simulated in detail before statistics collection starts */
+  warmup_insts = (warmup_count < 0) ? ld_chkpt_warmup : warmup_count;
+
+  fprintf(stderr, "sim: ** starting performance simulation **\n");
 
   /* main simulator loop, NOTE: the pipe stages are traverse in reverse order
      to eliminate this/next state synchronization and relaxation problems */
@@ -4544,8 +7451,20 @@ sim_main(void)
       /* indicate new cycle in pipetrace */
       ptrace_newcycle(sim_cycle);
 
+      /* a stalled pipeline repeats its last cycle, simulate it once more,
+	 then skip the repeats, pipetraces and DLite need every cycle */
+      skip_until = sim_cycle;
+      if (cycle_skip && !pipe_progress && ptrace_outfd == NULL
+	  && !dlite_check && !dlite_active)
+	{
+	  skip_until = cycle_skip_until();
+	  for (i=0; i < CYCLE_SKIP_NSTALLS; i++)
+	    stalls[i] = *cycle_skip_stalls[i];
+	}
+      pipe_progress = FALSE;
+
       /* commit entries from RUU/LSQ to architected register file */
-      ruu_commit();
+      smt_commit();
 
       /* service function unit release events */
       ruu_release_fu();
@@ -4560,7 +7479,7 @@ sim_main(void)
 	{
 	  /* try to locate memory operations that are ready to execute */
 	  /* ==> inserts operations into ready queue --> mem deps resolved */
-	  lsq_refresh();
+	  smt_refresh();
 
 	  /* issue operations ready to execute from a previous cycle */
 	  /* <== drains ready queue <-- ready operations commence execution */
@@ -4569,13 +7488,13 @@ sim_main(void)
 
       /* decode and dispatch new operations */
       /* ==> insert ops w/ no deps or all regs ready --> reg deps resolved */
-      ruu_dispatch();
+      smt_dispatch();
 
       if (bugcompat_mode)
 	{
 	  /* try to locate memory operations that are ready to execute */
 	  /* ==> inserts operations into ready queue --> mem deps resolved */
-	  lsq_refresh();
+	  smt_refresh();
 
 	  /* issue operations ready to execute from a previous cycle */
 	  /* <== drains ready queue <-- ready operations commence execution */
@@ -4583,24 +7502,32 @@ sim_main(void)
 	}
 
       /* call instruction fetch unit if it is not blocked */
-      if (!ruu_fetch_issue_delay)
-	ruu_fetch();
-      else
-	ruu_fetch_issue_delay--;
+      smt_fetch();
 
-      /* update buffer occupancy stats */
-      IFQ_count += fetch_num;
-      IFQ_fcount += ((fetch_num == ruu_ifq_size) ? 1 : 0);
-      RUU_count += RUU_num;
-      RUU_fcount += ((RUU_num == RUU_size) ? 1 : 0);
-      LSQ_count += LSQ_num;
-      LSQ_fcount += ((LSQ_num == LSQ_size) ? 1 : 0);
+      /* update buffer occupancy stats, over all hardware contexts */
+      occupancy_stats(1);
 
       /* go to next cycle */
       sim_cycle++;
 
+      /* skip the cycles the stalled pipeline only waits through */
+      if (skip_until > sim_cycle && !pipe_progress)
+	cycle_skip_run(skip_until - sim_cycle, stalls);
+
+      /* warm-up done?  statistics count from here on */
+      if (warmup_insts && sim_num_insn >= warmup_insts)
+	{
+	  myfprintf(stderr, "sim: ** warm-up done after %n insts, "
+		    "collecting statistics **\n", sim_num_insn);
+	  stat_clear(sim_sdb);
+	  warmup_insts = 0;
+	}
+
       /* finish early? */
       if (max_insts && sim_num_insn >= max_insts)
-	return;
+	{
+	  smt_switch(0);
+	  return;
+	}
     }
 }
@@ -0,0 +1,325 @@
+#!/usr/bin/perl
+
+#
+# sim-parallel - run sampled sim-outorder windows in parallel
+#
+
+# SimpleScalar(TM) Tool Suite
+# Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+# All Rights Reserved. 
+#
+# THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+# YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+#
+# No portion of this work may be used by any commercial entity, or for any
+# commercial purpose, without the prior, written permission of SimpleScalar,
+# LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+# as described below.
+#
+# 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+# or implied. The user of the program accepts full responsibility for the
+# application of the program and the use of any results.
+#
+# 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+# downloaded, compiled, executed, copied, and modified solely for nonprofit,
+# educational, noncommercial research, and noncommercial scholarship
+# purposes provided that this notice in its entirety accompanies all copies.
+# Copies of the modified software can be delivered to persons who use it
+# solely for nonprofit, educational, noncommercial research, and
+# noncommercial scholarship purposes provided that this notice in its
+# entirety accompanies all copies.
+#
+# 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+# PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+#
+# 4. No nonprofit user may place any restrictions on the use of this software,
+# including as modified by the user, by any other authorized user.
+#
+# 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+# in compiled or executable form as set forth in Section 2, provided that
+# either: (A) it is accompanied by the corresponding machine-readable source
+# code, or (B) it is accompanied by a written offer, with no time limit, to
+# give anyone a machine-readable copy of the corresponding source code in
+# return for reimbursement of the cost of distribution. This written offer
+# must permit verbatim duplication by anyone, or (C) it is distributed by
+# someone who received only the executable form, and is accompanied by a
+# copy of the written offer of source code.
+#
+# 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+# currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+# 2395 Timbercrest Court, Ann Arbor, MI 48105.
+#
+# Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+#
+
+
+#
+# config parms
+#
+$interval = 10000000;		# instructions per detailed window
+$period = 0;			# window spacing, 0 for back to back windows
+$warmup = 0;			# detailed warm-up before each window
+$jobs = 0;			# parallel workers, 0 for one per host CPU
+$fastfwd = 0;			# reach windows with -fastfwd, not checkpoints
+$total = 0;			# program length, 0 to count it with sim-fast
+$workdir = "parallel.work";	# where intermediate files go
+$stdin_file = "";		# program input redirection
+$bindir = $0;			# simulators live next to this script
+$bindir =~ s|/?[^/]*$||;
+$bindir = "." if ($bindir eq "");
+@sim_opts = ();			# extra sim-outorder options
+
+$max_chkpts = 64;		# sim-fast -chkpt:at limit per run
+$max_merge = 1024;		# -stats:merge limit per run
+
+#
+# parse commands
+#
+while (@ARGV && $ARGV[0] =~ /^-/)
+  {
+    $opt = shift(@ARGV);
+    if ($opt eq "-interval") { $interval = shift(@ARGV); }
+    elsif ($opt eq "-period") { $period = shift(@ARGV); }
+    elsif ($opt eq "-warmup") { $warmup = shift(@ARGV); }
+    elsif ($opt eq "-jobs") { $jobs = shift(@ARGV); }
+    elsif ($opt eq "-fastfwd") { $fastfwd = 1; }
+    elsif ($opt eq "-insts") { $total = shift(@ARGV); }
+    elsif ($opt eq "-workdir") { $workdir = shift(@ARGV); }
+    elsif ($opt eq "-stdin") { $stdin_file = shift(@ARGV); }
+    elsif ($opt eq "-bindir") { $bindir = shift(@ARGV); }
+    elsif ($opt eq "-sim") { push(@sim_opts, shift(@ARGV)); }
+    else { @ARGV = (); last; }
+  }
+$period = $interval if ($period == 0);
+if (@ARGV < 1 || $interval <= 0 || $period < $interval || $warmup < 0
+    || $jobs < 0 || $total < 0)
+  {
+     print STDERR
+"Usage: sim-parallel {-options} <program> {<program args>}\n".
+"\n".
+"         Splits a run of <program> into windows of detailed sim-outorder\n".
+"         simulation, one every -period instructions, and simulates them\n".
+"         in parallel worker processes.  Windows are reached through\n".
+"         sim-fast checkpoints, or with -fastfwd by fast forwarding each\n".
+"         worker from the start.  Each worker saves its raw stats, and a\n".
+"         final sim-outorder -stats:merge run sums them into one report,\n".
+"         `<workdir>/merged.sim', with CPI and the other formulas computed\n".
+"         over all windows.  The CPI of each window is printed as well.\n".
+"\n".
+"         Options:\n".
+"           -interval <n>   instructions per window (default $interval)\n".
+"           -period <n>     window spacing (default: back to back)\n".
+"           -warmup <n>     detailed warm-up before each window (default 0)\n".
+"           -jobs <n>       parallel workers (default: one per CPU)\n".
+"           -fastfwd        fast forward instead of using checkpoints\n".
+"           -insts <n>      program length (default: count with sim-fast)\n".
+"           -workdir <dir>  directory for intermediate files\n".
+"                           (default $workdir)\n".
+"           -stdin <file>   program standard input\n".
+"           -bindir <dir>   directory holding the simulators\n".
+"           -sim <opt>      pass <opt> to sim-outorder (mult uses ok)\n".
+"\n".
+"         Example usage:\n".
+"\n".
+"           sim-parallel -jobs 32 -interval 1000000 -period 10000000 \\\n".
+"             -warmup 100000 -sim -config -sim my.cfg gcc cccp.i\n".
+"\n";
+     exit -1;
+  }
+
+@prog = @ARGV;
+$redir = ($stdin_file ne "") ? " < $stdin_file" : "";
+
+# smaller of two numbers
+sub MIN
+  {
+    return ($_[0] < $_[1]) ? $_[0] : $_[1];
+  }
+
+# shell-quote a list of arguments
+sub quote
+  {
+    return join(" ", map { my $a = $_; $a =~ s/'/'\\''/g; "'$a'" } @_);
+  }
+
+# run a list of `command<TAB>output file' jobs, at most $jobs at a time,
+# and die if any of them failed
+sub run_jobs
+  {
+    local(@list) = @_;
+    local($job, $cmd, $out, $pid, %running, $failed);
+
+    $failed = "";
+    foreach $job (@list)
+      {
+	if (scalar(keys %running) >= $jobs)
+	  {
+	    $pid = wait();
+	    $failed = $running{$pid} if ($? != 0);
+	    delete $running{$pid};
+	  }
+	last if ($failed ne "");
+
+	($cmd, $out) = split(/\t/, $job);
+	print STDERR "sim-parallel: $cmd\n";
+	$pid = fork();
+	die "Cannot fork: $!\n" if (!defined($pid));
+	if ($pid == 0)
+	  {
+	    open(STDOUT, ">$out") || die "Cannot open output file: $out\n";
+	    open(STDERR, ">&STDOUT");
+	    exec("/bin/sh", "-c", $cmd);
+	    exit -1;
+	  }
+	$running{$pid} = $job;
+      }
+    while (scalar(keys %running) > 0)
+      {
+	$pid = wait();
+	$failed = $running{$pid} if ($? != 0 && $failed eq "");
+	delete $running{$pid};
+      }
+    if ($failed ne "")
+      {
+	($cmd, $out) = split(/\t/, $failed);
+	print STDERR "** FATAL ** `$cmd' failed, see `$out'\n";
+	exit -1;
+      }
+  }
+
+# value of stat NAME in simulator output file FNAME
+sub stat_value
+  {
+    local($fname, $name) = @_;
+    local($val);
+
+    open(SIM_FILE, $fname) || die "Cannot open simulator output: $fname\n";
+    while (<SIM_FILE>)
+      {
+	$val = $1 if (/^$name\s+([0-9.]+)/);
+      }
+    close(SIM_FILE);
+    if (!defined($val))
+      {
+	print STDERR "** FATAL ** no $name in `$fname'\n";
+	exit -1;
+      }
+    return $val;
+  }
+
+if ($jobs == 0)
+  {
+    $jobs = `getconf _NPROCESSORS_ONLN 2>/dev/null` + 0;
+    $jobs = 1 if ($jobs < 1);
+  }
+if (! -d $workdir)
+  {
+    mkdir($workdir, 0777)
+      || die "Cannot create work directory: $workdir\n";
+  }
+$prog_args = &quote(@prog);
+$opts = &quote(@sim_opts);
+
+#
+# find the windows
+#
+if ($total == 0)
+  {
+    &run_jobs("$bindir/sim-fast -redir:prog $workdir/count.prog "
+	      ."$prog_args$redir\t$workdir/count.out");
+    $total = &stat_value("$workdir/count.out", "sim_num_insn");
+  }
+for ($start=0; $start < $total; $start += $period)
+  {
+    push(@starts, $start);
+  }
+
+#
+# windows too close to the start for a full warm-up are simulated from
+# the beginning, the rest get checkpoints, written by sim-fast runs of
+# up to $max_chkpts checkpoints each, which run in parallel as well
+#
+@jobs = ();
+if (!$fastfwd)
+  {
+    @at = grep { $_ >= $warmup } @starts;
+    for ($c=0; $c * $max_chkpts < @at; $c++)
+      {
+	@chunk = @at[$c * $max_chkpts
+		     .. MIN(($c + 1) * $max_chkpts, scalar(@at)) - 1];
+	for ($i=0; $i < @chunk; $i++)
+	  {
+	    $chkpt{$chunk[$i]} = "$workdir/c$c.".($i + 1).".chk";
+	  }
+	push(@jobs, "$bindir/sim-fast -redir:prog $workdir/c$c.prog "
+	     ."-chkpt:file $workdir/c$c.%d.chk -chkpt:warmup $warmup "
+	     .join(" ", map { "-chkpt:at $_" } @chunk)
+	     ." $prog_args$redir\t$workdir/c$c.out");
+      }
+    &run_jobs(@jobs);
+  }
+
+#
+# simulate the windows
+#
+@jobs = ();
+for ($w=0; $w < @starts; $w++)
+  {
+    $start = $starts[$w];
+    $warm = ($start >= $warmup) ? $warmup : $start;
+    if ($start < $warmup)
+      { $cmd = "-warmup $warm"; }
+    elsif ($fastfwd)
+      { $cmd = "-fastfwd " . ($start - $warm) . " -warmup $warm"; }
+    else
+      { $cmd = "-chkpt $chkpt{$start} -warmup $warm"; }
+    $cmd .= " -max:inst " . ($warm + $interval);
+    push(@jobs, "$bindir/sim-outorder $opts $cmd -redir:sim $workdir/w$w.sim "
+	 ."-redir:prog $workdir/w$w.prog -stats:save $workdir/w$w.stats "
+	 ."$prog_args$redir\t$workdir/w$w.out");
+  }
+&run_jobs(@jobs);
+
+#
+# merge the stats, in rounds if there are more than one run takes
+#
+@files = map { "$workdir/w$_.stats" } (0 .. $#starts);
+for ($round=0; @files > $max_merge; $round++)
+  {
+    @jobs = ();
+    @next = ();
+    for ($c=0; $c * $max_merge < @files; $c++)
+      {
+	@chunk = @files[$c * $max_merge
+			.. MIN(($c + 1) * $max_merge, scalar(@files)) - 1];
+	push(@next, "$workdir/m$round.$c.stats");
+	push(@jobs, "$bindir/sim-outorder $opts "
+	     .join(" ", map { "-stats:merge $_" } @chunk)
+	     ." -stats:save $workdir/m$round.$c.stats "
+	     ."-redir:sim $workdir/m$round.$c.sim $prog_args"
+	     ."\t$workdir/m$round.$c.out");
+      }
+    &run_jobs(@jobs);
+    @files = @next;
+  }
+&run_jobs("$bindir/sim-outorder $opts "
+	  .join(" ", map { "-stats:merge $_" } @files)
+	  ." -redir:sim $workdir/merged.sim $prog_args\t$workdir/merged.out");
+
+#
+# report
+#
+printf "%-8s %12s %12s %12s %10s\n",
+  "window", "start inst", "insts", "cycles", "CPI";
+for ($w=0; $w < @starts; $w++)
+  {
+    $insn = &stat_value("$workdir/w$w.sim", "sim_num_insn");
+    $cycles = &stat_value("$workdir/w$w.sim", "sim_cycle");
+    printf "%-8d %12.0f %12.0f %12.0f %10.4f\n",
+      $w, $starts[$w], $insn, $cycles, $insn ? $cycles / $insn : 0;
+  }
+$insn = &stat_value("$workdir/merged.sim", "sim_num_insn");
+$cycles = &stat_value("$workdir/merged.sim", "sim_cycle");
+printf "%-8s %12s %12.0f %12.0f %10.4f\n",
+  "all", "", $insn, $cycles, &stat_value("$workdir/merged.sim", "sim_CPI");
+print "\nmerged statistics are in `$workdir/merged.sim'\n";
@@ -58,6 +58,7 @@
 #include "machine.h"
 #include "regs.h"
 #include "memory.h"
+#include "predec.h"
 #include "loader.h"
 #include "syscall.h"
 #include "dlite.h"
@@ -77,6 +78,9 @@ static struct regs_t regs;
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
+/* pre-decoded program text */
+static struct predec_t *predec = NULL;
+
 /* track number of refs */
 static counter_t sim_num_refs = 0;
 
@@ -100,6 +104,10 @@ static int prof_taddr /* = FALSE */;
 static int pcstat_nelt = 0;
 static char *pcstat_vars[MAX_PCSTAT_VARS];
 
+/* basic block vector output file name and interval size, in insts */
+static char *bbv_fname;
+static unsigned int bbv_interval;
+
 /* register simulator-specific options */
 void
 sim_reg_options(struct opt_odb_t *odb)
@@ -150,6 +158,25 @@ sim_reg_options(struct opt_odb_t *odb)
 		      "profile stat(s) against text addr's (mult uses ok)",
 		      pcstat_vars, MAX_PCSTAT_VARS, &pcstat_nelt, NULL,
 		      /* !print */FALSE, /* format */NULL, /* accrue */TRUE);
+
+  opt_reg_string(odb, "-bbv:file",
+		 "write basic block vectors to file <fname>",
+		 &bbv_fname, /* default */NULL, /* print */TRUE, NULL);
+
+  opt_reg_uint(odb, "-bbv:interval",
+	       "instructions per basic block vector",
+	       &bbv_interval, /* default */10000000,
+	       /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  With -bbv:file, each -bbv:interval instructions adds one basic block\n"
+"  vector line to the file, in the SimPoint format `T:<id>:<count> ...',\n"
+"  where <id> numbers the basic blocks from 1 in order of first execution\n"
+"  and <count> is the instructions the interval executed in that block.\n"
+"  Interval <n> (from 0) covers instructions <n>*interval up to the next\n"
+"  interval, so its simulation point is reached with sim-fast -chkpt:at\n"
+"  or sim-outorder -fastfwd.  See simpoint.pl and simpoint-run.pl.\n"
+		 );
 }
 
 /* check simulator-specific option values */
@@ -168,6 +195,9 @@ sim_check_options(struct opt_odb_t *odb, int argc, char **argv)
       prof_dsyms = TRUE;
       prof_taddr = TRUE;
     }
+
+  if (bbv_fname && bbv_interval == 0)
+    fatal("basic block vector interval must be non-zero");
 }
 
 /* instruction classes */
@@ -282,6 +312,91 @@ static struct stat_stat_t *pcstat_stats[MAX_PCSTAT_VARS];
 static counter_t pcstat_lastvals[MAX_PCSTAT_VARS];
 static struct stat_stat_t *pcstat_sdists[MAX_PCSTAT_VARS];
 
+/* basic blocks seen by the basic block vector profile, hashed by address */
+struct bbv_block_t {
+  struct bbv_block_t *next;	/* next block in the hash chain */
+  struct bbv_block_t *touched;	/* next block executed in this interval */
+  md_addr_t addr;		/* address of the block's first inst */
+  unsigned int id;		/* vector index, from 1 */
+  counter_t count;		/* insts executed in the block this interval */
+};
+
+#define BBV_HASH_SIZE		4096
+#define BBV_HASH(ADDR)		(((ADDR) >> 3) & (BBV_HASH_SIZE - 1))
+static struct bbv_block_t *bbv_htab[BBV_HASH_SIZE];
+
+/* blocks executed in the current interval */
+static struct bbv_block_t *bbv_touched = NULL;
+
+/* basic block vector output stream */
+static FILE *bbv_fd = NULL;
+
+/* current block's first inst and length so far, insts in this interval */
+static md_addr_t bbv_start;
+static counter_t bbv_len = 0;
+static counter_t bbv_insn = 0;
+
+/* basic block vector stats */
+static counter_t bbv_num_blocks = 0;
+static counter_t bbv_num_vectors = 0;
+
+/* credit the LEN insts of the block at ADDR to the current interval */
+static void
+bbv_credit(md_addr_t addr, counter_t len)
+{
+  struct bbv_block_t *blk;
+  int index = BBV_HASH(addr);
+
+  for (blk = bbv_htab[index]; blk != NULL; blk = blk->next)
+    {
+      if (blk->addr == addr)
+	break;
+    }
+  if (!blk)
+    {
+      blk = (struct bbv_block_t *)calloc(1, sizeof(struct bbv_block_t));
+      if (!blk)
+	fatal("out of virtual memory");
+      blk->addr = addr;
+      blk->id = ++bbv_num_blocks;
+      blk->next = bbv_htab[index];
+      bbv_htab[index] = blk;
+    }
+
+  if (blk->count == 0)
+    {
+      blk->touched = bbv_touched;
+      bbv_touched = blk;
+    }
+  blk->count += len;
+}
+
+/* write the current interval's basic block vector and start a new one */
+static void
+bbv_dump(void)
+{
+  struct bbv_block_t *blk;
+
+  if (bbv_len != 0)
+    {
+      /* the rest of the block counts toward the next interval */
+      bbv_credit(bbv_start, bbv_len);
+      bbv_len = 0;
+    }
+
+  fprintf(bbv_fd, "T");
+  for (blk = bbv_touched; blk != NULL; blk = blk->touched)
+    {
+      myfprintf(bbv_fd, ":%u:%n ", blk->id, blk->count);
+      blk->count = 0;
+    }
+  fprintf(bbv_fd, "\n");
+
+  bbv_touched = NULL;
+  bbv_insn = 0;
+  bbv_num_vectors++;
+}
+
 /* wedge all stat values into a counter_t */
 #define STATVAL(STAT)							\
   ((STAT)->sc == sc_int							\
@@ -485,8 +600,18 @@ sim_reg_stats(struct stat_sdb_t *sdb)
 					/* format */"0x%p %u %.2f",
 					/* print fn */NULL);
     }
+  if (bbv_fname)
+    {
+      stat_reg_counter(sdb, "bbv_num_vectors",
+		       "total full-interval basic block vectors written",
+		       &bbv_num_vectors, 0, NULL);
+      stat_reg_counter(sdb, "bbv_num_blocks",
+		       "total distinct basic blocks executed",
+		       &bbv_num_blocks, 0, NULL);
+    }
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
+  predec_reg_stats(predec, sdb);
 }
 
 /* initialize the simulator */
@@ -526,8 +651,19 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
+  /* keep the program text pre-decoded */
+  predec = predec_create(mem, PREDEC_NENTS);
+
   /* initialize the DLite debugger */
   dlite_init(md_reg_obj, dlite_mem_obj, profile_mstate_obj);
+
+  if (bbv_fname)
+    {
+      bbv_fd = fopen(bbv_fname, "w");
+      if (!bbv_fd)
+	fatal("cannot open basic block vector file `%s'", bbv_fname);
+      bbv_start = regs.regs_PC;
+    }
 }
 
 
@@ -548,7 +684,14 @@ sim_aux_stats(FILE *stream)		/* output stream */
 void
 sim_uninit(void)
 {
-  /* nada */
+  if (bbv_fd)
+    {
+      /* write out the last, partial, interval */
+      if (bbv_insn != 0)
+	bbv_dump();
+      fclose(bbv_fd);
+      bbv_fd = NULL;
+    }
 }
 
 
@@ -641,6 +784,7 @@ void
 sim_main(void)
 {
   int i;
+  struct predec_ent *pd;
   md_inst_t inst;
   register md_addr_t addr;
   register int is_write;
@@ -667,7 +811,8 @@ sim_main(void)
 #endif /* TARGET_ALPHA */
 
       /* get the next instruction to execute */
-      MD_FETCH_INST(inst, mem, regs.regs_PC);
+      pd = PREDEC_LOOKUP(predec, regs.regs_PC);
+      inst = pd->inst;
 
       if (verbose)
 	{
@@ -686,8 +831,8 @@ sim_main(void)
       /* set default fault - none */
       fault = md_fault_none;
 
-      /* decode the instruction */
-      MD_SET_OPCODE(op, inst);
+      /* the instruction is pre-decoded */
+      op = pd->op;
 
       /* execute the instruction */
       switch (op)
@@ -707,17 +852,17 @@ sim_main(void)
 	  panic("attempted to execute a bogus opcode");
       }
 
-      if (MD_OP_FLAGS(op) & F_MEM)
+      if (pd->flags & F_MEM)
 	{
 	  sim_num_refs++;
-	  if (MD_OP_FLAGS(op) & F_STORE)
+	  if (pd->flags & F_STORE)
 	    is_write = TRUE;
 	}
 
       /*
        * profile this instruction
        */
-      flags = MD_OP_FLAGS(op);
+      flags = pd->flags;
 
       if (prof_ic)
 	{
@@ -851,6 +996,22 @@ sim_main(void)
 	  stat_add_sample(taddr_prof, regs.regs_PC);
 	}
 
+      if (bbv_fd)
+	{
+	  /* control insts end a basic block */
+	  bbv_len++;
+	  if (flags & F_CTRL)
+	    {
+	      bbv_credit(bbv_start, bbv_len);
+	      bbv_start = regs.regs_NPC;
+	      bbv_len = 0;
+	    }
+
+	  /* end of the interval? */
+	  if (++bbv_insn == bbv_interval)
+	    bbv_dump();
+	}
+
       /* update any stats tracked by PC */
       for (i=0; i<pcstat_nelt; i++)
 	{
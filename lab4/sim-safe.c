@@ -58,6 +58,7 @@
 #include "machine.h"
 #include "regs.h"
 #include "memory.h"
+#include "predec.h"
 #include "loader.h"
 #include "syscall.h"
 #include "dlite.h"
@@ -78,6 +79,9 @@ static struct regs_t regs;
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
+/* pre-decoded program text */
+static struct predec_t *predec = NULL;
+
 /* track number of refs */
 static counter_t sim_num_refs = 0;
 
@@ -128,6 +132,7 @@ sim_reg_stats(struct stat_sdb_t *sdb)
 		   "sim_num_insn / sim_elapsed_time", NULL);
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
+  predec_reg_stats(predec, sdb);
 }
 
 /* initialize the simulator */
@@ -153,6 +158,9 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
+  /* keep the program text pre-decoded */
+  predec = predec_create(mem, PREDEC_NENTS);
+
   /* initialize the DLite debugger */
   dlite_init(md_reg_obj, dlite_mem_obj, dlite_mstate_obj);
 }
@@ -263,6 +271,7 @@ sim_uninit(void)
 void
 sim_main(void)
 {
+  struct predec_ent *pd;
   md_inst_t inst;
   register md_addr_t addr;
   enum md_opcode op;
@@ -288,7 +297,8 @@ sim_main(void)
 #endif /* TARGET_ALPHA */
 
       /* get the next instruction to execute */
-      MD_FETCH_INST(inst, mem, regs.regs_PC);
+      pd = PREDEC_LOOKUP(predec, regs.regs_PC);
+      inst = pd->inst;
 
       /* keep an instruction count */
       sim_num_insn++;
@@ -299,8 +309,8 @@ sim_main(void)
       /* set default fault - none */
       fault = md_fault_none;
 
-      /* decode the instruction */
-      MD_SET_OPCODE(op, inst);
+      /* the instruction is pre-decoded */
+      op = pd->op;
 
       /* execute the instruction */
       switch (op)
@@ -328,16 +338,16 @@ sim_main(void)
 	  myfprintf(stderr, "%10n [xor: 0x%08x] @ 0x%08p: ",
 		    sim_num_insn, md_xor_regs(&regs), regs.regs_PC);
 	  md_print_insn(inst, regs.regs_PC, stderr);
-	  if (MD_OP_FLAGS(op) & F_MEM)
+	  if (pd->flags & F_MEM)
 	    myfprintf(stderr, "  mem: 0x%08p", addr);
 	  fprintf(stderr, "\n");
 	  /* fflush(stderr); */
 	}
 
-      if (MD_OP_FLAGS(op) & F_MEM)
+      if (pd->flags & F_MEM)
 	{
 	  sim_num_refs++;
-	  if (MD_OP_FLAGS(op) & F_STORE)
+	  if (pd->flags & F_STORE)
 	    is_write = TRUE;
 	}
 
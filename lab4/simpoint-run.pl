@@ -0,0 +1,242 @@
+#!/usr/bin/perl
+
+#
+# simpoint-run - estimate a program's CPI from simulation points
+#
+
+# SimpleScalar(TM) Tool Suite
+# Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+# All Rights Reserved. 
+#
+# THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+# YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+#
+# No portion of this work may be used by any commercial entity, or for any
+# commercial purpose, without the prior, written permission of SimpleScalar,
+# LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+# as described below.
+#
+# 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+# or implied. The user of the program accepts full responsibility for the
+# application of the program and the use of any results.
+#
+# 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+# downloaded, compiled, executed, copied, and modified solely for nonprofit,
+# educational, noncommercial research, and noncommercial scholarship
+# purposes provided that this notice in its entirety accompanies all copies.
+# Copies of the modified software can be delivered to persons who use it
+# solely for nonprofit, educational, noncommercial research, and
+# noncommercial scholarship purposes provided that this notice in its
+# entirety accompanies all copies.
+#
+# 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+# PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+#
+# 4. No nonprofit user may place any restrictions on the use of this software,
+# including as modified by the user, by any other authorized user.
+#
+# 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+# in compiled or executable form as set forth in Section 2, provided that
+# either: (A) it is accompanied by the corresponding machine-readable source
+# code, or (B) it is accompanied by a written offer, with no time limit, to
+# give anyone a machine-readable copy of the corresponding source code in
+# return for reimbursement of the cost of distribution. This written offer
+# must permit verbatim duplication by anyone, or (C) it is distributed by
+# someone who received only the executable form, and is accompanied by a
+# copy of the written offer of source code.
+#
+# 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+# currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+# 2395 Timbercrest Court, Ann Arbor, MI 48105.
+#
+# Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+#
+
+
+#
+# config parms
+#
+$interval = 10000000;		# instructions per interval
+$max_k = 10;			# largest number of clusters tried
+$warmup = 0;			# detailed warm-up before each point
+$fastfwd = 0;			# reach points with -fastfwd, not checkpoints
+$workdir = "simpoint.work";	# where intermediate files go
+$stdin_file = "";		# program input redirection
+$bindir = $0;			# simulators live next to this script
+$bindir =~ s|/?[^/]*$||;
+$bindir = "." if ($bindir eq "");
+@sim_opts = ();			# extra sim-outorder options
+
+#
+# parse commands
+#
+while (@ARGV && $ARGV[0] =~ /^-/)
+  {
+    $opt = shift(@ARGV);
+    if ($opt eq "-interval") { $interval = shift(@ARGV); }
+    elsif ($opt eq "-k") { $max_k = shift(@ARGV); }
+    elsif ($opt eq "-warmup") { $warmup = shift(@ARGV); }
+    elsif ($opt eq "-fastfwd") { $fastfwd = 1; }
+    elsif ($opt eq "-workdir") { $workdir = shift(@ARGV); }
+    elsif ($opt eq "-stdin") { $stdin_file = shift(@ARGV); }
+    elsif ($opt eq "-bindir") { $bindir = shift(@ARGV); }
+    elsif ($opt eq "-sim") { push(@sim_opts, shift(@ARGV)); }
+    else { @ARGV = (); last; }
+  }
+if (@ARGV < 1 || $interval <= 0 || $warmup < 0)
+  {
+     print STDERR
+"Usage: simpoint-run {-options} <program> {<program args>}\n".
+"\n".
+"         Profiles <program> with sim-profile into one basic block vector\n".
+"         per interval, picks simulation points with simpoint, simulates\n".
+"         each point in sim-outorder, and prints the CPI of every point\n".
+"         and the weighted whole-program estimate.  Points are reached\n".
+"         through sim-fast checkpoints, or with -fastfwd by fast\n".
+"         forwarding each sim-outorder run from the start.\n".
+"\n".
+"         Options:\n".
+"           -interval <n>   instructions per interval (default $interval)\n".
+"           -k <n>          most simulation points (default $max_k)\n".
+"           -warmup <n>     detailed warm-up before each point (default 0)\n".
+"           -fastfwd        fast forward instead of using checkpoints\n".
+"           -workdir <dir>  directory for intermediate files\n".
+"                           (default $workdir)\n".
+"           -stdin <file>   program standard input\n".
+"           -bindir <dir>   directory holding the simulators\n".
+"           -sim <opt>      pass <opt> to sim-outorder (mult uses ok)\n".
+"\n".
+"         Example usage:\n".
+"\n".
+"           simpoint-run -interval 1000000 -warmup 100000 \\\n".
+"             -sim -config -sim my.cfg -stdin input.txt anagram words\n".
+"\n";
+     exit -1;
+  }
+
+@prog = @ARGV;
+$redir = ($stdin_file ne "") ? " < $stdin_file" : "";
+
+# run a command, output to a file, and die if it failed
+sub run
+  {
+    local($cmd, $out) = @_;
+
+    print STDERR "simpoint-run: $cmd\n";
+    system("$cmd > $out 2>&1");
+    if ($? != 0)
+      {
+	print STDERR "** FATAL ** `$cmd' failed, see `$out'\n";
+	exit -1;
+      }
+  }
+
+# shell-quote a list of arguments
+sub quote
+  {
+    return join(" ", map { my $a = $_; $a =~ s/'/'\\''/g; "'$a'" } @_);
+  }
+
+if (! -d $workdir)
+  {
+    mkdir($workdir, 0777)
+      || die "Cannot create work directory: $workdir\n";
+  }
+$prog_args = &quote(@prog);
+
+#
+# profile and pick the points
+#
+&run("$bindir/sim-profile -bbv:file $workdir/bbv -bbv:interval $interval "
+     ."$prog_args$redir", "$workdir/profile.out");
+&run("$bindir/simpoint.pl -k $max_k $workdir/bbv $workdir/simpoints "
+     ."$workdir/weights", "$workdir/simpoint.out");
+
+open(SIMPOINTS_FILE, "$workdir/simpoints")
+	|| die "Cannot open simulation points file: $workdir/simpoints\n";
+while (<SIMPOINTS_FILE>)
+  {
+    ($pt, $c) = split;
+    $point{$c} = $pt;
+  }
+close(SIMPOINTS_FILE);
+open(WEIGHTS_FILE, "$workdir/weights")
+	|| die "Cannot open weights file: $workdir/weights\n";
+while (<WEIGHTS_FILE>)
+  {
+    ($w, $c) = split;
+    $weight{$c} = $w;
+  }
+close(WEIGHTS_FILE);
+@clusters = sort { $point{$a} <=> $point{$b} } keys %point;
+
+#
+# points too close to the start for a full warm-up are simulated from
+# the beginning, the rest get checkpoints written in one sim-fast run,
+# numbered from 1 in point order
+#
+if (!$fastfwd)
+  {
+    @at = ();
+    foreach $c (@clusters)
+      {
+	push(@at, "-chkpt:at " . $point{$c} * $interval)
+	  if ($point{$c} * $interval >= $warmup);
+      }
+    if (@at)
+      {
+	&run("$bindir/sim-fast -chkpt:file $workdir/chkpt%d.chk "
+	     ."-chkpt:warmup $warmup @at $prog_args$redir",
+	     "$workdir/chkpt.out");
+      }
+  }
+
+#
+# simulate each point
+#
+$opts = &quote(@sim_opts);
+$n_chkpt = 0;
+$cpi = 0;
+foreach $c (@clusters)
+  {
+    $start = $point{$c} * $interval;
+    $warm = ($start >= $warmup) ? $warmup : $start;
+    if ($start < $warmup)
+      { $cmd = "-warmup $warm"; }
+    elsif ($fastfwd)
+      { $cmd = "-fastfwd " . ($start - $warm) . " -warmup $warm"; }
+    else
+      {
+	$n_chkpt++;
+	$cmd = "-chkpt $workdir/chkpt$n_chkpt.chk -warmup $warm";
+      }
+    $cmd .= " -max:inst " . ($warm + $interval);
+    $out = "$workdir/pt$c.out";
+    &run("$bindir/sim-outorder $opts $cmd -redir:sim $out.sim "
+	 ."$prog_args$redir", $out);
+
+    open(SIM_FILE, "$out.sim") || die "Cannot open simulator output: $out.sim\n";
+    $pt_cpi{$c} = -1;
+    while (<SIM_FILE>)
+      {
+	$pt_cpi{$c} = $1 if (/^sim_CPI\s+([0-9.]+)/);
+      }
+    close(SIM_FILE);
+    if ($pt_cpi{$c} < 0)
+      {
+	print STDERR "** FATAL ** no sim_CPI in `$out.sim'\n";
+	exit -1;
+      }
+    $cpi += $weight{$c} * $pt_cpi{$c};
+  }
+
+#
+# report
+#
+printf "%-8s %12s %10s %10s\n", "point", "start inst", "weight", "CPI";
+foreach $c (@clusters)
+  {
+    printf "%-8d %12.0f %10.6f %10.4f\n",
+      $c, $point{$c} * $interval, $weight{$c}, $pt_cpi{$c};
+  }
+printf "\nestimated CPI %.4f, IPC %.4f\n", $cpi, $cpi ? 1/$cpi : 0;
@@ -0,0 +1,403 @@
+#!/usr/bin/perl
+
+#
+# simpoint - pick simulation points from basic block vectors
+#
+
+# SimpleScalar(TM) Tool Suite
+# Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+# All Rights Reserved. 
+#
+# THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+# YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+#
+# No portion of this work may be used by any commercial entity, or for any
+# commercial purpose, without the prior, written permission of SimpleScalar,
+# LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+# as described below.
+#
+# 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+# or implied. The user of the program accepts full responsibility for the
+# application of the program and the use of any results.
+#
+# 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+# downloaded, compiled, executed, copied, and modified solely for nonprofit,
+# educational, noncommercial research, and noncommercial scholarship
+# purposes provided that this notice in its entirety accompanies all copies.
+# Copies of the modified software can be delivered to persons who use it
+# solely for nonprofit, educational, noncommercial research, and
+# noncommercial scholarship purposes provided that this notice in its
+# entirety accompanies all copies.
+#
+# 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+# PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+#
+# 4. No nonprofit user may place any restrictions on the use of this software,
+# including as modified by the user, by any other authorized user.
+#
+# 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+# in compiled or executable form as set forth in Section 2, provided that
+# either: (A) it is accompanied by the corresponding machine-readable source
+# code, or (B) it is accompanied by a written offer, with no time limit, to
+# give anyone a machine-readable copy of the corresponding source code in
+# return for reimbursement of the cost of distribution. This written offer
+# must permit verbatim duplication by anyone, or (C) it is distributed by
+# someone who received only the executable form, and is accompanied by a
+# copy of the written offer of source code.
+#
+# 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+# currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+# 2395 Timbercrest Court, Ann Arbor, MI 48105.
+#
+# Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+#
+
+
+#
+# config parms
+#
+$max_k = 10;			# largest number of clusters tried
+$dims = 15;			# random projection dimensions
+$seed = 1;			# random number seed
+$n_init = 5;			# k-means runs per k, the best one is kept
+$max_iters = 100;		# k-means iteration limit
+$bic_thresh = 0.9;		# fraction of the BIC range a k must reach
+$short_frac = 0.5;		# intervals shorter than this fraction of the
+				# longest one are not clustered
+
+#
+# parse commands
+#
+while (@ARGV && $ARGV[0] =~ /^-/)
+  {
+    $opt = shift(@ARGV);
+    if ($opt eq "-k") { $max_k = shift(@ARGV); }
+    elsif ($opt eq "-dim") { $dims = shift(@ARGV); }
+    elsif ($opt eq "-seed") { $seed = shift(@ARGV); }
+    elsif ($opt eq "-init") { $n_init = shift(@ARGV); }
+    elsif ($opt eq "-iters") { $max_iters = shift(@ARGV); }
+    elsif ($opt eq "-bic") { $bic_thresh = shift(@ARGV); }
+    elsif ($opt eq "-short") { $short_frac = shift(@ARGV); }
+    else { @ARGV = (); last; }
+  }
+if (@ARGV != 3)
+  {
+     print STDERR
+"Usage: simpoint {-options} <bbv_file> <simpoints_file> <weights_file>\n".
+"\n".
+"         where <bbv_file> holds the basic block vectors written by\n".
+"         sim-profile -bbv:file, one per interval.  The vectors are\n".
+"         normalized, randomly projected down to a few dimensions, and\n".
+"         clustered with k-means for each k up to the limit; the smallest\n".
+"         k whose BIC score reaches the threshold fraction of the range\n".
+"         of scores is picked.  Each cluster is represented by the\n".
+"         interval closest to its centroid, <simpoints_file> gets one\n".
+"         `<interval> <cluster>' line per cluster, and <weights_file> a\n".
+"         `<weight> <cluster>' line, the weight being the cluster's\n".
+"         fraction of all executed instructions.  Intervals count from 0.\n".
+"         An interval much shorter than the longest one, such as the\n".
+"         last, partial interval, is not clustered and never picked, its\n".
+"         instructions count toward the cluster with the nearest centroid.\n".
+"\n".
+"         Options:\n".
+"           -k <n>        most clusters to try (default $max_k)\n".
+"           -dim <n>      random projection dimensions (default $dims)\n".
+"           -seed <n>     random number seed (default $seed)\n".
+"           -init <n>     k-means runs per k (default $n_init)\n".
+"           -iters <n>    k-means iteration limit (default $max_iters)\n".
+"           -bic <f>      BIC score threshold (default $bic_thresh)\n".
+"           -short <f>    shortest clustered interval, as a fraction of\n".
+"                         the longest (default $short_frac)\n".
+"\n".
+"         Example usage:\n".
+"\n".
+"           sim-profile -bbv:file gcc.bbv -bbv:interval 10000000 gcc ...\n".
+"           simpoint gcc.bbv gcc.simpoints gcc.weights\n".
+"\n";
+     exit -1;
+  }
+
+$bbv_file = $ARGV[0];
+$simpoints_file = $ARGV[1];
+$weights_file = $ARGV[2];
+
+srand($seed);
+
+#
+# read the basic block vectors, normalize them, and project them down
+# to $dims dimensions with a random [-1,1] matrix, one row per block
+#
+open(BBV_FILE, $bbv_file)
+	|| die "Cannot open basic block vector file: $bbv_file\n";
+$nall = 0;
+$interval = -1;
+$total_insn = 0;
+$max_insn = 0;
+while (<BBV_FILE>)
+  {
+    next if (!/^T/);
+    $interval++;
+    %vec = ();
+    $sum = 0;
+    while (/:(\d+):(\d+)/g)
+      {
+	$vec{$1} += $2;
+	$sum += $2;
+      }
+    next if ($sum == 0);
+
+    @p = (0) x $dims;
+    foreach $id (sort { $a <=> $b } keys %vec)
+      {
+	if (!defined($proj{$id}))
+	  {
+	    $proj{$id} = [ map { 2*rand() - 1 } (1..$dims) ];
+	  }
+	$row = $proj{$id};
+	$f = $vec{$id} / $sum;
+	for ($j=0; $j < $dims; $j++)
+	  {
+	    $p[$j] += $f * $row->[$j];
+	  }
+      }
+    $all_point[$nall] = [ @p ];
+    $all_insn[$nall] = $sum;
+    $all_num[$nall] = $interval;
+    $total_insn += $sum;
+    $max_insn = $sum if ($sum > $max_insn);
+    $nall++;
+  }
+close(BBV_FILE);
+
+if ($nall == 0)
+  {
+    print STDERR "** FATAL ** no basic block vectors in `$bbv_file'\n";
+    exit -1;
+  }
+
+# set the short intervals aside, they would skew a cluster they represent
+$n = 0;
+@short = ();
+for ($i=0; $i < $nall; $i++)
+  {
+    if ($all_insn[$i] < $short_frac * $max_insn)
+      {
+	push(@short, $i);
+	next;
+      }
+    $point[$n] = $all_point[$i];
+    $insn[$n] = $all_insn[$i];
+    $num[$n] = $all_num[$i];
+    $n++;
+  }
+printf STDERR "%d short interval(s) not clustered\n", scalar(@short)
+  if (@short);
+$max_k = $n if ($max_k > $n);
+
+# squared distance between two projected points
+sub dist2
+  {
+    local($a, $b) = @_;
+    local($d, $j, $t);
+
+    $d = 0;
+    for ($j=0; $j < $dims; $j++)
+      {
+	$t = $a->[$j] - $b->[$j];
+	$d += $t * $t;
+      }
+    return $d;
+  }
+
+# one k-means run from $k randomly picked intervals, returns the
+# distortion, leaves the assignment in @assign and centers in @center
+sub kmeans
+  {
+    local($k) = @_;
+    local($i, $c, $j, $iter, $changed, $best, $bestc, $d, $sse);
+    local(%picked, @count);
+
+    # initial centers, distinct random intervals
+    %picked = ();
+    for ($c=0; $c < $k; $c++)
+      {
+	do { $i = int(rand($n)); } while ($picked{$i});
+	$picked{$i} = 1;
+	$center[$c] = [ @{$point[$i]} ];
+      }
+
+    @assign = (-1) x $n;
+    for ($iter=0; $iter < $max_iters; $iter++)
+      {
+	# assign each interval to its closest center
+	$changed = 0;
+	for ($i=0; $i < $n; $i++)
+	  {
+	    $bestc = 0;
+	    $best = &dist2($point[$i], $center[0]);
+	    for ($c=1; $c < $k; $c++)
+	      {
+		$d = &dist2($point[$i], $center[$c]);
+		if ($d < $best)
+		  {
+		    $best = $d;
+		    $bestc = $c;
+		  }
+	      }
+	    if ($assign[$i] != $bestc)
+	      {
+		$assign[$i] = $bestc;
+		$changed = 1;
+	      }
+	  }
+	last if (!$changed);
+
+	# move each center to the mean of its intervals, an empty
+	# cluster keeps its center
+	@count = (0) x $k;
+	@sum = ();
+	for ($c=0; $c < $k; $c++)
+	  {
+	    $sum[$c] = [ (0) x $dims ];
+	  }
+	for ($i=0; $i < $n; $i++)
+	  {
+	    $c = $assign[$i];
+	    $count[$c]++;
+	    for ($j=0; $j < $dims; $j++)
+	      {
+		$sum[$c]->[$j] += $point[$i]->[$j];
+	      }
+	  }
+	for ($c=0; $c < $k; $c++)
+	  {
+	    next if (!$count[$c]);
+	    for ($j=0; $j < $dims; $j++)
+	      {
+		$center[$c]->[$j] = $sum[$c]->[$j] / $count[$c];
+	      }
+	  }
+      }
+
+    $sse = 0;
+    for ($i=0; $i < $n; $i++)
+      {
+	$sse += &dist2($point[$i], $center[$assign[$i]]);
+      }
+    return $sse;
+  }
+
+# Bayesian information criterion of the clustering in @assign, from the
+# X-means spherical Gaussian likelihood
+sub bic
+  {
+    local($k, $sse) = @_;
+    local($i, $c, $var, $l, @count);
+
+    @count = (0) x $k;
+    for ($i=0; $i < $n; $i++)
+      {
+	$count[$assign[$i]]++;
+      }
+
+    $var = ($n > $k) ? $sse / ($n - $k) : 0;
+    $var = 1e-12 if ($var < 1e-12);
+
+    $l = 0;
+    for ($c=0; $c < $k; $c++)
+      {
+	next if (!$count[$c]);
+	$l += $count[$c] * log($count[$c]) - $count[$c] * log($n)
+	      - $count[$c] / 2 * log(2 * 3.14159265358979)
+	      - $count[$c] * $dims / 2 * log($var);
+      }
+    $l -= ($n - $k) / 2;
+
+    return $l - (($k - 1) + $dims * $k + 1) / 2 * log($n);
+  }
+
+#
+# cluster for each k, keeping the best of $n_init runs
+#
+for ($k=1; $k <= $max_k; $k++)
+  {
+    $best_sse = -1;
+    for ($r=0; $r < $n_init; $r++)
+      {
+	$sse = &kmeans($k);
+	if ($best_sse < 0 || $sse < $best_sse)
+	  {
+	    $best_sse = $sse;
+	    $best_assign[$k] = [ @assign ];
+	    $best_center[$k] = [ map { [ @$_ ] } @center[0..$k-1] ];
+	  }
+      }
+    @assign = @{$best_assign[$k]};
+    $score[$k] = &bic($k, $best_sse);
+    printf STDERR "k = %2d  distortion = %.6f  BIC = %.2f\n",
+      $k, $best_sse, $score[$k];
+  }
+
+# the smallest k that reaches the BIC threshold
+$min_bic = $max_bic = $score[1];
+for ($k=2; $k <= $max_k; $k++)
+  {
+    $min_bic = $score[$k] if ($score[$k] < $min_bic);
+    $max_bic = $score[$k] if ($score[$k] > $max_bic);
+  }
+for ($k=1; $k <= $max_k; $k++)
+  {
+    last if ($score[$k] >= $min_bic + $bic_thresh * ($max_bic - $min_bic));
+  }
+printf STDERR "picked k = %d\n", $k;
+
+#
+# pick each cluster's interval closest to its centroid, and weigh the
+# cluster by its share of executed instructions
+#
+@assign = @{$best_assign[$k]};
+@center = @{$best_center[$k]};
+for ($i=0; $i < $n; $i++)
+  {
+    $c = $assign[$i];
+    $d = &dist2($point[$i], $center[$c]);
+    if (!defined($rep[$c]) || $d < $rep_dist[$c])
+      {
+	$rep[$c] = $i;
+	$rep_dist[$c] = $d;
+      }
+    $weight[$c] += $insn[$i] / $total_insn;
+  }
+
+# short intervals count toward the nearest cluster that got a point
+foreach $i (@short)
+  {
+    $bestc = -1;
+    for ($c=0; $c < $k; $c++)
+      {
+	next if (!defined($rep[$c]));
+	$d = &dist2($all_point[$i], $center[$c]);
+	if ($bestc < 0 || $d < $best)
+	  {
+	    $best = $d;
+	    $bestc = $c;
+	  }
+      }
+    $weight[$bestc] += $all_insn[$i] / $total_insn;
+  }
+
+open(SIMPOINTS_FILE, ">$simpoints_file")
+	|| die "Cannot open simulation points file: $simpoints_file\n";
+open(WEIGHTS_FILE, ">$weights_file")
+	|| die "Cannot open weights file: $weights_file\n";
+$id = 0;
+for ($c=0; $c < $k; $c++)
+  {
+    # empty clusters get no simulation point
+    next if (!defined($rep[$c]));
+    print SIMPOINTS_FILE "$num[$rep[$c]] $id\n";
+    printf WEIGHTS_FILE "%.6f %d\n", $weight[$c], $id;
+    $id++;
+  }
+close(SIMPOINTS_FILE);
+close(WEIGHTS_FILE);
@@ -102,15 +102,18 @@ stat_eval_ident(struct eval_state_t *es)/* an expression evaluator */
       /* FIXME: cast to double, eval package doesn't support long long's */
       val.type = et_double;
 #ifdef _MSC_VER /* FIXME: MSC does not implement qword_t to dbl conversion */
-      val.value.as_double = (double)(sqword_t)*stat->variant.for_qword.var;
+      val.value.as_double = (double)(sqword_t)
+	(*stat->variant.for_qword.var - stat->variant.for_qword.base);
 #else /* !_MSC_VER */
-      val.value.as_double = (double)*stat->variant.for_qword.var;
+      val.value.as_double =
+	(double)(*stat->variant.for_qword.var - stat->variant.for_qword.base);
 #endif /* _MSC_VER */
       break;
     case sc_sqword:
       /* FIXME: cast to double, eval package doesn't support long long's */
       val.type = et_double;
-      val.value.as_double = (double)*stat->variant.for_sqword.var;
+      val.value.as_double =
+	(double)(*stat->variant.for_sqword.var - stat->variant.for_sqword.base);
       break;
 #endif /* HOST_HAS_QWORD */
     case sc_float:
@@ -914,6 +917,225 @@ print_sdist(struct stat_stat_t *stat,	/* stat variable */
   fprintf(fd, "%s.end_dist\n", stat->name);
 }
 
+/* start a new measurement interval in stat database SDB: from here on,
+   counter (qword) stats report their growth since this call, and
+   distributions are emptied; the counter variables themselves are not
+   touched, since simulator state (e.g., page counts) may live in them, and
+   int/uint/float/double stats are levels and are left as is */
+void
+stat_clear(struct stat_sdb_t *sdb)	/* stat database */
+{
+  unsigned int i;
+  struct stat_stat_t *stat;
+  struct bucket_t *bucket, *bucket_next;
+
+  for (stat=sdb->stats; stat != NULL; stat=stat->next)
+    {
+      switch (stat->sc)
+	{
+#ifdef HOST_HAS_QWORD
+	case sc_qword:
+	  stat->variant.for_qword.base = *stat->variant.for_qword.var;
+	  break;
+	case sc_sqword:
+	  stat->variant.for_sqword.base = *stat->variant.for_sqword.var;
+	  break;
+#endif /* HOST_HAS_QWORD */
+	case sc_dist:
+	  for (i=0; i < stat->variant.for_dist.arr_sz; i++)
+	    stat->variant.for_dist.arr[i] = stat->variant.for_dist.init_val;
+	  stat->variant.for_dist.overflows = 0;
+	  break;
+	case sc_sdist:
+	  for (i=0; i<HTAB_SZ; i++)
+	    {
+	      for (bucket = stat->variant.for_sdist.sarr[i];
+		   bucket != NULL;
+		   bucket = bucket_next)
+		{
+		  bucket_next = bucket->next;
+		  free(bucket);
+		}
+	      stat->variant.for_sdist.sarr[i] = NULL;
+	    }
+	  break;
+	default:
+	  /* levels and formulas, nothing to clear */
+	  break;
+	}
+    }
+}
+
+/* write the values of all stats in database SDB to stream FD, in a raw form
+   stat_merge() reads back; formulas are not written, they are evaluated
+   from the merged values */
+void
+stat_save(struct stat_sdb_t *sdb,	/* stat database */
+	  FILE *fd)			/* output stream */
+{
+  unsigned int i, n;
+  struct stat_stat_t *stat;
+  struct bucket_t *bucket;
+
+  for (stat=sdb->stats; stat != NULL; stat=stat->next)
+    {
+      switch (stat->sc)
+	{
+	case sc_int:
+	  fprintf(fd, "%s %d\n", stat->name, *stat->variant.for_int.var);
+	  break;
+	case sc_uint:
+	  fprintf(fd, "%s %u\n", stat->name, *stat->variant.for_uint.var);
+	  break;
+#ifdef HOST_HAS_QWORD
+	case sc_qword:
+	  myfprintf(fd, "%s %n\n", stat->name,
+		    *stat->variant.for_qword.var - stat->variant.for_qword.base);
+	  break;
+	case sc_sqword:
+	  myfprintf(fd, "%s %n\n", stat->name,
+		    *stat->variant.for_sqword.var
+		    - stat->variant.for_sqword.base);
+	  break;
+#endif /* HOST_HAS_QWORD */
+	case sc_float:
+	  fprintf(fd, "%s %.9g\n", stat->name,
+		  (double)*stat->variant.for_float.var);
+	  break;
+	case sc_double:
+	  fprintf(fd, "%s %.17g\n", stat->name, *stat->variant.for_double.var);
+	  break;
+	case sc_dist:
+	  fprintf(fd, "%s %u %u", stat->name, stat->variant.for_dist.arr_sz,
+		  stat->variant.for_dist.overflows);
+	  for (i=0; i < stat->variant.for_dist.arr_sz; i++)
+	    fprintf(fd, " %u", stat->variant.for_dist.arr[i]);
+	  fprintf(fd, "\n");
+	  break;
+	case sc_sdist:
+	  /* bucket count, then <index> <count> pairs */
+	  for (n=0, i=0; i<HTAB_SZ; i++)
+	    for (bucket = stat->variant.for_sdist.sarr[i];
+		 bucket != NULL;
+		 bucket = bucket->next)
+	      n++;
+	  fprintf(fd, "%s %u", stat->name, n);
+	  for (i=0; i<HTAB_SZ; i++)
+	    for (bucket = stat->variant.for_sdist.sarr[i];
+		 bucket != NULL;
+		 bucket = bucket->next)
+	      myfprintf(fd, " 0x%p %u", bucket->index, bucket->count);
+	  fprintf(fd, "\n");
+	  break;
+	default:
+	  /* formulas are evaluated from the merged values */
+	  break;
+	}
+    }
+}
+
+/* merge the stats saved by stat_save() in file FNAME into database SDB,
+   which must hold the same stats, i.e., come from the same simulator and
+   configuration; counters and distributions are summed, int/uint/float/
+   double stats are levels and keep the larger value */
+void
+stat_merge(struct stat_sdb_t *sdb,	/* stat database */
+	   char *fname)			/* file written by stat_save() */
+{
+  FILE *fd;
+  char name[1024];
+  unsigned int i, n, u, count;
+  int d;
+  double f;
+#ifdef HOST_HAS_QWORD
+  sqword_t q;
+#endif /* HOST_HAS_QWORD */
+  unsigned long index;
+  struct stat_stat_t *stat;
+
+  fd = fopen(fname, "r");
+  if (!fd)
+    fatal("cannot open saved stats file `%s'", fname);
+
+  while (fscanf(fd, "%1023s", name) == 1)
+    {
+      stat = stat_find_stat(sdb, name);
+      if (!stat)
+	fatal("stat `%s' in `%s' is not in this simulator's database, "
+	      "were the stats saved with another configuration?", name, fname);
+
+      switch (stat->sc)
+	{
+	case sc_int:
+	  if (fscanf(fd, "%d", &d) != 1)
+	    goto bad;
+	  *stat->variant.for_int.var = MAX(*stat->variant.for_int.var, d);
+	  break;
+	case sc_uint:
+	  if (fscanf(fd, "%u", &u) != 1)
+	    goto bad;
+	  *stat->variant.for_uint.var = MAX(*stat->variant.for_uint.var, u);
+	  break;
+#ifdef HOST_HAS_QWORD
+	case sc_qword:
+	  if (fscanf(fd, "%Ld", &q) != 1)
+	    goto bad;
+	  *stat->variant.for_qword.var += (qword_t)q;
+	  break;
+	case sc_sqword:
+	  if (fscanf(fd, "%Ld", &q) != 1)
+	    goto bad;
+	  *stat->variant.for_sqword.var += q;
+	  break;
+#endif /* HOST_HAS_QWORD */
+	case sc_float:
+	  if (fscanf(fd, "%lf", &f) != 1)
+	    goto bad;
+	  *stat->variant.for_float.var =
+	    MAX(*stat->variant.for_float.var, (float)f);
+	  break;
+	case sc_double:
+	  if (fscanf(fd, "%lf", &f) != 1)
+	    goto bad;
+	  *stat->variant.for_double.var =
+	    MAX(*stat->variant.for_double.var, f);
+	  break;
+	case sc_dist:
+	  if (fscanf(fd, "%u %u", &n, &u) != 2)
+	    goto bad;
+	  if (n != stat->variant.for_dist.arr_sz)
+	    fatal("distribution `%s' in `%s' has %u buckets, not %u",
+		  name, fname, n, stat->variant.for_dist.arr_sz);
+	  stat->variant.for_dist.overflows += u;
+	  for (i=0; i < n; i++)
+	    {
+	      if (fscanf(fd, "%u", &u) != 1)
+		goto bad;
+	      stat->variant.for_dist.arr[i] += u;
+	    }
+	  break;
+	case sc_sdist:
+	  if (fscanf(fd, "%u", &n) != 1)
+	    goto bad;
+	  for (i=0; i < n; i++)
+	    {
+	      if (fscanf(fd, "%lx %u", &index, &count) != 2)
+		goto bad;
+	      stat_add_samples(stat, (md_addr_t)index, count);
+	    }
+	  break;
+	default:
+	  fatal("formula `%s' in saved stats file `%s'", name, fname);
+	}
+    }
+
+  fclose(fd);
+  return;
+
+ bad:
+  fatal("bad value for stat `%s' in saved stats file `%s'", name, fname);
+}
+
 /* print the value of stat variable STAT */
 void
 stat_print_stat(struct stat_sdb_t *sdb,	/* stat database */
@@ -940,7 +1162,8 @@ stat_print_stat(struct stat_sdb_t *sdb,	/* stat database */
 	char buf[128];
 
 	fprintf(fd, "%-22s ", stat->name);
-	mysprintf(buf, stat->format, *stat->variant.for_qword.var);
+	mysprintf(buf, stat->format,
+		  *stat->variant.for_qword.var - stat->variant.for_qword.base);
 	fprintf(fd, "%s # %s", buf, stat->desc);
       }
       break;
@@ -949,7 +1172,8 @@ stat_print_stat(struct stat_sdb_t *sdb,	/* stat database */
 	char buf[128];
 
 	fprintf(fd, "%-22s ", stat->name);
-	mysprintf(buf, stat->format, *stat->variant.for_sqword.var);
+	mysprintf(buf, stat->format,
+		  *stat->variant.for_sqword.var - stat->variant.for_sqword.base);
 	fprintf(fd, "%s # %s", buf, stat->desc);
       }
       break;
@@ -138,11 +138,13 @@ struct stat_stat_t {
     struct stat_for_qword_t {
       qword_t *var;		/* qword integer stat variable */
       qword_t init_val;		/* qword integer value */
+      qword_t base;		/* value at the last stat_clear() */
     } for_qword;
     /* sc == sc_sqword */
     struct stat_for_sqword_t {
       sqword_t *var;		/* signed qword integer stat variable */
       sqword_t init_val;	/* signed qword integer value */
+      sqword_t base;		/* value at the last stat_clear() */
     } for_sqword;
 #endif /* HOST_HAS_QWORD */
     /* sc == sc_float */
@@ -312,6 +314,29 @@ stat_reg_formula(struct stat_sdb_t *sdb,/* stat database */
 		 char *formula,		/* formula expression */
 		 char *format);		/* optional variable output format */
 
+/* start a new measurement interval in stat database SDB: from here on,
+   counter (qword) stats report their growth since this call, and
+   distributions are emptied; the counter variables themselves are not
+   touched, since simulator state (e.g., page counts) may live in them, and
+   int/uint/float/double stats are levels and are left as is */
+void
+stat_clear(struct stat_sdb_t *sdb);	/* stat database */
+
+/* write the values of all stats in database SDB to stream FD, in a raw form
+   stat_merge() reads back; formulas are not written, they are evaluated
+   from the merged values */
+void
+stat_save(struct stat_sdb_t *sdb,	/* stat database */
+	  FILE *fd);			/* output stream */
+
+/* merge the stats saved by stat_save() in file FNAME into database SDB,
+   which must hold the same stats, i.e., come from the same simulator and
+   configuration; counters and distributions are summed, int/uint/float/
+   double stats are levels and keep the larger value */
+void
+stat_merge(struct stat_sdb_t *sdb,	/* stat database */
+	   char *fname);		/* file written by stat_save() */
+
 /* print the value of stat variable STAT */
 void
 stat_print_stat(struct stat_sdb_t *sdb,	/* stat database */
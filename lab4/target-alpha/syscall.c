@@ -1244,7 +1244,10 @@ sys_syscall(struct regs_t *regs,	/* registers to access */
 	
 	/* check for an error condition */
 	if (regs->regs_R[MD_REG_V0] != (qword_t)-1)
-	  regs->regs_R[MD_REG_A3] = 0;
+	  {
+	    eio_fd_open(regs->regs_R[MD_REG_V0], buf, local_flags);
+	    regs->regs_R[MD_REG_A3] = 0;
+	  }
 	else /* got an error, return details */
 	  {
 	    regs->regs_R[MD_REG_A3] = -1;
@@ -1268,7 +1271,10 @@ sys_syscall(struct regs_t *regs,	/* registers to access */
 
       /* check for an error condition */
       if (regs->regs_R[MD_REG_V0] != (qword_t)-1)
-	regs->regs_R[MD_REG_A3] = 0;
+	{
+	  eio_fd_close(regs->regs_R[MD_REG_A0]);
+	  regs->regs_R[MD_REG_A3] = 0;
+	}
       else /* got an error, return details */
 	{
 	  regs->regs_R[MD_REG_A3] = -1;
@@ -1586,7 +1592,10 @@ sys_syscall(struct regs_t *regs,	/* registers to access */
 
       /* check for an error condition */
       if (regs->regs_R[MD_REG_V0] != (qword_t)-1)
-	regs->regs_R[MD_REG_A3] = 0;
+	{
+	  eio_fd_dup(regs->regs_R[MD_REG_A0], regs->regs_R[MD_REG_V0]);
+	  regs->regs_R[MD_REG_A3] = 0;
+	}
       else /* got an error, return details */
 	{
 	  regs->regs_R[MD_REG_A3] = -1;
@@ -2076,7 +2085,10 @@ sys_syscall(struct regs_t *regs,	/* registers to access */
 
       /* check for an error condition */
       if (regs->regs_R[MD_REG_V0] != (qword_t)-1)
-	regs->regs_R[MD_REG_A3] = 0;
+	{
+	  eio_fd_dup(regs->regs_R[MD_REG_A0], regs->regs_R[MD_REG_A1]);
+	  regs->regs_R[MD_REG_A3] = 0;
+	}
       else /* got an error, return details */
 	{
 	  regs->regs_R[MD_REG_A3] = -1;
@@ -98,6 +98,9 @@ md_addr_t ld_stack_min = (md_addr_t)-1;
 /* program file name */
 char *ld_prog_fname = NULL;
 
+/* warm-up instructions recorded in the restored native checkpoint */
+counter_t ld_chkpt_warmup = 0;
+
 /* program entry point (initial PC) */
 md_addr_t ld_prog_entry = 0;
 
@@ -146,6 +149,34 @@ ld_reg_stats(struct stat_sdb_t *sdb)	/* stats data base */
 }
 
 
+/* restore a checkpoint of a native program run over the freshly loaded
+   program, the program's open host files are reopened at their offsets */
+static void
+ld_restore_chkpt(struct regs_t *regs,	/* registers to restore */
+		 struct mem_t *mem)	/* memory space to restore */
+{
+  FILE *chkpt_fd;
+  counter_t icnt = sim_num_insn;
+
+  fprintf(stderr, "sim: loading checkpoint file: %s\n", sim_chkpt_fname);
+
+  if (!eio_valid(sim_chkpt_fname))
+    fatal("file `%s' does not appear to be a checkpoint file",
+	  sim_chkpt_fname);
+
+  chkpt_fd = eio_open(sim_chkpt_fname);
+  eio_read_chkpt(regs, mem, chkpt_fd);
+  ld_chkpt_warmup = eio_read_chkpt_host(chkpt_fd);
+
+  /* simulators start at the program entry */
+  ld_prog_entry = regs->regs_PC;
+
+  /* this run counts its own instructions, starting at the checkpoint */
+  myfprintf(stderr, "sim: restored checkpoint at instruction %n\n",
+	    sim_num_insn);
+  sim_num_insn = icnt;
+}
+
 /* load program text and initialized data into simulated virtual memory
    space and initialize program segment range variables */
 void
@@ -221,9 +252,6 @@ ld_load_prog(char *fname,		/* program to load */
 #endif /* MD_CROSS_ENDIAN */
 
 
-  if (sim_chkpt_fname != NULL)
-    fatal("checkpoints only supported while EIO tracing");
-
 #ifdef BFD_LOADER
 
   {
@@ -663,4 +691,8 @@ ld_load_prog(char *fname,		/* program to load */
 	  fatal("could not write instruction memory");
       }
   }
+
+  /* restore a checkpoint of the program? */
+  if (sim_chkpt_fname != NULL)
+    ld_restore_chkpt(regs, mem);
 }
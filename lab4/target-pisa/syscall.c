@@ -773,7 +773,10 @@ sys_syscall(struct regs_t *regs,	/* registers to access */
 	
 	/* check for an error condition */
 	if (regs->regs_R[2] != -1)
-	  regs->regs_R[7] = 0;
+	  {
+	    eio_fd_open(regs->regs_R[2], buf, local_flags);
+	    regs->regs_R[7] = 0;
+	  }
 	else
 	  {
 	    /* got an error, return details */
@@ -798,7 +801,10 @@ sys_syscall(struct regs_t *regs,	/* registers to access */
 
       /* check for an error condition */
       if (regs->regs_R[2] != -1)
-	regs->regs_R[7] = 0;
+	{
+	  eio_fd_close(regs->regs_R[4]);
+	  regs->regs_R[7] = 0;
+	}
       else
 	{
 	  /* got an error, return details */
@@ -819,7 +825,10 @@ sys_syscall(struct regs_t *regs,	/* registers to access */
 
 	/* check for an error condition */
 	if (regs->regs_R[2] != -1)
-	  regs->regs_R[7] = 0;
+	  {
+	    eio_fd_open(regs->regs_R[2], buf, O_CREAT|O_WRONLY|O_TRUNC);
+	    regs->regs_R[7] = 0;
+	  }
 	else
 	  {
 	    /* got an error, return details */
@@ -1097,7 +1106,10 @@ sys_syscall(struct regs_t *regs,	/* registers to access */
 
       /* check for an error condition */
       if (regs->regs_R[2] != -1)
-	regs->regs_R[7] = 0;
+	{
+	  eio_fd_dup(regs->regs_R[4], regs->regs_R[2]);
+	  regs->regs_R[7] = 0;
+	}
       else
 	{
 	  /* got an error, return details */
@@ -1446,7 +1458,10 @@ sys_syscall(struct regs_t *regs,	/* registers to access */
 
       /* check for an error condition */
       if (regs->regs_R[2] != -1)
-	regs->regs_R[7] = 0;
+	{
+	  eio_fd_dup(regs->regs_R[4], regs->regs_R[5]);
+	  regs->regs_R[7] = 0;
+	}
       else
 	{
 	  /* got an error, return details */
@@ -0,0 +1,316 @@
+/* tcache.c - trace cache model routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "stats.h"
+#include "tcache.h"
+
+/* allocate the instruction arrays of trace LINE */
+static void
+tcache_line_alloc(struct tcache_line_t *line,	/* trace to set up */
+		  int max_insts)		/* most insts per trace */
+{
+  line->PCs = calloc(max_insts, sizeof(md_addr_t));
+  line->insts = calloc(max_insts, sizeof(md_inst_t));
+  if (!line->PCs || !line->insts)
+    fatal("out of virtual memory");
+}
+
+/* create a trace cache of NSETS sets of ASSOC traces, each trace holding at
+   most MAX_INSTS instructions and MAX_BRANCHES conditional branches, with
+   NFILLS fill buffers; NSETS must be a power of two */
+struct tcache_t *			/* trace cache instance */
+tcache_create(int nsets,		/* number of sets */
+	      int assoc,		/* traces per set */
+	      int max_insts,		/* most insts per trace */
+	      int max_branches,		/* most cond branches per trace */
+	      int nfills)		/* fill buffers (hardware contexts) */
+{
+  struct tcache_t *tc;
+  int i;
+
+  /* check all trace cache parameters */
+  if (nsets <= 0 || (nsets & (nsets-1)) != 0)
+    fatal("trace cache sets `%d' must be a positive power of two", nsets);
+  if (assoc <= 0 || assoc > TCACHE_MAX_ASSOC)
+    fatal("trace cache associativity `%d' must be between 1 and %d",
+	  assoc, TCACHE_MAX_ASSOC);
+  if (max_insts <= 0)
+    fatal("trace cache insts per trace `%d' must be positive", max_insts);
+  if (max_branches < 1 || max_branches > sizeof(unsigned int) * 8)
+    fatal("trace cache branches per trace `%d' must be between 1 and %d",
+	  max_branches, (int)(sizeof(unsigned int) * 8));
+  if (nfills <= 0)
+    panic("no trace cache fill buffers");
+
+  tc = calloc(1, sizeof(struct tcache_t));
+  if (!tc)
+    fatal("out of virtual memory");
+
+  tc->nsets = nsets;
+  tc->assoc = assoc;
+  tc->max_insts = max_insts;
+  tc->max_branches = max_branches;
+
+  tc->lines = calloc(nsets * assoc, sizeof(struct tcache_line_t));
+  tc->fills = calloc(nfills, sizeof(struct tcache_line_t));
+  if (!tc->lines || !tc->fills)
+    fatal("out of virtual memory");
+  for (i=0; i < nsets * assoc; i++)
+    tcache_line_alloc(&tc->lines[i], max_insts);
+  for (i=0; i < nfills; i++)
+    tcache_line_alloc(&tc->fills[i], max_insts);
+  tc->nfills = nfills;
+
+  return tc;
+}
+
+/* first trace of the set ADDR maps to in trace cache TC */
+#define TCACHE_SET(TC, ADDR)						\
+  (&(TC)->lines[(((ADDR) / sizeof(md_inst_t)) & ((TC)->nsets - 1))	\
+		* (TC)->assoc])
+
+/* look up the traces starting at ADDR in trace cache TC, fills WAYS (at
+   least TC->ASSOC entries) with them, most recently used first, and
+   returns their number */
+int					/* number of matching traces */
+tcache_lookup(struct tcache_t *tc,	/* trace cache instance */
+	      md_addr_t addr,		/* fetch address */
+	      struct tcache_line_t **ways)	/* matching traces */
+{
+  struct tcache_line_t *set = TCACHE_SET(tc, addr), *line;
+  int i, j, n = 0;
+
+  tc->lookups++;
+
+  for (i=0; i < tc->assoc; i++)
+    {
+      line = &set[i];
+      if (!line->ninsts || line->tag != addr)
+	continue;
+
+      /* insert in most recently used order */
+      for (j=n; j > 0 && ways[j-1]->last_use < line->last_use; j--)
+	ways[j] = ways[j-1];
+      ways[j] = line;
+      n++;
+    }
+
+  return n;
+}
+
+/* record that trace LINE of trace cache TC supplied NINSTS instructions,
+   PARTIAL if fetch left it before its end */
+void
+tcache_hit(struct tcache_t *tc,		/* trace cache instance */
+	   struct tcache_line_t *line,	/* trace fetched from */
+	   int ninsts,			/* insts supplied */
+	   int partial)			/* left the trace early? */
+{
+  tc->hits++;
+  tc->hit_insts += ninsts;
+  if (partial)
+    tc->partial++;
+  line->last_use = ++tc->clock;
+}
+
+/* write the complete trace in fill buffer FB into trace cache TC, unless
+   the same trace is already there */
+static void
+tcache_write(struct tcache_t *tc,	/* trace cache instance */
+	     struct tcache_line_t *fb)	/* complete trace */
+{
+  struct tcache_line_t *set = TCACHE_SET(tc, fb->tag), *line, *victim;
+  md_addr_t *PCs;
+  md_inst_t *insts;
+  int i;
+
+  /* the start address and path name the trace, a trace that also ended at
+     the same point is the same trace */
+  victim = &set[0];
+  for (i=0; i < tc->assoc; i++)
+    {
+      line = &set[i];
+      if (line->ninsts
+	  && line->tag == fb->tag
+	  && line->path == fb->path
+	  && line->nbranches == fb->nbranches
+	  && line->ninsts == fb->ninsts)
+	{
+	  tc->fill_present++;
+	  line->last_use = ++tc->clock;
+	  return;
+	}
+
+      /* replace an invalid trace, else the least recently used one */
+      if (victim->ninsts
+	  && (!line->ninsts || line->last_use < victim->last_use))
+	victim = line;
+    }
+
+  if (victim->ninsts)
+    tc->replacements++;
+  tc->fills_done++;
+  tc->fill_insts += fb->ninsts;
+
+  /* swap the instruction arrays, the fill buffer is reset by the caller */
+  PCs = victim->PCs;
+  insts = victim->insts;
+  *victim = *fb;
+  victim->last_use = ++tc->clock;
+  fb->PCs = PCs;
+  fb->insts = insts;
+}
+
+/* add committed instruction INST at PC, whose successor is NEXT_PC, to fill
+   buffer FILL of trace cache TC, the trace is written into the cache when
+   it is complete */
+void
+tcache_fill(struct tcache_t *tc,	/* trace cache instance */
+	    int fill,			/* fill buffer (hardware context) */
+	    md_addr_t PC,		/* inst address */
+	    md_inst_t inst,		/* committed inst */
+	    enum md_opcode op,		/* decoded opcode */
+	    md_addr_t next_PC)		/* address of the next inst */
+{
+  struct tcache_line_t *fb = &tc->fills[fill];
+
+  if (!fb->ninsts)
+    {
+      /* start a new trace */
+      fb->tag = PC;
+      fb->path = 0;
+      fb->nbranches = 0;
+    }
+
+  fb->PCs[fb->ninsts] = PC;
+  fb->insts[fb->ninsts] = inst;
+  fb->ninsts++;
+
+  if (MD_OP_FLAGS(op) & F_COND)
+    {
+      if (next_PC != PC + sizeof(md_inst_t))
+	fb->path |= 1U << fb->nbranches;
+      fb->nbranches++;
+    }
+
+  /* the trace ends when it is full, or at an inst whose successor it cannot
+     name */
+  if (fb->ninsts == tc->max_insts
+      || fb->nbranches == tc->max_branches
+      || (MD_OP_FLAGS(op) & (F_INDIRJMP|F_TRAP)))
+    {
+      tcache_write(tc, fb);
+      fb->ninsts = 0;
+    }
+}
+
+/* print trace cache configuration */
+void
+tcache_config(struct tcache_t *tc,	/* trace cache instance */
+	      FILE *stream)		/* output stream */
+{
+  fprintf(stream,
+	  "tcache: %d sets, %d traces/set, %d insts/trace, "
+	  "%d cond branches/trace\n",
+	  tc->nsets, tc->assoc, tc->max_insts, tc->max_branches);
+}
+
+/* register trace cache stats, the fill rate is relative to the simulator
+   stat CYCLES_STAT and the fraction of instructions supplied to INSTS_STAT */
+void
+tcache_reg_stats(struct tcache_t *tc,	/* trace cache instance */
+		 struct stat_sdb_t *sdb,	/* stats database */
+		 char *cycles_stat,	/* name of the cycle count stat */
+		 char *insts_stat)	/* name of the fetched inst stat */
+{
+  char buf[512];
+
+  stat_reg_counter(sdb, "tcache.lookups", "total trace cache lookups",
+		   &tc->lookups, 0, NULL);
+  stat_reg_counter(sdb, "tcache.hits", "lookups that supplied instructions",
+		   &tc->hits, 0, NULL);
+  stat_reg_formula(sdb, "tcache.hit_rate",
+		   "trace cache hit rate (i.e., hits/lookups)",
+		   "tcache.hits / tcache.lookups", NULL);
+  stat_reg_counter(sdb, "tcache.partial",
+		   "hits that left the trace before its end",
+		   &tc->partial, 0, NULL);
+  stat_reg_counter(sdb, "tcache.hit_insts",
+		   "instructions supplied by the trace cache",
+		   &tc->hit_insts, 0, NULL);
+  stat_reg_formula(sdb, "tcache.insts_per_hit",
+		   "average instructions supplied per hit",
+		   "tcache.hit_insts / tcache.hits", NULL);
+  sprintf(buf, "tcache.hit_insts / %s", insts_stat);
+  stat_reg_formula(sdb, "tcache.coverage",
+		   "fraction of instructions supplied by the trace cache",
+		   buf, NULL);
+  stat_reg_counter(sdb, "tcache.fills", "traces written by the fill unit",
+		   &tc->fills_done, 0, NULL);
+  stat_reg_counter(sdb, "tcache.fill_insts",
+		   "instructions in the written traces",
+		   &tc->fill_insts, 0, NULL);
+  stat_reg_counter(sdb, "tcache.fill_present",
+		   "completed traces already in the trace cache",
+		   &tc->fill_present, 0, NULL);
+  sprintf(buf, "tcache.fills / %s", cycles_stat);
+  stat_reg_formula(sdb, "tcache.fill_rate",
+		   "traces written per cycle (fill bandwidth)",
+		   buf, NULL);
+  stat_reg_counter(sdb, "tcache.replacements",
+		   "valid traces evicted by a fill",
+		   &tc->replacements, 0, NULL);
+}
@@ -0,0 +1,171 @@
+/* tcache.h - trace cache model interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#ifndef TCACHE_H
+#define TCACHE_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "stats.h"
+
+/*
+ * This module models a trace cache in front of the instruction cache.  A
+ * trace is a run of up to MAX_INSTS committed instructions holding up to
+ * MAX_BRANCHES conditional branches; it may cross any number of taken
+ * branches and jumps, but ends at an indirect jump (which includes
+ * returns) or a trap, whose next address the trace cannot name.
+ *
+ * The fill unit builds traces from the committed instruction stream, one
+ * fill buffer per hardware context, and writes each trace into the set
+ * picked by its start address.  The tag is the start address plus the
+ * branch-path bits, the directions of the trace's conditional branches, so
+ * traces that start at the same address but follow different paths are
+ * held side by side in the set.
+ *
+ * A lookup returns every trace starting at the fetch address, most
+ * recently used first.  The fetch stage follows one while the branch
+ * predictor agrees with it, and may switch to another whose path agrees
+ * further; each fetch from the trace cache is reported back with
+ * tcache_hit(), which makes the trace the most recently used one.
+ */
+
+/* most ways per trace cache set */
+#define TCACHE_MAX_ASSOC	16
+
+/* a trace, a trace cache line or a fill buffer */
+struct tcache_line_t {
+  md_addr_t tag;		/* start address */
+  unsigned int path;		/* branch-path bits, bit I is set if
+				   conditional branch I was taken */
+  int nbranches;		/* conditional branches in the trace */
+  int ninsts;			/* instructions in the trace, 0 if invalid */
+  md_addr_t *PCs;		/* instruction addresses */
+  md_inst_t *insts;		/* decoded instructions */
+  counter_t last_use;		/* time of the last use, for LRU */
+};
+
+/* a trace cache */
+struct tcache_t {
+  /* parameters */
+  int nsets;			/* number of sets */
+  int assoc;			/* traces per set */
+  int max_insts;		/* most instructions per trace */
+  int max_branches;		/* most conditional branches per trace */
+
+  struct tcache_line_t *lines;	/* NSETS * ASSOC traces */
+  struct tcache_line_t *fills;	/* fill buffer per hardware context */
+  int nfills;			/* number of fill buffers */
+  counter_t clock;		/* use counter, orders the traces for LRU */
+
+  /* stats */
+  counter_t lookups;		/* total lookups */
+  counter_t hits;		/* lookups that supplied instructions */
+  counter_t hit_insts;		/* instructions supplied */
+  counter_t partial;		/* hits that left the trace before its end */
+  counter_t fills_done;		/* traces written into the cache */
+  counter_t fill_insts;		/* instructions in the written traces */
+  counter_t fill_present;	/* completed traces already in the cache */
+  counter_t replacements;	/* valid traces evicted by a fill */
+};
+
+/* create a trace cache of NSETS sets of ASSOC traces, each trace holding at
+   most MAX_INSTS instructions and MAX_BRANCHES conditional branches, with
+   NFILLS fill buffers; NSETS must be a power of two */
+struct tcache_t *			/* trace cache instance */
+tcache_create(int nsets,		/* number of sets */
+	      int assoc,		/* traces per set */
+	      int max_insts,		/* most insts per trace */
+	      int max_branches,		/* most cond branches per trace */
+	      int nfills);		/* fill buffers (hardware contexts) */
+
+/* look up the traces starting at ADDR in trace cache TC, fills WAYS (at
+   least TC->ASSOC entries) with them, most recently used first, and
+   returns their number */
+int					/* number of matching traces */
+tcache_lookup(struct tcache_t *tc,	/* trace cache instance */
+	      md_addr_t addr,		/* fetch address */
+	      struct tcache_line_t **ways);	/* matching traces */
+
+/* record that trace LINE of trace cache TC supplied NINSTS instructions,
+   PARTIAL if fetch left it before its end */
+void
+tcache_hit(struct tcache_t *tc,		/* trace cache instance */
+	   struct tcache_line_t *line,	/* trace fetched from */
+	   int ninsts,			/* insts supplied */
+	   int partial);		/* left the trace early? */
+
+/* add committed instruction INST at PC, whose successor is NEXT_PC, to fill
+   buffer FILL of trace cache TC, the trace is written into the cache when
+   it is complete */
+void
+tcache_fill(struct tcache_t *tc,	/* trace cache instance */
+	    int fill,			/* fill buffer (hardware context) */
+	    md_addr_t PC,		/* inst address */
+	    md_inst_t inst,		/* committed inst */
+	    enum md_opcode op,		/* decoded opcode */
+	    md_addr_t next_PC);		/* address of the next inst */
+
+/* print trace cache configuration */
+void
+tcache_config(struct tcache_t *tc,	/* trace cache instance */
+	      FILE *stream);		/* output stream */
+
+/* register trace cache stats, the fill rate is relative to the simulator
+   stat CYCLES_STAT and the fraction of instructions supplied to INSTS_STAT */
+void
+tcache_reg_stats(struct tcache_t *tc,	/* trace cache instance */
+		 struct stat_sdb_t *sdb,	/* stats database */
+		 char *cycles_stat,	/* name of the cycle count stat */
+		 char *insts_stat);	/* name of the fetched inst stat */
+
+#endif /* TCACHE_H */